@@ -34,6 +34,9 @@
 #define CONFIG_GPIO_WATER_LEAK3     26
 #define CONFIG_GPIO_WATER_LEVEL     27
 #define CONFIG_GPIO_DS18B20         32
+// EN: Pulse flow meter input (CONFIG_WATERING_FLOW_METER)
+// RU: Вход импульсного счетчика воды (CONFIG_WATERING_FLOW_METER)
+#define CONFIG_GPIO_FLOW_METER      18
 // EN: Analog inputs
 // RU: Аналоговые входы
 #define CONFIG_GPIO_COIL_MS1        36
@@ -111,6 +114,15 @@
 // EN: Interval of reading data from sensors in milliseconds
 // RU: Интервал чтения данных с сенсоров в миллисекундах
 #define CONFIG_WATERING_TASK_CYCLE 30000
+// EN: Number of watering zones (up to 16). Zone 0 is the main pump and soil sensor, hardware of other zones is described in watering.h
+// RU: Количество зон полива (до 16). Зона 0 - основной насос и датчик почвы, оборудование остальных зон описывается в watering.h
+#define CONFIG_WATERING_ZONES 1
+// EN: Adaptive reading: soil is polled often while watering or near the moisture thresholds and rarely far from them, indoor and heating sensors use their own periods
+// RU: Адаптивный опрос: почва опрашивается часто во время полива и вблизи порогов влажности и редко вдали от них, датчики в помещении и батарей - со своими периодами
+#define CONFIG_WATERING_ADAPTIVE_READ 1
+// EN: Allow the predictive watering mode: the controller learns moisture rise per second of pumping and drying rate, and plans pulses to reach the upper threshold
+// RU: Разрешить упреждающий режим полива: контроллер обучается приросту влажности за секунду работы насоса и скорости высыхания и планирует импульсы до верхнего порога
+#define CONFIG_WATERING_MODEL_ENABLE 1
 // EN: Use static memory allocation for the task and queue. CONFIG_FREERTOS_SUPPORT_STATIC_ALLOCATION must be enabled!
 // RU: Использовать статическое выделение памяти под задачу и очередь. Должен быть включен параметр CONFIG_FREERTOS_SUPPORT_STATIC_ALLOCATION!
 #define CONFIG_WATERING_STATIC_ALLOCATION 1
@@ -124,6 +136,126 @@
 // RU: Процессорное ядро главной задачи
 #define CONFIG_WATERING_TASK_CORE 1
 
+// EN: Pump emergency stop task (leak or low water level): priority must be higher than the main task
+// RU: Задача аварийного отключения насоса (перелив или низкий уровень воды): приоритет должен быть выше главной задачи
+#define CONFIG_WATERING_INTERLOCK_PRIORITY 15
+#define CONFIG_WATERING_INTERLOCK_STACK_SIZE 3*1024
+#define CONFIG_WATERING_INTERLOCK_CORE 1
+
+// EN: Send Telegram notifications from a separate low-priority task: events are put into a lock-free queue, repeated leak flaps are merged into one message
+// RU: Отправлять уведомления в Telegram из отдельной задачи с низким приоритетом: события помещаются в очередь без блокировок, повторные срабатывания датчиков перелива объединяются в одно сообщение
+#define CONFIG_WATERING_NOTIFY_QUEUE 1
+#if CONFIG_WATERING_NOTIFY_QUEUE
+#define CONFIG_WATERING_NOTIFY_QUEUE_SIZE 16
+#define CONFIG_WATERING_NOTIFY_PRIORITY_TASK CONFIG_DEFAULT_TASK_PRIORITY-1
+#define CONFIG_WATERING_NOTIFY_STACK_SIZE 3*1024
+#define CONFIG_WATERING_NOTIFY_CORE 0
+// EN: Leak flaps within this interval (seconds) after a notification are reported as one summary
+// RU: Срабатывания датчика перелива в течение этого интервала (в секундах) после уведомления сводятся в одно сообщение
+#define CONFIG_WATERING_NOTIFY_COALESCE 30
+#endif // CONFIG_WATERING_NOTIFY_QUEUE
+
+// EN: Read sensors on independent buses (RS485, I2C, 1-Wire) simultaneously, each in its own task
+// RU: Читать сенсоры на независимых шинах (RS485, I2C, 1-Wire) одновременно, каждый в своей задаче
+#define CONFIG_WATERING_PARALLEL_READ 1
+#if CONFIG_WATERING_PARALLEL_READ
+// EN: Stack size for the sensor reading tasks
+// RU: Размер стека для задач чтения сенсоров
+#define CONFIG_WATERING_READER_STACK_SIZE 3*1024
+// EN: Maximum time to wait for all sensors to finish reading in milliseconds
+// RU: Максимальное время ожидания завершения чтения всех сенсоров в миллисекундах
+#define CONFIG_WATERING_READER_TIMEOUT 5000
+#endif // CONFIG_WATERING_PARALLEL_READ
+// EN: Interval (in minutes) for saving changed extremums and pump counters to NVS; unchanged data is not written
+// RU: Интервал (в минутах) сохранения изменившихся экстремумов и счётчиков насоса в NVS; неизменные данные не записываются
+#define CONFIG_WATERING_NVS_INTERVAL 30
+// EN: Keep compressed history of readings in RAM and send it to the MQTT broker after the connection is restored
+// RU: Хранить сжатую историю показаний в ОЗУ и отправлять её на MQTT брокер после восстановления связи
+#define CONFIG_WATERING_HISTORY_ENABLE 1
+#if CONFIG_WATERING_HISTORY_ENABLE
+// EN: Interval between history samples in seconds
+// RU: Интервал между записями истории в секундах
+#define CONFIG_WATERING_HISTORY_INTERVAL 30
+#endif // CONFIG_WATERING_HISTORY_ENABLE
+// EN: Journal of leak, water level, pump and sensor status events with microsecond timestamps in RAM, dumped to MQTT by the "journal" command
+// RU: Журнал событий перелива, уровня воды, насоса и состояния сенсоров с микросекундными метками в ОЗУ, выгружается на MQTT командой "journal"
+#define CONFIG_WATERING_JOURNAL 1
+#if CONFIG_WATERING_JOURNAL
+// EN: Number of records, must be a power of two
+// RU: Количество записей, должно быть степенью двойки
+#define CONFIG_WATERING_JOURNAL_SIZE 256
+#endif // CONFIG_WATERING_JOURNAL
+// EN: Modbus soil sensors scheduler: zones that are watering are polled first, slaves that do not respond are retried with exponential backoff
+// RU: Планировщик опроса датчиков почвы Modbus: зоны, где идёт полив, опрашиваются первыми, неотвечающие датчики - с нарастающей паузой
+#define CONFIG_WATERING_MODBUS_SCHEDULER 1
+#if CONFIG_WATERING_MODBUS_SCHEDULER
+// EN: Minimum and maximum pause before polling a failed slave again, in seconds
+// RU: Минимальная и максимальная пауза перед повторным опросом неотвечающего датчика в секундах
+#define CONFIG_WATERING_MODBUS_RETRY_MIN 10
+#define CONFIG_WATERING_MODBUS_RETRY_MAX 600
+#endif // CONFIG_WATERING_MODBUS_SCHEDULER
+// EN: Switch soil sensors to a faster baud rate: at startup the current rate of the sensors is detected and, if it differs, they are reprogrammed
+// RU: Переводить датчики почвы на более высокую скорость: при запуске определяется текущая скорость датчиков и, если она отличается, они перепрограммируются
+#define CONFIG_WATERING_MODBUS_BAUD_SETUP 0
+#if CONFIG_WATERING_MODBUS_BAUD_SETUP
+// EN: Target baud rate: 2400, 4800, 9600, 19200, 38400, 57600 or 115200
+// RU: Целевая скорость: 2400, 4800, 9600, 19200, 38400, 57600 или 115200
+#define CONFIG_WATERING_MODBUS_BAUD 19200
+#endif // CONFIG_WATERING_MODBUS_BAUD_SETUP
+// EN: Measure duration of each phase of the watering task cycle and publish min/avg/max/p99 to the MQTT broker
+// RU: Измерять длительность каждой фазы рабочего цикла полива и публиковать min/avg/max/p99 на MQTT брокере
+#define CONFIG_WATERING_PROFILE 1
+// EN: Periodic MQTT publishing only of changed data: values are compared with the last published ones using per-field deadbands, unchanged messages are repeated no more often than the heartbeat interval
+// RU: Периодическая публикация на MQTT только изменившихся данных: значения сравниваются с последними опубликованными с учетом зоны нечувствительности, неизменные сообщения повторяются не чаще интервала heartbeat
+#define CONFIG_WATERING_MQTT_DEDUP 1
+#if CONFIG_WATERING_MQTT_DEDUP
+// EN: Maximum silence interval in seconds
+// RU: Максимальный интервал без публикации в секундах
+#define CONFIG_WATERING_MQTT_HEARTBEAT 900
+#endif // CONFIG_WATERING_MQTT_DEDUP
+// EN: Heap accounting: attribute heap usage to the sensors, watering, MQTT and Telegram subsystems, track fragmentation and warn before allocations start to fail
+// RU: Учет памяти: распределение занятой кучи по подсистемам (сенсоры, полив, MQTT, Telegram), контроль фрагментации и предупреждение до того, как начнутся ошибки выделения памяти
+#define CONFIG_WATERING_HEAP_ACCOUNTING 1
+#if CONFIG_WATERING_HEAP_ACCOUNTING
+// EN: Warning thresholds: free heap and largest free block in bytes
+// RU: Пороги предупреждения: свободная куча и наибольший свободный блок в байтах
+#define CONFIG_WATERING_HEAP_WARN_FREE 24576
+#define CONFIG_WATERING_HEAP_WARN_BLOCK 8192
+#endif // CONFIG_WATERING_HEAP_ACCOUNTING
+// EN: Water volume accounting: pump on-time is converted into litres using the calibrated flow rate of each zone, totals are kept per day, week, month, billing period and year, the tank level is estimated between refills
+// RU: Учет расхода воды: время работы насоса пересчитывается в литры по откалиброванному расходу каждой зоны, итоги ведутся за сутки, неделю, месяц, отчетный период и год, остаток в баке оценивается между заправками
+#define CONFIG_WATERING_VOLUME 1
+#if CONFIG_WATERING_VOLUME
+// EN: Count water with a pulse flow meter on CONFIG_GPIO_FLOW_METER using the PCNT peripheral instead of the pump on-time
+// RU: Считать воду импульсным счетчиком на CONFIG_GPIO_FLOW_METER с помощью периферии PCNT вместо времени работы насоса
+#define CONFIG_WATERING_FLOW_METER 0
+// EN: Tank estimator: learn the usable tank volume from refill to low level and the daily consumption, publish remaining litres and days to empty
+// RU: Прогноз по баку: обучение полезному объему бака от заправки до низкого уровня и суточному расходу, публикация остатка в литрах и дней до опустошения
+#define CONFIG_WATERING_TANK_ESTIMATOR 1
+#if CONFIG_WATERING_TANK_ESTIMATOR
+// EN: Averaging of the daily consumption, days (exponential moving average)
+// RU: Усреднение суточного расхода, дней (экспоненциальное скользящее среднее)
+#define CONFIG_WATERING_TANK_RATE_DAYS 7
+// EN: Averaging of the usable tank volume, refills
+// RU: Усреднение полезного объема бака, заправок
+#define CONFIG_WATERING_TANK_CAPACITY_CYCLES 3
+#endif // CONFIG_WATERING_TANK_ESTIMATOR
+#endif // CONFIG_WATERING_VOLUME
+// EN: Sensor health scoring (error rate, implausible jumps, stuck values, staleness); a zone whose soil probe is unhealthy is watered by the interval and duration learned from recent watering
+// RU: Оценка исправности сенсоров (доля ошибок, неправдоподобные скачки, залипание, устаревание); зона с неисправным датчиком почвы поливается с интервалом и длительностью, изученными по недавним поливам
+#define CONFIG_WATERING_SENSOR_HEALTH 1
+#if CONFIG_WATERING_SENSOR_HEALTH
+// EN: Number of waterings by a healthy probe required before the learned schedule is used
+// RU: Количество поливов по исправному датчику, после которого можно использовать изученное расписание
+#define CONFIG_WATERING_FALLBACK_SESSIONS 3
+// EN: Averaging of the learned interval and duration, waterings (exponential moving average)
+// RU: Усреднение изученных интервала и длительности, поливов (экспоненциальное скользящее среднее)
+#define CONFIG_WATERING_FALLBACK_WEIGHT 5
+// EN: Intervals between waterings longer than this are not learned (watering was disabled), hours
+// RU: Интервалы между поливами длиннее этого не учитываются (полив был отключен), часов
+#define CONFIG_WATERING_FALLBACK_MAX_INTERVAL 7*24
+#endif // CONFIG_WATERING_SENSOR_HEALTH
+
 // EN: Allow publishing of raw RAW data (no correction or filtering): 0 - only processed value, 1 - always both values, 2 - only when there is processing
 // RU: Разрешить публикацию необработанных RAW-данных (без коррекции и фильтрации): 0 - только обработанное значение, 1 - всегда оба значения, 2 - только когда есть обработка
 #define CONFIG_SENSOR_RAW_ENABLE 1
@@ -283,6 +415,33 @@
 // RU: Сохранять на брокере последние отправленные данные
 #define CONFIG_MQTT_SENSORS_RETAINED 1
 #define CONFIG_MQTT_SENSORS_LOCAL_RETAINED 0
+// EN: Publish all readings, leak and level flags and pump state as one consolidated message instead of separate topics
+// RU: Публиковать все показания, флаги перелива и уровня и состояние насоса одним сводным сообщением вместо отдельных топиков
+#define CONFIG_MQTT_SNAPSHOT_ENABLE 0
+// EN: Encode snapshots, backlog, water leak and water level messages as CBOR with positional fields (COBS framed) instead of JSON
+// RU: Кодировать сводные и отложенные снимки, сообщения о переливе и уровне воды в CBOR с позиционными полями (в обертке COBS) вместо JSON
+#define CONFIG_MQTT_PAYLOAD_CBOR 0
+// EN: Queue sensor snapshots while the broker is unreachable and send them after reconnecting
+// RU: Накапливать снимки показаний, пока брокер недоступен, и отправлять их после подключения
+#define CONFIG_MQTT_BACKLOG_ENABLE 1
+#if CONFIG_MQTT_BACKLOG_ENABLE
+// EN: Queue size (number of snapshots)
+// RU: Размер очереди (количество снимков)
+#define CONFIG_MQTT_BACKLOG_SIZE 64
+// EN: Queue overflow policy: 0 - drop the oldest snapshot, 1 - downsample (keep every second snapshot and halve the rate)
+// RU: Действие при переполнении очереди: 0 - удалить самый старый снимок, 1 - проредить (оставить каждый второй снимок и вдвое реже сохранять новые)
+#define CONFIG_MQTT_BACKLOG_POLICY 1
+// EN: Maximum number of snapshots in one message and minimum interval between messages (ms) when flushing the queue
+// RU: Максимальное количество снимков в одном сообщении и минимальный интервал между сообщениями (мс) при отправке очереди
+#define CONFIG_MQTT_BACKLOG_BATCH 6
+#define CONFIG_MQTT_BACKLOG_INTERVAL 1000
+#endif // CONFIG_MQTT_BACKLOG_ENABLE
+// EN: Buffer size for data sent to open-monitoring.online, narodmon.ru and thingspeak.com (bytes)
+// RU: Размер буфера данных для отправки на open-monitoring.online, narodmon.ru и thingspeak.com (байт)
+#define CONFIG_DSPAYLOAD_SIZE 256
+// EN: Buffer size for all device MQTT topics of one broker; topics are built once per broker (bytes)
+// RU: Размер буфера для всех топиков устройства одного брокера; топики собираются один раз для каждого брокера (байт)
+#define CONFIG_MQTT_TOPICS_ARENA_SIZE 1024
 
 // -----------------------------------------------------------------------------------------------------------------------
 // -------------------------------------- EN - http://open-monitoring.online/ --------------------------------------------
@@ -0,0 +1,121 @@
+#include "cborPayload.h"
+#include <math.h>
+
+#define CBOR_MAJOR_UINT       0x00
+#define CBOR_MAJOR_NINT       0x20
+#define CBOR_MAJOR_ARRAY      0x80
+#define CBOR_FALSE            0xF4
+#define CBOR_TRUE             0xF5
+#define CBOR_NULL             0xF6
+#define CBOR_ARRAY_INDEF      0x9F
+#define CBOR_BREAK            0xFF
+
+static const float cborPow10[] = { 1.0, 10.0, 100.0, 1000.0, 10000.0 };
+#define CBOR_DECIMALS_MAX (sizeof(cborPow10) / sizeof(float) - 1)
+
+void cborInit(cbor_payload_t* cbor, uint8_t* buffer, uint16_t size)
+{
+  cbor->data = buffer;
+  cbor->size = size;
+  cbor->len = 0;
+  cbor->overflow = false;
+}
+
+static bool cborPutByte(cbor_payload_t* cbor, uint8_t value)
+{
+  if (cbor->len < cbor->size) {
+    cbor->data[cbor->len++] = value;
+    return true;
+  };
+  cbor->overflow = true;
+  return false;
+}
+
+// Заголовок элемента: старший тип и аргумент в кратчайшей форме
+static bool cborPutHead(cbor_payload_t* cbor, uint8_t major, uint32_t value)
+{
+  if (value < 24) {
+    return cborPutByte(cbor, major | value);
+  } else if (value <= UINT8_MAX) {
+    return cborPutByte(cbor, major | 24) && cborPutByte(cbor, value);
+  } else if (value <= UINT16_MAX) {
+    return cborPutByte(cbor, major | 25) && cborPutByte(cbor, value >> 8) && cborPutByte(cbor, value);
+  } else {
+    return cborPutByte(cbor, major | 26) 
+      && cborPutByte(cbor, value >> 24) && cborPutByte(cbor, value >> 16) 
+      && cborPutByte(cbor, value >> 8) && cborPutByte(cbor, value);
+  };
+}
+
+bool cborPutUInt(cbor_payload_t* cbor, uint32_t value)
+{
+  return cborPutHead(cbor, CBOR_MAJOR_UINT, value);
+}
+
+bool cborPutInt(cbor_payload_t* cbor, int32_t value)
+{
+  if (value >= 0) {
+    return cborPutHead(cbor, CBOR_MAJOR_UINT, (uint32_t)value);
+  };
+  return cborPutHead(cbor, CBOR_MAJOR_NINT, (uint32_t)(-1 - value));
+}
+
+bool cborPutBool(cbor_payload_t* cbor, bool value)
+{
+  return cborPutByte(cbor, value ? CBOR_TRUE : CBOR_FALSE);
+}
+
+bool cborPutNull(cbor_payload_t* cbor)
+{
+  return cborPutByte(cbor, CBOR_NULL);
+}
+
+bool cborPutFixed(cbor_payload_t* cbor, float value, uint8_t decimals, bool valid)
+{
+  if (!valid || isnan(value)) return cborPutNull(cbor);
+  if (decimals > CBOR_DECIMALS_MAX) decimals = CBOR_DECIMALS_MAX;
+  return cborPutInt(cbor, (int32_t)lroundf(value * cborPow10[decimals]));
+}
+
+bool cborPutArray(cbor_payload_t* cbor, uint16_t count)
+{
+  return cborPutHead(cbor, CBOR_MAJOR_ARRAY, count);
+}
+
+bool cborPutArrayBegin(cbor_payload_t* cbor)
+{
+  return cborPutByte(cbor, CBOR_ARRAY_INDEF);
+}
+
+bool cborPutBreak(cbor_payload_t* cbor)
+{
+  return cborPutByte(cbor, CBOR_BREAK);
+}
+
+size_t cborCobsEncode(const cbor_payload_t* cbor, char* dest, size_t size)
+{
+  if (cbor->overflow || (size < 2)) return 0;
+  // Каждый блок начинается с байта-кода: расстояние до следующего нуля (или 0xFF для блока из 254 байт без нулей)
+  size_t code_pos = 0;
+  size_t out = 1;
+  uint8_t code = 1;
+  for (uint16_t i = 0; i < cbor->len; i++) {
+    if (out + 1 >= size) return 0;
+    if (cbor->data[i] == 0) {
+      dest[code_pos] = code;
+      code_pos = out++;
+      code = 1;
+    } else {
+      dest[out++] = cbor->data[i];
+      if (++code == 0xFF) {
+        dest[code_pos] = code;
+        code_pos = out++;
+        code = 1;
+      };
+    };
+  };
+  if (out >= size) return 0;
+  dest[code_pos] = code;
+  dest[out] = 0;
+  return out;
+}
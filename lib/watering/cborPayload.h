@@ -0,0 +1,46 @@
+#ifndef __CBORPAYLOAD_H__
+#define __CBORPAYLOAD_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Компактное двоичное представление данных для MQTT: CBOR (RFC 8949) с позиционными полями вместо ключей.
+// Дробные значения передаются целыми числами с фиксированным количеством знаков после запятой, NAN - как null.
+// mqttPublish() определяет длину сообщения по strlen(), поэтому готовое сообщение кодируется COBS - в нем
+// не остается нулевых байт (накладные расходы - 1 байт на каждые 254 байта данных)
+
+typedef struct {
+  uint8_t* data;
+  uint16_t size;
+  uint16_t len;
+  bool overflow;
+} cbor_payload_t;
+
+// Размер буфера CBOR, который гарантированно помещается в буфер COBS размером size (с завершающим нулем)
+#define CBOR_COBS_CAPACITY(size) ((size) - (size) / 254 - 2)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void cborInit(cbor_payload_t* cbor, uint8_t* buffer, uint16_t size);
+bool cborPutUInt(cbor_payload_t* cbor, uint32_t value);
+bool cborPutInt(cbor_payload_t* cbor, int32_t value);
+bool cborPutBool(cbor_payload_t* cbor, bool value);
+bool cborPutNull(cbor_payload_t* cbor);
+// Значение * 10^decimals, округленное до целого; NAN или valid = false - null
+bool cborPutFixed(cbor_payload_t* cbor, float value, uint8_t decimals, bool valid);
+bool cborPutArray(cbor_payload_t* cbor, uint16_t count);
+// Массив неизвестной заранее длины, завершается cborPutBreak()
+bool cborPutArrayBegin(cbor_payload_t* cbor);
+bool cborPutBreak(cbor_payload_t* cbor);
+
+// Кодирование COBS в строку; возвращает длину без завершающего нуля или 0, если не хватило места
+size_t cborCobsEncode(const cbor_payload_t* cbor, char* dest, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CBORPAYLOAD_H__
@@ -0,0 +1,54 @@
+#include "cycleProfile.h"
+#include <string.h>
+
+// Номер корзины: значения до CONFIG_PROFILE_SUB_BUCKETS мкс - линейно, далее - старший бит и следующие за ним
+// CONFIG_PROFILE_SUB_BITS бит
+static uint16_t profileBucket(uint32_t us)
+{
+  if (us < CONFIG_PROFILE_SUB_BUCKETS) return us;
+  uint8_t msb = 31 - __builtin_clz(us);
+  uint16_t bucket = (msb - CONFIG_PROFILE_SUB_BITS + 1) * CONFIG_PROFILE_SUB_BUCKETS
+    + ((us >> (msb - CONFIG_PROFILE_SUB_BITS)) & (CONFIG_PROFILE_SUB_BUCKETS - 1));
+  return bucket < CONFIG_PROFILE_BUCKETS ? bucket : CONFIG_PROFILE_BUCKETS - 1;
+}
+
+static uint32_t profileBucketUpper(uint16_t bucket)
+{
+  if (bucket < CONFIG_PROFILE_SUB_BUCKETS) return bucket;
+  uint8_t msb = bucket / CONFIG_PROFILE_SUB_BUCKETS + CONFIG_PROFILE_SUB_BITS - 1;
+  uint32_t sub = bucket % CONFIG_PROFILE_SUB_BUCKETS;
+  uint32_t step = 1U << (msb - CONFIG_PROFILE_SUB_BITS);
+  return (1U << msb) + (sub + 1) * step - 1;
+}
+
+void profileReset(profile_phase_t* phase)
+{
+  memset(phase, 0, sizeof(profile_phase_t));
+  phase->min_us = UINT32_MAX;
+}
+
+void profileAdd(profile_phase_t* phase, uint32_t us)
+{
+  if (phase->count == 0) phase->min_us = UINT32_MAX;
+  phase->count++;
+  phase->sum_us += us;
+  if (us < phase->min_us) phase->min_us = us;
+  if (us > phase->max_us) phase->max_us = us;
+  uint16_t bucket = profileBucket(us);
+  if (phase->hist[bucket] < UINT16_MAX) phase->hist[bucket]++;
+}
+
+uint32_t profilePercentile(const profile_phase_t* phase, uint8_t percent)
+{
+  if (phase->count == 0) return 0;
+  uint32_t rank = (uint32_t)(((uint64_t)phase->count * percent + 99) / 100);
+  uint32_t total = 0;
+  for (uint16_t i = 0; i < CONFIG_PROFILE_BUCKETS; i++) {
+    total += phase->hist[i];
+    if (total >= rank) {
+      uint32_t upper = profileBucketUpper(i);
+      return upper < phase->max_us ? upper : phase->max_us;
+    };
+  };
+  return phase->max_us;
+}
@@ -0,0 +1,38 @@
+#ifndef __CYCLEPROFILE_H__
+#define __CYCLEPROFILE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Статистика длительности одной фазы рабочего цикла в фиксированной памяти. Гистограмма логарифмическая:
+// каждая степень двойки (мкс) делится на CONFIG_PROFILE_SUB_BUCKETS равных частей, поэтому относительная
+// погрешность процентилей не превышает 1 / CONFIG_PROFILE_SUB_BUCKETS
+
+#define CONFIG_PROFILE_SUB_BITS       2
+#define CONFIG_PROFILE_SUB_BUCKETS    (1 << CONFIG_PROFILE_SUB_BITS)
+#define CONFIG_PROFILE_OCTAVES        25      // До 2^25 мкс (~33 с), более длинные фазы попадают в последнюю корзину
+#define CONFIG_PROFILE_BUCKETS        (CONFIG_PROFILE_OCTAVES * CONFIG_PROFILE_SUB_BUCKETS)
+
+typedef struct {
+  uint32_t count;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint64_t sum_us;
+  uint16_t hist[CONFIG_PROFILE_BUCKETS];
+} profile_phase_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void profileReset(profile_phase_t* phase);
+void profileAdd(profile_phase_t* phase, uint32_t us);
+// Верхняя граница корзины, в которую попадает заданный процентиль, мкс
+uint32_t profilePercentile(const profile_phase_t* phase, uint8_t percent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CYCLEPROFILE_H__
@@ -0,0 +1,104 @@
+#include "dsPayload.h"
+#include <string.h>
+#include <math.h>
+
+static const int32_t dsPow10[] = { 1, 10, 100, 1000, 10000, 100000 };
+#define DSPAYLOAD_DECIMALS_MAX (sizeof(dsPow10) / sizeof(int32_t) - 1)
+
+void dsPayloadClear(ds_payload_t* payload)
+{
+  payload->len = 0;
+  payload->overflow = false;
+  payload->data[0] = 0;
+}
+
+static bool dsPayloadPutChar(ds_payload_t* payload, char c)
+{
+  if (payload->len + 1 < CONFIG_DSPAYLOAD_SIZE) {
+    payload->data[payload->len++] = c;
+    return true;
+  };
+  payload->overflow = true;
+  return false;
+}
+
+static bool dsPayloadPutStr(ds_payload_t* payload, const char* str)
+{
+  while (*str) {
+    if (!dsPayloadPutChar(payload, *str++)) return false;
+  };
+  return true;
+}
+
+// Десятичная запись беззнакового числа с дополнением нулями до min_digits
+static bool dsPayloadPutUInt(ds_payload_t* payload, uint32_t value, uint8_t min_digits)
+{
+  char buf[10];
+  uint8_t n = 0;
+  do {
+    buf[n++] = '0' + (value % 10);
+    value = value / 10;
+  } while ((value > 0) && (n < sizeof(buf)));
+  while ((n < min_digits) && (n < sizeof(buf))) {
+    buf[n++] = '0';
+  };
+  while (n > 0) {
+    if (!dsPayloadPutChar(payload, buf[--n])) return false;
+  };
+  return true;
+}
+
+// Начало нового поля: разделитель, ключ и "="
+static bool dsPayloadPutKey(ds_payload_t* payload, const char* key)
+{
+  if ((payload->len > 0) && !dsPayloadPutChar(payload, '&')) return false;
+  return dsPayloadPutStr(payload, key) && dsPayloadPutChar(payload, '=');
+}
+
+// При переполнении поле откатывается целиком, чтобы на сервер не ушло обрезанное значение
+static bool dsPayloadCommit(ds_payload_t* payload, uint16_t start, bool ok)
+{
+  if (!ok) payload->len = start;
+  payload->data[payload->len] = 0;
+  return ok;
+}
+
+bool dsPayloadAddInt(ds_payload_t* payload, const char* key, int32_t value)
+{
+  uint16_t start = payload->len;
+  bool ok = dsPayloadPutKey(payload, key)
+    && ((value >= 0) || dsPayloadPutChar(payload, '-'))
+    && dsPayloadPutUInt(payload, value >= 0 ? (uint32_t)value : (uint32_t)(-(int64_t)value), 1);
+  return dsPayloadCommit(payload, start, ok);
+}
+
+bool dsPayloadAddFloat(ds_payload_t* payload, const char* key, float value, uint8_t decimals)
+{
+  if (isnan(value) || isinf(value)) return false;
+  if (decimals > DSPAYLOAD_DECIMALS_MAX) decimals = DSPAYLOAD_DECIMALS_MAX;
+  if (decimals == 0) return dsPayloadAddInt(payload, key, (int32_t)lroundf(value));
+
+  // Фиксированная точка: округляем до нужного количества знаков и выводим целую и дробную части
+  int64_t scaled = llround((double)value * dsPow10[decimals]);
+  bool negative = scaled < 0;
+  if (negative) scaled = -scaled;
+  uint16_t start = payload->len;
+  bool ok = dsPayloadPutKey(payload, key)
+    && (!negative || dsPayloadPutChar(payload, '-'))
+    && dsPayloadPutUInt(payload, (uint32_t)(scaled / dsPow10[decimals]), 1)
+    && dsPayloadPutChar(payload, '.')
+    && dsPayloadPutUInt(payload, (uint32_t)(scaled % dsPow10[decimals]), decimals);
+  return dsPayloadCommit(payload, start, ok);
+}
+
+bool dsPayloadBuild(ds_payload_t* payload, const ds_payload_field_t* fields, size_t count)
+{
+  float value;
+  dsPayloadClear(payload);
+  for (size_t i = 0; i < count; i++) {
+    if (fields[i].value(&value)) {
+      dsPayloadAddFloat(payload, fields[i].key, value, fields[i].decimals);
+    };
+  };
+  return payload->len > 0;
+}
@@ -0,0 +1,48 @@
+#ifndef __DSPAYLOAD_H__
+#define __DSPAYLOAD_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Формирование данных для внешних сервисов (p1=..&p2=.. или field1=..&field2=..) 
+// в статическом буфере фиксированного размера, без обращений к куче
+
+// Размер буфера задается в project_config.h; значение по умолчанию - только для сборки модуля вне проекта (тесты на хосте)
+#ifdef ESP_PLATFORM
+#include "project_config.h"
+#endif // ESP_PLATFORM
+#ifndef CONFIG_DSPAYLOAD_SIZE
+#define CONFIG_DSPAYLOAD_SIZE 256
+#endif // CONFIG_DSPAYLOAD_SIZE
+
+typedef struct {
+  char data[CONFIG_DSPAYLOAD_SIZE];
+  uint16_t len;
+  bool overflow;
+} ds_payload_t;
+
+// Функция чтения значения поля, возвращает false, если данных нет и поле нужно пропустить
+typedef bool (*cb_payload_value_t) (float* value);
+
+// Описание поля: ключ, количество знаков после запятой (0 - целое) и функция чтения значения
+typedef struct {
+  const char* key;
+  uint8_t decimals;
+  cb_payload_value_t value;
+} ds_payload_field_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void dsPayloadClear(ds_payload_t* payload);
+bool dsPayloadAddInt(ds_payload_t* payload, const char* key, int32_t value);
+bool dsPayloadAddFloat(ds_payload_t* payload, const char* key, float value, uint8_t decimals);
+bool dsPayloadBuild(ds_payload_t* payload, const ds_payload_field_t* fields, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DSPAYLOAD_H__
@@ -0,0 +1,33 @@
+#include "leakScan.h"
+#include <string.h>
+
+void leakScanInit(leak_scan_t* scan)
+{
+  memset(scan, 0, sizeof(leak_scan_t));
+}
+
+uint8_t leakScanProcess(leak_scan_t* scan, uint8_t enabled, uint8_t wet, uint8_t active, 
+  int64_t now, int64_t debounce, uint8_t* cleared)
+{
+  uint8_t set = 0;
+  *cleared = 0;
+  for (uint8_t i = 0; i < CONFIG_LEAK_SCAN_CHANNELS; i++) {
+    uint8_t mask = 1 << i;
+    if (enabled & mask) {
+      if (wet & mask) {
+        // Устанавливаем признак перелива немедленно
+        scan->dry_time[i] = 0;
+        if (!(active & mask)) set |= mask;
+      } else if (active & mask) {
+        // Требуется подтверждение, дабы не было "метаний туда и обратно"
+        if (scan->dry_time[i] == 0) {
+          scan->dry_time[i] = now;
+        } else if ((now - scan->dry_time[i]) >= debounce) {
+          scan->dry_time[i] = 0;
+          *cleared |= mask;
+        };
+      };
+    };
+  };
+  return set;
+}
@@ -0,0 +1,35 @@
+#ifndef __LEAKSCAN_H__
+#define __LEAKSCAN_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Обработка одного опроса датчиков протечки (все входы читаются за один раз, каждый вход - бит маски):
+//   - признак протечки устанавливается немедленно, по первому "мокрому" чтению;
+//   - снимается, только если вход непрерывно остается "сухим" в течение заданного времени.
+// Сами признаки хранятся снаружи (биты группы событий), модуль хранит только моменты начала "сухих" интервалов
+
+#define CONFIG_LEAK_SCAN_CHANNELS   3
+
+typedef struct {
+  int64_t dry_time[CONFIG_LEAK_SCAN_CHANNELS];   // Момент, с которого вход "сухой" при установленном признаке, мкс (0 - нет)
+} leak_scan_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void leakScanInit(leak_scan_t* scan);
+
+// enabled - включенные входы, wet - входы, на которых обнаружена вода, active - входы с установленным признаком протечки,
+// debounce - время подтверждения устранения протечки, мкс. Возвращает входы, для которых признак нужно установить,
+// в cleared - входы, для которых признак нужно снять
+uint8_t leakScanProcess(leak_scan_t* scan, uint8_t enabled, uint8_t wet, uint8_t active, 
+  int64_t now, int64_t debounce, uint8_t* cleared);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __LEAKSCAN_H__
@@ -0,0 +1,66 @@
+#include "modbusBaud.h"
+
+const uint32_t modbusBauds[MODBUS_BAUDS_COUNT] = { 2400, 4800, 9600, 19200, 38400, 57600, 115200 };
+
+int8_t modbusBaudCode(uint32_t baud)
+{
+  for (uint8_t i = 0; i < MODBUS_BAUDS_COUNT; i++) {
+    if (modbusBauds[i] == baud) return i;
+  };
+  return -1;
+}
+
+static uint8_t modbusBaudAppend(uint32_t* candidates, uint8_t count, uint32_t baud)
+{
+  if (modbusBaudCode(baud) < 0) return count;
+  for (uint8_t i = 0; i < count; i++) {
+    if (candidates[i] == baud) return count;
+  };
+  candidates[count] = baud;
+  return count + 1;
+}
+
+uint8_t modbusBaudCandidates(uint32_t saved, uint32_t target, uint32_t factory, uint32_t* candidates)
+{
+  uint8_t count = 0;
+  count = modbusBaudAppend(candidates, count, saved);
+  count = modbusBaudAppend(candidates, count, target);
+  count = modbusBaudAppend(candidates, count, factory);
+  for (uint8_t i = 0; i < MODBUS_BAUDS_COUNT; i++) {
+    count = modbusBaudAppend(candidates, count, modbusBauds[i]);
+  };
+  return count;
+}
+
+modbus_baud_result_t modbusBaudSetupBus(const modbus_baud_bus_t* bus, uint32_t saved, uint32_t target, uint32_t factory,
+  uint32_t* detected, uint32_t* current)
+{
+  uint32_t candidates[MODBUS_BAUD_CANDIDATES_MAX];
+  uint8_t count = modbusBaudCandidates(saved, target, factory, candidates);
+  *detected = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (bus->probe(candidates[i])) {
+      *detected = candidates[i];
+      break;
+    };
+  };
+  if (*detected == 0) {
+    bus->uart(factory);
+    *current = factory;
+    return MODBUS_BAUD_NOT_FOUND;
+  };
+
+  *current = *detected;
+  if (*detected == target) return MODBUS_BAUD_KEPT;
+  bus->write(target);
+  if (bus->probe(target)) {
+    *current = target;
+    return MODBUS_BAUD_SWITCHED;
+  };
+  // Часть датчиков могла переключиться сразу, остальные - только после перезапуска питания:
+  // возвращаем прежний код скорости и тем, и другим
+  bus->write(*detected);
+  bus->uart(*detected);
+  bus->write(*detected);
+  return bus->probe(*detected) ? MODBUS_BAUD_ROLLED_BACK : MODBUS_BAUD_LOST;
+}
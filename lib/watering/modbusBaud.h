@@ -0,0 +1,57 @@
+#ifndef __MODBUSBAUD_H__
+#define __MODBUSBAUD_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Скорости шины, поддерживаемые датчиками почвы CWT: индекс в таблице - код скорости в регистре настройки датчика
+
+#define MODBUS_BAUDS_COUNT          7
+#define MODBUS_BAUD_CANDIDATES_MAX  (3 + MODBUS_BAUDS_COUNT)
+
+// Обращения к шине при настройке скорости
+typedef bool (*cb_baud_probe_t) (uint32_t baud);     // UART переключается на baud, все датчики отвечают
+typedef bool (*cb_baud_write_t) (uint32_t baud);     // Запись кода скорости во все датчики на текущей скорости UART
+typedef void (*cb_baud_uart_t) (uint32_t baud);      // Только переключение UART
+
+typedef struct {
+  cb_baud_probe_t probe;
+  cb_baud_write_t write;
+  cb_baud_uart_t  uart;
+} modbus_baud_bus_t;
+
+typedef enum {
+  MODBUS_BAUD_NOT_FOUND = 0,        // Датчики не отвечают ни на одной скорости
+  MODBUS_BAUD_KEPT,                 // Датчики уже работают на целевой скорости
+  MODBUS_BAUD_SWITCHED,             // Датчики переведены на целевую скорость
+  MODBUS_BAUD_ROLLED_BACK,          // На целевой скорости датчики не ответили и возвращены на прежнюю
+  MODBUS_BAUD_LOST                  // После возврата на прежнюю скорость отвечают не все датчики
+} modbus_baud_result_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const uint32_t modbusBauds[MODBUS_BAUDS_COUNT];
+
+// Код скорости или -1, если скорость не поддерживается
+int8_t modbusBaudCode(uint32_t baud);
+
+// Порядок проверки скоростей при определении текущей скорости датчиков: последняя рабочая скорость, целевая, 
+// заводская, затем все остальные; неподдерживаемые скорости и повторы пропускаются. Возвращает количество скоростей
+uint8_t modbusBaudCandidates(uint32_t saved, uint32_t target, uint32_t factory, uint32_t* candidates);
+
+// Определение текущей скорости датчиков и перевод их на целевую скорость: скорости проверяются в порядке
+// modbusBaudCandidates(), если после перепрограммирования датчики не отвечают на целевой скорости, им возвращается
+// прежний код скорости - сначала на целевой скорости (датчики, переключившиеся сразу), затем на прежней (датчики,
+// которые переключатся только после перезапуска питания). Если датчики не найдены, UART остается на заводской скорости.
+// В current - скорость, на которой шина работает после настройки, в detected - найденная скорость датчиков (0 - не найдены)
+modbus_baud_result_t modbusBaudSetupBus(const modbus_baud_bus_t* bus, uint32_t saved, uint32_t target, uint32_t factory,
+  uint32_t* detected, uint32_t* current);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MODBUSBAUD_H__
@@ -0,0 +1,68 @@
+#include "modbusSchedule.h"
+
+void modbusBusInit(modbus_bus_t* bus, uint32_t retry_min, uint32_t retry_max)
+{
+  bus->retry_min = retry_min;
+  bus->retry_max = retry_max;
+  bus->window_start = 0;
+  bus->busy_time = 0;
+}
+
+uint8_t modbusScheduleOrder(modbus_bus_t* bus, modbus_slave_t* slaves, uint8_t count, 
+  uint32_t present, uint32_t active, int64_t now, uint8_t* order)
+{
+  if (bus->window_start == 0) bus->window_start = now;
+  if (count > CONFIG_MODBUS_SLAVES_MAX) count = CONFIG_MODBUS_SLAVES_MAX;
+  uint8_t n = 0;
+  for (uint8_t pass = 0; pass < 2; pass++) {
+    for (uint8_t i = 0; i < count; i++) {
+      uint32_t mask = 1UL << i;
+      if (!(present & mask)) continue;
+      bool isActive = (active & mask) != 0;
+      if (isActive != (pass == 0)) continue;
+      if (!isActive && (now < slaves[i].retry_at)) {
+        slaves[i].skipped++;
+        continue;
+      };
+      order[n++] = i;
+    };
+  };
+  return n;
+}
+
+void modbusSlaveDone(modbus_bus_t* bus, modbus_slave_t* slave, bool ok, int64_t started, int64_t finished)
+{
+  uint32_t latency = (uint32_t)(finished - started);
+  slave->requests++;
+  slave->latency_last = latency;
+  slave->latency_sum += latency;
+  if (latency > slave->latency_max) slave->latency_max = latency;
+  bus->busy_time += latency;
+  if (ok) {
+    slave->failures = 0;
+    slave->retry_at = 0;
+  } else {
+    slave->errors++;
+    if (slave->failures < UINT8_MAX) slave->failures++;
+    uint32_t pause = bus->retry_max;
+    if (slave->failures <= 16) {
+      uint32_t backoff = bus->retry_min << (slave->failures - 1);
+      if (backoff < pause) pause = backoff;
+    };
+    slave->retry_at = finished + (int64_t)pause * 1000000LL;
+  };
+}
+
+float modbusBusUtilization(const modbus_bus_t* bus, int64_t now)
+{
+  if ((bus->window_start > 0) && (now > bus->window_start)) {
+    return 100.0 * (float)bus->busy_time / (float)(now - bus->window_start);
+  };
+  return 0.0;
+}
+
+void modbusBusWindowReset(modbus_bus_t* bus, int64_t now)
+{
+  bus->window_start = now;
+  bus->busy_time = 0;
+}
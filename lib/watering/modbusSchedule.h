@@ -0,0 +1,56 @@
+#ifndef __MODBUSSCHEDULE_H__
+#define __MODBUSSCHEDULE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Планировщик опроса датчиков на одной линии Modbus RTU. Транзакции выполняются строго по очереди, поэтому 
+// планировщик управляет только порядком и пропусками: сначала датчики зон, где идёт полив (их показания нужны 
+// для управления, пауза после ошибок для них не действует), затем остальные, кроме датчиков, для которых ещё 
+// не истекла пауза после ошибок. Пауза удваивается с каждой ошибкой подряд: retry_min, 2 * retry_min, ... до retry_max
+
+#define CONFIG_MODBUS_SLAVES_MAX    32      // Датчики задаются битовыми масками
+
+// Состояние и статистика одного датчика на шине
+typedef struct {
+  uint8_t  failures;        // Ошибок подряд
+  int64_t  retry_at;        // Время, раньше которого неотвечающий датчик не опрашивается, мкс
+  uint32_t requests;        // Выполнено опросов
+  uint32_t errors;          // Из них с ошибкой
+  uint32_t skipped;         // Пропущено опросов из-за паузы после ошибок
+  uint32_t latency_last;    // Длительность опроса, мкс
+  uint32_t latency_max;
+  uint64_t latency_sum;
+} modbus_slave_t;
+
+typedef struct {
+  uint32_t retry_min;       // Пауза перед повторным опросом после ошибки, с
+  uint32_t retry_max;
+  int64_t  window_start;    // Начало окна расчета загрузки шины, мкс
+  uint64_t busy_time;       // Время занятости шины в текущем окне, мкс
+} modbus_bus_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void modbusBusInit(modbus_bus_t* bus, uint32_t retry_min, uint32_t retry_max);
+
+// Очередь опроса на момент now: present - датчики на шине, active - датчики зон, где идёт полив.
+// Заполняет order номерами датчиков в порядке опроса и возвращает их количество; пропущенные датчики учитываются в skipped
+uint8_t modbusScheduleOrder(modbus_bus_t* bus, modbus_slave_t* slaves, uint8_t count, 
+  uint32_t present, uint32_t active, int64_t now, uint8_t* order);
+
+// Результат одного опроса: статистика, занятость шины и пауза после ошибки
+void modbusSlaveDone(modbus_bus_t* bus, modbus_slave_t* slave, bool ok, int64_t started, int64_t finished);
+
+// Загрузка шины с начала окна, %; modbusBusWindowReset() начинает новое окно
+float modbusBusUtilization(const modbus_bus_t* bus, int64_t now);
+void modbusBusWindowReset(modbus_bus_t* bus, int64_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MODBUSSCHEDULE_H__
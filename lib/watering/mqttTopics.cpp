@@ -0,0 +1,30 @@
+#include "mqttTopics.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool mqttTopicsBuild(mqtt_topics_t* table, bool primary, const char* const* names, uint8_t count, cb_topic_create_t create)
+{
+  if (table->ready) return true;
+  if (count > CONFIG_MQTT_TOPICS_MAX) count = CONFIG_MQTT_TOPICS_MAX;
+  bool ok = true;
+  for (uint8_t i = 0; i < count; i++) {
+    // Топики, собранные при прошлых попытках, остаются на своих местах в арене
+    if (table->topics[i]) continue;
+    char* topic = create(primary, false, names[i]);
+    if (topic) {
+      size_t len = strlen(topic) + 1;
+      if (table->used + len <= sizeof(table->arena)) {
+        memcpy(table->arena + table->used, topic, len);
+        table->topics[i] = table->arena + table->used;
+        table->used += len;
+      } else {
+        ok = false;
+      };
+      free(topic);
+    } else {
+      ok = false;
+    };
+  };
+  table->ready = ok;
+  return ok;
+}
@@ -0,0 +1,48 @@
+#ifndef __MQTTTOPICS_H__
+#define __MQTTTOPICS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Таблица топиков устройства для одного брокера. Топики собираются один раз в общий буфер (арену) и больше
+// не меняются, поэтому указатели на них остаются действительными все время работы, а публикация не требует
+// выделения памяти под топик. Память кучи нужна только при сборке - под временную строку от функции создания топика
+// Размер арены задается в project_config.h; значение по умолчанию - только для сборки модуля вне проекта (тесты на хосте)
+
+#ifdef ESP_PLATFORM
+#include "project_config.h"
+#endif // ESP_PLATFORM
+
+#ifndef CONFIG_MQTT_TOPICS_ARENA_SIZE
+#define CONFIG_MQTT_TOPICS_ARENA_SIZE 1024
+#endif // CONFIG_MQTT_TOPICS_ARENA_SIZE
+
+#define CONFIG_MQTT_TOPICS_MAX      16      // Топиков в одной таблице
+
+// Функция создания топика: возвращает строку в куче (освобождается через free()) или nullptr,
+// совпадает с mqttGetTopicDevice1() из библиотеки reMqtt
+typedef char* (*cb_topic_create_t) (bool primary, bool local, const char* topic);
+
+typedef struct {
+  char     arena[CONFIG_MQTT_TOPICS_ARENA_SIZE];
+  char*    topics[CONFIG_MQTT_TOPICS_MAX];
+  uint16_t used;          // Занято в арене, байт
+  bool     ready;
+} mqtt_topics_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Сборка топиков names[0..count) для брокера; таблица перед первой сборкой должна быть обнулена.
+// Возвращает false, если какой-либо топик не создан или не поместился в арену (его указатель - nullptr):
+// такая таблица не считается готовой, и при следующем вызове досоздаются только недостающие топики.
+// Полностью собранная таблица не пересобирается
+bool mqttTopicsBuild(mqtt_topics_t* table, bool primary, const char* const* names, uint8_t count, cb_topic_create_t create);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTTTOPICS_H__
@@ -0,0 +1,205 @@
+#include "sensorFilter.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// -----------------------------------------------------------------------------------------------------------------------
+// -------------------------------------------------------- Медиана ------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+// Количество значений в max-куче (меньшие) и в min-куче (большие), не считая медианы
+#define SFILTER_MAX_COUNT(f) (((f)->count) / 2)
+#define SFILTER_MIN_COUNT(f) (((f)->count - 1) / 2)
+
+static inline bool sfilterLess(sfilter_t* f, int16_t i, int16_t j)
+{
+  return f->data[f->heap[i]] < f->data[f->heap[j]];
+}
+
+static inline bool sfilterExchange(sfilter_t* f, int16_t i, int16_t j)
+{
+  int16_t t = f->heap[i];
+  f->heap[i] = f->heap[j];
+  f->heap[j] = t;
+  f->pos[f->heap[i]] = i;
+  f->pos[f->heap[j]] = j;
+  return true;
+}
+
+static inline bool sfilterCmpExch(sfilter_t* f, int16_t i, int16_t j)
+{
+  return sfilterLess(f, i, j) && sfilterExchange(f, i, j);
+}
+
+static void sfilterMinSortDown(sfilter_t* f, int16_t i)
+{
+  for (; i <= SFILTER_MIN_COUNT(f); i *= 2) {
+    if ((i > 1) && (i < SFILTER_MIN_COUNT(f)) && sfilterLess(f, i + 1, i)) i++;
+    if (!sfilterCmpExch(f, i, i / 2)) break;
+  };
+}
+
+static void sfilterMaxSortDown(sfilter_t* f, int16_t i)
+{
+  for (; i >= -SFILTER_MAX_COUNT(f); i *= 2) {
+    if ((i < -1) && (i > -SFILTER_MAX_COUNT(f)) && sfilterLess(f, i, i - 1)) i--;
+    if (!sfilterCmpExch(f, i / 2, i)) break;
+  };
+}
+
+// Возвращают true, если значение поднялось до медианы
+static bool sfilterMinSortUp(sfilter_t* f, int16_t i)
+{
+  while ((i > 0) && sfilterCmpExch(f, i, i / 2)) i /= 2;
+  return i == 0;
+}
+
+static bool sfilterMaxSortUp(sfilter_t* f, int16_t i)
+{
+  while ((i < 0) && sfilterCmpExch(f, i / 2, i)) i /= 2;
+  return i == 0;
+}
+
+static float sfilterMedian(sfilter_t* f, float value)
+{
+  bool added = f->count < f->size;
+  int16_t p = f->pos[f->index];
+  float old = f->data[f->index];
+  f->data[f->index] = value;
+  if (++f->index >= f->size) f->index = 0;
+  if (added) f->count++;
+
+  if (p > 0) {
+    // Значение в min-куче
+    if (!added && (old < value)) {
+      sfilterMinSortDown(f, p * 2);
+    } else if (sfilterMinSortUp(f, p)) {
+      sfilterMaxSortDown(f, -1);
+    };
+  } else if (p < 0) {
+    // Значение в max-куче
+    if (!added && (value < old)) {
+      sfilterMaxSortDown(f, p * 2);
+    } else if (sfilterMaxSortUp(f, p)) {
+      sfilterMinSortDown(f, 1);
+    };
+  } else {
+    // Значение на месте медианы
+    if (SFILTER_MAX_COUNT(f) > 0) sfilterMaxSortDown(f, -1);
+    if (SFILTER_MIN_COUNT(f) > 0) sfilterMinSortDown(f, 1);
+  };
+
+  float median = f->data[f->heap[0]];
+  if ((f->count & 1) == 0) {
+    median = (median + f->data[f->heap[-1]]) / 2;
+  };
+  return median;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------- Среднее и EMA ----------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+static float sfilterMean(sfilter_t* f, float value)
+{
+  if (f->count < f->size) {
+    f->count++;
+  } else {
+    f->sum -= f->data[f->index];
+  };
+  f->data[f->index] = value;
+  f->sum += value;
+  if (++f->index >= f->size) {
+    f->index = 0;
+    // Раз в окно пересчитываем сумму заново, чтобы не накапливалась ошибка округления
+    f->sum = 0;
+    for (uint16_t i = 0; i < f->count; i++) {
+      f->sum += f->data[i];
+    };
+  };
+  return (float)(f->sum / f->count);
+}
+
+static float sfilterEma(sfilter_t* f, float value)
+{
+  if (f->count == 0) {
+    f->count = 1;
+    f->ema = value;
+  } else {
+    f->ema += 2.0f / (f->size + 1) * (value - f->ema);
+  };
+  return f->ema;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// -------------------------------------------------------- Фильтр -------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+void sfilterReset(sfilter_t* filter)
+{
+  filter->count = 0;
+  filter->index = 0;
+  filter->sum = 0;
+  filter->ema = NAN;
+  if (filter->mode == SFILTER_MEDIAN) {
+    // Начальная раскладка: медиана, max-куча, min-куча, max-куча, ...
+    for (int16_t i = filter->size - 1; i >= 0; i--) {
+      filter->pos[i] = ((i + 1) / 2) * ((i & 1) ? -1 : 1);
+      filter->heap[filter->pos[i]] = i;
+    };
+  };
+}
+
+void sfilterFree(sfilter_t* filter)
+{
+  if (filter->data) free(filter->data);
+  if (filter->pos) free(filter->pos);
+  if (filter->heap) free(filter->heap - filter->size / 2);
+  filter->data = nullptr;
+  filter->pos = nullptr;
+  filter->heap = nullptr;
+  filter->mode = SFILTER_NONE;
+  filter->size = 0;
+}
+
+bool sfilterInit(sfilter_t* filter, sfilter_mode_t mode, uint16_t size)
+{
+  sfilterFree(filter);
+  if ((mode == SFILTER_NONE) || (size < 2)) return true;
+  if (size > CONFIG_SFILTER_MAX_SIZE) size = CONFIG_SFILTER_MAX_SIZE;
+  // Для медианы нечетное окно, чтобы результат был одним из значений
+  if ((mode == SFILTER_MEDIAN) && ((size & 1) == 0)) size++;
+
+  filter->mode = mode;
+  filter->size = size;
+  if (mode != SFILTER_EMA) {
+    filter->data = (float*)calloc(size, sizeof(float));
+    if (filter->data == nullptr) goto failed;
+  };
+  if (mode == SFILTER_MEDIAN) {
+    filter->pos = (int16_t*)calloc(size, sizeof(int16_t));
+    int16_t* heap = (int16_t*)calloc(size, sizeof(int16_t));
+    if ((filter->pos == nullptr) || (heap == nullptr)) {
+      if (heap) free(heap);
+      goto failed;
+    };
+    filter->heap = heap + size / 2;
+  };
+  sfilterReset(filter);
+  return true;
+
+failed:
+  sfilterFree(filter);
+  return false;
+}
+
+float sfilterAdd(sfilter_t* filter, float value)
+{
+  if (isnan(value)) return value;
+  switch (filter->mode) {
+    case SFILTER_MEAN:   return sfilterMean(filter, value);
+    case SFILTER_MEDIAN: return sfilterMedian(filter, value);
+    case SFILTER_EMA:    return sfilterEma(filter, value);
+    default:             return value;
+  };
+}
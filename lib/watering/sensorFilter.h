@@ -0,0 +1,49 @@
+#ifndef __SENSORFILTER_H__
+#define __SENSORFILTER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Фильтры показаний сенсоров со скользящим окном, стоимость обработки одного значения:
+//   - медиана: O(log n) - окно хранится в виде двух куч (max-куча меньших значений и min-куча больших) вокруг медианы;
+//   - среднее: O(1) - текущая сумма окна;
+//   - экспоненциальное сглаживание: O(1), коэффициент 2 / (n + 1).
+// Память под окно выделяется один раз при инициализации
+
+#define CONFIG_SFILTER_MAX_SIZE     256
+
+typedef enum {
+  SFILTER_NONE    = 0,
+  SFILTER_MEAN    = 1,
+  SFILTER_MEDIAN  = 2,
+  SFILTER_EMA     = 3
+} sfilter_mode_t;
+
+typedef struct {
+  sfilter_mode_t mode;
+  uint16_t size;        // Размер окна
+  uint16_t count;       // Значений в окне
+  uint16_t index;       // Позиция следующего значения в кольцевом буфере
+  float*   data;        // Кольцевой буфер значений
+  int16_t* pos;         // Позиция каждого значения в кучах
+  int16_t* heap;        // Указатель на середину массива куч: [0] - медиана, [-1, -2, ...] - max-куча, [1, 2, ...] - min-куча
+  double   sum;         // Сумма окна для среднего
+  float    ema;
+} sfilter_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool sfilterInit(sfilter_t* filter, sfilter_mode_t mode, uint16_t size);
+void sfilterFree(sfilter_t* filter);
+void sfilterReset(sfilter_t* filter);
+// Добавляет значение и возвращает результат фильтрации; NAN пропускается и не попадает в окно
+float sfilterAdd(sfilter_t* filter, float value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SENSORFILTER_H__
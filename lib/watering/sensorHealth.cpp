@@ -0,0 +1,74 @@
+#include "sensorHealth.h"
+#include <math.h>
+
+void shealthInit(shealth_t* health, const shealth_limits_t* limits, uint32_t now)
+{
+  health->limits = limits;
+  health->reads = 0;
+  health->errors = 0;
+  health->jumps = 0;
+  health->error_rate = 0.0;
+  health->jump_rate = 0.0;
+  health->last_value = NAN;
+  // До первого чтения сенсор считается исправным, устаревание отсчитывается от запуска
+  health->last_ok = now;
+  health->changed = now;
+  health->flags = 0;
+  health->score = 100;
+  health->healthy = true;
+}
+
+static inline float shealthRate(float rate, bool event)
+{
+  return rate + ((event ? 1.0f : 0.0f) - rate) / CONFIG_SHEALTH_RATE_WEIGHT;
+}
+
+void shealthObserve(shealth_t* health, uint32_t now, bool ok, float value)
+{
+  const shealth_limits_t* limits = health->limits;
+  health->reads++;
+  bool error = !ok || isnan(value) || (value < limits->min_value) || (value > limits->max_value);
+  health->error_rate = shealthRate(health->error_rate, error);
+  if (error) {
+    health->errors++;
+    return;
+  };
+
+  // Скачок учитывается, но значение принимается: если изменение настоящее, следующие чтения скачками уже не будут
+  bool jump = (limits->max_jump > 0) && !isnan(health->last_value) && (fabsf(value - health->last_value) > limits->max_jump);
+  health->jump_rate = shealthRate(health->jump_rate, jump);
+  if (jump) health->jumps++;
+
+  if (isnan(health->last_value) || (value != health->last_value)) {
+    health->changed = now;
+  };
+  health->last_value = value;
+  health->last_ok = now;
+}
+
+bool shealthUpdate(shealth_t* health, uint32_t now)
+{
+  const shealth_limits_t* limits = health->limits;
+  uint8_t flags = 0;
+  if (health->error_rate > 0.1) flags |= SHEALTH_ERRORS;
+  if (health->jump_rate > 0.1) flags |= SHEALTH_JUMPS;
+  if ((limits->stuck_time > 0) && (now - health->changed > limits->stuck_time)) flags |= SHEALTH_STUCK;
+  if (now - health->last_ok > limits->stale_time) flags |= SHEALTH_STALE;
+  health->flags = flags;
+
+  float score = 100.0 * (1.0 - health->error_rate) * (1.0 - health->jump_rate);
+  if (flags & (SHEALTH_STUCK | SHEALTH_STALE)) score = 0.0;
+  health->score = (uint8_t)(score + 0.5);
+
+  bool healthy = health->healthy;
+  if (healthy) {
+    healthy = health->score >= CONFIG_SHEALTH_SCORE_BAD;
+  } else {
+    healthy = health->score >= CONFIG_SHEALTH_SCORE_GOOD;
+  };
+  if (healthy != health->healthy) {
+    health->healthy = healthy;
+    return true;
+  };
+  return false;
+}
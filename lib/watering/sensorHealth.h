@@ -0,0 +1,62 @@
+#ifndef __SENSORHEALTH_H__
+#define __SENSORHEALTH_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Оценка исправности сенсора по результатам чтений:
+//   - доля ошибок чтения и значений вне допустимого диапазона (экспоненциальное сглаживание);
+//   - доля неправдоподобных скачков между соседними значениями;
+//   - залипание: значение не меняется дольше заданного времени;
+//   - устаревание: удачных чтений нет дольше заданного времени.
+// Оценка 0..100, переход в неисправное состояние и обратно - с гистерезисом, чтобы одиночный сбой не переключал управление
+
+#define CONFIG_SHEALTH_RATE_WEIGHT    16      // Сглаживание долей ошибок и скачков, чтений
+#define CONFIG_SHEALTH_SCORE_BAD      50      // Ниже - сенсор неисправен
+#define CONFIG_SHEALTH_SCORE_GOOD     80      // Не ниже (и без залипания и устаревания) - сенсор снова исправен
+
+// Причины снижения оценки
+#define SHEALTH_ERRORS                0x01
+#define SHEALTH_JUMPS                 0x02
+#define SHEALTH_STUCK                 0x04
+#define SHEALTH_STALE                 0x08
+
+typedef struct {
+  float    min_value;                 // Допустимый диапазон значений
+  float    max_value;
+  float    max_jump;                  // Наибольшее правдоподобное изменение между соседними чтениями (0 - не проверяется)
+  uint32_t stuck_time;                // Значение не меняется дольше, с (0 - не проверяется)
+  uint32_t stale_time;                // Нет удачных чтений дольше, с
+} shealth_limits_t;
+
+typedef struct {
+  const shealth_limits_t* limits;
+  uint32_t reads;                     // Всего чтений
+  uint32_t errors;                    // Из них ошибок и значений вне диапазона
+  uint32_t jumps;                     // Из них скачков
+  float    error_rate;                // Сглаженная доля ошибок
+  float    jump_rate;                 // Сглаженная доля скачков
+  float    last_value;                // Последнее удачное значение
+  uint32_t last_ok;                   // Время последнего удачного чтения, с
+  uint32_t changed;                   // Время последнего изменения значения, с
+  uint8_t  flags;                     // SHEALTH_*
+  uint8_t  score;                     // 0..100
+  bool     healthy;
+} shealth_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void shealthInit(shealth_t* health, const shealth_limits_t* limits, uint32_t now);
+// Результат одного чтения: ok - статус сенсора, value - прочитанное значение (до фильтрации)
+void shealthObserve(shealth_t* health, uint32_t now, bool ok, float value);
+// Пересчет оценки; возвращает true, если состояние исправности изменилось
+bool shealthUpdate(shealth_t* health, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SENSORHEALTH_H__
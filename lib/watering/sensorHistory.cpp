@@ -0,0 +1,224 @@
+#include "sensorHistory.h"
+#include <string.h>
+#include <math.h>
+#include "esp_timer.h"
+
+// Формат записи: байт заголовка, далее данные
+//   ключевая запись: HISTORY_HDR_KEY | насос; время uint32; значения int16 по всем каналам (little-endian)
+//   приращение:      маска изменившихся каналов | насос; varint(dt); zigzag-varint(delta) для каждого канала из маски
+#define HISTORY_HDR_KEY             0x80
+#define HISTORY_HDR_PUMP            0x40
+#define HISTORY_RECORD_MAX          (1 + 5 + CONFIG_HISTORY_CHANNELS * 3)
+
+typedef struct {
+  uint16_t used;
+  uint16_t count;
+  uint8_t  data[CONFIG_HISTORY_BLOCK_SIZE];
+} history_block_t;
+
+static history_block_t _historyBlocks[CONFIG_HISTORY_BLOCKS];
+static uint16_t _historyHead = 0;     // Самый старый блок
+static uint16_t _historyUsed = 0;     // Количество занятых блоков
+static history_sample_t _historyLast;
+static history_stats_t _historyStats;
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------ Кодирование ----------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+int16_t historyEncodeValue(float value)
+{
+  if (isnan(value)) return CONFIG_HISTORY_NO_VALUE;
+  float scaled = value * CONFIG_HISTORY_SCALE;
+  if (scaled >= INT16_MAX) return INT16_MAX;
+  if (scaled <= (CONFIG_HISTORY_NO_VALUE + 1)) return CONFIG_HISTORY_NO_VALUE + 1;
+  return (int16_t)lroundf(scaled);
+}
+
+float historyDecodeValue(int16_t value)
+{
+  if (value == CONFIG_HISTORY_NO_VALUE) return NAN;
+  return (float)value / CONFIG_HISTORY_SCALE;
+}
+
+static uint8_t historyPutVarint(uint8_t* buf, uint32_t value)
+{
+  uint8_t n = 0;
+  while (value >= 0x80) {
+    buf[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  };
+  buf[n++] = (uint8_t)value;
+  return n;
+}
+
+static bool historyGetVarint(const uint8_t* buf, uint16_t size, uint16_t* offset, uint32_t* value)
+{
+  uint32_t result = 0;
+  uint8_t shift = 0;
+  while (*offset < size) {
+    uint8_t b = buf[(*offset)++];
+    result |= (uint32_t)(b & 0x7F) << shift;
+    if ((b & 0x80) == 0) {
+      *value = result;
+      return true;
+    };
+    shift += 7;
+    if (shift > 28) return false;
+  };
+  return false;
+}
+
+static inline uint32_t historyZigZag(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t historyUnZigZag(uint32_t value)
+{
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static uint8_t historyEncodeKey(uint8_t* buf, const history_sample_t* sample)
+{
+  uint8_t n = 0;
+  buf[n++] = HISTORY_HDR_KEY | (sample->pump ? HISTORY_HDR_PUMP : 0);
+  for (uint8_t i = 0; i < 4; i++) {
+    buf[n++] = (uint8_t)(sample->time >> (8 * i));
+  };
+  for (uint8_t i = 0; i < CONFIG_HISTORY_CHANNELS; i++) {
+    buf[n++] = (uint8_t)((uint16_t)sample->values[i]);
+    buf[n++] = (uint8_t)((uint16_t)sample->values[i] >> 8);
+  };
+  return n;
+}
+
+static uint8_t historyEncodeDelta(uint8_t* buf, const history_sample_t* sample, const history_sample_t* prev)
+{
+  uint8_t mask = 0;
+  uint8_t n = 1;
+  n += historyPutVarint(buf + n, sample->time - prev->time);
+  for (uint8_t i = 0; i < CONFIG_HISTORY_CHANNELS; i++) {
+    if (sample->values[i] != prev->values[i]) {
+      mask |= (1 << i);
+      n += historyPutVarint(buf + n, historyZigZag((int32_t)sample->values[i] - (int32_t)prev->values[i]));
+    };
+  };
+  buf[0] = mask | (sample->pump ? HISTORY_HDR_PUMP : 0);
+  return n;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// -------------------------------------------------------- Запись -------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+void historyClear()
+{
+  _historyHead = 0;
+  _historyUsed = 0;
+  memset(&_historyLast, 0, sizeof(_historyLast));
+  memset(&_historyStats, 0, sizeof(_historyStats));
+  _historyStats.capacity = CONFIG_HISTORY_BLOCKS * CONFIG_HISTORY_BLOCK_SIZE;
+}
+
+static history_block_t* historyNextBlock()
+{
+  if (_historyUsed < CONFIG_HISTORY_BLOCKS) {
+    _historyUsed++;
+  } else {
+    // Вытесняем самый старый блок
+    history_block_t* oldest = &_historyBlocks[_historyHead];
+    _historyStats.samples -= oldest->count;
+    _historyStats.bytes -= oldest->used;
+    _historyStats.evicted += oldest->count;
+    _historyHead = (_historyHead + 1) % CONFIG_HISTORY_BLOCKS;
+  };
+  history_block_t* block = &_historyBlocks[(_historyHead + _historyUsed - 1) % CONFIG_HISTORY_BLOCKS];
+  block->used = 0;
+  block->count = 0;
+  return block;
+}
+
+bool historyAdd(const history_sample_t* sample)
+{
+  if (_historyStats.capacity == 0) historyClear();
+  // Время не может идти назад внутри блока, иначе приращение не уложится в беззнаковое число
+  if ((_historyUsed > 0) && (sample->time < _historyLast.time)) return false;
+
+  int64_t start = esp_timer_get_time();
+  uint8_t buf[HISTORY_RECORD_MAX];
+  uint8_t len = 0;
+  history_block_t* block = nullptr;
+  if (_historyUsed > 0) {
+    block = &_historyBlocks[(_historyHead + _historyUsed - 1) % CONFIG_HISTORY_BLOCKS];
+    len = historyEncodeDelta(buf, sample, &_historyLast);
+  };
+  if ((block == nullptr) || (block->used + len > CONFIG_HISTORY_BLOCK_SIZE)) {
+    block = historyNextBlock();
+    len = historyEncodeKey(buf, sample);
+  };
+  memcpy(block->data + block->used, buf, len);
+  block->used += len;
+  block->count++;
+  _historyLast = *sample;
+
+  _historyStats.samples++;
+  _historyStats.bytes += len;
+  _historyStats.encode_time += (uint32_t)(esp_timer_get_time() - start);
+  _historyStats.encode_count++;
+  return true;
+}
+
+void historyGetStats(history_stats_t* stats)
+{
+  if (_historyStats.capacity == 0) historyClear();
+  *stats = _historyStats;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// -------------------------------------------------------- Чтение -------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+void historyCursorInit(history_cursor_t* cursor)
+{
+  memset(cursor, 0, sizeof(history_cursor_t));
+}
+
+bool historyCursorNext(history_cursor_t* cursor, history_sample_t* sample)
+{
+  while (cursor->block < _historyUsed) {
+    const history_block_t* block = &_historyBlocks[(_historyHead + cursor->block) % CONFIG_HISTORY_BLOCKS];
+    if (cursor->offset < block->used) {
+      const uint8_t* data = block->data;
+      uint8_t hdr = data[cursor->offset++];
+      history_sample_t* last = &cursor->last;
+      if (hdr & HISTORY_HDR_KEY) {
+        if (cursor->offset + 4 + 2 * CONFIG_HISTORY_CHANNELS > block->used) return false;
+        last->time = 0;
+        for (uint8_t i = 0; i < 4; i++) {
+          last->time |= (uint32_t)data[cursor->offset++] << (8 * i);
+        };
+        for (uint8_t i = 0; i < CONFIG_HISTORY_CHANNELS; i++) {
+          last->values[i] = (int16_t)(data[cursor->offset] | (data[cursor->offset + 1] << 8));
+          cursor->offset += 2;
+        };
+      } else {
+        uint32_t value;
+        if (!historyGetVarint(data, block->used, &cursor->offset, &value)) return false;
+        last->time += value;
+        for (uint8_t i = 0; i < CONFIG_HISTORY_CHANNELS; i++) {
+          if (hdr & (1 << i)) {
+            if (!historyGetVarint(data, block->used, &cursor->offset, &value)) return false;
+            last->values[i] = (int16_t)((int32_t)last->values[i] + historyUnZigZag(value));
+          };
+        };
+      };
+      last->pump = (hdr & HISTORY_HDR_PUMP) != 0;
+      *sample = *last;
+      return true;
+    };
+    cursor->block++;
+    cursor->offset = 0;
+  };
+  return false;
+}
@@ -0,0 +1,58 @@
+#ifndef __SENSORHISTORY_H__
+#define __SENSORHISTORY_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Кольцевой буфер истории показаний в ОЗУ. Буфер разбит на блоки фиксированного размера, первая запись
+// каждого блока хранится целиком (ключевая), остальные - как приращения времени и значений в формате varint.
+// При заполнении буфера вытесняется самый старый блок целиком
+
+#define CONFIG_HISTORY_CHANNELS     5       // Количество каналов в одной записи
+#define CONFIG_HISTORY_BLOCKS       16      // Количество блоков в буфере
+#define CONFIG_HISTORY_BLOCK_SIZE   512     // Размер одного блока в байтах
+#define CONFIG_HISTORY_SCALE        10      // Значения хранятся с фиксированной точкой: value * CONFIG_HISTORY_SCALE
+#define CONFIG_HISTORY_NO_VALUE     INT16_MIN
+
+typedef struct {
+  uint32_t time;
+  int16_t  values[CONFIG_HISTORY_CHANNELS];
+  bool     pump;
+} history_sample_t;
+
+// Позиция чтения: номер блока от самого старого и смещение внутри него
+typedef struct {
+  uint16_t block;
+  uint16_t offset;
+  history_sample_t last;
+} history_cursor_t;
+
+typedef struct {
+  uint32_t samples;
+  uint32_t bytes;
+  uint32_t capacity;
+  uint32_t evicted;
+  uint32_t encode_time;    // Суммарное время упаковки, мкс
+  uint32_t encode_count;
+} history_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void historyClear();
+bool historyAdd(const history_sample_t* sample);
+void historyGetStats(history_stats_t* stats);
+
+int16_t historyEncodeValue(float value);
+float historyDecodeValue(int16_t value);
+
+void historyCursorInit(history_cursor_t* cursor);
+bool historyCursorNext(history_cursor_t* cursor, history_sample_t* sample);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SENSORHISTORY_H__
@@ -1,13 +1,21 @@
 #include "watering.h"
 #include "strings.h"
+#include <new>
+#include <inttypes.h>
 #include "math.h"
+#include "stdarg.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include <driver/gpio.h>
+#include "soc/gpio_reg.h"
 #include "project_config.h"
 #include "def_consts.h"
 #include "def_alarm.h"
 #include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
 #include "mbcontroller.h"
 #include "rLog.h"
 #include "rTypes.h"
@@ -16,6 +24,7 @@
 #include "reEvents.h"
 #include "reMqtt.h"
 #include "reEsp32.h"
+#include "reNvs.h"
 #include "reWiFi.h"
 #if CONFIG_TELEGRAM_ENABLE
 #include "reTgSend.h"
@@ -26,15 +35,30 @@
 #if defined(CONFIG_ELTARIFFS_ENABLED) && CONFIG_ELTARIFFS_ENABLED
 #include "reElTariffs.h"
 #endif // CONFIG_ELTARIFFS_ENABLED
+#if CONFIG_WATERING_VOLUME && CONFIG_WATERING_FLOW_METER
+#include "driver/pulse_cnt.h"
+#endif // CONFIG_WATERING_FLOW_METER
 #include "reLed.h" 
 #include "reLoadCtrl.h"
 #include "reGpio.h"
+#include "dsPayload.h"
+#include "sensorHistory.h"
+#include "sensorFilter.h"
+#include "sensorHealth.h"
+#include "cycleProfile.h"
+#include "cborPayload.h"
+#include "wateringModel.h"
+#include "leakScan.h"
+#include "modbusSchedule.h"
+#include "modbusBaud.h"
+#include "mqttTopics.h"
 
 static const char* logTAG   = "WTRС";
 static const char* wateringTaskName = "watering";
 static uint32_t _sensorsReadInterval = CONFIG_WATERING_TASK_CYCLE / 1000;
 static bool _sensorsNeedStore = false;
 static TaskHandle_t _wateringTask;
+static TaskHandle_t _interlockTask = nullptr;
 static EventGroupHandle_t _wateringFlags = nullptr;
 
 // Низкий уровень воды
@@ -45,12 +69,93 @@ static EventGroupHandle_t _wateringFlags = nullptr;
 #define WATER_LEAK_IN1        BIT2
 #define WATER_LEAK_IN2        BIT3
 #define WATER_LEAK_IN3        BIT4
+#define WATER_LEAK_CHANGED    BIT5
+#define WATER_LEAK_ALL        (WATER_LEAK_IN1 | WATER_LEAK_IN2 | WATER_LEAK_IN3)
+
+// Аварийное отключение насоса
+#define PUMP_INTERLOCK        BIT6
+#define PUMP_DEFERRED         BIT7
 
 // Временные события
 #define TIME_MINUTE_EVENT     BIT8
 
 // Есть изменения на любом из входов
-#define FORCED_CONTROL        (WATER_LEVEL_CHANGED | TIME_MINUTE_EVENT)
+#define FORCED_CONTROL        (WATER_LEVEL_CHANGED | WATER_LEAK_CHANGED | PUMP_DEFERRED | TIME_MINUTE_EVENT)
+
+// Момент события, требующего аварийного отключения насоса
+static volatile int64_t _interlockEventTime = 0;
+// Аварийная блокировка: выходы нагрузок отключены напрямую, включать их нельзя до устранения причины
+static bool _interlockLatched = false;
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------ Топики MQTT ----------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+// Топики устройства, которые публикуются напрямую (топики сенсоров и нагрузок создаются библиотеками)
+typedef enum {
+  TOPIC_STORAGE = 0,
+  TOPIC_WATER_LEAK,
+  TOPIC_WATER_LEVEL,
+  TOPIC_INTERLOCK,
+  TOPIC_MODBUS,
+  TOPIC_MODEL,
+  TOPIC_PROFILE,
+  TOPIC_HEAP,
+  TOPIC_DEDUP,
+  TOPIC_VOLUME,
+  TOPIC_HEALTH,
+  TOPIC_SNAPSHOT,
+  TOPIC_BACKLOG,
+  TOPIC_HISTORY,
+  TOPIC_JOURNAL,
+  TOPIC_COUNT
+} mqtt_topic_id_t;
+
+static const char* _topicNames[TOPIC_COUNT] = {
+  CONFIG_STORAGE_TOPIC, CONFIG_WATER_LEAK_TOPIC, CONFIG_WATER_LEVEL_TOPIC, CONFIG_INTERLOCK_TOPIC, CONFIG_MODBUS_TOPIC,
+  CONFIG_MODEL_TOPIC, CONFIG_PROFILE_TOPIC, CONFIG_HEAP_TOPIC, CONFIG_DEDUP_TOPIC, CONFIG_VOLUME_TOPIC, CONFIG_HEALTH_TOPIC,
+  CONFIG_SNAPSHOT_TOPIC, CONFIG_BACKLOG_TOPIC, CONFIG_HISTORY_TOPIC, CONFIG_JOURNAL_TOPIC
+};
+
+#ifdef CONFIG_MQTT2_TYPE
+  #define MQTT_TOPICS_BROKERS 2
+#else
+  #define MQTT_TOPICS_BROKERS 1
+#endif // CONFIG_MQTT2_TYPE
+
+static_assert(TOPIC_COUNT <= CONFIG_MQTT_TOPICS_MAX, "Too many MQTT topics for the topic table");
+
+// Таблица для каждого брокера собирается при первом подключении к нему и далее не меняется (mqttTopics.h);
+// топики, которые не удалось создать, досоздаются при следующем подключении
+static mqtt_topics_t _mqttTopics[MQTT_TOPICS_BROKERS];
+static mqtt_topics_t* volatile _mqttTopicsActive = nullptr;
+
+static void mqttTopicsSelect(bool primary)
+{
+  mqtt_topics_t* table = &_mqttTopics[(MQTT_TOPICS_BROKERS > 1) && !primary ? 1 : 0];
+  if (!table->ready) {
+    if (!mqttTopicsBuild(table, primary, _topicNames, TOPIC_COUNT, mqttGetTopicDevice1)) {
+      for (uint8_t i = 0; i < TOPIC_COUNT; i++) {
+        if (table->topics[i] == nullptr) {
+          rlog_e(logTAG, "MQTT topic \"%s\" is not available: not created or topic arena overflow, will retry on next connect", _topicNames[i]);
+        };
+      };
+    };
+    rlog_d(logTAG, "MQTT topics for %s broker: %u bytes", primary ? "primary" : "secondary", table->used);
+  };
+  _mqttTopicsActive = table;
+}
+
+static void mqttTopicsDeselect()
+{
+  _mqttTopicsActive = nullptr;
+}
+
+static inline char* mqttTopic(mqtt_topic_id_t id)
+{
+  mqtt_topics_t* table = _mqttTopicsActive;
+  return table ? table->topics[id] : nullptr;
+}
 
 // -----------------------------------------------------------------------------------------------------------------------
 // ------------------------------------------------------ Параметры ------------------------------------------------------
@@ -60,6 +165,57 @@ static paramsGroupHandle_t pgSensors;
 static paramsGroupHandle_t pgIntervals;
 static paramsGroupHandle_t pgWatering;
 
+// Настройки одной зоны полива
+static void sensorsInitZoneParameters(paramsGroupHandle_t group, watering_zone_t* zone)
+{
+  // Режим управления поливом
+  paramsSetLimitsU8(
+    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_U8, nullptr, group, 
+      CONFIG_MODE_KEY, CONFIG_MODE_FRIENDLY, 
+      CONFIG_MQTT_PARAMS_QOS, (void*)&zone->mode),
+    #if CONFIG_WATERING_MODEL_ENABLE
+      (uint8_t)WATERING_OFF, (uint8_t)WATERING_MODEL);
+    #else
+      (uint8_t)WATERING_OFF, (uint8_t)WATERING_SENSORS);
+    #endif // CONFIG_WATERING_MODEL_ENABLE
+  // Расписание работы полива
+  paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_TIMESPAN, nullptr, group, 
+    CONFIG_TIMESPAN_KEY, CONFIG_TIMESPAN_FRIENDLY, 
+    CONFIG_MQTT_PARAMS_QOS, (void*)&zone->timespan);
+  // Влажность почвы
+  paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_FLOAT, nullptr, group, 
+    CONFIG_WATERING_MST_MIN_KEY, CONFIG_WATERING_MST_MIN_FRIENDLY, 
+    CONFIG_MQTT_PARAMS_QOS, (void*)&zone->moisture_min);
+  paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_FLOAT, nullptr, group, 
+    CONFIG_WATERING_MST_MAX_KEY, CONFIG_WATERING_MST_MAX_FRIENDLY, 
+    CONFIG_MQTT_PARAMS_QOS, (void*)&zone->moisture_max);
+  // Температура почвы
+  paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_FLOAT, nullptr, group, 
+    CONFIG_WATERING_ST_MIN_KEY, CONFIG_WATERING_ST_MIN_FRIENDLY, 
+    CONFIG_MQTT_PARAMS_QOS, (void*)&zone->soil_temp_min);
+  paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_FLOAT, nullptr, group, 
+    CONFIG_WATERING_ST_MAX_KEY, CONFIG_WATERING_ST_MAX_FRIENDLY, 
+    CONFIG_MQTT_PARAMS_QOS, (void*)&zone->soil_temp_max);
+  // Максимальное время полива
+  paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_U32, nullptr, group, 
+    CONFIG_WATERING_MAX_DUR_KEY, CONFIG_WATERING_MAX_DUR_FRIENDLY, 
+    CONFIG_MQTT_PARAMS_QOS, (void*)&zone->max_duration);
+  // Время работы для одного цикла
+  paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_U32, nullptr, group, 
+    CONFIG_WATERING_CYC_TIME_KEY, CONFIG_WATERING_CYC_TIME_FRIENDLY, 
+    CONFIG_MQTT_PARAMS_QOS, (void*)&zone->cycle_time);
+  // Интервал повторения циклов
+  paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_U32, nullptr, group, 
+    CONFIG_WATERING_CYC_INTV_KEY, CONFIG_WATERING_CYC_INTV_FRIENDLY, 
+    CONFIG_MQTT_PARAMS_QOS, (void*)&zone->cycle_interval);
+  // Расход воды при включенной нагрузке
+  #if CONFIG_WATERING_VOLUME && !CONFIG_WATERING_FLOW_METER
+    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_FLOAT, nullptr, group, 
+      CONFIG_WATERING_FLOW_KEY, CONFIG_WATERING_FLOW_FRIENDLY, 
+      CONFIG_MQTT_PARAMS_QOS, (void*)&zone->flow_rate);
+  #endif // CONFIG_WATERING_VOLUME
+}
+
 static void sensorsInitParameters()
 {
   // ------------------------------------------------------------------------------------------
@@ -80,6 +236,25 @@ static void sensorsInitParameters()
     CONFIG_SENSOR_PARAM_INTERVAL_READ_KEY, CONFIG_SENSOR_PARAM_INTERVAL_READ_FRIENDLY,
     CONFIG_MQTT_PARAMS_QOS, (void*)&_sensorsReadInterval);
 
+  #if CONFIG_WATERING_ADAPTIVE_READ
+    // Адаптивные периоды опроса сенсоров
+    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_U32, nullptr, pgIntervals,
+      CONFIG_SENSOR_PARAM_INTERVAL_SOIL_FAST_KEY, CONFIG_SENSOR_PARAM_INTERVAL_SOIL_FAST_FRIENDLY,
+      CONFIG_MQTT_PARAMS_QOS, (void*)&sensorsSoilFastInterval);
+    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_U32, nullptr, pgIntervals,
+      CONFIG_SENSOR_PARAM_INTERVAL_SOIL_SLOW_KEY, CONFIG_SENSOR_PARAM_INTERVAL_SOIL_SLOW_FRIENDLY,
+      CONFIG_MQTT_PARAMS_QOS, (void*)&sensorsSoilSlowInterval);
+    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_FLOAT, nullptr, pgIntervals,
+      CONFIG_SENSOR_PARAM_SOIL_NEAR_BAND_KEY, CONFIG_SENSOR_PARAM_SOIL_NEAR_BAND_FRIENDLY,
+      CONFIG_MQTT_PARAMS_QOS, (void*)&sensorsSoilNearBand);
+    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_U32, nullptr, pgIntervals,
+      CONFIG_SENSOR_PARAM_INTERVAL_INDOOR_KEY, CONFIG_SENSOR_PARAM_INTERVAL_INDOOR_FRIENDLY,
+      CONFIG_MQTT_PARAMS_QOS, (void*)&sensorsIndoorInterval);
+    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_U32, nullptr, pgIntervals,
+      CONFIG_SENSOR_PARAM_INTERVAL_HEATING_KEY, CONFIG_SENSOR_PARAM_INTERVAL_HEATING_FRIENDLY,
+      CONFIG_MQTT_PARAMS_QOS, (void*)&sensorsHeatingInterval);
+  #endif // CONFIG_WATERING_ADAPTIVE_READ
+
   // Период публикации данных с сенсоров на MQTT
   paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_U32, nullptr, pgIntervals,
     CONFIG_SENSOR_PARAM_INTERVAL_MQTT_KEY, CONFIG_SENSOR_PARAM_INTERVAL_MQTT_FRIENDLY,
@@ -150,42 +325,31 @@ static void sensorsInitParameters()
         CONFIG_WATERLEAK_DEBOUNCE_KEY, CONFIG_WATERLEAK_DEBOUNCE_FRIENDLY, 
         CONFIG_MQTT_PARAMS_QOS, (void*)&waterleakDebounceCount);
 
-    // Режим управления поливом
-    paramsSetLimitsU8(
-      paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_U8, nullptr, pgWatering, 
-        CONFIG_MODE_KEY, CONFIG_MODE_FRIENDLY, 
-        CONFIG_MQTT_PARAMS_QOS, (void*)&wateringMode),
-      (uint8_t)WATERING_OFF, (uint8_t)WATERING_SENSORS);
-    // Расписание работы полива
-    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_TIMESPAN, nullptr, pgWatering, 
-      CONFIG_TIMESPAN_KEY, CONFIG_TIMESPAN_FRIENDLY, 
-      CONFIG_MQTT_PARAMS_QOS, (void*)&wateringTimespan);
-    // Влажность почвы
-    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_FLOAT, nullptr, pgWatering, 
-      CONFIG_WATERING_MST_MIN_KEY, CONFIG_WATERING_MST_MIN_FRIENDLY, 
-      CONFIG_MQTT_PARAMS_QOS, (void*)&wateringMoistureMin);
-    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_FLOAT, nullptr, pgWatering, 
-      CONFIG_WATERING_MST_MAX_KEY, CONFIG_WATERING_MST_MAX_FRIENDLY, 
-      CONFIG_MQTT_PARAMS_QOS, (void*)&wateringMoistureMax);
-    // Температура почвы
-    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_FLOAT, nullptr, pgWatering, 
-      CONFIG_WATERING_ST_MIN_KEY, CONFIG_WATERING_ST_MIN_FRIENDLY, 
-      CONFIG_MQTT_PARAMS_QOS, (void*)&wateringSoilTempMin);
-    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_FLOAT, nullptr, pgWatering, 
-      CONFIG_WATERING_ST_MAX_KEY, CONFIG_WATERING_ST_MAX_FRIENDLY, 
-      CONFIG_MQTT_PARAMS_QOS, (void*)&wateringSoilTempMax);
-    // Максимальное время полива
-    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_U32, nullptr, pgWatering, 
-      CONFIG_WATERING_MAX_DUR_KEY, CONFIG_WATERING_MAX_DUR_FRIENDLY, 
-      CONFIG_MQTT_PARAMS_QOS, (void*)&wateringMoistureMaxDuration);
-    // Время работы для одного цикла
-    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_U32, nullptr, pgWatering, 
-      CONFIG_WATERING_CYC_TIME_KEY, CONFIG_WATERING_CYC_TIME_FRIENDLY, 
-      CONFIG_MQTT_PARAMS_QOS, (void*)&wateringMoistureCycleTime);
-    // Интервал повторения циклов
-    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_U32, nullptr, pgWatering, 
-      CONFIG_WATERING_CYC_INTV_KEY, CONFIG_WATERING_CYC_INTV_FRIENDLY, 
-      CONFIG_MQTT_PARAMS_QOS, (void*)&wateringMoistureCycleInterval);
+    // Учет расхода воды
+    #if CONFIG_WATERING_VOLUME
+      paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_FLOAT, nullptr, pgWatering, 
+          CONFIG_VOLUME_TANK_KEY, CONFIG_VOLUME_TANK_FRIENDLY, 
+          CONFIG_MQTT_PARAMS_QOS, (void*)&volumeTankCapacity);
+      #if CONFIG_WATERING_FLOW_METER
+        paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_FLOAT, nullptr, pgWatering, 
+            CONFIG_VOLUME_PULSES_KEY, CONFIG_VOLUME_PULSES_FRIENDLY, 
+            CONFIG_MQTT_PARAMS_QOS, (void*)&volumeMeterPulses);
+      #endif // CONFIG_WATERING_FLOW_METER
+    #endif // CONFIG_WATERING_VOLUME
+
+    // Зоны полива: основная зона - в корне группы, остальные - в своих подгруппах
+    sensorsInitZoneParameters(pgWatering, &wateringZones[0]);
+    for (uint8_t i = 1; i < CONFIG_WATERING_ZONES; i++) {
+      // Пока параметры не восстановлены из NVS, дополнительные зоны работают с настройками основной
+      wateringZones[i] = wateringZones[0];
+      if (wateringZonesHw[i].soil_address > 0) {
+        paramsGroupHandle_t pgZone = paramsRegisterGroup(pgWatering, 
+          wateringZonesHw[i].key, wateringZonesHw[i].topic, wateringZonesHw[i].name);
+        if (pgZone) {
+          sensorsInitZoneParameters(pgZone, &wateringZones[i]);
+        };
+      };
+    };
   };
 }
 
@@ -193,6 +357,44 @@ static void sensorsInitParameters()
 // ------------------------------------------------------- Сенсоры -------------------------------------------------------
 // -----------------------------------------------------------------------------------------------------------------------
 
+// Зоны полива: датчик почвы и нагрузка каждой зоны. Зона 0 - sensorSoil и lcPump, датчики и нагрузки 
+// дополнительных зон создаются при запуске по таблице wateringZonesHw
+typedef struct {
+  reCWTSoilS* soil;
+  rLoadGpioController* load;
+  uint32_t crc;                     // Контрольная сумма счётчиков нагрузки на момент последней записи в NVS
+  zone_control_t control;           // Решение о поливе: расписание без датчика, модель почвы, длительность импульса
+} watering_zone_ctrl_t;
+
+static watering_zone_ctrl_t _zones[CONFIG_WATERING_ZONES] = { { &sensorSoil, nullptr, 0, {} } };
+
+// Запрос на чтение данных (выставляет главная задача)
+#define SENSOR_READ_SOIL      BIT0
+#define SENSOR_READ_INDOOR    BIT1
+#define SENSOR_READ_HEATING   BIT2
+#define SENSOR_READ_ALL       (SENSOR_READ_SOIL | SENSOR_READ_INDOOR | SENSOR_READ_HEATING)
+
+#if CONFIG_WATERING_PARALLEL_READ
+// Сенсоры, от которых еще не получен ответ на предыдущий запрос: задача чтения может находиться внутри readData()
+static EventBits_t _sensorsReadPending = 0;
+#endif // CONFIG_WATERING_PARALLEL_READ
+
+// Сенсор еще читается задачей, не уложившейся в таймаут: до завершения чтения его данные (значения, экстремумы, 
+// статистика шины) не используются ни управлением, ни публикацией, ни сохранением
+static inline bool sensorsReadBusy(EventBits_t bits)
+{
+  #if CONFIG_WATERING_PARALLEL_READ
+    return (_sensorsReadPending & bits) != 0;
+  #else
+    return false;
+  #endif // CONFIG_WATERING_PARALLEL_READ
+}
+
+static inline bool sensorsValueOk(rSensor* sensor, EventBits_t bits)
+{
+  return !sensorsReadBusy(bits) && (sensor->getStatus() == SENSOR_STATUS_OK);
+}
+
 static bool sensorsPublish(rSensor *sensor, char* topic, char* payload, const bool free_topic, const bool free_payload)
 {
   return mqttPublish(topic, payload, CONFIG_MQTT_SENSORS_QOS, CONFIG_MQTT_SENSORS_RETAINED, free_topic, free_payload);
@@ -200,30 +402,240 @@ static bool sensorsPublish(rSensor *sensor, char* topic, char* payload, const bo
 
 static void sensorsMqttTopicsCreate(bool primary)
 {
-  sensorSoil.topicsCreate(primary);
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    if (_zones[i].soil) _zones[i].soil->topicsCreate(primary);
+  };
   sensorIndoor.topicsCreate(primary);
   sensorHeating.topicsCreate(primary);
 }
 
 static void sensorsMqttTopicsFree()
 {
-  sensorSoil.topicsFree();
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    if (_zones[i].soil) _zones[i].soil->topicsFree();
+  };
   sensorIndoor.topicsFree();
   sensorHeating.topicsFree();
 }
 
+// Сохранение в NVS выполняется по группам (отдельные величины сенсоров, счётчики насоса): 
+// группа записывается только тогда, когда её контрольная сумма изменилась с момента последней записи
+
+#define NVS_KEYS_SENSOR_ITEM    18      // Количество ключей, которые записывает rSensorItem::nvsStoreExtremums()
+#define NVS_KEYS_LOAD_COUNTERS  24      // Количество ключей, которые записывает rLoadController::countersNvsStore()
+
+typedef struct {
+  uint32_t today;       // Записано ключей за сегодня
+  uint32_t yesterday;   // Записано ключей за вчера
+  uint32_t total;       // Записано ключей с момента запуска
+  uint32_t stored;      // Записано групп
+  uint32_t skipped;     // Пропущено групп без изменений
+} nvs_writes_t;
+
+typedef struct {
+  const char* nvs_space;
+  uint8_t index;
+  EventBits_t sensor;   // SENSOR_READ_*
+  rSensorItem* item;
+  uint32_t crc;
+} nvs_store_item_t;
+
+// Основные сенсоры, затем по две величины датчика почвы каждой дополнительной зоны (заполняются в nvsItemsInit())
+#define NVS_ITEMS_FIXED         5
+#define NVS_ITEMS_COUNT         (NVS_ITEMS_FIXED + 2 * (CONFIG_WATERING_ZONES - 1))
+
+static nvs_writes_t _nvsWrites;
+static nvs_store_item_t _nvsItems[NVS_ITEMS_COUNT] = {
+  { SENSOR_SOIL_KEY,    1, SENSOR_READ_SOIL,    nullptr, 0 },
+  { SENSOR_SOIL_KEY,    2, SENSOR_READ_SOIL,    nullptr, 0 },
+  { SENSOR_INDOOR_KEY,  1, SENSOR_READ_INDOOR,  nullptr, 0 },
+  { SENSOR_INDOOR_KEY,  2, SENSOR_READ_INDOOR,  nullptr, 0 },
+  { SENSOR_HEATING_KEY, 1, SENSOR_READ_HEATING, nullptr, 0 }
+};
+
+static void nvsWritesAdd(uint32_t keys)
+{
+  _nvsWrites.today += keys;
+  _nvsWrites.total += keys;
+  _nvsWrites.stored++;
+}
+
+static void nvsWritesNewDay()
+{
+  _nvsWrites.yesterday = _nvsWrites.today;
+  _nvsWrites.today = 0;
+}
+
+// Флаги minValueChanged / maxValueChanged в контрольную сумму не входят, они меняются при каждой публикации
+static uint32_t nvsItemChecksum(rSensorItem* item)
+{
+  sensor_extremums_t ext[3] = { item->getExtremumsDaily(), item->getExtremumsWeekly(), item->getExtremumsEntirely() };
+  uint32_t crc = 0;
+  for (uint8_t i = 0; i < 3; i++) {
+    crc = esp_rom_crc32_le(crc, (const uint8_t*)&ext[i].minValue, sizeof(sensor_value_t));
+    crc = esp_rom_crc32_le(crc, (const uint8_t*)&ext[i].maxValue, sizeof(sensor_value_t));
+  };
+  return crc;
+}
+
+// Привязка к величинам сенсоров после их инициализации и восстановления из NVS
+static void nvsItemsInit()
+{
+  _nvsItems[0].item = sensorSoil.getSensorItem1();
+  _nvsItems[1].item = sensorSoil.getSensorItem2();
+  _nvsItems[2].item = sensorIndoor.getSensorItem1();
+  _nvsItems[3].item = sensorIndoor.getSensorItem2();
+  _nvsItems[4].item = sensorHeating.getSensorItem();
+  for (uint8_t i = 1; i < CONFIG_WATERING_ZONES; i++) {
+    reCWTSoilS* soil = _zones[i].soil;
+    if (soil == nullptr) continue;
+    nvs_store_item_t* items = &_nvsItems[NVS_ITEMS_FIXED + 2 * (i - 1)];
+    items[0] = { wateringZonesHw[i].key, 1, SENSOR_READ_SOIL, soil->getSensorItem1(), 0 };
+    items[1] = { wateringZonesHw[i].key, 2, SENSOR_READ_SOIL, soil->getSensorItem2(), 0 };
+  };
+  for (uint8_t i = 0; i < NVS_ITEMS_COUNT; i++) {
+    if (_nvsItems[i].item) _nvsItems[i].crc = nvsItemChecksum(_nvsItems[i].item);
+  };
+}
+
 static void relaysStoreData();
+#if CONFIG_WATERING_VOLUME
+static void volumeStoreData();
+#endif // CONFIG_WATERING_VOLUME
+#if CONFIG_WATERING_SENSOR_HEALTH
+static void fallbackStoreData();
+#endif // CONFIG_WATERING_SENSOR_HEALTH
 static void sensorsStoreData()
 {
-  rlog_i(logTAG, "Store sensors data");
-
-  sensorSoil.nvsStoreExtremums(SENSOR_SOIL_KEY); 
-  sensorIndoor.nvsStoreExtremums(SENSOR_INDOOR_KEY); 
-  sensorHeating.nvsStoreExtremums(SENSOR_HEATING_KEY); 
+  uint8_t stored = 0;
+  for (uint8_t i = 0; i < NVS_ITEMS_COUNT; i++) {
+    nvs_store_item_t* store = &_nvsItems[i];
+    if (store->item && !sensorsReadBusy(store->sensor)) {
+      uint32_t crc = nvsItemChecksum(store->item);
+      if (crc != store->crc) {
+        char* nvs_space = malloc_stringf(CONFIG_SENSOR_NVS_ITEMS, store->nvs_space, store->index);
+        if (nvs_space) {
+          store->item->nvsStoreExtremums(nvs_space);
+          free(nvs_space);
+          store->crc = crc;
+          nvsWritesAdd(NVS_KEYS_SENSOR_ITEM);
+          stored++;
+        };
+      } else {
+        _nvsWrites.skipped++;
+      };
+    };
+  };
+  rlog_i(logTAG, "Store sensors data: %d items changed", stored);
 
   relaysStoreData();
+  #if CONFIG_WATERING_VOLUME
+    volumeStoreData();
+  #endif // CONFIG_WATERING_VOLUME
+  #if CONFIG_WATERING_SENSOR_HEALTH
+    fallbackStoreData();
+  #endif // CONFIG_WATERING_SENSOR_HEALTH
+}
+
+static void nvsWritesMqttPublish()
+{
+  mqttPublish(mqttTopic(TOPIC_STORAGE), 
+    malloc_stringf("{\"writes\":{\"today\":%" PRIu32 ",\"yesterday\":%" PRIu32 ",\"total\":%" PRIu32 "},"
+      "\"stored\":%" PRIu32 ",\"skipped\":%" PRIu32 "}", 
+
+      _nvsWrites.today, _nvsWrites.yesterday, _nvsWrites.total, _nvsWrites.stored, _nvsWrites.skipped), 
+    CONFIG_MQTT_SENSORS_QOS, CONFIG_MQTT_SENSORS_RETAINED, false, true);
+}
+
+#if CONFIG_WATERING_MODBUS_BAUD_SETUP
+
+// Регистры настройки датчиков CWT: чтение - функция 0x03, запись - функция 0x06
+#define CWT_FUNC_READ           0x03
+#define CWT_FUNC_WRITE          0x06
+#define CWT_REG_SLAVE_ID        0x07D0
+#define CWT_REG_BAUD_RATE       0x07D1  // Код скорости - индекс в таблице modbusBauds
+
+static esp_err_t modbusRequest(uint8_t address, uint8_t command, uint16_t reg, uint16_t* value)
+{
+  mb_param_request_t request = {
+    .slave_addr = address,
+    .command    = command,
+    .reg_start  = reg,
+    .reg_size   = 1
+  };
+  return mbc_master_send_request(&request, (void*)value);
+}
+
+// Все используемые датчики почвы отвечают на заданной скорости
+static bool modbusBaudProbe(uint32_t baud)
+{
+  if (uart_set_baudrate(SENSOR_MODBUS_PORT, baud) != ESP_OK) return false;
+  vTaskDelay(pdMS_TO_TICKS(50));
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    if (wateringZonesHw[i].soil_address == 0) continue;
+    uint16_t value = 0;
+    if (modbusRequest(wateringZonesHw[i].soil_address, CWT_FUNC_READ, CWT_REG_SLAVE_ID, &value) != ESP_OK) {
+      return false;
+    };
+  };
+  return true;
+}
+
+// Запись кода скорости во все датчики; ошибки не прерывают запись в остальные датчики
+static bool modbusBaudWrite(uint32_t baud)
+{
+  bool ret = true;
+  uint16_t code = (uint16_t)modbusBaudCode(baud);
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    if (wateringZonesHw[i].soil_address == 0) continue;
+    esp_err_t err = modbusRequest(wateringZonesHw[i].soil_address, CWT_FUNC_WRITE, CWT_REG_BAUD_RATE, &code);
+    if (err != ESP_OK) {
+      rlog_e(logTAG, "Failed to set baud rate %" PRIu32 " for sensor 0x%.2x: %d %s", baud, wateringZonesHw[i].soil_address, err, esp_err_to_name(err));
+      ret = false;
+    };
+  };
+  return ret;
+}
+
+static void modbusBaudUart(uint32_t baud)
+{
+  uart_set_baudrate(SENSOR_MODBUS_PORT, baud);
+}
+
+// Определение текущей скорости датчиков и перевод их на CONFIG_WATERING_MODBUS_BAUD (порядок проверки скоростей
+// и возврат на прежнюю скорость - modbusBaudSetupBus()); в NVS сохраняется только проверенная рабочая скорость
+static void modbusBaudSetup()
+{
+  if (modbusBaudCode(CONFIG_WATERING_MODBUS_BAUD) < 0) {
+    rlog_e(logTAG, "Unsupported Modbus baud rate: %d", CONFIG_WATERING_MODBUS_BAUD);
+    return;
+  };
+
+  static const modbus_baud_bus_t bus = { modbusBaudProbe, modbusBaudWrite, modbusBaudUart };
+  uint32_t saved = SENSOR_MODBUS_SPEED;
+  nvsRead(SENSOR_MODBUS_NVS_SPACE, SENSOR_MODBUS_NVS_BAUD, OPT_TYPE_U32, &saved);
+  uint32_t detected, current;
+  modbus_baud_result_t result = modbusBaudSetupBus(&bus, saved, CONFIG_WATERING_MODBUS_BAUD, SENSOR_MODBUS_SPEED, &detected, &current);
+  if (result == MODBUS_BAUD_NOT_FOUND) {
+    rlog_e(logTAG, "Soil sensors do not respond at any baud rate, using %d", SENSOR_MODBUS_SPEED);
+    return;
+  };
+  rlog_i(logTAG, "Soil sensors detected at %" PRIu32 " baud", detected);
+  if (result == MODBUS_BAUD_SWITCHED) {
+    rlog_i(logTAG, "Soil sensors switched to %d baud", CONFIG_WATERING_MODBUS_BAUD);
+  } else if (result == MODBUS_BAUD_ROLLED_BACK) {
+    rlog_w(logTAG, "Soil sensors do not respond at %d baud, rolled back to %" PRIu32, CONFIG_WATERING_MODBUS_BAUD, current);
+  } else if (result == MODBUS_BAUD_LOST) {
+    rlog_e(logTAG, "Some soil sensors do not respond at %" PRIu32 " baud after rollback", current);
+  };
+
+  if (current != saved) {
+    nvsWrite(SENSOR_MODBUS_NVS_SPACE, SENSOR_MODBUS_NVS_BAUD, OPT_TYPE_U32, &current);
+  };
 }
 
+#endif // CONFIG_WATERING_MODBUS_BAUD_SETUP
+
 static void sensorsInitModbus()
 {
   rlog_i(logTAG, "Modbus initialization");
@@ -243,12 +655,83 @@ static void sensorsInitModbus()
   RE_OK_CHECK_EVENT(mbc_master_start(), return);
   // Set UART mode
   RE_OK_CHECK_EVENT(uart_set_mode(SENSOR_MODBUS_PORT, UART_MODE_RS485_HALF_DUPLEX), return);
+  #if CONFIG_WATERING_MODBUS_BAUD_SETUP
+    modbusBaudSetup();
+  #endif // CONFIG_WATERING_MODBUS_BAUD_SETUP
+}
+
+// Элемент сенсора с фильтром sensorFilter: фильтр применяется после преобразования значения элементом, поэтому 
+// встроенный фильтр rSensorItem должен быть отключен (SENSOR_FILTER_RAW). Необработанное значение публикуется без изменений
+template <class T>
+class rFilteredItem: public T {
+  public:
+    using T::T;
+    ~rFilteredItem() { sfilterFree(&_sfilter); };
+    bool setSFilter(sfilter_mode_t mode, uint16_t size) { return sfilterInit(&_sfilter, mode, size); };
+  protected:
+    value_t convertValue(const value_t rawValue) override { return sfilterAdd(&_sfilter, T::convertValue(rawValue)); };
+  private:
+    sfilter_t _sfilter = { SFILTER_NONE, 0, 0, 0, nullptr, nullptr, nullptr, 0, 0 };
+};
+
+#if CONFIG_WATERING_ZONES > 1
+
+// Датчики почвы дополнительных зон висят на той же шине Modbus, что и основной. Объекты создаются при запуске 
+// в статической памяти, рассчитанной на все зоны, без обращений к куче
+typedef struct {
+  alignas(rFilteredItem<rTemperatureItem>) uint8_t temp[sizeof(rFilteredItem<rTemperatureItem>)];
+  alignas(rFilteredItem<rSensorItem>) uint8_t mois[sizeof(rFilteredItem<rSensorItem>)];
+  alignas(reCWTSoilS) uint8_t soil[sizeof(reCWTSoilS)];
+} watering_zone_sensor_mem_t;
+
+static watering_zone_sensor_mem_t _zonesSensorMem[CONFIG_WATERING_ZONES - 1];
+
+static void sensorsInitZones()
+{
+  for (uint8_t i = 1; i < CONFIG_WATERING_ZONES; i++) {
+    const watering_zone_hw_t* hw = &wateringZonesHw[i];
+    if (hw->soil_address == 0) continue;
+
+    watering_zone_sensor_mem_t* mem = &_zonesSensorMem[i - 1];
+    rFilteredItem<rTemperatureItem>* itemTemp = new (mem->temp) rFilteredItem<rTemperatureItem>(nullptr, CONFIG_SENSOR_TEMP_NAME, CONFIG_FORMAT_TEMP_UNIT,
+      SENSOR_SOIL_FILTER_MODE, SENSOR_SOIL_FILTER_SIZE, 
+      CONFIG_FORMAT_TEMP_VALUE, CONFIG_FORMAT_TEMP_STRING,
+      #if CONFIG_SENSOR_TIMESTAMP_ENABLE
+        CONFIG_FORMAT_TIMESTAMP_L, 
+      #endif // CONFIG_SENSOR_TIMESTAMP_ENABLE
+      #if CONFIG_SENSOR_TIMESTRING_ENABLE  
+        CONFIG_FORMAT_TIMESTAMP_S, CONFIG_FORMAT_TSVALUE
+      #endif // CONFIG_SENSOR_TIMESTRING_ENABLE
+    );
+    rFilteredItem<rSensorItem>* itemMois = new (mem->mois) rFilteredItem<rSensorItem>(nullptr, CONFIG_SENSOR_MOISTURE_NAME, 
+      SENSOR_SOIL_FILTER_MODE, SENSOR_SOIL_FILTER_SIZE, 
+      CONFIG_FORMAT_MOISTURE_VALUE, CONFIG_FORMAT_MOISTURE_STRING,
+      #if CONFIG_SENSOR_TIMESTAMP_ENABLE
+        CONFIG_FORMAT_TIMESTAMP_L, 
+      #endif // CONFIG_SENSOR_TIMESTAMP_ENABLE
+      #if CONFIG_SENSOR_TIMESTRING_ENABLE  
+        CONFIG_FORMAT_TIMESTAMP_S, CONFIG_FORMAT_TSVALUE
+      #endif // CONFIG_SENSOR_TIMESTRING_ENABLE
+    );
+    reCWTSoilS* soil = new (mem->soil) reCWTSoilS(SENSOR_SOIL_ZONE_ID + i);
+    itemTemp->setSFilter(SENSOR_SOIL_SFILTER_MODE, SENSOR_SOIL_SFILTER_SIZE);
+    itemMois->setSFilter(SENSOR_SOIL_SFILTER_MODE, SENSOR_SOIL_SFILTER_SIZE);
+    soil->initExtItems(hw->name, hw->topic, false,
+      _modbus, hw->soil_address, SENSOR_SOIL_TYPE,
+      itemTemp, itemMois, nullptr, nullptr,
+      1000, SENSOR_SOIL_ERRORS_LIMIT, nullptr, sensorsPublish);
+    soil->registerParameters(pgSensors, hw->key, hw->topic, hw->name);
+    soil->nvsRestoreExtremums(hw->key);
+    _zones[i].soil = soil;
+  };
 }
 
+#endif // CONFIG_WATERING_ZONES > 1
+
 static void sensorsInitSensors()
 {
   // Почва
-  static rTemperatureItem siSoilTemp(nullptr, CONFIG_SENSOR_TEMP_NAME, CONFIG_FORMAT_TEMP_UNIT,
+  static rFilteredItem<rTemperatureItem> siSoilTemp(nullptr, CONFIG_SENSOR_TEMP_NAME, CONFIG_FORMAT_TEMP_UNIT,
     SENSOR_SOIL_FILTER_MODE, SENSOR_SOIL_FILTER_SIZE, 
     CONFIG_FORMAT_TEMP_VALUE, CONFIG_FORMAT_TEMP_STRING,
     #if CONFIG_SENSOR_TIMESTAMP_ENABLE
@@ -258,7 +741,7 @@ static void sensorsInitSensors()
       CONFIG_FORMAT_TIMESTAMP_S, CONFIG_FORMAT_TSVALUE
     #endif // CONFIG_SENSOR_TIMESTRING_ENABLE
   );
-  static rSensorItem siSoilMois(nullptr, CONFIG_SENSOR_MOISTURE_NAME, 
+  static rFilteredItem<rSensorItem> siSoilMois(nullptr, CONFIG_SENSOR_MOISTURE_NAME, 
     SENSOR_SOIL_FILTER_MODE, SENSOR_SOIL_FILTER_SIZE, 
     CONFIG_FORMAT_MOISTURE_VALUE, CONFIG_FORMAT_MOISTURE_STRING,
     #if CONFIG_SENSOR_TIMESTAMP_ENABLE
@@ -268,6 +751,8 @@ static void sensorsInitSensors()
       CONFIG_FORMAT_TIMESTAMP_S, CONFIG_FORMAT_TSVALUE
     #endif // CONFIG_SENSOR_TIMESTRING_ENABLE
   );
+  siSoilTemp.setSFilter(SENSOR_SOIL_SFILTER_MODE, SENSOR_SOIL_SFILTER_SIZE);
+  siSoilMois.setSFilter(SENSOR_SOIL_SFILTER_MODE, SENSOR_SOIL_SFILTER_SIZE);
   sensorSoil.initExtItems(SENSOR_SOIL_NAME, SENSOR_SOIL_TOPIC, false,
     _modbus, SENSOR_SOIL_ADDRESS, SENSOR_SOIL_TYPE,
     &siSoilTemp, &siSoilMois, nullptr, nullptr,
@@ -276,7 +761,7 @@ static void sensorsInitSensors()
   sensorSoil.nvsRestoreExtremums(SENSOR_SOIL_KEY);
 
   // Комната
-  static rTemperatureItem siIndoorTemp(nullptr, CONFIG_SENSOR_TEMP_NAME, CONFIG_FORMAT_TEMP_UNIT,
+  static rFilteredItem<rTemperatureItem> siIndoorTemp(nullptr, CONFIG_SENSOR_TEMP_NAME, CONFIG_FORMAT_TEMP_UNIT,
     SENSOR_INDOOR_FILTER_MODE, SENSOR_INDOOR_FILTER_SIZE, 
     CONFIG_FORMAT_TEMP_VALUE, CONFIG_FORMAT_TEMP_STRING,
     #if CONFIG_SENSOR_TIMESTAMP_ENABLE
@@ -286,7 +771,7 @@ static void sensorsInitSensors()
       CONFIG_FORMAT_TIMESTAMP_S, CONFIG_FORMAT_TSVALUE
     #endif // CONFIG_SENSOR_TIMESTRING_ENABLE
   );
-  static rSensorItem siIndoorHum(nullptr, CONFIG_SENSOR_HUMIDITY_NAME, 
+  static rFilteredItem<rSensorItem> siIndoorHum(nullptr, CONFIG_SENSOR_HUMIDITY_NAME, 
     SENSOR_INDOOR_FILTER_MODE, SENSOR_INDOOR_FILTER_SIZE, 
     CONFIG_FORMAT_HUMIDITY_VALUE, CONFIG_FORMAT_HUMIDITY_STRING,
     #if CONFIG_SENSOR_TIMESTAMP_ENABLE
@@ -296,6 +781,8 @@ static void sensorsInitSensors()
       CONFIG_FORMAT_TIMESTAMP_S, CONFIG_FORMAT_TSVALUE
     #endif // CONFIG_SENSOR_TIMESTRING_ENABLE
   );
+  siIndoorTemp.setSFilter(SENSOR_INDOOR_SFILTER_MODE, SENSOR_INDOOR_SFILTER_SIZE);
+  siIndoorHum.setSFilter(SENSOR_INDOOR_SFILTER_MODE, SENSOR_INDOOR_SFILTER_SIZE);
   sensorIndoor.initExtItems(SENSOR_INDOOR_NAME, SENSOR_INDOOR_TOPIC, false,
     SENSOR_INDOOR_BUS, HTU2X_RES_RH12_TEMP14, true,
     &siIndoorHum, &siIndoorTemp,
@@ -304,7 +791,7 @@ static void sensorsInitSensors()
   sensorIndoor.nvsRestoreExtremums(SENSOR_INDOOR_KEY);
 
   // Батареи отопления
-  static rTemperatureItem siHeatingTemp(nullptr, CONFIG_SENSOR_TEMP_NAME, CONFIG_FORMAT_TEMP_UNIT,
+  static rFilteredItem<rTemperatureItem> siHeatingTemp(nullptr, CONFIG_SENSOR_TEMP_NAME, CONFIG_FORMAT_TEMP_UNIT,
     SENSOR_HEATING_FILTER_MODE, SENSOR_HEATING_FILTER_SIZE, 
     CONFIG_FORMAT_TEMP_VALUE, CONFIG_FORMAT_TEMP_STRING,
     #if CONFIG_SENSOR_TIMESTAMP_ENABLE
@@ -314,6 +801,7 @@ static void sensorsInitSensors()
       CONFIG_FORMAT_TIMESTAMP_S, CONFIG_FORMAT_TSVALUE
     #endif // CONFIG_SENSOR_TIMESTRING_ENABLE
   );
+  siHeatingTemp.setSFilter(SENSOR_HEATING_SFILTER_MODE, SENSOR_HEATING_SFILTER_SIZE);
   sensorHeating.initExtItems(SENSOR_HEATING_NAME, SENSOR_HEATING_TOPIC, false,
     (gpio_num_t)SENSOR_HEATING_PIN, ONEWIRE_NONE, SENSOR_HEATING_INDEX, 
     DS18x20_RESOLUTION_12_BIT, true, 
@@ -322,416 +810,2942 @@ static void sensorsInitSensors()
   sensorHeating.registerParameters(pgSensors, SENSOR_HEATING_KEY, SENSOR_HEATING_TOPIC, SENSOR_HEATING_NAME);
   sensorHeating.nvsRestoreExtremums(SENSOR_HEATING_KEY);
 
+  #if CONFIG_WATERING_ZONES > 1
+    sensorsInitZones();
+  #endif // CONFIG_WATERING_ZONES > 1
+  nvsItemsInit();
+
   _sensorsNeedStore = false;
   espRegisterShutdownHandler(sensorsStoreData); // #2
 }
 
-// Текущие значения с сенсора почвы
-static float sensorsGetSoilTemp()
+// Текущие значения с сенсора почвы зоны
+static float sensorsGetZoneSoilTemp(uint8_t zone)
 {
-  if (sensorSoil.getStatus() == SENSOR_STATUS_OK) {
-    return sensorSoil.getValue1(false).filteredValue;
+  reCWTSoilS* soil = _zones[zone].soil;
+  if ((soil) && sensorsValueOk(soil, SENSOR_READ_SOIL)) {
+    return soil->getValue1(false).filteredValue;
   };
   return NAN;
 }
 
-static float sensorsGetSoilMoisture()
+static float sensorsGetZoneSoilMoisture(uint8_t zone)
 {
-  if (sensorSoil.getStatus() == SENSOR_STATUS_OK) {
-    return sensorSoil.getValue2(false).filteredValue;
+  reCWTSoilS* soil = _zones[zone].soil;
+  if ((soil) && sensorsValueOk(soil, SENSOR_READ_SOIL)) {
+    return soil->getValue2(false).filteredValue;
   };
   return NAN;
 }
 
+// Текущие значения с сенсора почвы основной зоны
+static float sensorsGetSoilTemp()
+{
+  return sensorsGetZoneSoilTemp(0);
+}
+
+static float sensorsGetSoilMoisture()
+{
+  return sensorsGetZoneSoilMoisture(0);
+}
+
 // -----------------------------------------------------------------------------------------------------------------------
-// ------------------------------------------------- Перелив или протечка ------------------------------------------------
+// ------------------------------------------------------ Учет памяти ----------------------------------------------------
 // -----------------------------------------------------------------------------------------------------------------------
-static void ledMode();
 
-static void waterleakInit()
+// Подсистемы, между которыми распределяется занятая куча
+typedef enum {
+  HEAP_SENSORS = 0,
+  HEAP_WATERING,
+  HEAP_MQTT,
+  HEAP_TELEGRAM,
+  HEAP_COUNT
+} heap_subsys_t;
+
+// Отметка начала области: свободная куча и сумма изменений, уже учтенных во вложенных областях
+typedef struct {
+  size_t  free;
+  int32_t nested;
+} heap_mark_t;
+
+#if CONFIG_WATERING_HEAP_ACCOUNTING
+
+typedef struct {
+  int32_t  retained;      // Удерживаемая подсистемой память (сумма изменений свободной кучи), байт
+  int32_t  peak;          // Максимум удерживаемой памяти
+  uint32_t grows;         // Количество областей, после которых куча уменьшилась
+} heap_usage_t;
+
+static const char* _heapNames[HEAP_COUNT] = { "sensors", "watering", "mqtt", "telegram" };
+static heap_usage_t _heapUsage[HEAP_COUNT];
+static int32_t _heapNested = 0;
+static size_t _heapLargestMin = SIZE_MAX;
+static bool _heapWarning = false;
+
+#endif // CONFIG_WATERING_HEAP_ACCOUNTING
+
+// Изменение свободной кучи между heapBegin() и heapEnd() относится к подсистеме за вычетом вложенных областей. 
+// Куча общая, поэтому выделения других задач, попавшие в эти интервалы, тоже будут учтены - оценка приблизительная
+static inline heap_mark_t heapBegin()
 {
-  gpio_reset_pin((gpio_num_t)CONFIG_WATER_LEAK_GPIO1);
-  gpio_reset_pin((gpio_num_t)CONFIG_WATER_LEAK_GPIO2);
-  gpio_reset_pin((gpio_num_t)CONFIG_WATER_LEAK_GPIO3);
-  gpio_reset_pin((gpio_num_t)CONFIG_WATER_LEAK_ACTVATOR);
-  gpio_set_direction((gpio_num_t)CONFIG_WATER_LEAK_GPIO1, GPIO_MODE_INPUT);
-  gpio_set_direction((gpio_num_t)CONFIG_WATER_LEAK_GPIO2, GPIO_MODE_INPUT);
-  gpio_set_direction((gpio_num_t)CONFIG_WATER_LEAK_GPIO3, GPIO_MODE_INPUT);
-  gpio_set_direction((gpio_num_t)CONFIG_WATER_LEAK_ACTVATOR, GPIO_MODE_OUTPUT);
-  gpio_set_level((gpio_num_t)CONFIG_WATER_LEAK_ACTVATOR, CONFIG_WATER_LEAK_ACT_OFF);
+  heap_mark_t mark = { 0, 0 };
+  #if CONFIG_WATERING_HEAP_ACCOUNTING
+    mark.free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    mark.nested = _heapNested;
+  #endif // CONFIG_WATERING_HEAP_ACCOUNTING
+  return mark;
 }
 
-void waterleakSendNotify(bool leak, uint8_t input)
+static inline void heapEnd(heap_subsys_t id, heap_mark_t mark)
 {
-  #if CONFIG_TELEGRAM_ENABLE
-    if (waterleakNotify > NOTIFY_OFF) {
-      if (leak) {
-        tgSend(CONFIG_WATERING_NOTIFY_KIND, CONFIG_WATERING_NOTIFY_PRIORITY, waterleakNotify == NOTIFY_SOUND, CONFIG_TELEGRAM_DEVICE, 
-          "⚠ <b>Внимание!</b> Обнаружен перелив по входу #<b>%d</b>", input);
-      } else {
-        tgSend(CONFIG_WATERING_NOTIFY_KIND, CONFIG_WATERING_NOTIFY_PRIORITY, waterleakNotify == NOTIFY_SOUND, CONFIG_TELEGRAM_DEVICE, 
-          "✅ Перелив по входу #<b>%d</b> устранён", input);
-      };
+  #if CONFIG_WATERING_HEAP_ACCOUNTING
+    int32_t delta = (int32_t)mark.free - (int32_t)heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    int32_t own = delta;
+    // Вложенность отслеживается только в задаче полива, обработчики событий учитываются целиком
+    if ((_wateringTask == nullptr) || (xTaskGetCurrentTaskHandle() == _wateringTask)) {
+      own = delta - (_heapNested - mark.nested);
+      _heapNested = mark.nested + delta;
     };
-  #endif // CONFIG_TELEGRAM_ENABLE
+    heap_usage_t* usage = &_heapUsage[id];
+    usage->retained += own;
+    if (usage->retained > usage->peak) usage->peak = usage->retained;
+    if (own > 0) usage->grows++;
+  #endif // CONFIG_WATERING_HEAP_ACCOUNTING
 }
 
-void sensorsWaterLeakMqttPublish()
+#if CONFIG_WATERING_HEAP_ACCOUNTING
+
+static void heapMqttPublish()
 {
-  mqttPublish(mqttGetTopicDevice1(mqttIsPrimary(), false, CONFIG_WATER_LEAK_TOPIC), 
-    malloc_stringf("{\"channel1\":%d,\"channel2\":%d,\"channel3\":%d}", 
-      ((xEventGroupGetBits(_wateringFlags) & WATER_LEAK_IN1) > 0),
-      ((xEventGroupGetBits(_wateringFlags) & WATER_LEAK_IN2) > 0),
-      ((xEventGroupGetBits(_wateringFlags) & WATER_LEAK_IN3) > 0)), 
-    CONFIG_MQTT_LOAD_QOS, CONFIG_MQTT_LOAD_RETAINED, true, true);
-}
-
-static uint32_t waterleakCount1 = 0;
-static uint32_t waterleakCount2 = 0;
-static uint32_t waterleakCount3 = 0;
-
-static void sensorsCheckWaterLeak(gpio_num_t pin, EventBits_t bit, uint8_t num, uint32_t* counter)
-{
-  // Читаем состояние входа
-  gpio_set_pull_mode(pin, GPIO_PULLUP_ONLY);
-  vTaskDelay(CONFIG_WATER_LEAK_DELAY_ON);
-  bool wleak = gpio_get_level(pin) == CONFIG_WATER_LEAK_LEVEL;
-  gpio_set_pull_mode(pin, GPIO_FLOATING);
-  rlog_d(logTAG, "Water leak control #%d: %d", num, wleak);
-
-  // Если перелив имеется, сбрасываем счетчик в любом случае
-  if ((*counter > 0) && wleak) { 
-    *counter = 0; 
-  };
-  // Сверяемся с текущим значением
-  if (wleak != ((xEventGroupGetBits(_wateringFlags) & bit) > 0)) {
-    if (wleak) {
-      // Устанавливаем признак перелива немедленно
-      xEventGroupSetBits(_wateringFlags, bit);
-      waterleakSendNotify(wleak, num);
-      sensorsWaterLeakMqttPublish();
-      ledMode();
-    } else {
-      // Требуется подтверждение waterleakDebounceCount раз, дабы не было "метаний туда и обратно"
-      *counter = *counter + 1;
-      if (*counter >= waterleakDebounceCount) {
-        xEventGroupClearBits(_wateringFlags, bit);
-        waterleakSendNotify(wleak, num);
-        sensorsWaterLeakMqttPublish();
-        ledMode();
-      };
+  static char buf[CONFIG_HEAP_STATS_SIZE];
+  size_t free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  int len = snprintf(buf, sizeof(buf), 
+    "{\"free\":%zu,\"min_free\":%zu,\"largest\":%zu,\"largest_min\":%zu,\"fragmentation\":%.1f,\"warning\":%d,\"subsystems\":{",
+    free, heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT), largest, _heapLargestMin == SIZE_MAX ? largest : _heapLargestMin, 
+    free > 0 ? 100.0 * (1.0 - (double)largest / (double)free) : 0.0, _heapWarning);
+  for (uint8_t i = 0; i < HEAP_COUNT; i++) {
+    if ((len < 0) || (len >= (int)sizeof(buf))) break;
+    len += snprintf(buf + len, sizeof(buf) - len, "%s\"%s\":{\"retained\":%" PRId32 ",\"peak\":%" PRId32 ",\"grows\":%" PRIu32 "}", 
+      i > 0 ? "," : "", _heapNames[i], _heapUsage[i].retained, _heapUsage[i].peak, _heapUsage[i].grows);
+  };
+  if ((len < 0) || (len + 3 > (int)sizeof(buf))) {
+    rlog_w(logTAG, "Heap statistics do not fit into the buffer");
+    return;
+  };
+  snprintf(buf + len, sizeof(buf) - len, "}}");
+  mqttPublish(mqttTopic(TOPIC_HEAP), buf, 
+    CONFIG_MQTT_SENSORS_QOS, CONFIG_MQTT_SENSORS_RETAINED, false, false);
+}
+
+// Проверка запаса памяти в каждом цикле. Ошибка выделения памяти приводит к перезапуску устройства
+// (CONFIG_HEAP_ALLOC_FAILED_RESTART), поэтому предупреждение выдается заранее; снимается с запасом 25%
+static void heapCheck()
+{
+  size_t free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  if (largest < _heapLargestMin) _heapLargestMin = largest;
+  if (!_heapWarning) {
+    if ((free < CONFIG_WATERING_HEAP_WARN_FREE) || (largest < CONFIG_WATERING_HEAP_WARN_BLOCK)) {
+      _heapWarning = true;
+      rlog_w(logTAG, "Heap is running low: free %zu bytes, largest block %zu bytes", free, largest);
+      if (mqttIsConnected()) heapMqttPublish();
     };
+  } else if ((free > CONFIG_WATERING_HEAP_WARN_FREE * 5 / 4) && (largest > CONFIG_WATERING_HEAP_WARN_BLOCK * 5 / 4)) {
+    _heapWarning = false;
+    rlog_i(logTAG, "Heap has recovered: free %zu bytes, largest block %zu bytes", free, largest);
   };
 }
 
-static bool sensorsGetWaterLeaks()
+#endif // CONFIG_WATERING_HEAP_ACCOUNTING
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------- Профилирование ---------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+typedef enum {
+  PROFILE_CYCLE = 0,
+  PROFILE_READ,
+  PROFILE_SOIL,
+  PROFILE_INDOOR,
+  PROFILE_HEATING,
+  PROFILE_CONTROL,
+  PROFILE_NVS,
+  PROFILE_MQTT,
+  PROFILE_OPENMON,
+  PROFILE_NARODMON,
+  PROFILE_THINGSPEAK,
+  PROFILE_COUNT
+} profile_id_t;
+
+#if CONFIG_WATERING_PROFILE
+
+static const char* _profileNames[PROFILE_COUNT] = { 
+  "cycle", "read", "soil", "indoor", "heating", "control", "nvs", "mqtt", "openmon", "narodmon", "thingspeak" 
+};
+static profile_phase_t _profile[PROFILE_COUNT];
+
+// Фазы чтения сенсоров записываются из задач чтения (CONFIG_WATERING_PARALLEL_READ)
+static EventBits_t wateringProfileReader(uint8_t id)
 {
-  EventBits_t wlBits = 0x0;
-  if (waterleakSensorEnabled1) wlBits |= WATER_LEAK_IN1;
-  if (waterleakSensorEnabled2) wlBits |= WATER_LEAK_IN2;
-  if (waterleakSensorEnabled3) wlBits |= WATER_LEAK_IN3;
-  return (xEventGroupGetBits(_wateringFlags) & wlBits) > 0;
+  switch (id) {
+    case PROFILE_SOIL:    return SENSOR_READ_SOIL;
+    case PROFILE_INDOOR:  return SENSOR_READ_INDOOR;
+    case PROFILE_HEATING: return SENSOR_READ_HEATING;
+    default:              return 0;
+  };
 }
 
-static bool sensorsCheckWaterLeaks()
+// Статистика накапливается между публикациями. Фаза, задача чтения которой еще не ответила, может изменяться
+// прямо сейчас: она не публикуется и не сбрасывается, а попадет в одну из следующих публикаций целиком
+static void wateringProfileMqttPublish()
 {
-  // Читаем состояние входов
-  if (waterleakSensorEnabled1) {
-    sensorsCheckWaterLeak((gpio_num_t)CONFIG_WATER_LEAK_GPIO1, WATER_LEAK_IN1, 1, &waterleakCount1);
-    vTaskDelay(CONFIG_WATER_LEAK_DELAY_OFF);
+  static char buf[CONFIG_PROFILE_STATS_SIZE];
+  int len = snprintf(buf, sizeof(buf), "{");
+  for (uint8_t i = 0; i < PROFILE_COUNT; i++) {
+    const profile_phase_t* phase = &_profile[i];
+    if ((phase->count == 0) || sensorsReadBusy(wateringProfileReader(i))) continue;
+    if ((len < 0) || (len >= (int)sizeof(buf))) break;
+    len += snprintf(buf + len, sizeof(buf) - len, "%s\"%s\":{\"count\":%" PRIu32 ",\"min\":%" PRIu32 ",\"avg\":%" PRIu32 ",\"max\":%" PRIu32 ",\"p99\":%" PRIu32 "}",
+      len > 1 ? "," : "", _profileNames[i], phase->count, phase->min_us, (uint32_t)(phase->sum_us / phase->count), 
+      phase->max_us, profilePercentile(phase, 99));
   };
-  if (waterleakSensorEnabled2) {
-    sensorsCheckWaterLeak((gpio_num_t)CONFIG_WATER_LEAK_GPIO2, WATER_LEAK_IN2, 2, &waterleakCount2);
-    vTaskDelay(CONFIG_WATER_LEAK_DELAY_OFF);
+  if ((len < 0) || (len + 2 > (int)sizeof(buf))) {
+    rlog_w(logTAG, "Profile statistics do not fit into the buffer");
+  } else if (len > 1) {
+    snprintf(buf + len, sizeof(buf) - len, "}");
+    mqttPublish(mqttTopic(TOPIC_PROFILE), buf, 
+      CONFIG_MQTT_SENSORS_QOS, CONFIG_MQTT_SENSORS_RETAINED, false, false);
   };
-  if (waterleakSensorEnabled3) {
-    sensorsCheckWaterLeak((gpio_num_t)CONFIG_WATER_LEAK_GPIO3, WATER_LEAK_IN2, 3, &waterleakCount3);
+  for (uint8_t i = 0; i < PROFILE_COUNT; i++) {
+    if (!sensorsReadBusy(wateringProfileReader(i))) profileReset(&_profile[i]);
   };
+}
 
-  // Возвращаем true, если есть перелив
-  bool wleaks = sensorsGetWaterLeaks();
-  rlog_d(logTAG, "Water leak control summary: %d", wleaks);
-  return wleaks;
+#endif // CONFIG_WATERING_PROFILE
+
+static inline void wateringProfile(profile_id_t id, int64_t started)
+{
+  #if CONFIG_WATERING_PROFILE
+    profileAdd(&_profile[id], (uint32_t)(esp_timer_get_time() - started));
+  #endif // CONFIG_WATERING_PROFILE
 }
 
 // -----------------------------------------------------------------------------------------------------------------------
-// ----------------------------------------------------- Уровень воды ----------------------------------------------------
+// ---------------------------------------------------- Журнал событий ---------------------------------------------------
 // -----------------------------------------------------------------------------------------------------------------------
 
-static reGPIO gpioWaterLevel(CONFIG_WATER_LEVEL_GPIO, CONFIG_WATER_LEVEL_LEVEL, CONFIG_WATER_LEVEL_PULL, CONFIG_WATER_LEVEL_INTR, CONFIG_WATER_LEVEL_DEBOUNCE, nullptr);
+typedef enum {
+  JOURNAL_LEAK_ON = 0,    // source - номер входа
+  JOURNAL_LEAK_OFF,
+  JOURNAL_LEVEL_LOW,
+  JOURNAL_LEVEL_OK,
+  JOURNAL_PUMP_ON,        // source - зона
+  JOURNAL_PUMP_OFF,       // source - зона, value - время работы, с
+  JOURNAL_SENSOR,         // source - сенсор (JOURNAL_SENSOR_*: почва зон 0..N-1, помещение, отопление), value - sensor_status_t
+  JOURNAL_HEALTH_BAD,     // source - индекс в таблице исправности сенсоров (HEALTH_*), value - оценка
+  JOURNAL_HEALTH_OK,
+  JOURNAL_COUNT
+} journal_event_t;
 
-static time_t lastLowLevelNotify = 0;
+// Сенсоры нумеруются так же, как в таблице исправности: датчики почвы всех зон, затем датчики в помещении и на батареях
+#define JOURNAL_SENSOR_INDOOR CONFIG_WATERING_ZONES
+#define JOURNAL_SENSOR_HEATING (CONFIG_WATERING_ZONES + 1)
+#define JOURNAL_SENSOR_COUNT  (CONFIG_WATERING_ZONES + 2)
 
-void waterLowLevelNotify(bool level)
+#if CONFIG_WATERING_JOURNAL
+
+static_assert((CONFIG_WATERING_JOURNAL_SIZE & (CONFIG_WATERING_JOURNAL_SIZE - 1)) == 0, 
+  "CONFIG_WATERING_JOURNAL_SIZE must be a power of two");
+
+static const char* _journalNames[JOURNAL_COUNT] = { 
+  "leak_on", "leak_off", "level_low", "level_ok", "pump_on", "pump_off", "sensor", "health_bad", "health_ok" 
+};
+
+typedef struct {
+  uint32_t seq;           // Номер записи + 1; пока запись заполняется - 0
+  uint8_t  event;
+  uint8_t  source;
+  uint16_t value;
+  int64_t  time_us;       // esp_timer_get_time()
+} journal_entry_t;
+
+static journal_entry_t _journal[CONFIG_WATERING_JOURNAL_SIZE];
+static uint32_t _journalNext = 0;
+static uint32_t _journalDumpFrom = 0;
+static volatile bool _journalDumpPending = false;
+static uint8_t _journalSensors[JOURNAL_SENSOR_COUNT] = { SENSOR_STATUS_NO_INIT };
+static char _journalBuf[CONFIG_JOURNAL_CHUNK_SIZE];
+
+#endif // CONFIG_WATERING_JOURNAL
+
+// Добавление записи без блокировок, из любой задачи или обработчика прерывания: номер записи выделяется атомарно,
+// а готовность записи публикуется полем seq. При переполнении перезаписываются самые старые записи
+static inline void journalAdd(journal_event_t event, uint8_t source, uint16_t value)
 {
-  #if CONFIG_TELEGRAM_ENABLE
-    if (waterlevelNotify > NOTIFY_OFF) {
-      if (level) {
-        tgSend(CONFIG_WATERING_NOTIFY_KIND, CONFIG_WATERING_NOTIFY_PRIORITY, waterlevelNotify == NOTIFY_SOUND, CONFIG_TELEGRAM_DEVICE, 
-          "✅ Уровень воды в норме");
-      } else {
-        tgSend(CONFIG_WATERING_NOTIFY_KIND, CONFIG_WATERING_NOTIFY_PRIORITY, waterlevelNotify == NOTIFY_SOUND, CONFIG_TELEGRAM_DEVICE, 
-          "⚠ <b>Внимание!</b> Низкий уровень воды в ёмкости!");
-      };
+  #if CONFIG_WATERING_JOURNAL
+    int64_t now = esp_timer_get_time();
+    uint32_t index = __atomic_fetch_add(&_journalNext, 1, __ATOMIC_RELAXED);
+    journal_entry_t* entry = &_journal[index & (CONFIG_WATERING_JOURNAL_SIZE - 1)];
+    __atomic_store_n(&entry->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    entry->event = event;
+    entry->source = source;
+    entry->value = value;
+    entry->time_us = now;
+    __atomic_store_n(&entry->seq, index + 1, __ATOMIC_RELEASE);
+  #endif // CONFIG_WATERING_JOURNAL
+}
+
+// Записывается только изменение состояния сенсора
+static inline void journalSensorStatus(uint8_t index, rSensor* sensor)
+{
+  #if CONFIG_WATERING_JOURNAL
+    uint8_t status = sensor->getStatus();
+    if (status != _journalSensors[index]) {
+      _journalSensors[index] = status;
+      journalAdd(JOURNAL_SENSOR, index, status);
     };
-  #endif // CONFIG_TELEGRAM_ENABLE
+  #endif // CONFIG_WATERING_JOURNAL
 }
 
-void sensorsWaterLevelMqttPublish() 
+#if CONFIG_WATERING_JOURNAL
+
+// Копия записи index; false, если запись еще не заполнена или уже перезаписана
+static bool journalRead(uint32_t index, journal_entry_t* entry)
 {
-  mqttPublish(mqttGetTopicDevice1(mqttIsPrimary(), false, CONFIG_WATER_LEVEL_TOPIC), 
-    malloc_stringf("{\"status\":%d}", 
-      !(xEventGroupGetBits(_wateringFlags) & WATER_LEVEL_LOW)), 
-    CONFIG_MQTT_LOAD_QOS, CONFIG_MQTT_LOAD_RETAINED, true, true);
+  const journal_entry_t* src = &_journal[index & (CONFIG_WATERING_JOURNAL_SIZE - 1)];
+  if (__atomic_load_n(&src->seq, __ATOMIC_ACQUIRE) != index + 1) return false;
+  entry->event = src->event;
+  entry->source = src->source;
+  entry->value = src->value;
+  entry->time_us = src->time_us;
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&src->seq, __ATOMIC_RELAXED) == index + 1;
 }
 
-static bool sensorsCheckWaterLevel()
+// Запрос журнала командой: "journal" - весь журнал; "journal <номер>" - начиная с записи с указанным номером
+static void journalCommand(const char* from)
 {
-  time_t now = time(nullptr);
-  bool level = true;
-  if (waterlevelSensorEnabled) {
-    level = (xEventGroupGetBits(_wateringFlags) & WATER_LEVEL_LOW) == 0;
-  };
-  if (xEventGroupGetBits(_wateringFlags) & WATER_LEVEL_CHANGED) {
-    xEventGroupClearBits(_wateringFlags, WATER_LEVEL_CHANGED);
-    lastLowLevelNotify = now;
-    ledMode();
-    sensorsWaterLevelMqttPublish();
-    waterLowLevelNotify(level);
-  } else {
-    if (!level && ((now - lastLowLevelNotify) >= CONFIG_WATERING_NOTIFY_PERIOD)) {
-      lastLowLevelNotify = now;
-      waterLowLevelNotify(level);
-      ledMode();
+  _journalDumpFrom = from ? (uint32_t)strtoul(from, nullptr, 10) : 0;
+  _journalDumpPending = true;
+  rlog_i(logTAG, "Journal requested from %" PRIu32, _journalDumpFrom);
+}
+
+// Выгрузка порциями: {"now":мкс,"time":unixtime,"next":..,"data":[[номер,мкс,"событие",источник,значение],..]}.
+// По now и time получатель переводит метки esp_timer во время устройства
+static void journalMqttDump()
+{
+  if (!_journalDumpPending) return;
+  char* topic = mqttTopic(TOPIC_JOURNAL);
+  if (topic == nullptr) return;
+
+  uint32_t next = __atomic_load_n(&_journalNext, __ATOMIC_ACQUIRE);
+  uint32_t index = _journalDumpFrom;
+  if (index > next) index = next;
+  if (next - index > CONFIG_WATERING_JOURNAL_SIZE) index = next - CONFIG_WATERING_JOURNAL_SIZE;
+  uint8_t chunks = 0;
+  do {
+    int len = snprintf(_journalBuf, sizeof(_journalBuf), "{\"now\":%lld,\"time\":%" PRIu32 ",\"next\":%" PRIu32 ",\"data\":[", 
+      (long long)esp_timer_get_time(), (uint32_t)time(nullptr), next);
+    bool first = true;
+    journal_entry_t entry;
+    while (index < next) {
+      // Записи, которые заполняются прямо сейчас, будут отправлены в следующем цикле
+      if (!journalRead(index, &entry)) {
+        if (next - index <= CONFIG_WATERING_JOURNAL_SIZE / 2) break;
+        index++;
+        continue;
+      };
+      char row[64];
+      int rowLen = snprintf(row, sizeof(row), "%s[%" PRIu32 ",%lld,\"%s\",%u,%u]", first ? "" : ",",
+        index, (long long)entry.time_us, entry.event < JOURNAL_COUNT ? _journalNames[entry.event] : "?", entry.source, entry.value);
+      if (len + rowLen + 3 > (int)sizeof(_journalBuf)) break;
+      memcpy(_journalBuf + len, row, rowLen);
+      len += rowLen;
+      first = false;
+      index++;
     };
-  };
-  return level;
+    if (first && (index < next)) return;
+    snprintf(_journalBuf + len, sizeof(_journalBuf) - len, "]}");
+    if (mqttPublish(topic, _journalBuf, CONFIG_MQTT_SENSORS_QOS, false, false, false) != ESP_OK) return;
+    _journalDumpFrom = index;
+    if ((index < next) && (++chunks >= CONFIG_HISTORY_DRAIN_CHUNKS)) return;
+  } while (index < next);
+  _journalDumpPending = false;
 }
 
-// -----------------------------------------------------------------------------------------------------------------------
-// -------------------------------------------------------- Входы --------------------------------------------------------
-// -----------------------------------------------------------------------------------------------------------------------
+#endif // CONFIG_WATERING_JOURNAL
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ----------------------------------------------- Чтение данных с сенсоров ----------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------------------------------------------
+// Расписание опроса: каждый сенсор читается со своим периодом, период почвы зависит от состояния полива
+
+#define SENSOR_SCHEDULE_COUNT 3
+#define SENSOR_SCHEDULE_GAP   100000  // Допуск на неточность пробуждения задачи, мкс
+
+// Время последнего чтения каждого сенсора (в порядке битов SENSOR_READ_*), мкс
+static int64_t _sensorsReadLast[SENSOR_SCHEDULE_COUNT] = { 0, 0, 0 };
+
+#if CONFIG_WATERING_ADAPTIVE_READ
+
+static bool relaysPumpIsOn();
+
+// Часто - пока работает полив хотя бы в одной зоне или влажность любой из зон близка к одному из её порогов, 
+// редко - когда до порогов далеко во всех зонах
+static uint32_t sensorsSoilInterval()
+{
+  if (relaysPumpIsOn()) return sensorsSoilFastInterval;
+  uint32_t interval = sensorsSoilSlowInterval;
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    if (_zones[i].soil == nullptr) continue;
+    float moisture = sensorsGetZoneSoilMoisture(i);
+    if (isnan(moisture)) {
+      if (_sensorsReadInterval < interval) interval = _sensorsReadInterval;
+    } else if ((fabsf(moisture - wateringZones[i].moisture_min) <= sensorsSoilNearBand) 
+            || (fabsf(moisture - wateringZones[i].moisture_max) <= sensorsSoilNearBand)) {
+      return sensorsSoilFastInterval;
+    };
+  };
+  return interval;
+}
+
+#endif // CONFIG_WATERING_ADAPTIVE_READ
+
+// Период опроса сенсора в секундах
+static uint32_t sensorsReadPeriod(uint8_t index)
+{
+  uint32_t period = _sensorsReadInterval;
+  #if CONFIG_WATERING_ADAPTIVE_READ
+    switch (index) {
+      case 0: period = sensorsSoilInterval(); break;
+      case 1: period = sensorsIndoorInterval; break;
+      case 2: period = sensorsHeatingInterval; break;
+    };
+  #endif // CONFIG_WATERING_ADAPTIVE_READ
+  return period > 0 ? period : 1;
+}
+
+// Сенсоры, которые пора опросить
+static EventBits_t sensorsReadDue(int64_t now)
+{
+  EventBits_t due = 0;
+  for (uint8_t i = 0; i < SENSOR_SCHEDULE_COUNT; i++) {
+    if ((_sensorsReadLast[i] == 0) 
+     || (now - _sensorsReadLast[i] + SENSOR_SCHEDULE_GAP >= (int64_t)sensorsReadPeriod(i) * 1000000LL)) {
+      due |= (1 << i);
+    };
+  };
+  return due;
+}
+
+// Период отсчитывается от момента запроса, а не от окончания чтения, чтобы длительность чтения не сдвигала расписание
+static void sensorsReadDone(EventBits_t due, int64_t started)
+{
+  for (uint8_t i = 0; i < SENSOR_SCHEDULE_COUNT; i++) {
+    if (due & (1 << i)) _sensorsReadLast[i] = started;
+  };
+}
+
+// Время до следующего планового опроса, мс (не больше базового периода, чтобы не задерживать управление и публикацию)
+static uint32_t sensorsReadWait()
+{
+  int64_t now = esp_timer_get_time();
+  int64_t wait = (int64_t)_sensorsReadInterval * 1000000LL;
+  for (uint8_t i = 0; i < SENSOR_SCHEDULE_COUNT; i++) {
+    int64_t left = _sensorsReadLast[i] + (int64_t)sensorsReadPeriod(i) * 1000000LL - now;
+    if (left < wait) wait = left;
+  };
+  return wait > 0 ? (uint32_t)(wait / 1000) : 0;
+}
+
+#if CONFIG_WATERING_MODBUS_SCHEDULER
+
+static modbus_slave_t _modbusSlaves[CONFIG_WATERING_ZONES];
+static modbus_bus_t _modbusBus = { CONFIG_WATERING_MODBUS_RETRY_MIN, CONFIG_WATERING_MODBUS_RETRY_MAX, 0, 0 };
+
+// Порядок опроса и пропуски определяет планировщик (modbusSchedule.h), здесь - только чтение датчиков
+static void sensorsReadSoil()
+{
+  int64_t readStarted = esp_timer_get_time();
+  uint32_t present = 0;
+  uint32_t active = 0;
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    if (_zones[i].soil) present |= (1UL << i);
+    if ((_zones[i].load) && (_zones[i].load->getState())) active |= (1UL << i);
+  };
+  uint8_t order[CONFIG_WATERING_ZONES];
+  uint8_t count = modbusScheduleOrder(&_modbusBus, _modbusSlaves, CONFIG_WATERING_ZONES, present, active, readStarted, order);
+  for (uint8_t n = 0; n < count; n++) {
+    uint8_t i = order[n];
+    int64_t started = esp_timer_get_time();
+    bool ok = _zones[i].soil->readData() == SENSOR_STATUS_OK;
+    modbusSlaveDone(&_modbusBus, &_modbusSlaves[i], ok, started, esp_timer_get_time());
+  };
+  wateringProfile(PROFILE_SOIL, readStarted);
+}
+
+// Статистика шины: загрузка за время с предыдущей публикации и задержки по каждому датчику
+static void modbusMqttPublish()
+{
+  static char buf[CONFIG_MODBUS_STATS_SIZE];
+  if (sensorsReadBusy(SENSOR_READ_SOIL)) return;
+  int64_t now = esp_timer_get_time();
+  float util = modbusBusUtilization(&_modbusBus, now);
+  int len = snprintf(buf, sizeof(buf), "{\"util\":%.2f,\"slaves\":[", util);
+  bool first = true;
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    if (_zones[i].soil == nullptr) continue;
+    const modbus_slave_t* slave = &_modbusSlaves[i];
+    if ((len < 0) || (len >= (int)sizeof(buf))) break;
+    len += snprintf(buf + len, sizeof(buf) - len, 
+      "%s{\"address\":%d,\"requests\":%" PRIu32 ",\"errors\":%" PRIu32 ",\"skipped\":%" PRIu32 ",\"failures\":%d,"
+      "\"last\":%" PRIu32 ",\"avg\":%" PRIu32 ",\"max\":%" PRIu32 "}",
+      first ? "" : ",", wateringZonesHw[i].soil_address, slave->requests, slave->errors, slave->skipped, slave->failures, 
+      slave->latency_last, slave->requests > 0 ? (uint32_t)(slave->latency_sum / slave->requests) : 0, slave->latency_max);
+    first = false;
+  };
+  if ((len < 0) || (len + 3 > (int)sizeof(buf))) {
+    rlog_w(logTAG, "Modbus statistics do not fit into the buffer");
+    return;
+  };
+  snprintf(buf + len, sizeof(buf) - len, "]}");
+  modbusBusWindowReset(&_modbusBus, now);
+  mqttPublish(mqttTopic(TOPIC_MODBUS), buf, 
+    CONFIG_MQTT_SENSORS_QOS, CONFIG_MQTT_SENSORS_RETAINED, false, false);
+}
+
+#else
+
+// Датчики почвы всех зон на одной шине, поэтому опрашиваются последовательно
+static void sensorsReadSoil()
+{
+  int64_t started = esp_timer_get_time();
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    if (_zones[i].soil) _zones[i].soil->readData();
+  };
+  wateringProfile(PROFILE_SOIL, started);
+}
+
+#endif // CONFIG_WATERING_MODBUS_SCHEDULER
+
+static void sensorsReadIndoor()
+{
+  int64_t started = esp_timer_get_time();
+  sensorIndoor.readData();
+  wateringProfile(PROFILE_INDOOR, started);
+}
+
+static void sensorsReadHeating()
+{
+  int64_t started = esp_timer_get_time();
+  sensorHeating.readData();
+  wateringProfile(PROFILE_HEATING, started);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+
+#if CONFIG_WATERING_PARALLEL_READ
+
+// Чтение завершено (выставляет задача чтения)
+#define SENSOR_DONE_SHIFT     4
+#define SENSOR_DONE_ALL       (SENSOR_READ_ALL << SENSOR_DONE_SHIFT)
+
+typedef struct {
+  void (*read)();
+  const char* task_name;
+  EventBits_t bit_read;
+  TaskHandle_t task;
+} sensor_reader_t;
+
+// Каждый тип сенсоров висит на своей шине, поэтому читать их можно одновременно
+static sensor_reader_t _sensorsReaders[] = {
+  { sensorsReadSoil,    "rd_soil",    SENSOR_READ_SOIL,    nullptr },
+  { sensorsReadIndoor,  "rd_indoor",  SENSOR_READ_INDOOR,  nullptr },
+  { sensorsReadHeating, "rd_heating", SENSOR_READ_HEATING, nullptr }
+};
+#define SENSOR_READERS_COUNT  (sizeof(_sensorsReaders) / sizeof(sensor_reader_t))
+
+static EventGroupHandle_t _sensorsReadFlags = nullptr;
+
+static void sensorsReaderExec(void *pvParameters)
+{
+  sensor_reader_t* reader = (sensor_reader_t*)pvParameters;
+  while (1) {
+    xEventGroupWaitBits(_sensorsReadFlags, reader->bit_read, pdTRUE, pdTRUE, portMAX_DELAY);
+    reader->read();
+    xEventGroupSetBits(_sensorsReadFlags, reader->bit_read << SENSOR_DONE_SHIFT);
+  };
+  vTaskDelete(nullptr);
+}
+
+static bool sensorsReadersStart()
+{
+  #if CONFIG_WATERING_STATIC_ALLOCATION
+    static StaticEventGroup_t sensorsReadFlagsBuffer;
+    static StaticTask_t readerTaskBuffer[SENSOR_READERS_COUNT];
+    static StackType_t readerTaskStack[SENSOR_READERS_COUNT][CONFIG_WATERING_READER_STACK_SIZE];
+    _sensorsReadFlags = xEventGroupCreateStatic(&sensorsReadFlagsBuffer);
+  #else
+    _sensorsReadFlags = xEventGroupCreate();
+  #endif // CONFIG_WATERING_STATIC_ALLOCATION
+  if (_sensorsReadFlags == nullptr) {
+    rlog_e(logTAG, "Failed to create event group for sensor readers!");
+    return false;
+  };
+  xEventGroupClearBits(_sensorsReadFlags, SENSOR_READ_ALL | SENSOR_DONE_ALL);
+
+  for (uint8_t i = 0; i < SENSOR_READERS_COUNT; i++) {
+    #if CONFIG_WATERING_STATIC_ALLOCATION
+      _sensorsReaders[i].task = xTaskCreateStaticPinnedToCore(sensorsReaderExec, _sensorsReaders[i].task_name, 
+        CONFIG_WATERING_READER_STACK_SIZE, &_sensorsReaders[i], CONFIG_TASK_PRIORITY_SENSORS, 
+        readerTaskStack[i], &readerTaskBuffer[i], CONFIG_TASK_CORE_SENSORS);
+    #else
+      xTaskCreatePinnedToCore(sensorsReaderExec, _sensorsReaders[i].task_name, 
+        CONFIG_WATERING_READER_STACK_SIZE, &_sensorsReaders[i], CONFIG_TASK_PRIORITY_SENSORS, 
+        &_sensorsReaders[i].task, CONFIG_TASK_CORE_SENSORS);
+    #endif // CONFIG_WATERING_STATIC_ALLOCATION
+    if (_sensorsReaders[i].task == nullptr) {
+      rlog_e(logTAG, "Failed to create task [ %s ]!", _sensorsReaders[i].task_name);
+      return false;
+    };
+  };
+  rlog_i(logTAG, "Sensor reading tasks have been successfully created and started");
+  return true;
+}
+
+static EventBits_t sensorsReadParallel(EventBits_t due)
+{
+  // Учитываем ответы, которые пришли уже после таймаута предыдущего цикла
+  EventBits_t done = xEventGroupClearBits(_sensorsReadFlags, SENSOR_DONE_ALL) & SENSOR_DONE_ALL;
+  _sensorsReadPending &= ~(done >> SENSOR_DONE_SHIFT);
+
+  // Запускаем чтение на всех свободных шинах одновременно
+  EventBits_t request = due & ~_sensorsReadPending;
+  if (request) {
+    _sensorsReadPending |= request;
+    xEventGroupSetBits(_sensorsReadFlags, request);
+    // Ждем, пока ответят все - время цикла определяется самым медленным сенсором
+    done = xEventGroupWaitBits(_sensorsReadFlags, request << SENSOR_DONE_SHIFT, pdTRUE, pdTRUE, 
+      pdMS_TO_TICKS(CONFIG_WATERING_READER_TIMEOUT)) & SENSOR_DONE_ALL;
+    // По таймауту биты не сбрасываются: учитываем и сбрасываем только тех, кто успел ответить
+    xEventGroupClearBits(_sensorsReadFlags, done);
+    _sensorsReadPending &= ~(done >> SENSOR_DONE_SHIFT);
+  };
+  if (_sensorsReadPending) {
+    rlog_w(logTAG, "Sensors reading not completed: 0x%.2x", (unsigned int)_sensorsReadPending);
+  };
+  return request & ~_sensorsReadPending;
+}
+
+#endif // CONFIG_WATERING_PARALLEL_READ
+
+#if CONFIG_WATERING_SENSOR_HEALTH
+static void healthObserve(EventBits_t read);
+#endif // CONFIG_WATERING_SENSOR_HEALTH
+
+static void sensorsReadData()
+{
+  int64_t started = esp_timer_get_time();
+  EventBits_t due = sensorsReadDue(started);
+  if (due == 0) return;
+
+  #if CONFIG_WATERING_PARALLEL_READ
+    EventBits_t read = sensorsReadParallel(due);
+  #else
+    if (due & SENSOR_READ_SOIL) sensorsReadSoil();
+    if (due & SENSOR_READ_INDOOR) sensorsReadIndoor();
+    if (due & SENSOR_READ_HEATING) sensorsReadHeating();
+    EventBits_t read = due;
+  #endif // CONFIG_WATERING_PARALLEL_READ
+  // Сенсор, не успевший ответить, тоже переносится на следующий период, иначе задача будет крутиться без ожидания
+  sensorsReadDone(due, started);
+  if (read & SENSOR_READ_SOIL) {
+    for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+      if (_zones[i].soil) journalSensorStatus(i, _zones[i].soil);
+    };
+  };
+  if (read & SENSOR_READ_INDOOR) journalSensorStatus(JOURNAL_SENSOR_INDOOR, &sensorIndoor);
+  if (read & SENSOR_READ_HEATING) journalSensorStatus(JOURNAL_SENSOR_HEATING, &sensorHeating);
+  #if CONFIG_WATERING_SENSOR_HEALTH
+    healthObserve(read);
+  #endif // CONFIG_WATERING_SENSOR_HEALTH
+
+  if ((read & SENSOR_READ_SOIL) && (sensorSoil.getStatus() == SENSOR_STATUS_OK)) {
+    rlog_i("SOIL", "Values raw: %.1f %% / %.1f °С | out: %.1f %% / %.1f °С | min: %.1f %% / %.1f °С | max: %.1f %% / %.1f °С", 
+      sensorSoil.getValue2(false).rawValue, sensorSoil.getValue1(false).rawValue, 
+      sensorSoil.getValue2(false).filteredValue, sensorSoil.getValue1(false).filteredValue,
+      sensorSoil.getExtremumsDaily2(false).minValue.filteredValue, sensorSoil.getExtremumsDaily1(false).minValue.filteredValue,
+      sensorSoil.getExtremumsDaily2(false).maxValue.filteredValue, sensorSoil.getExtremumsDaily1(false).maxValue.filteredValue);
+  };
+
+  if ((read & SENSOR_READ_INDOOR) && (sensorIndoor.getStatus() == SENSOR_STATUS_OK)) {
+    rlog_i("INDOOR", "Values raw: %.2f °С / %.2f %% | out: %.2f °С / %.2f %% | min: %.2f °С / %.2f %% | max: %.2f °С / %.2f %%", 
+      sensorIndoor.getValue2(false).rawValue, sensorIndoor.getValue1(false).rawValue, 
+      sensorIndoor.getValue2(false).filteredValue, sensorIndoor.getValue1(false).filteredValue, 
+      sensorIndoor.getExtremumsDaily2(false).minValue.filteredValue, sensorIndoor.getExtremumsDaily1(false).minValue.filteredValue, 
+      sensorIndoor.getExtremumsDaily2(false).maxValue.filteredValue, sensorIndoor.getExtremumsDaily1(false).maxValue.filteredValue);
+  };
+
+  if ((read & SENSOR_READ_HEATING) && (sensorHeating.getStatus() == SENSOR_STATUS_OK)) {
+    rlog_i("HEATING", "Values raw: %.1f °С | out: %.1f °С | min: %.1f °С | max: %.1f °С", 
+      sensorHeating.getValue(false).rawValue,
+      sensorHeating.getValue(false).filteredValue,
+      sensorHeating.getExtremumsDaily(false).minValue.filteredValue,
+      sensorHeating.getExtremumsDaily(false).maxValue.filteredValue);
+  };
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------- Исправность сенсоров ------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#if CONFIG_WATERING_SENSOR_HEALTH
+
+// Таблица исправности: датчики почвы всех зон, затем датчики в помещении и на батареях
+#define HEALTH_INDOOR         CONFIG_WATERING_ZONES
+#define HEALTH_HEATING        (CONFIG_WATERING_ZONES + 1)
+#define HEALTH_COUNT          (CONFIG_WATERING_ZONES + 2)
+
+// Влажность почвы может измениться на десятки процентов за полив, но не за одно чтение; почва и воздух в помещении 
+// меняются медленно, но не замирают на полсуток. Температура батарей летом может стоять сутками, залипание не проверяется.
+// Время устаревания пересчитывается по периодам опроса, см. healthUpdate()
+static shealth_limits_t _healthLimits[3] = {
+  { 0.0,   100.0, 30.0, 12*60*60, 30*60 },   // Влажность почвы
+  { 0.0,   100.0, 20.0, 24*60*60, 30*60 },   // Влажность в помещении
+  { -10.0, 100.0, 20.0, 0,        30*60 }    // Температура батарей
+};
+
+static shealth_t _health[HEALTH_COUNT];
+
+// Изученное расписание полива без датчика почвы (watering_fallback_t, см. zoneControl.h) хранится в NVS по зонам
+static uint32_t _fallbackCrc[CONFIG_WATERING_ZONES];        // Контрольные суммы расписаний на момент последней записи в NVS
+
+static void fallbackNvsKey(char* key, size_t size, const char* name, uint8_t zone)
+{
+  snprintf(key, size, "%s%d", name, zone);
+}
+
+// Текущее начало полива и признаки режима в NVS не хранятся и в контрольную сумму не входят
+static uint32_t fallbackChecksum(uint8_t zone)
+{
+  const watering_fallback_t* fallback = &_zones[zone].control.fallback;
+  uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)&fallback->interval, sizeof(fallback->interval));
+  crc = esp_rom_crc32_le(crc, (const uint8_t*)&fallback->duration, sizeof(fallback->duration));
+  crc = esp_rom_crc32_le(crc, (const uint8_t*)&fallback->sessions, sizeof(fallback->sessions));
+  return esp_rom_crc32_le(crc, (const uint8_t*)&fallback->intervals, sizeof(fallback->intervals));
+}
+
+static void fallbackInit()
+{
+  char key[16];
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    fallbackNvsKey(key, sizeof(key), "interval", i);
+    nvsRead(CONFIG_FALLBACK_NVS_SPACE, key, OPT_TYPE_FLOAT, &_zones[i].control.fallback.interval);
+    fallbackNvsKey(key, sizeof(key), "duration", i);
+    nvsRead(CONFIG_FALLBACK_NVS_SPACE, key, OPT_TYPE_FLOAT, &_zones[i].control.fallback.duration);
+    fallbackNvsKey(key, sizeof(key), "sessions", i);
+    nvsRead(CONFIG_FALLBACK_NVS_SPACE, key, OPT_TYPE_U32, &_zones[i].control.fallback.sessions);
+    fallbackNvsKey(key, sizeof(key), "intervals", i);
+    nvsRead(CONFIG_FALLBACK_NVS_SPACE, key, OPT_TYPE_U32, &_zones[i].control.fallback.intervals);
+    _fallbackCrc[i] = fallbackChecksum(i);
+  };
+}
+
+// Средние меняются при каждом поливе по датчику; записываются вместе с остальными группами по таймеру nvsStoreTimer,
+// только если изменились с момента последней записи
+static void fallbackStoreData()
+{
+  char key[16];
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    if (_zones[i].soil == nullptr) continue;
+    uint32_t crc = fallbackChecksum(i);
+    if (crc != _fallbackCrc[i]) {
+      watering_fallback_t* fallback = &_zones[i].control.fallback;
+      fallbackNvsKey(key, sizeof(key), "interval", i);
+      nvsWrite(CONFIG_FALLBACK_NVS_SPACE, key, OPT_TYPE_FLOAT, &fallback->interval);
+      fallbackNvsKey(key, sizeof(key), "duration", i);
+      nvsWrite(CONFIG_FALLBACK_NVS_SPACE, key, OPT_TYPE_FLOAT, &fallback->duration);
+      fallbackNvsKey(key, sizeof(key), "sessions", i);
+      nvsWrite(CONFIG_FALLBACK_NVS_SPACE, key, OPT_TYPE_U32, &fallback->sessions);
+      fallbackNvsKey(key, sizeof(key), "intervals", i);
+      nvsWrite(CONFIG_FALLBACK_NVS_SPACE, key, OPT_TYPE_U32, &fallback->intervals);
+      _fallbackCrc[i] = crc;
+      nvsWritesAdd(4);
+    } else {
+      _nvsWrites.skipped++;
+    };
+  };
+}
+
+static void healthInit()
+{
+  uint32_t now = (uint32_t)(esp_timer_get_time() / 1000000);
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    shealthInit(&_health[i], &_healthLimits[0], now);
+  };
+  shealthInit(&_health[HEALTH_INDOOR], &_healthLimits[1], now);
+  shealthInit(&_health[HEALTH_HEATING], &_healthLimits[2], now);
+  fallbackInit();
+}
+
+// Результаты чтения: оцениваются необработанные значения, фильтр мог бы скрыть скачки и залипание
+static void healthObserve(EventBits_t read)
+{
+  uint32_t now = (uint32_t)(esp_timer_get_time() / 1000000);
+  if (read & SENSOR_READ_SOIL) {
+    for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+      reCWTSoilS* soil = _zones[i].soil;
+      if (soil) {
+        shealthObserve(&_health[i], now, soil->getStatus() == SENSOR_STATUS_OK, soil->getValue2(false).rawValue);
+      };
+    };
+  };
+  if (read & SENSOR_READ_INDOOR) {
+    shealthObserve(&_health[HEALTH_INDOOR], now, sensorIndoor.getStatus() == SENSOR_STATUS_OK, sensorIndoor.getValue1(false).rawValue);
+  };
+  if (read & SENSOR_READ_HEATING) {
+    shealthObserve(&_health[HEALTH_HEATING], now, sensorHeating.getStatus() == SENSOR_STATUS_OK, sensorHeating.getValue(false).rawValue);
+  };
+}
+
+static void healthUpdate()
+{
+  uint32_t now = (uint32_t)(esp_timer_get_time() / 1000000);
+  // Сенсор устарел, если пропущено не меньше трех плановых чтений подряд
+  #if CONFIG_WATERING_ADAPTIVE_READ
+    _healthLimits[0].stale_time = 3 * sensorsSoilSlowInterval > 30*60 ? 3 * sensorsSoilSlowInterval : 30*60;
+    _healthLimits[1].stale_time = 3 * sensorsIndoorInterval > 30*60 ? 3 * sensorsIndoorInterval : 30*60;
+    _healthLimits[2].stale_time = 3 * sensorsHeatingInterval > 30*60 ? 3 * sensorsHeatingInterval : 30*60;
+  #endif // CONFIG_WATERING_ADAPTIVE_READ
+  for (uint8_t i = 0; i < HEALTH_COUNT; i++) {
+    if ((i < CONFIG_WATERING_ZONES) && (_zones[i].soil == nullptr)) continue;
+    shealth_t* health = &_health[i];
+    if (shealthUpdate(health, now)) {
+      journalAdd(health->healthy ? JOURNAL_HEALTH_OK : JOURNAL_HEALTH_BAD, i, health->score);
+      if (health->healthy) {
+        rlog_i(logTAG, "Sensor %d is healthy again, score %d", i, health->score);
+      } else {
+        rlog_w(logTAG, "Sensor %d is unhealthy, score %d, flags 0x%.2x", i, health->score, health->flags);
+      };
+    };
+  };
+}
+
+// Данные с неисправного сенсора в модель не передаются
+static inline bool healthIsOk(uint8_t index)
+{
+  return _health[index].healthy;
+}
+
+static void healthMqttPublish()
+{
+  static char buf[CONFIG_HEALTH_STATS_SIZE];
+  uint32_t now = (uint32_t)(esp_timer_get_time() / 1000000);
+  int len = snprintf(buf, sizeof(buf), "{\"sensors\":[");
+  bool first = true;
+  for (uint8_t i = 0; i < HEALTH_COUNT; i++) {
+    const char* name;
+    if (i == HEALTH_INDOOR) {
+      name = SENSOR_INDOOR_TOPIC;
+    } else if (i == HEALTH_HEATING) {
+      name = SENSOR_HEATING_TOPIC;
+    } else if (_zones[i].soil) {
+      name = i == 0 ? SENSOR_SOIL_TOPIC : wateringZonesHw[i].topic;
+    } else {
+      continue;
+    };
+    const shealth_t* health = &_health[i];
+    if ((len < 0) || (len >= (int)sizeof(buf))) break;
+    len += snprintf(buf + len, sizeof(buf) - len, 
+      "%s{\"name\":\"%s\",\"healthy\":%d,\"score\":%d,\"flags\":%d,\"reads\":%" PRIu32 ",\"errors\":%" PRIu32 ","
+      "\"jumps\":%" PRIu32 ",\"age\":%" PRIu32 ",\"unchanged\":%" PRIu32 "}",
+      first ? "" : ",", name, health->healthy, health->score, health->flags, health->reads, health->errors, health->jumps, 
+      now - health->last_ok, now - health->changed);
+    first = false;
+  };
+  if ((len >= 0) && (len < (int)sizeof(buf))) {
+    len += snprintf(buf + len, sizeof(buf) - len, "],\"zones\":[");
+  };
+  first = true;
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    if (_zones[i].soil == nullptr) continue;
+    const watering_fallback_t* fallback = &_zones[i].control.fallback;
+    if ((len < 0) || (len >= (int)sizeof(buf))) break;
+    len += snprintf(buf + len, sizeof(buf) - len, "%s{\"zone\":%d,\"fallback\":%d,\"interval\":%.0f,\"intervals\":%" PRIu32 ",\"duration\":%.0f,\"sessions\":%" PRIu32 "}",
+      first ? "" : ",", i, fallback->active, fallback->interval, fallback->intervals, fallback->duration, fallback->sessions);
+    first = false;
+  };
+  if ((len < 0) || (len + 3 > (int)sizeof(buf))) {
+    rlog_w(logTAG, "Sensor health does not fit into the buffer");
+    return;
+  };
+  snprintf(buf + len, sizeof(buf) - len, "]}");
+  mqttPublish(mqttTopic(TOPIC_HEALTH), buf, 
+    CONFIG_MQTT_SENSORS_QOS, CONFIG_MQTT_SENSORS_RETAINED, false, false);
+}
+
+#endif // CONFIG_WATERING_SENSOR_HEALTH
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------ Уведомления ----------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#if CONFIG_TELEGRAM_ENABLE
+
+static void waterleakNotifyRender(bool leak, uint8_t input)
+{
+  heap_mark_t heap = heapBegin();
+  if (waterleakNotify > NOTIFY_OFF) {
+    if (leak) {
+      tgSend(CONFIG_WATERING_NOTIFY_KIND, CONFIG_WATERING_NOTIFY_PRIORITY, waterleakNotify == NOTIFY_SOUND, CONFIG_TELEGRAM_DEVICE, 
+        "⚠ <b>Внимание!</b> Обнаружен перелив по входу #<b>%d</b>", input);
+    } else {
+      tgSend(CONFIG_WATERING_NOTIFY_KIND, CONFIG_WATERING_NOTIFY_PRIORITY, waterleakNotify == NOTIFY_SOUND, CONFIG_TELEGRAM_DEVICE, 
+        "✅ Перелив по входу #<b>%d</b> устранён", input);
+    };
+  };
+  heapEnd(HEAP_TELEGRAM, heap);
+}
+
+static void waterLevelNotifyRender(bool level)
+{
+  heap_mark_t heap = heapBegin();
+  if (waterlevelNotify > NOTIFY_OFF) {
+    if (level) {
+      tgSend(CONFIG_WATERING_NOTIFY_KIND, CONFIG_WATERING_NOTIFY_PRIORITY, waterlevelNotify == NOTIFY_SOUND, CONFIG_TELEGRAM_DEVICE, 
+        "✅ Уровень воды в норме");
+    } else {
+      tgSend(CONFIG_WATERING_NOTIFY_KIND, CONFIG_WATERING_NOTIFY_PRIORITY, waterlevelNotify == NOTIFY_SOUND, CONFIG_TELEGRAM_DEVICE, 
+        "⚠ <b>Внимание!</b> Низкий уровень воды в ёмкости!");
+    };
+  };
+  heapEnd(HEAP_TELEGRAM, heap);
+}
+
+static void wateringPumpNotifyRender(bool state, uint32_t duration, float moisture, float temp)
+{
+  heap_mark_t heap = heapBegin();
+  if (wateringNotify != NOTIFY_OFF) {
+    if (state) {
+      tgSend(CONFIG_WATERING_NOTIFY_KIND, CONFIG_WATERING_NOTIFY_PRIORITY, wateringNotify == NOTIFY_SOUND, CONFIG_TELEGRAM_DEVICE, 
+      "💦 Полив <b>запущен</b>\n\n<code>Влажность:   %.1f %%\nТемпература: %.1f°C</code>", moisture, temp);
+    } else {
+      uint16_t last_h = duration / 3600;
+      uint16_t last_m = duration % 3600 / 60;
+      uint16_t last_s = duration % 3600 % 60;
+      tgSend(CONFIG_WATERING_NOTIFY_KIND, CONFIG_WATERING_NOTIFY_PRIORITY, wateringNotify == NOTIFY_SOUND, CONFIG_TELEGRAM_DEVICE, 
+      "✅ Полив <b>завершен</b>\n\n<code>Влажность:   %.1f %%\nТемпература: %.1f°C\nВремя работы: %.2dч %.2dм %.2dc</code>", 
+        moisture, temp, last_h, last_m, last_s);
+    };
+  };
+  heapEnd(HEAP_TELEGRAM, heap);
+}
+
+#if CONFIG_WATERING_NOTIFY_QUEUE
+
+static_assert((CONFIG_WATERING_NOTIFY_QUEUE_SIZE & (CONFIG_WATERING_NOTIFY_QUEUE_SIZE - 1)) == 0, 
+  "CONFIG_WATERING_NOTIFY_QUEUE_SIZE must be a power of two");
+
+typedef enum {
+  NOTIFY_EVENT_LEAK = 0,
+  NOTIFY_EVENT_LEVEL,
+  NOTIFY_EVENT_PUMP
+} notify_event_kind_t;
+
+typedef struct {
+  uint8_t  kind;          // notify_event_kind_t
+  uint8_t  input;         // Номер входа перелива
+  bool     state;
+  uint32_t duration;      // Время работы насоса, с
+  float    moisture;
+  float    temp;
+} notify_event_t;
+
+// Ячейка очереди: номер позиции, с которой она может быть записана (seq == pos) или прочитана (seq == pos + 1)
+typedef struct {
+  uint32_t seq;
+  notify_event_t event;
+} notify_cell_t;
+
+// Состояние входа перелива для объединения частых срабатываний
+typedef struct {
+  bool     state;         // Последнее полученное состояние
+  bool     notified;      // Последнее отправленное состояние
+  bool     pending;       // Открыто окно объединения
+  uint16_t flaps;         // Переключений после последнего уведомления
+  int64_t  opened;        // Время отправки последнего уведомления, мкс
+} notify_leak_t;
+
+static notify_cell_t _notifyCells[CONFIG_WATERING_NOTIFY_QUEUE_SIZE];
+static uint32_t _notifyHead = 0;      // Позиция записи, изменяется атомарно любым отправителем
+static uint32_t _notifyTail = 0;      // Позиция чтения, только задача уведомлений
+static uint32_t _notifyDropped = 0;
+static notify_leak_t _notifyLeaks[3];
+static TaskHandle_t _notifyTask = nullptr;
+
+// Ограниченная очередь без блокировок для нескольких отправителей и одного получателя: место в очереди 
+// захватывается CAS по _notifyHead, запись в ячейку публикуется изменением её seq
+static bool notifyPush(const notify_event_t* event)
+{
+  uint32_t pos = __atomic_load_n(&_notifyHead, __ATOMIC_RELAXED);
+  notify_cell_t* cell;
+  while (1) {
+    cell = &_notifyCells[pos & (CONFIG_WATERING_NOTIFY_QUEUE_SIZE - 1)];
+    int32_t diff = (int32_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos);
+    if (diff == 0) {
+      if (__atomic_compare_exchange_n(&_notifyHead, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    } else if (diff < 0) {
+      __atomic_fetch_add(&_notifyDropped, 1, __ATOMIC_RELAXED);
+      return false;
+    } else {
+      pos = __atomic_load_n(&_notifyHead, __ATOMIC_RELAXED);
+    };
+  };
+  cell->event = *event;
+  __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+  if (_notifyTask) xTaskNotifyGive(_notifyTask);
+  return true;
+}
+
+static bool notifyPop(notify_event_t* event)
+{
+  notify_cell_t* cell = &_notifyCells[_notifyTail & (CONFIG_WATERING_NOTIFY_QUEUE_SIZE - 1)];
+  if ((int32_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (_notifyTail + 1)) < 0) return false;
+  *event = cell->event;
+  __atomic_store_n(&cell->seq, _notifyTail + CONFIG_WATERING_NOTIFY_QUEUE_SIZE, __ATOMIC_RELEASE);
+  _notifyTail++;
+  return true;
+}
+
+// Первое изменение отправляется сразу, последующие в течение CONFIG_WATERING_NOTIFY_COALESCE только подсчитываются
+static void notifyLeakEvent(uint8_t input, bool state, int64_t now)
+{
+  if ((input < 1) || (input > 3)) return;
+  notify_leak_t* leak = &_notifyLeaks[input - 1];
+  if (state == leak->state) return;
+  leak->state = state;
+  if (leak->pending) {
+    leak->flaps++;
+  } else {
+    waterleakNotifyRender(state, input);
+    leak->notified = state;
+    leak->pending = true;
+    leak->flaps = 0;
+    leak->opened = now;
+  };
+}
+
+// Закрытие окна объединения: итог отправляется, только если за это время что-то менялось
+static void notifyLeakFlush(int64_t now)
+{
+  for (uint8_t i = 0; i < 3; i++) {
+    notify_leak_t* leak = &_notifyLeaks[i];
+    if (!leak->pending || (now - leak->opened < (int64_t)CONFIG_WATERING_NOTIFY_COALESCE * 1000000)) continue;
+    leak->pending = false;
+    if (leak->flaps == 0) continue;
+    if (leak->state == leak->notified) {
+      if (waterleakNotify > NOTIFY_OFF) {
+        heap_mark_t heap = heapBegin();
+        tgSend(CONFIG_WATERING_NOTIFY_KIND, CONFIG_WATERING_NOTIFY_PRIORITY, waterleakNotify == NOTIFY_SOUND, CONFIG_TELEGRAM_DEVICE, 
+          "⚠ Вход перелива #<b>%d</b>: <b>%d</b> кратковременных переключений за %d с, сейчас %s", 
+          i + 1, leak->flaps, CONFIG_WATERING_NOTIFY_COALESCE, leak->state ? "<b>перелив</b>" : "норма");
+        heapEnd(HEAP_TELEGRAM, heap);
+      };
+    } else {
+      waterleakNotifyRender(leak->state, i + 1);
+      leak->notified = leak->state;
+    };
+    leak->flaps = 0;
+  };
+}
+
+static void notifyTaskExec(void *pvParameters)
+{
+  notify_event_t event;
+  while (1) {
+    // Ждем новых событий или закрытия ближайшего окна объединения
+    TickType_t wait = portMAX_DELAY;
+    int64_t now = esp_timer_get_time();
+    for (uint8_t i = 0; i < 3; i++) {
+      if (_notifyLeaks[i].pending) {
+        int64_t left = _notifyLeaks[i].opened + (int64_t)CONFIG_WATERING_NOTIFY_COALESCE * 1000000 - now;
+        TickType_t ticks = left > 0 ? pdMS_TO_TICKS(left / 1000) + 1 : 0;
+        if (ticks < wait) wait = ticks;
+      };
+    };
+    ulTaskNotifyTake(pdTRUE, wait);
+
+    now = esp_timer_get_time();
+    while (notifyPop(&event)) {
+      switch (event.kind) {
+        case NOTIFY_EVENT_LEAK:
+          notifyLeakEvent(event.input, event.state, now);
+          break;
+        case NOTIFY_EVENT_LEVEL:
+          waterLevelNotifyRender(event.state);
+          break;
+        case NOTIFY_EVENT_PUMP:
+          wateringPumpNotifyRender(event.state, event.duration, event.moisture, event.temp);
+          break;
+      };
+    };
+    notifyLeakFlush(now);
+
+    uint32_t dropped = __atomic_exchange_n(&_notifyDropped, 0, __ATOMIC_RELAXED);
+    if (dropped > 0) {
+      rlog_w(logTAG, "Notification queue overflow, %" PRIu32 " events dropped", dropped);
+    };
+  };
+  vTaskDelete(nullptr);
+}
+
+static bool notifyTaskStart()
+{
+  for (uint32_t i = 0; i < CONFIG_WATERING_NOTIFY_QUEUE_SIZE; i++) {
+    _notifyCells[i].seq = i;
+  };
+  #if CONFIG_WATERING_STATIC_ALLOCATION
+    static StaticTask_t notifyTaskBuffer;
+    static StackType_t notifyTaskStack[CONFIG_WATERING_NOTIFY_STACK_SIZE];
+    _notifyTask = xTaskCreateStaticPinnedToCore(notifyTaskExec, "wtr_notify", 
+      CONFIG_WATERING_NOTIFY_STACK_SIZE, NULL, CONFIG_WATERING_NOTIFY_PRIORITY_TASK, 
+      notifyTaskStack, &notifyTaskBuffer, CONFIG_WATERING_NOTIFY_CORE);
+  #else
+    xTaskCreatePinnedToCore(notifyTaskExec, "wtr_notify", 
+      CONFIG_WATERING_NOTIFY_STACK_SIZE, NULL, CONFIG_WATERING_NOTIFY_PRIORITY_TASK, 
+      &_notifyTask, CONFIG_WATERING_NOTIFY_CORE);
+  #endif // CONFIG_WATERING_STATIC_ALLOCATION
+  if (_notifyTask == nullptr) {
+    rlog_e(logTAG, "Failed to create notification task!");
+    return false;
+  };
+  return true;
+}
+
+#endif // CONFIG_WATERING_NOTIFY_QUEUE
+
+#endif // CONFIG_TELEGRAM_ENABLE
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------- Перелив или протечка ------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+static void ledMode();
+
+// Входы датчиков протечки опрашиваются все сразу, одним чтением регистров GPIO
+static const gpio_num_t waterleakPins[3] = { 
+  (gpio_num_t)CONFIG_WATER_LEAK_GPIO1, (gpio_num_t)CONFIG_WATER_LEAK_GPIO2, (gpio_num_t)CONFIG_WATER_LEAK_GPIO3 };
+static const EventBits_t waterleakBits[3] = { WATER_LEAK_IN1, WATER_LEAK_IN2, WATER_LEAK_IN3 };
+static uint8_t* const waterleakEnabled[3] = { &waterleakSensorEnabled1, &waterleakSensorEnabled2, &waterleakSensorEnabled3 };
+
+static esp_timer_handle_t _waterleakTimer = nullptr;
+static bool _waterleakSample = false;
+static leak_scan_t _waterleakScan;
+// Состояние входов, о котором уже были отправлены уведомления
+static EventBits_t _waterleakNotified = 0;
+
+static void waterleakScanProcess(uint64_t levels)
+{
+  EventBits_t bits = xEventGroupGetBits(_wateringFlags);
+  uint8_t enabled = 0;
+  uint8_t wet = 0;
+  uint8_t active = 0;
+  for (uint8_t i = 0; i < 3; i++) {
+    if (*waterleakEnabled[i]) enabled |= (1 << i);
+    if (((levels >> waterleakPins[i]) & 0x01) == CONFIG_WATER_LEAK_LEVEL) wet |= (1 << i);
+    if (bits & waterleakBits[i]) active |= (1 << i);
+  };
+
+  // Устранение перелива подтверждается в течение waterleakDebounceCount циклов основной задачи
+  int64_t now = esp_timer_get_time();
+  int64_t debounce = (int64_t)waterleakDebounceCount * _sensorsReadInterval * 1000000LL;
+  uint8_t cleared = 0;
+  uint8_t set = leakScanProcess(&_waterleakScan, enabled, wet, active, now, debounce, &cleared);
+
+  EventBits_t bitsSet = 0;
+  EventBits_t bitsClr = 0;
+  for (uint8_t i = 0; i < 3; i++) {
+    if (set & (1 << i)) {
+      bitsSet |= waterleakBits[i];
+      journalAdd(JOURNAL_LEAK_ON, i + 1, 0);
+    };
+    if (cleared & (1 << i)) {
+      bitsClr |= waterleakBits[i];
+      journalAdd(JOURNAL_LEAK_OFF, i + 1, 0);
+    };
+  };
+  if (bitsSet) {
+    _interlockEventTime = now;
+    xEventGroupSetBits(_wateringFlags, bitsSet | WATER_LEAK_CHANGED | PUMP_INTERLOCK);
+  };
+  if (bitsClr) {
+    xEventGroupClearBits(_wateringFlags, bitsClr);
+    xEventGroupSetBits(_wateringFlags, WATER_LEAK_CHANGED);
+  };
+}
+
+static void waterleakScanTimer(void* arg)
+{
+  if (!_waterleakSample) {
+    // Фаза 1: включаем подтяжку на всех входах и ждем установления уровня
+    for (uint8_t i = 0; i < 3; i++) {
+      if (*waterleakEnabled[i]) {
+        gpio_set_pull_mode(waterleakPins[i], GPIO_PULLUP_ONLY);
+      };
+    };
+    _waterleakSample = true;
+    esp_timer_start_once(_waterleakTimer, CONFIG_WATER_LEAK_SCAN_SETTLE);
+  } else {
+    // Фаза 2: читаем все входы за один раз и снимаем подтяжку (чтобы не было электролиза)
+    uint64_t levels = ((uint64_t)REG_READ(GPIO_IN1_REG) << 32) | REG_READ(GPIO_IN_REG);
+    for (uint8_t i = 0; i < 3; i++) {
+      gpio_set_pull_mode(waterleakPins[i], GPIO_FLOATING);
+    };
+    _waterleakSample = false;
+    waterleakScanProcess(levels);
+    esp_timer_start_once(_waterleakTimer, (uint64_t)CONFIG_WATER_LEAK_SCAN_INTERVAL*1000 - CONFIG_WATER_LEAK_SCAN_SETTLE);
+  };
+}
+
+static void waterleakInit()
+{
+  gpio_reset_pin((gpio_num_t)CONFIG_WATER_LEAK_GPIO1);
+  gpio_reset_pin((gpio_num_t)CONFIG_WATER_LEAK_GPIO2);
+  gpio_reset_pin((gpio_num_t)CONFIG_WATER_LEAK_GPIO3);
+  gpio_reset_pin((gpio_num_t)CONFIG_WATER_LEAK_ACTVATOR);
+  gpio_set_direction((gpio_num_t)CONFIG_WATER_LEAK_GPIO1, GPIO_MODE_INPUT);
+  gpio_set_direction((gpio_num_t)CONFIG_WATER_LEAK_GPIO2, GPIO_MODE_INPUT);
+  gpio_set_direction((gpio_num_t)CONFIG_WATER_LEAK_GPIO3, GPIO_MODE_INPUT);
+  gpio_set_direction((gpio_num_t)CONFIG_WATER_LEAK_ACTVATOR, GPIO_MODE_OUTPUT);
+  gpio_set_level((gpio_num_t)CONFIG_WATER_LEAK_ACTVATOR, CONFIG_WATER_LEAK_ACT_OFF);
+  leakScanInit(&_waterleakScan);
+
+  // Запускаем собственный таймер опроса датчиков протечки, независимый от цикла основной задачи
+  esp_timer_create_args_t timer_args;
+  memset(&timer_args, 0, sizeof(esp_timer_create_args_t));
+  timer_args.callback = &waterleakScanTimer;
+  timer_args.name = "wleak_scan";
+  RE_OK_CHECK_EVENT(esp_timer_create(&timer_args, &_waterleakTimer), return);
+  RE_OK_CHECK_EVENT(esp_timer_start_once(_waterleakTimer, (uint64_t)CONFIG_WATER_LEAK_SCAN_INTERVAL*1000), return);
+}
+
+void waterleakSendNotify(bool leak, uint8_t input)
+{
+  #if CONFIG_TELEGRAM_ENABLE
+    #if CONFIG_WATERING_NOTIFY_QUEUE
+      notify_event_t event = { NOTIFY_EVENT_LEAK, input, leak, 0, NAN, NAN };
+      notifyPush(&event);
+    #else
+      waterleakNotifyRender(leak, input);
+    #endif // CONFIG_WATERING_NOTIFY_QUEUE
+  #endif // CONFIG_TELEGRAM_ENABLE
+}
+
+void sensorsWaterLeakMqttPublish()
+{
+  #if CONFIG_MQTT_PAYLOAD_CBOR
+    // [версия схемы, флаги перелива: бит 0 - канал 1, бит 1 - канал 2, бит 2 - канал 3]
+    EventBits_t bits = xEventGroupGetBits(_wateringFlags);
+    uint8_t raw[8];
+    char buf[sizeof(raw) + 2];
+    cbor_payload_t cbor;
+    cborInit(&cbor, raw, sizeof(raw));
+    cborPutArray(&cbor, 2);
+    cborPutUInt(&cbor, CONFIG_PAYLOAD_SCHEMA_VERSION);
+    cborPutUInt(&cbor, ((bits & WATER_LEAK_IN1) ? 0x01 : 0) | ((bits & WATER_LEAK_IN2) ? 0x02 : 0) | ((bits & WATER_LEAK_IN3) ? 0x04 : 0));
+    if (cborCobsEncode(&cbor, buf, sizeof(buf)) > 0) {
+      mqttPublish(mqttTopic(TOPIC_WATER_LEAK), buf, CONFIG_MQTT_LOAD_QOS, CONFIG_MQTT_LOAD_RETAINED, false, false);
+    };
+  #else
+    mqttPublish(mqttTopic(TOPIC_WATER_LEAK), 
+      malloc_stringf("{\"channel1\":%d,\"channel2\":%d,\"channel3\":%d}", 
+        ((xEventGroupGetBits(_wateringFlags) & WATER_LEAK_IN1) > 0),
+        ((xEventGroupGetBits(_wateringFlags) & WATER_LEAK_IN2) > 0),
+        ((xEventGroupGetBits(_wateringFlags) & WATER_LEAK_IN3) > 0)), 
+      CONFIG_MQTT_LOAD_QOS, CONFIG_MQTT_LOAD_RETAINED, false, true);
+  #endif // CONFIG_MQTT_PAYLOAD_CBOR
+}
+
+static bool sensorsGetWaterLeaks()
+{
+  EventBits_t wlBits = 0x0;
+  if (waterleakSensorEnabled1) wlBits |= WATER_LEAK_IN1;
+  if (waterleakSensorEnabled2) wlBits |= WATER_LEAK_IN2;
+  if (waterleakSensorEnabled3) wlBits |= WATER_LEAK_IN3;
+  return (xEventGroupGetBits(_wateringFlags) & wlBits) > 0;
+}
+
+static bool sensorsCheckWaterLeaks()
+{
+  // Сами входы опрашивает таймер, здесь только уведомления об изменениях
+  if (xEventGroupGetBits(_wateringFlags) & WATER_LEAK_CHANGED) {
+    xEventGroupClearBits(_wateringFlags, WATER_LEAK_CHANGED);
+    EventBits_t wlBits = xEventGroupGetBits(_wateringFlags) & WATER_LEAK_ALL;
+    EventBits_t wlChanged = wlBits ^ _waterleakNotified;
+    _waterleakNotified = wlBits;
+    if (wlChanged) {
+      for (uint8_t i = 0; i < 3; i++) {
+        if (wlChanged & waterleakBits[i]) {
+          rlog_d(logTAG, "Water leak control #%d: %d", i+1, (wlBits & waterleakBits[i]) > 0);
+          waterleakSendNotify((wlBits & waterleakBits[i]) > 0, i+1);
+        };
+      };
+      sensorsWaterLeakMqttPublish();
+      ledMode();
+    };
+  };
+
+  // Возвращаем true, если есть перелив
+  bool wleaks = sensorsGetWaterLeaks();
+  rlog_d(logTAG, "Water leak control summary: %d", wleaks);
+  return wleaks;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------ Расход воды ----------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#if CONFIG_WATERING_VOLUME
+
+// Счетчики расхода воды в мл; текущий и предыдущий период каждой пары идут подряд
+typedef enum {
+  VOLUME_TOTAL = 0,
+  VOLUME_TODAY,
+  VOLUME_YESTERDAY,
+  VOLUME_WEEK_CURR,
+  VOLUME_WEEK_PREV,
+  VOLUME_MONTH_CURR,
+  VOLUME_MONTH_PREV,
+  VOLUME_PERIOD_CURR,
+  VOLUME_PERIOD_PREV,
+  VOLUME_YEAR_CURR,
+  VOLUME_YEAR_PREV,
+  VOLUME_TANK_USED,                 // С последней заправки бака
+  VOLUME_TANK_LAST,                 // От последней заправки до срабатывания датчика низкого уровня
+  VOLUME_COUNT
+} volume_counter_t;
+
+// Ключи NVS и поля JSON
+static const char* _volumeKeys[VOLUME_COUNT] = {
+  "total", "today", "yesterday", "week", "week_prev", "month", "month_prev", 
+  "period", "period_prev", "year", "year_prev", "tank_used", "tank_last"
+};
+
+#define VOLUME_NVS_DAYS         "days"
+#define VOLUME_ROLL_DAY         BIT0
+#define VOLUME_ROLL_PERIOD      BIT1
+#define VOLUME_ROLL_WEEK        BIT2
+#define VOLUME_ROLL_MONTH       BIT3
+#define VOLUME_ROLL_YEAR        BIT4
+
+static uint32_t _volume[VOLUME_COUNT];
+static double _volumeFraction = 0.0;                       // Неучтенная часть миллилитра
+static uint32_t _volumeCrc = 0;                            // Контрольная сумма счетчиков на момент последней записи в NVS
+static uint32_t _volumeDays = 0;                           // Сутки с начала эпохи UNIX, на которые записаны счетчики
+static bool _volumeRestored = false;                       // Счетчики восстановлены, но пропущенные периоды еще не учтены
+static uint32_t _volumeRoll = 0;                           // Смена периодов VOLUME_ROLL_*, выставляется обработчиком событий времени
+static uint8_t* _volumePeriodStart = nullptr;
+
+#if CONFIG_WATERING_TANK_ESTIMATOR
+
+// Прогноз по баку: датчик уровня дает только момент опустошения до отметки, поэтому между событиями остаток 
+// считается по расходу с последней заправки и обучаемому полезному объему, а время до опустошения - по среднему суточному расходу
+typedef struct {
+  float capacity;                   // Полезный объем бака от заправки до датчика низкого уровня, л (0 - еще не измерен)
+  float rate;                       // Средний суточный расход, л/сутки (0 - еще не измерен)
+  uint8_t refilled;                 // С момента заправки низкий уровень еще не наступал, замер объема будет полным
+} volume_tank_t;
+
+#define VOLUME_NVS_TANK_CAPACITY  "tank_capacity"
+#define VOLUME_NVS_TANK_RATE      "tank_rate"
+#define VOLUME_NVS_TANK_REFILLED  "tank_refilled"
+
+static volume_tank_t _volumeTank = { 0.0, 0.0, 0 };
+
+static float volumeEma(float average, float value, uint32_t count)
+{
+  if (average <= 0) return value;
+  return average + 2.0 / (count + 1) * (value - average);
+}
+
+#endif // CONFIG_WATERING_TANK_ESTIMATOR
+
+#if CONFIG_WATERING_FLOW_METER
+
+// Аппаратный счетчик 16-битный: при достижении предела драйвер сбрасывает его и сам накапливает переполнения 
+// (accum_count), поэтому pcnt_unit_get_count() возвращает монотонно растущее значение
+#define VOLUME_METER_LIMIT      INT16_MAX
+#define VOLUME_METER_GLITCH_NS  12000     // Импульсы короче ~12 мкс считаются помехой
+
+static pcnt_unit_handle_t _volumeMeterUnit = nullptr;
+static int _volumeMeterLast = 0;
+
+static void volumeMeterInit()
+{
+  pcnt_unit_config_t unitConfig = {};
+  unitConfig.low_limit = -1;
+  unitConfig.high_limit = VOLUME_METER_LIMIT;
+  unitConfig.flags.accum_count = 1;
+  pcnt_unit_handle_t unit = nullptr;
+  esp_err_t err = pcnt_new_unit(&unitConfig, &unit);
+  if (err == ESP_OK) {
+    pcnt_chan_config_t chanConfig = {};
+    chanConfig.edge_gpio_num = CONFIG_GPIO_FLOW_METER;
+    chanConfig.level_gpio_num = -1;
+    pcnt_channel_handle_t channel = nullptr;
+    err = pcnt_new_channel(unit, &chanConfig, &channel);
+    if (err == ESP_OK) err = pcnt_channel_set_edge_action(channel, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_HOLD);
+  };
+  if (err == ESP_OK) {
+    pcnt_glitch_filter_config_t filterConfig = {};
+    filterConfig.max_glitch_ns = VOLUME_METER_GLITCH_NS;
+    err = pcnt_unit_set_glitch_filter(unit, &filterConfig);
+  };
+  if (err == ESP_OK) err = pcnt_unit_add_watch_point(unit, VOLUME_METER_LIMIT);
+  if (err == ESP_OK) err = pcnt_unit_enable(unit);
+  if (err == ESP_OK) err = pcnt_unit_clear_count(unit);
+  if (err == ESP_OK) err = pcnt_unit_start(unit);
+  if (err == ESP_OK) {
+    _volumeMeterUnit = unit;
+    rlog_i(logTAG, "Flow meter started on GPIO %d", CONFIG_GPIO_FLOW_METER);
+  } else {
+    rlog_e(logTAG, "Failed to start flow meter: %d %s", err, esp_err_to_name(err));
+  };
+}
+
+#else
+
+// Время работы нагрузок в секундах, еще не пересчитанное в объем: пополняется при выключении нагрузки 
+// (в том числе из задачи аварийной блокировки), забирается основной задачей
+static uint32_t _volumePending[CONFIG_WATERING_ZONES];
+
+static void volumeLoadOff(uint8_t zone, time_t duration)
+{
+  if (duration > 0) {
+    __atomic_fetch_add(&_volumePending[zone], (uint32_t)duration, __ATOMIC_RELAXED);
+  };
+}
+
+#endif // CONFIG_WATERING_FLOW_METER
+
+static void volumeAdd(double ml)
+{
+  ml += _volumeFraction;
+  uint32_t whole = (uint32_t)ml;
+  _volumeFraction = ml - whole;
+  if (whole > 0) {
+    _volume[VOLUME_TOTAL] += whole;
+    _volume[VOLUME_TODAY] += whole;
+    _volume[VOLUME_WEEK_CURR] += whole;
+    _volume[VOLUME_MONTH_CURR] += whole;
+    _volume[VOLUME_PERIOD_CURR] += whole;
+    _volume[VOLUME_YEAR_CURR] += whole;
+    _volume[VOLUME_TANK_USED] += whole;
+  };
+}
+
+static void volumeShift(volume_counter_t curr)
+{
+  _volume[curr + 1] = _volume[curr];
+  _volume[curr] = 0;
+}
+
+// Номера суток, недели, месяца, отчетного периода и года так же, как их считает rLoadController::countersNvsRestore()
+typedef struct {
+  uint32_t day;
+  uint32_t week;
+  uint32_t month;
+  uint32_t period;
+  uint32_t year;
+} volume_calendar_t;
+
+static volume_calendar_t volumeCalendar(uint32_t days)
+{
+  volume_calendar_t cal;
+  time_t stamp = (time_t)days * 86400 + 1;
+  struct tm tm;
+  localtime_r(&stamp, &tm);
+  cal.day = days;
+  cal.week = (days + 3) / 7;
+  cal.month = tm.tm_year * 12 + tm.tm_mon;
+  cal.year = tm.tm_year;
+  cal.period = 0;
+  if ((_volumePeriodStart) && (*_volumePeriodStart > 0)) {
+    cal.period = cal.month + (tm.tm_mday < *_volumePeriodStart ? 0 : 1);
+  };
+  return cal;
+}
+
+// Пара счетчиков после перерыва в работе: тот же период - без изменений, следующий - сдвиг, более поздний - обнуление
+static void volumeRestorePair(volume_counter_t curr, uint32_t now, uint32_t saved)
+{
+  if (now == saved + 1) {
+    volumeShift(curr);
+  } else if (now != saved) {
+    _volume[curr] = 0;
+    _volume[curr + 1] = 0;
+  };
+}
+
+// Периоды, сменившиеся пока устройство было выключено; учитываются, когда время синхронизировано
+static void volumeRestoreRollover()
+{
+  uint32_t days = (uint32_t)(time(nullptr) / 86400);
+  if (days > _volumeDays) {
+    volume_calendar_t now = volumeCalendar(days);
+    volume_calendar_t saved = volumeCalendar(_volumeDays);
+    volumeRestorePair(VOLUME_TODAY, now.day, saved.day);
+    volumeRestorePair(VOLUME_WEEK_CURR, now.week, saved.week);
+    volumeRestorePair(VOLUME_MONTH_CURR, now.month, saved.month);
+    volumeRestorePair(VOLUME_PERIOD_CURR, now.period, saved.period);
+    volumeRestorePair(VOLUME_YEAR_CURR, now.year, saved.year);
+    _volumeDays = days;
+  };
+  _volumeRestored = false;
+}
+
+static uint32_t volumeChecksum()
+{
+  uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)_volume, sizeof(_volume));
+  #if CONFIG_WATERING_TANK_ESTIMATOR
+    crc = esp_rom_crc32_le(crc, (const uint8_t*)&_volumeTank, sizeof(_volumeTank));
+  #endif // CONFIG_WATERING_TANK_ESTIMATOR
+  return crc;
+}
+
+static void volumeInit()
+{
+  #if defined(CONFIG_ELTARIFFS_ENABLED) && CONFIG_ELTARIFFS_ENABLED
+    _volumePeriodStart = elTariffsGetReportDayAddress();
+  #endif // CONFIG_ELTARIFFS_ENABLED
+  for (uint8_t i = 0; i < VOLUME_COUNT; i++) {
+    nvsRead(CONFIG_VOLUME_NVS_SPACE, _volumeKeys[i], OPT_TYPE_U32, &_volume[i]);
+  };
+  _volumeRestored = nvsRead(CONFIG_VOLUME_NVS_SPACE, VOLUME_NVS_DAYS, OPT_TYPE_U32, &_volumeDays) && (_volumeDays > 0);
+  #if CONFIG_WATERING_TANK_ESTIMATOR
+    nvsRead(CONFIG_VOLUME_NVS_SPACE, VOLUME_NVS_TANK_CAPACITY, OPT_TYPE_FLOAT, &_volumeTank.capacity);
+    nvsRead(CONFIG_VOLUME_NVS_SPACE, VOLUME_NVS_TANK_RATE, OPT_TYPE_FLOAT, &_volumeTank.rate);
+    nvsRead(CONFIG_VOLUME_NVS_SPACE, VOLUME_NVS_TANK_REFILLED, OPT_TYPE_U8, &_volumeTank.refilled);
+  #endif // CONFIG_WATERING_TANK_ESTIMATOR
+  _volumeCrc = volumeChecksum();
+  #if CONFIG_WATERING_FLOW_METER
+    volumeMeterInit();
+  #endif // CONFIG_WATERING_FLOW_METER
+}
+
+// События времени приходят в задаче цикла событий, поэтому счетчики сдвигаются основной задачей в volumeUpdate()
+static void volumeTimeEventHandler(int32_t event_id, void* event_data)
+{
+  uint32_t roll = 0;
+  if (event_id == RE_TIME_START_OF_DAY) {
+    roll = VOLUME_ROLL_DAY;
+    if ((event_data) && (_volumePeriodStart) && (*(int*)event_data == *_volumePeriodStart)) {
+      roll |= VOLUME_ROLL_PERIOD;
+    };
+  } else if (event_id == RE_TIME_START_OF_WEEK) {
+    roll = VOLUME_ROLL_WEEK;
+  } else if (event_id == RE_TIME_START_OF_MONTH) {
+    roll = VOLUME_ROLL_MONTH;
+  } else if (event_id == RE_TIME_START_OF_YEAR) {
+    roll = VOLUME_ROLL_YEAR;
+  };
+  if (roll) __atomic_fetch_or(&_volumeRoll, roll, __ATOMIC_RELAXED);
+}
+
+// Пересчет накопленного времени работы или импульсов счетчика в объем, выполняется в каждом рабочем цикле
+static void volumeUpdate()
+{
+  if (_volumeRestored && statesTimeIsOk()) {
+    volumeRestoreRollover();
+  };
+
+  uint32_t roll = __atomic_exchange_n(&_volumeRoll, 0, __ATOMIC_RELAXED);
+  if (roll & VOLUME_ROLL_DAY) {
+    volumeShift(VOLUME_TODAY);
+    // Дни без полива тоже учитываются, иначе прогноз будет занижен в дождливую погоду
+    #if CONFIG_WATERING_TANK_ESTIMATOR
+      _volumeTank.rate = volumeEma(_volumeTank.rate, _volume[VOLUME_YESTERDAY] / 1000.0, CONFIG_WATERING_TANK_RATE_DAYS);
+    #endif // CONFIG_WATERING_TANK_ESTIMATOR
+  };
+  if (roll & VOLUME_ROLL_PERIOD) volumeShift(VOLUME_PERIOD_CURR);
+  if (roll & VOLUME_ROLL_WEEK) volumeShift(VOLUME_WEEK_CURR);
+  if (roll & VOLUME_ROLL_MONTH) volumeShift(VOLUME_MONTH_CURR);
+  if (roll & VOLUME_ROLL_YEAR) volumeShift(VOLUME_YEAR_CURR);
+
+  #if CONFIG_WATERING_FLOW_METER
+    int count = 0;
+    if (_volumeMeterUnit && (pcnt_unit_get_count(_volumeMeterUnit, &count) == ESP_OK)) {
+      uint32_t pulses = (uint32_t)count - (uint32_t)_volumeMeterLast;
+      _volumeMeterLast = count;
+      if ((pulses > 0) && (volumeMeterPulses > 0)) {
+        volumeAdd(1000.0 * pulses / volumeMeterPulses);
+      };
+    };
+  #else
+    for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+      uint32_t seconds = __atomic_exchange_n(&_volumePending[i], 0, __ATOMIC_RELAXED);
+      if ((seconds > 0) && (wateringZones[i].flow_rate > 0)) {
+        volumeAdd(1000.0 * wateringZones[i].flow_rate * seconds / 60.0);
+      };
+    };
+  #endif // CONFIG_WATERING_FLOW_METER
+}
+
+// Уровень воды вернулся в норму - бак заправлен
+static void volumeTankRefill()
+{
+  _volume[VOLUME_TANK_USED] = 0;
+  #if CONFIG_WATERING_TANK_ESTIMATOR
+    _volumeTank.refilled = 1;
+  #endif // CONFIG_WATERING_TANK_ESTIMATOR
+}
+
+// Низкий уровень воды: расход от заправки до датчика уровня - фактический полезный объем бака. 
+// Дребезг датчика сразу после заправки не затирает последнее измерение
+static void volumeTankLow()
+{
+  if (_volume[VOLUME_TANK_USED] > 0) {
+    _volume[VOLUME_TANK_LAST] = _volume[VOLUME_TANK_USED];
+    // Объем обучается только по полным циклам: после запуска без заправки расход с начала цикла неизвестен
+    #if CONFIG_WATERING_TANK_ESTIMATOR
+      if (_volumeTank.refilled) {
+        _volumeTank.capacity = volumeEma(_volumeTank.capacity, _volume[VOLUME_TANK_LAST] / 1000.0, CONFIG_WATERING_TANK_CAPACITY_CYCLES);
+        rlog_i(logTAG, "Usable tank volume: measured %.1f l, learned %.1f l", _volume[VOLUME_TANK_LAST] / 1000.0, _volumeTank.capacity);
+      };
+    #endif // CONFIG_WATERING_TANK_ESTIMATOR
+  };
+  #if CONFIG_WATERING_TANK_ESTIMATOR
+    _volumeTank.refilled = 0;
+  #endif // CONFIG_WATERING_TANK_ESTIMATOR
+}
+
+static void volumeStoreData()
+{
+  uint32_t crc = volumeChecksum();
+  if (crc != _volumeCrc) {
+    if (statesTimeIsOk() && !_volumeRestored) {
+      _volumeDays = (uint32_t)(time(nullptr) / 86400);
+    };
+    nvsWrite(CONFIG_VOLUME_NVS_SPACE, VOLUME_NVS_DAYS, OPT_TYPE_U32, &_volumeDays);
+    for (uint8_t i = 0; i < VOLUME_COUNT; i++) {
+      nvsWrite(CONFIG_VOLUME_NVS_SPACE, _volumeKeys[i], OPT_TYPE_U32, &_volume[i]);
+    };
+    #if CONFIG_WATERING_TANK_ESTIMATOR
+      nvsWrite(CONFIG_VOLUME_NVS_SPACE, VOLUME_NVS_TANK_CAPACITY, OPT_TYPE_FLOAT, &_volumeTank.capacity);
+      nvsWrite(CONFIG_VOLUME_NVS_SPACE, VOLUME_NVS_TANK_RATE, OPT_TYPE_FLOAT, &_volumeTank.rate);
+      nvsWrite(CONFIG_VOLUME_NVS_SPACE, VOLUME_NVS_TANK_REFILLED, OPT_TYPE_U8, &_volumeTank.refilled);
+      nvsWritesAdd(VOLUME_COUNT + 4);
+    #else
+      nvsWritesAdd(VOLUME_COUNT + 1);
+    #endif // CONFIG_WATERING_TANK_ESTIMATOR
+    _volumeCrc = crc;
+  } else {
+    _nvsWrites.skipped++;
+  };
+}
+
+// Значение в литрах или null, если оно неизвестно (отрицательное)
+static int volumeJsonAppend(char* buf, size_t size, int len, const char* name, float value)
+{
+  if ((len < 0) || (len >= (int)size)) return len;
+  if (value < 0) {
+    return len + snprintf(buf + len, size - len, ",\"%s\":null", name);
+  };
+  return len + snprintf(buf + len, size - len, ",\"%s\":%.1f", name, value);
+}
+
+// Объемы в литрах: {"total":..,"today":..,...,"tank":{"used":..,"last":..,"capacity":..,"learned":..,"remaining":..,"rate":..,"days":..}}.
+// Остаток считается от обученного полезного объема, пока он не измерен - от заданного объема бака
+static void volumeMqttPublish()
+{
+  static char buf[CONFIG_VOLUME_STATS_SIZE];
+  int len = snprintf(buf, sizeof(buf), "{");
+  for (uint8_t i = 0; i < VOLUME_TANK_USED; i++) {
+    if ((len < 0) || (len >= (int)sizeof(buf))) break;
+    len += snprintf(buf + len, sizeof(buf) - len, "%s\"%s\":%.1f", i > 0 ? "," : "", _volumeKeys[i], _volume[i] / 1000.0);
+  };
+
+  float used = _volume[VOLUME_TANK_USED] / 1000.0;
+  float usable = volumeTankCapacity > 0 ? volumeTankCapacity : -1.0;
+  #if CONFIG_WATERING_TANK_ESTIMATOR
+    float learned = _volumeTank.capacity > 0 ? _volumeTank.capacity : -1.0;
+    if (learned > 0) usable = learned;
+  #endif // CONFIG_WATERING_TANK_ESTIMATOR
+  float remaining = -1.0;
+  if (waterlevelSensorEnabled && (xEventGroupGetBits(_wateringFlags) & WATER_LEVEL_LOW)) {
+    remaining = 0.0;
+  } else if (usable > 0) {
+    remaining = used < usable ? usable - used : 0.0;
+  };
+
+  if ((len >= 0) && (len < (int)sizeof(buf))) {
+    len += snprintf(buf + len, sizeof(buf) - len, ",\"tank\":{\"used\":%.1f", used);
+  };
+  len = volumeJsonAppend(buf, sizeof(buf), len, "last", _volume[VOLUME_TANK_LAST] > 0 ? _volume[VOLUME_TANK_LAST] / 1000.0 : -1.0);
+  len = volumeJsonAppend(buf, sizeof(buf), len, "capacity", volumeTankCapacity > 0 ? volumeTankCapacity : -1.0);
+  #if CONFIG_WATERING_TANK_ESTIMATOR
+    len = volumeJsonAppend(buf, sizeof(buf), len, "learned", learned);
+  #endif // CONFIG_WATERING_TANK_ESTIMATOR
+  len = volumeJsonAppend(buf, sizeof(buf), len, "remaining", remaining);
+  #if CONFIG_WATERING_TANK_ESTIMATOR
+    float rate = _volumeTank.rate > 0 ? _volumeTank.rate : -1.0;
+    len = volumeJsonAppend(buf, sizeof(buf), len, "rate", rate);
+    len = volumeJsonAppend(buf, sizeof(buf), len, "days", (remaining >= 0) && (rate > 0) ? remaining / rate : -1.0);
+  #endif // CONFIG_WATERING_TANK_ESTIMATOR
+  if ((len >= 0) && (len < (int)sizeof(buf))) {
+    len += snprintf(buf + len, sizeof(buf) - len, "}}");
+  };
+  if ((len < 0) || (len >= (int)sizeof(buf))) {
+    rlog_w(logTAG, "Water volume does not fit into the buffer");
+    return;
+  };
+  mqttPublish(mqttTopic(TOPIC_VOLUME), buf, 
+    CONFIG_MQTT_SENSORS_QOS, CONFIG_MQTT_SENSORS_RETAINED, false, false);
+}
+
+#endif // CONFIG_WATERING_VOLUME
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------- Уровень воды ----------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+static reGPIO gpioWaterLevel(CONFIG_WATER_LEVEL_GPIO, CONFIG_WATER_LEVEL_LEVEL, CONFIG_WATER_LEVEL_PULL, CONFIG_WATER_LEVEL_INTR, CONFIG_WATER_LEVEL_DEBOUNCE, nullptr);
+
+static time_t lastLowLevelNotify = 0;
+
+void waterLowLevelNotify(bool level)
+{
+  #if CONFIG_TELEGRAM_ENABLE
+    #if CONFIG_WATERING_NOTIFY_QUEUE
+      notify_event_t event = { NOTIFY_EVENT_LEVEL, 0, level, 0, NAN, NAN };
+      notifyPush(&event);
+    #else
+      waterLevelNotifyRender(level);
+    #endif // CONFIG_WATERING_NOTIFY_QUEUE
+  #endif // CONFIG_TELEGRAM_ENABLE
+}
+
+void sensorsWaterLevelMqttPublish() 
+{
+  #if CONFIG_MQTT_PAYLOAD_CBOR
+    // [версия схемы, уровень воды в норме]
+    uint8_t raw[4];
+    char buf[sizeof(raw) + 2];
+    cbor_payload_t cbor;
+    cborInit(&cbor, raw, sizeof(raw));
+    cborPutArray(&cbor, 2);
+    cborPutUInt(&cbor, CONFIG_PAYLOAD_SCHEMA_VERSION);
+    cborPutBool(&cbor, !(xEventGroupGetBits(_wateringFlags) & WATER_LEVEL_LOW));
+    if (cborCobsEncode(&cbor, buf, sizeof(buf)) > 0) {
+      mqttPublish(mqttTopic(TOPIC_WATER_LEVEL), buf, CONFIG_MQTT_LOAD_QOS, CONFIG_MQTT_LOAD_RETAINED, false, false);
+    };
+  #else
+    mqttPublish(mqttTopic(TOPIC_WATER_LEVEL), 
+      malloc_stringf("{\"status\":%d}", 
+        !(xEventGroupGetBits(_wateringFlags) & WATER_LEVEL_LOW)), 
+      CONFIG_MQTT_LOAD_QOS, CONFIG_MQTT_LOAD_RETAINED, false, true);
+  #endif // CONFIG_MQTT_PAYLOAD_CBOR
+}
+
+static bool sensorsCheckWaterLevel()
+{
+  time_t now = time(nullptr);
+  bool level = true;
+  if (waterlevelSensorEnabled) {
+    level = (xEventGroupGetBits(_wateringFlags) & WATER_LEVEL_LOW) == 0;
+  };
+  if (xEventGroupGetBits(_wateringFlags) & WATER_LEVEL_CHANGED) {
+    xEventGroupClearBits(_wateringFlags, WATER_LEVEL_CHANGED);
+    lastLowLevelNotify = now;
+    #if CONFIG_WATERING_VOLUME
+      if (xEventGroupGetBits(_wateringFlags) & WATER_LEVEL_LOW) {
+        volumeTankLow();
+      } else {
+        volumeTankRefill();
+      };
+    #endif // CONFIG_WATERING_VOLUME
+    ledMode();
+    sensorsWaterLevelMqttPublish();
+    waterLowLevelNotify(level);
+  } else {
+    if (!level && ((now - lastLowLevelNotify) >= CONFIG_WATERING_NOTIFY_PERIOD)) {
+      lastLowLevelNotify = now;
+      waterLowLevelNotify(level);
+      ledMode();
+    };
+  };
+  return level;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// -------------------------------------------------------- Входы --------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+static void gpioInit()
+{
+  waterleakInit();
+  gpioWaterLevel.initGPIO();
+  ledWatering = ledTaskCreate(CONFIG_GPIO_WATERING_LED, true, true, "led_wtr", CONFIG_LED_TASK_STACK_SIZE, nullptr);
+  ledTaskSend(ledWatering, lmFlash, 5, 500, 500);
+}
+
+static void sensorsGpioEventHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+  if (event_id == RE_GPIO_CHANGE) {
+    if (event_data) {
+      gpio_data_t* data = (gpio_data_t*)event_data;
+      if (data->pin == CONFIG_GPIO_WATER_LEVEL) {
+        xEventGroupSetBits(_wateringFlags, WATER_LEVEL_CHANGED);
+        journalAdd(data->value == 1 ? JOURNAL_LEVEL_LOW : JOURNAL_LEVEL_OK, 0, 0);
+        if (data->value == 1) {
+          _interlockEventTime = esp_timer_get_time();
+          xEventGroupSetBits(_wateringFlags, WATER_LEVEL_LOW | PUMP_INTERLOCK);
+        } else {
+          xEventGroupClearBits(_wateringFlags, WATER_LEVEL_LOW);
+        };
+      };
+    };
+  };
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------- Управление нагрузкой ------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#define RELAYS_LEVEL_ON       0x01    // Уровень на выходе, при котором нагрузка включена
+
+static bool relaysPublish(rLoadController *ctrl, char* topic, char* payload, bool free_topic, bool free_payload)
+{
+  return mqttPublish(topic, payload, CONFIG_MQTT_LOAD_QOS, CONFIG_MQTT_LOAD_RETAINED, free_topic, free_payload);
+}
+
+// Показания почвы фиксируются в момент переключения насоса, а текст формируется уже при отправке
+static void wateringPumpNotify(bool state, time_t duration)
+{
+  #if CONFIG_TELEGRAM_ENABLE
+    #if CONFIG_WATERING_NOTIFY_QUEUE
+      notify_event_t event = { NOTIFY_EVENT_PUMP, 0, state, (uint32_t)duration, sensorsGetSoilMoisture(), sensorsGetSoilTemp() };
+      notifyPush(&event);
+    #else
+      wateringPumpNotifyRender(state, (uint32_t)duration, sensorsGetSoilMoisture(), sensorsGetSoilTemp());
+    #endif // CONFIG_WATERING_NOTIFY_QUEUE
+  #endif // CONFIG_TELEGRAM_ENABLE
+}
+
+void wateringPumpStateChange(rLoadController *ctrl, bool state, time_t duration)
+{
+  journalAdd(state ? JOURNAL_PUMP_ON : JOURNAL_PUMP_OFF, 0, state ? 0 : (uint16_t)(duration > UINT16_MAX ? UINT16_MAX : duration));
+  #if CONFIG_WATERING_VOLUME && !CONFIG_WATERING_FLOW_METER
+    if (!state) volumeLoadOff(0, duration);
+  #endif // CONFIG_WATERING_VOLUME
+  ledMode();
+  wateringPumpNotify(state, duration);
+}
+
+// Выход нагрузки зоны отключается напрямую, минуя объект нагрузки: так делает задача аварийного отключения,
+// которая не трогает объекты нагрузок, их таймеры и счетчики (это делает основной цикл)
+static void relaysCutZone(uint8_t zone)
+{
+  if (_zones[zone].load) {
+    gpio_set_level((gpio_num_t)wateringZonesHw[zone].load_gpio, !RELAYS_LEVEL_ON);
+  };
+}
+
+// Переключение выходов нагрузок выполняется из основного цикла, из таймера импульсного режима (esp_timer) и 
+// при обновлении прошивки, поэтому отключение прерывания датчика уровня на время переключения сериализуется
+static SemaphoreHandle_t _relaysGpioLock = nullptr;
+
+void wateringPumpBefore(rLoadController *ctrl, bool state, time_t duration)
+{
+  if (_relaysGpioLock) xSemaphoreTake(_relaysGpioLock, portMAX_DELAY);
+  gpioWaterLevel.deactivate(false);
+}
+
+void wateringPumpAfter(rLoadController *ctrl, bool state, time_t duration)
+{
+  // При аварийной блокировке выход, только что включенный таймером импульсного режима или управлением, 
+  // сразу отключается снова; состояние объекта нагрузки приводится в порядок в основном цикле
+  if ((state == RELAYS_LEVEL_ON) && __atomic_load_n(&_interlockLatched, __ATOMIC_SEQ_CST)) {
+    for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+      if (_zones[i].load == ctrl) relaysCutZone(i);
+    };
+  };
+  gpioWaterLevel.activate(false);
+  if (_relaysGpioLock) xSemaphoreGive(_relaysGpioLock);
+}
+
+static rLoadGpioController lcPump(CONFIG_GPIO_PUMP, RELAYS_LEVEL_ON, false, CONFIG_WATERING_KEY, 
+      &_zones[0].control.pulse, &wateringZones[0].cycle_interval, TI_SECONDS,
+      wateringPumpBefore, wateringPumpAfter, wateringPumpStateChange, relaysPublish);
+
+#if CONFIG_WATERING_ZONES > 1
+
+// Уведомления о поливе отправляются только для основной зоны
+void wateringZoneStateChange(rLoadController *ctrl, bool state, time_t duration)
+{
+  for (uint8_t i = 1; i < CONFIG_WATERING_ZONES; i++) {
+    if (_zones[i].load == ctrl) {
+      journalAdd(state ? JOURNAL_PUMP_ON : JOURNAL_PUMP_OFF, i, state ? 0 : (uint16_t)(duration > UINT16_MAX ? UINT16_MAX : duration));
+      #if CONFIG_WATERING_VOLUME && !CONFIG_WATERING_FLOW_METER
+        if (!state) volumeLoadOff(i, duration);
+      #endif // CONFIG_WATERING_VOLUME
+      break;
+    };
+  };
+  ledMode();
+}
+
+// Нагрузки создаются раньше датчиков, чтобы сразу перевести выходы в выключенное состояние
+typedef struct {
+  alignas(rLoadGpioController) uint8_t load[sizeof(rLoadGpioController)];
+} watering_zone_load_mem_t;
+
+static watering_zone_load_mem_t _zonesLoadMem[CONFIG_WATERING_ZONES - 1];
+
+static void relaysInitZones()
+{
+  for (uint8_t i = 1; i < CONFIG_WATERING_ZONES; i++) {
+    const watering_zone_hw_t* hw = &wateringZonesHw[i];
+    if (hw->soil_address == 0) continue;
+    _zones[i].load = new (_zonesLoadMem[i - 1].load) rLoadGpioController(hw->load_gpio, RELAYS_LEVEL_ON, false, hw->key, 
+      &_zones[i].control.pulse, &wateringZones[i].cycle_interval, TI_SECONDS,
+      wateringPumpBefore, wateringPumpAfter, wateringZoneStateChange, relaysPublish);
+  };
+}
+
+#endif // CONFIG_WATERING_ZONES > 1
+
+// Полив включен хотя бы в одной зоне
+static bool relaysPumpIsOn()
+{
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    if ((_zones[i].load) && (_zones[i].load->getState())) return true;
+  };
+  return false;
+}
+
+static void ledMode()
+{
+  if (sensorsGetWaterLeaks()) {
+    ledTaskSend(ledWatering, lmBlinkOn, CONFIG_LED_WATER_LEAK);
+  } else if (xEventGroupGetBits(_wateringFlags) & WATER_LEVEL_LOW) {
+    ledTaskSend(ledWatering, lmBlinkOn, CONFIG_LED_WATER_LEVEL);
+  } else if (relaysPumpIsOn()) {
+    ledTaskSend(ledWatering, lmBlinkOn, CONFIG_LED_WATER_ON);
+  } else {
+    ledTaskSend(ledWatering, lmBlinkOff, CONFIG_LED_WATER_OFF);
+  };
+}
+
+static uint32_t relaysChecksum(rLoadController* ctrl)
+{
+  re_load_counters_t counters = ctrl->getCounters();
+  re_load_durations_t durations = ctrl->getDurations();
+  uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)&counters, sizeof(counters));
+  return esp_rom_crc32_le(crc, (const uint8_t*)&durations, sizeof(durations));
+}
+
+static void relaysInit()
+{
+  #if CONFIG_WATERING_STATIC_ALLOCATION
+    static StaticSemaphore_t relaysGpioLockBuffer;
+    _relaysGpioLock = xSemaphoreCreateMutexStatic(&relaysGpioLockBuffer);
+  #else
+    _relaysGpioLock = xSemaphoreCreateMutex();
+  #endif // CONFIG_WATERING_STATIC_ALLOCATION
+  _zones[0].load = &lcPump;
+  #if CONFIG_WATERING_ZONES > 1
+    relaysInitZones();
+  #endif // CONFIG_WATERING_ZONES > 1
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    rLoadGpioController* load = _zones[i].load;
+    if (load == nullptr) continue;
+    #if defined(CONFIG_ELTARIFFS_ENABLED) && CONFIG_ELTARIFFS_ENABLED
+    load->setPeriodStartDay(elTariffsGetReportDayAddress());
+    #endif // CONFIG_ELTARIFFS_ENABLED
+    load->loadInit(false);
+    load->countersNvsRestore();
+    _zones[i].crc = relaysChecksum(load);
+  };
+}
+
+static void relaysMqttTopicsCreate(bool primary)
+{
+  lcPump.mqttTopicCreate(primary, false, CONFIG_WATERING_TOPIC, nullptr, nullptr);
+  for (uint8_t i = 1; i < CONFIG_WATERING_ZONES; i++) {
+    if (_zones[i].load) {
+      _zones[i].load->mqttTopicCreate(primary, false, wateringZonesHw[i].topic, CONFIG_WATERING_TOPIC, nullptr);
+    };
+  };
+}
+
+static void relaysMqttTopicsFree()
+{
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    if (_zones[i].load) _zones[i].load->mqttTopicFree();
+  };
+}
+
+static void relaysMqttPublishState()
+{
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    if (_zones[i].load) _zones[i].load->mqttPublish();
+  };
+}
+
+static void relaysStoreData()
+{
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    rLoadGpioController* load = _zones[i].load;
+    if (load == nullptr) continue;
+    uint32_t crc = relaysChecksum(load);
+    if (crc != _zones[i].crc) {
+      rlog_i(logTAG, "Store relays data for zone %d", i);
+      load->countersNvsStore();
+      _zones[i].crc = crc;
+      nvsWritesAdd(NVS_KEYS_LOAD_COUNTERS);
+    } else {
+      _nvsWrites.skipped++;
+    };
+  };
+}
+
+static void relaysTimeEventHandler(int32_t event_id, void* event_data)
+{
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    if (_zones[i].load) _zones[i].load->countersTimeEventHandler(event_id, event_data);
+  };
+  #if CONFIG_WATERING_VOLUME
+    volumeTimeEventHandler(event_id, event_data);
+  #endif // CONFIG_WATERING_VOLUME
+
+  /**************************************************************************
+  // 2023-07-19: Отладка счетчиков
+  if (event_id == RE_TIME_START_OF_DAY) {
+    tgSend(MK_MAIN, MP_ORDINARY, true, "DEBUG", "⏰ Получено событие: RE_TIME_START_OF_DAY");
+
+    if ((event_data)) {
+      int* mday = (int*)event_data;
+      if (*mday == 24) {
+        tgSend(MK_MAIN, MP_ORDINARY, true, "DEBUG", "⏰ Получено событие: RE_TIME_START_OF_PERIOD");
+      };
+    };
+  }
+  else if (event_id == RE_TIME_START_OF_WEEK) {
+    tgSend(MK_MAIN, MP_ORDINARY, true, "DEBUG", "⏰ Получено событие: RE_TIME_START_OF_WEEK");
+  }
+  else if (event_id == RE_TIME_START_OF_MONTH) {
+    tgSend(MK_MAIN, MP_ORDINARY, true, "DEBUG", "⏰ Получено событие: RE_TIME_START_OF_MONTH");
+  }
+  else if (event_id == RE_TIME_START_OF_YEAR) {
+    tgSend(MK_MAIN, MP_ORDINARY, true, "DEBUG", "⏰ Получено событие: RE_TIME_START_OF_YEAR");
+  };
+  **************************************************************************/
+}
+
+static void relaysOtaHandler()
+{
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    if (_zones[i].load) _zones[i].load->loadSetState(false, true, true);
+  };
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------ Аварийное отключение насоса ------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+typedef struct {
+  uint32_t count;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint32_t last_us;
+  uint32_t hist[CONFIG_INTERLOCK_HIST_SIZE];
+} interlock_stats_t;
+
+static interlock_stats_t _interlockStats = { 0, UINT32_MAX, 0, 0, { 0 } };
+
+static void interlockStatsAdd(int64_t latency)
+{
+  uint32_t us = latency > 0 ? (latency < UINT32_MAX ? (uint32_t)latency : UINT32_MAX) : 0;
+  uint8_t index = 31 - __builtin_clz(us | 1);
+  if (index >= CONFIG_INTERLOCK_HIST_SIZE) index = CONFIG_INTERLOCK_HIST_SIZE - 1;
+  _interlockStats.count++;
+  _interlockStats.last_us = us;
+  if (us < _interlockStats.min_us) _interlockStats.min_us = us;
+  if (us > _interlockStats.max_us) _interlockStats.max_us = us;
+  _interlockStats.hist[index]++;
+}
+
+static bool interlockRequired()
+{
+  return sensorsGetWaterLeaks() 
+    || (waterlevelSensorEnabled && (xEventGroupGetBits(_wateringFlags) & WATER_LEVEL_LOW));
+}
+
+static void interlockTaskExec(void *pvParameters)
+{
+  while (1) {
+    xEventGroupWaitBits(_wateringFlags, PUMP_INTERLOCK, pdTRUE, pdFALSE, portMAX_DELAY);
+    // Только блокировка и отключение выходов всех зон, независимо от состояния объектов нагрузок (импульсный режим 
+    // может переключить выход в любой момент); объекты нагрузок приводятся в порядок в основном цикле
+    if (interlockRequired()) {
+      __atomic_store_n(&_interlockLatched, true, __ATOMIC_SEQ_CST);
+      for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+        relaysCutZone(i);
+      };
+      interlockStatsAdd(esp_timer_get_time() - _interlockEventTime);
+      xEventGroupSetBits(_wateringFlags, PUMP_DEFERRED);
+    };
+  };
+  vTaskDelete(nullptr);
+}
+
+static bool interlockTaskStart()
+{
+  #if CONFIG_WATERING_STATIC_ALLOCATION
+    static StaticTask_t interlockTaskBuffer;
+    static StackType_t interlockTaskStack[CONFIG_WATERING_INTERLOCK_STACK_SIZE];
+    _interlockTask = xTaskCreateStaticPinnedToCore(interlockTaskExec, "interlock", 
+      CONFIG_WATERING_INTERLOCK_STACK_SIZE, NULL, CONFIG_WATERING_INTERLOCK_PRIORITY, 
+      interlockTaskStack, &interlockTaskBuffer, CONFIG_WATERING_INTERLOCK_CORE);
+  #else
+    xTaskCreatePinnedToCore(interlockTaskExec, "interlock", 
+      CONFIG_WATERING_INTERLOCK_STACK_SIZE, NULL, CONFIG_WATERING_INTERLOCK_PRIORITY, 
+      &_interlockTask, CONFIG_WATERING_INTERLOCK_CORE);
+  #endif // CONFIG_WATERING_STATIC_ALLOCATION
+  if (_interlockTask == nullptr) {
+    rlog_e(logTAG, "Failed to create pump interlock task!");
+    return false;
+  };
+  return true;
+}
+
+// Отложенные последствия аварийного отключения насоса
+static void interlockDeferred()
+{
+  if (xEventGroupGetBits(_wateringFlags) & PUMP_DEFERRED) {
+    xEventGroupClearBits(_wateringFlags, PUMP_DEFERRED);
+    rlog_w(logTAG, "Pump has been stopped by interlock, latency %" PRIu32 " us", _interlockStats.last_us);
+    // Выходы уже отключены: останавливаем таймеры импульсного режима и учитываем выключение в счетчиках, 
+    // светодиод и уведомления обновятся из обработчиков изменения состояния
+    for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+      if (_zones[i].load) _zones[i].load->loadSetState(false, true, false);
+    };
+    ledMode();
+    if (mqttIsConnected()) {
+      relaysMqttPublishState();
+    };
+  };
+  // Блокировка снимается, когда причины больше нет. Повторная проверка после снятия - на случай, если задача 
+  // аварийного отключения установила блокировку заново между проверкой и снятием
+  if (__atomic_load_n(&_interlockLatched, __ATOMIC_SEQ_CST) && !interlockRequired()) {
+    __atomic_store_n(&_interlockLatched, false, __ATOMIC_SEQ_CST);
+    if (interlockRequired()) __atomic_store_n(&_interlockLatched, true, __ATOMIC_SEQ_CST);
+  };
+}
+
+static void interlockMqttPublish()
+{
+  if (_interlockStats.count > 0) {
+    char hist[CONFIG_INTERLOCK_HIST_SIZE * 11 + 1];
+    uint16_t len = 0;
+    for (uint8_t i = 0; i < CONFIG_INTERLOCK_HIST_SIZE; i++) {
+      len += snprintf(hist + len, sizeof(hist) - len, i > 0 ? ",%" PRIu32 : "%" PRIu32, _interlockStats.hist[i]);
+    };
+    mqttPublish(mqttTopic(TOPIC_INTERLOCK), 
+      malloc_stringf("{\"count\":%" PRIu32 ",\"last\":%" PRIu32 ",\"min\":%" PRIu32 ",\"max\":%" PRIu32 ",\"hist\":[%s]}", 
+        _interlockStats.count, _interlockStats.last_us, _interlockStats.min_us, _interlockStats.max_us, hist), 
+      CONFIG_MQTT_LOAD_QOS, CONFIG_MQTT_LOAD_RETAINED, false, true);
+  };
+}
+
+#if CONFIG_WATERING_MODEL_ENABLE
+
+static void wateringModelInputs(wmodel_inputs_t* inputs)
+{
+  inputs->indoor_temp = NAN;
+  inputs->indoor_humidity = NAN;
+  inputs->heating_temp = NAN;
+  bool indoorOk = sensorsValueOk(&sensorIndoor, SENSOR_READ_INDOOR);
+  bool heatingOk = sensorsValueOk(&sensorHeating, SENSOR_READ_HEATING);
+  #if CONFIG_WATERING_SENSOR_HEALTH
+    indoorOk = indoorOk && healthIsOk(HEALTH_INDOOR);
+    heatingOk = heatingOk && healthIsOk(HEALTH_HEATING);
+  #endif // CONFIG_WATERING_SENSOR_HEALTH
+  if (indoorOk) {
+    inputs->indoor_humidity = sensorIndoor.getValue1(false).filteredValue;
+    inputs->indoor_temp = sensorIndoor.getValue2(false).filteredValue;
+  };
+  if (heatingOk) {
+    inputs->heating_temp = sensorHeating.getValue(false).filteredValue;
+  };
+}
+
+static void wateringModelMqttPublish()
+{
+  static char buf[CONFIG_MODEL_STATS_SIZE];
+  wmodel_inputs_t inputs;
+  wateringModelInputs(&inputs);
+  int len = snprintf(buf, sizeof(buf), "{\"zones\":[");
+  bool first = true;
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    if (wateringZones[i].mode != WATERING_MODEL) continue;
+    const wmodel_t* model = &_zones[i].control.model;
+    if ((len < 0) || (len >= (int)sizeof(buf))) break;
+    len += snprintf(buf + len, sizeof(buf) - len, 
+      "%s{\"zone\":%d,\"gain\":%.4f,\"gain_samples\":%" PRIu32 ",\"decay\":%.3f,\"decay_samples\":%" PRIu32 ","
+      "\"pulse\":%" PRIu32 ",\"count\":%d}",
+      first ? "" : ",", i, model->gain, model->gain_samples, wmodelDecayRate(model, &inputs), model->decay_samples, 
+      model->plan_pulse, model->plan_count);
+    first = false;
+  };
+  if (first) return;
+  if ((len < 0) || (len + 3 > (int)sizeof(buf))) {
+    rlog_w(logTAG, "Model parameters do not fit into the buffer");
+    return;
+  };
+  snprintf(buf + len, sizeof(buf) - len, "]}");
+  mqttPublish(mqttTopic(TOPIC_MODEL), buf, 
+    CONFIG_MQTT_SENSORS_QOS, CONFIG_MQTT_SENSORS_RETAINED, false, false);
+}
+
+#endif // CONFIG_WATERING_MODEL_ENABLE
+
+#if CONFIG_WATERING_SENSOR_HEALTH
+
+// Состояние зоны при переходе на полив по расписанию и обратно
+static void wateringFallbackLog(uint8_t zone)
+{
+  const watering_fallback_t* fallback = &_zones[zone].control.fallback;
+  if (fallback->active) {
+    if (zoneFallbackLearned(fallback)) {
+      rlog_w(logTAG, "Zone %d is watered by learned schedule: every %.0f s for %.0f s", zone, fallback->interval, fallback->duration);
+    } else {
+      rlog_e(logTAG, "Zone %d: soil sensor is unhealthy and watering schedule is not learned yet", zone);
+    };
+  } else {
+    rlog_i(logTAG, "Zone %d is watered by soil sensor again", zone);
+  };
+}
+
+#endif // CONFIG_WATERING_SENSOR_HEALTH
+
+static void wateringControlInit()
+{
+  uint8_t features = 0;
+  #if CONFIG_WATERING_SENSOR_HEALTH
+    features |= ZONE_FEATURE_FALLBACK;
+  #endif // CONFIG_WATERING_SENSOR_HEALTH
+  #if CONFIG_WATERING_MODEL_ENABLE
+    features |= ZONE_FEATURE_MODEL;
+  #endif // CONFIG_WATERING_MODEL_ENABLE
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    zoneControlInit(&_zones[i].control, features);
+  };
+}
+
+void wateringControl() 
+{
+  // Пролучаем данные с датчиков
+  bool waterLeak = sensorsCheckWaterLeaks();
+  bool waterLevel = sensorsCheckWaterLevel();
+  zone_inputs_t inputs;
+  inputs.allowed = !waterLeak && waterLevel && !__atomic_load_n(&_interlockLatched, __ATOMIC_SEQ_CST);
+  inputs.time = time(nullptr);
+  inputs.now = (uint32_t)(esp_timer_get_time() / 1000000);
+  inputs.sensor_ok = true;
+  #if CONFIG_WATERING_SENSOR_HEALTH
+    healthUpdate();
+  #endif // CONFIG_WATERING_SENSOR_HEALTH
+  #if CONFIG_WATERING_MODEL_ENABLE
+    wateringModelInputs(&inputs.inputs);
+  #else
+    inputs.inputs = { NAN, NAN, NAN };
+  #endif // CONFIG_WATERING_MODEL_ENABLE
+
+  // Управление нагрузкой каждой зоны; решение принимает zoneControl(), здесь - только данные, журнал и нагрузка
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    rLoadGpioController* load = _zones[i].load;
+    if ((load == nullptr) || (_zones[i].soil == nullptr)) continue;
+    inputs.state = load->getState();
+    inputs.last_on = load->getLastOn();
+    inputs.last_off = load->getLastOff();
+    inputs.moisture = sensorsGetZoneSoilMoisture(i);
+    inputs.soil_temp = sensorsGetZoneSoilTemp(i);
+    #if CONFIG_WATERING_SENSOR_HEALTH
+      inputs.sensor_ok = _health[i].healthy;
+    #endif // CONFIG_WATERING_SENSOR_HEALTH
+    uint8_t events;
+    bool newState = zoneControl(&_zones[i].control, &wateringZones[i], &inputs, &events);
+    #if CONFIG_WATERING_SENSOR_HEALTH
+      if (events & ZONE_EVENT_FALLBACK) wateringFallbackLog(i);
+    #endif // CONFIG_WATERING_SENSOR_HEALTH
+    if (events & ZONE_EVENT_PLAN) {
+      const wmodel_t* model = &_zones[i].control.model;
+      rlog_i(logTAG, "Watering plan for zone %d: %d x %" PRIu32 " s, gain %.4f %%/s", i, model->plan_count, model->plan_pulse, model->gain);
+    };
+    if (i == 0) {
+      rlog_i(logTAG, "Watering state: %d", newState);
+    } else {
+      rlog_i(logTAG, "Watering state [ %s ]: %d", wateringZonesHw[i].name, newState);
+    };
+    load->loadSetState(newState, false, true);
+  };
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------- Подавление повторов -------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#if CONFIG_WATERING_MQTT_DEDUP
+
+#define DEDUP_FIELDS_MAX      4
+#define DEDUP_DISCRETE        0.5     // Зона нечувствительности для состояний и счетчиков - любое изменение
+
+// Последние опубликованные значения одного сообщения
+typedef struct {
+  double   values[DEDUP_FIELDS_MAX];
+  uint32_t sent;        // Время публикации с момента запуска, с
+  bool     valid;
+} dedup_item_t;
+
+static dedup_item_t _dedupSoil[CONFIG_WATERING_ZONES];
+static dedup_item_t _dedupIndoor;
+static dedup_item_t _dedupHeating;
+static dedup_item_t _dedupLeak;
+static dedup_item_t _dedupLevel;
+static dedup_item_t _dedupRelays[CONFIG_WATERING_ZONES];
+static uint32_t _dedupPublished = 0;
+static uint32_t _dedupSuppressed = 0;
+
+// Сообщение публикуется, если хотя бы одно поле вышло за зону нечувствительности, изменилась доступность значения
+// или истек интервал heartbeat. При публикации запоминаются новые значения
+static bool dedupChanged(dedup_item_t* item, const double* values, const double* deadbands, uint8_t count)
+{
+  uint32_t now = (uint32_t)(esp_timer_get_time() / 1000000);
+  bool changed = !item->valid || (now - item->sent >= CONFIG_WATERING_MQTT_HEARTBEAT);
+  for (uint8_t i = 0; (i < count) && !changed; i++) {
+    if (isnan(values[i]) || isnan(item->values[i])) {
+      changed = isnan(values[i]) != isnan(item->values[i]);
+    } else {
+      changed = fabs(values[i] - item->values[i]) >= deadbands[i];
+    };
+  };
+  if (changed) {
+    memcpy(item->values, values, count * sizeof(double));
+    item->sent = now;
+    item->valid = true;
+    _dedupPublished++;
+  } else {
+    _dedupSuppressed++;
+  };
+  return changed;
+}
+
+// После подключения к брокеру все данные публикуются заново
+static void dedupReset()
+{
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    _dedupSoil[i].valid = false;
+    _dedupRelays[i].valid = false;
+  };
+  _dedupIndoor.valid = false;
+  _dedupHeating.valid = false;
+  _dedupLeak.valid = false;
+  _dedupLevel.valid = false;
+}
+
+static double dedupSensorValue(rSensor* sensor, float value)
+{
+  return sensor->getStatus() == SENSOR_STATUS_OK ? (double)value : NAN;
+}
+
+static void dedupMqttPublishChanged()
+{
+  static const double dbSoil[3] = { DEDUP_DISCRETE, SENSOR_SOIL_DEADBAND_TEMP, SENSOR_SOIL_DEADBAND_MOISTURE };
+  static const double dbIndoor[3] = { DEDUP_DISCRETE, SENSOR_INDOOR_DEADBAND_HUMIDITY, SENSOR_INDOOR_DEADBAND_TEMP };
+  static const double dbHeating[2] = { DEDUP_DISCRETE, SENSOR_HEATING_DEADBAND_TEMP };
+  static const double dbDiscrete[DEDUP_FIELDS_MAX] = { DEDUP_DISCRETE, DEDUP_DISCRETE, DEDUP_DISCRETE, DEDUP_DISCRETE };
+  double values[DEDUP_FIELDS_MAX];
+
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    reCWTSoilS* soil = _zones[i].soil;
+    if ((soil == nullptr) || sensorsReadBusy(SENSOR_READ_SOIL)) continue;
+    values[0] = soil->getStatus();
+    values[1] = dedupSensorValue(soil, soil->getValue1(false).filteredValue);
+    values[2] = dedupSensorValue(soil, soil->getValue2(false).filteredValue);
+    if (dedupChanged(&_dedupSoil[i], values, dbSoil, 3)) soil->publishData(false);
+  };
+
+  if (!sensorsReadBusy(SENSOR_READ_INDOOR)) {
+    values[0] = sensorIndoor.getStatus();
+    values[1] = dedupSensorValue(&sensorIndoor, sensorIndoor.getValue1(false).filteredValue);
+    values[2] = dedupSensorValue(&sensorIndoor, sensorIndoor.getValue2(false).filteredValue);
+    if (dedupChanged(&_dedupIndoor, values, dbIndoor, 3)) sensorIndoor.publishData(false);
+  };
+
+  if (!sensorsReadBusy(SENSOR_READ_HEATING)) {
+    values[0] = sensorHeating.getStatus();
+    values[1] = dedupSensorValue(&sensorHeating, sensorHeating.getValue(false).filteredValue);
+    if (dedupChanged(&_dedupHeating, values, dbHeating, 2)) sensorHeating.publishData(false);
+  };
+
+  EventBits_t bits = xEventGroupGetBits(_wateringFlags);
+  values[0] = (bits & WATER_LEAK_IN1) > 0;
+  values[1] = (bits & WATER_LEAK_IN2) > 0;
+  values[2] = (bits & WATER_LEAK_IN3) > 0;
+  if (dedupChanged(&_dedupLeak, values, dbDiscrete, 3)) sensorsWaterLeakMqttPublish();
+
+  values[0] = (bits & WATER_LEVEL_LOW) == 0;
+  if (dedupChanged(&_dedupLevel, values, dbDiscrete, 1)) sensorsWaterLevelMqttPublish();
+
+  // Длительности работы нагрузки меняются постоянно, поэтому они обновляются только по heartbeat
+  for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+    rLoadGpioController* load = _zones[i].load;
+    if (load == nullptr) continue;
+    values[0] = load->getState();
+    values[1] = load->getCounters().cntTotal;
+    values[2] = load->getLastOn();
+    values[3] = load->getLastOff();
+    if (dedupChanged(&_dedupRelays[i], values, dbDiscrete, 4)) load->mqttPublish();
+  };
+}
+
+static void dedupMqttPublish()
+{
+  uint32_t total = _dedupPublished + _dedupSuppressed;
+  mqttPublish(mqttTopic(TOPIC_DEDUP), 
+    malloc_stringf("{\"published\":%" PRIu32 ",\"suppressed\":%" PRIu32 ",\"ratio\":%.1f}", 
+      _dedupPublished, _dedupSuppressed, total > 0 ? 100.0 * _dedupSuppressed / total : 0.0), 
+    CONFIG_MQTT_SENSORS_QOS, CONFIG_MQTT_SENSORS_RETAINED, false, true);
+}
+
+#endif // CONFIG_WATERING_MQTT_DEDUP
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------- Сводная публикация --------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#if CONFIG_MQTT_SNAPSHOT_ENABLE || CONFIG_MQTT_BACKLOG_ENABLE
+
+// Снимок состояния устройства, собирается один раз и может быть отправлен сразу или позже
+typedef struct {
+  uint32_t time;
+  uint8_t  status[3];     // sensor_status_t: почва, помещение, отопление
+  float    values[5];     // Температура и влажность почвы, температура и влажность в помещении, температура отопления
+  uint8_t  leaks;
+  bool     level;
+  bool     pump;
+} snapshot_data_t;
+
+static char _snapshotBuf[CONFIG_SNAPSHOT_SIZE];
+static uint16_t _snapshotLen = 0;
+
+static void snapshotCollect(snapshot_data_t* data)
+{
+  EventBits_t bits = xEventGroupGetBits(_wateringFlags);
+  data->time = (uint32_t)time(nullptr);
+  // Сенсор, который еще читается, попадает в снимок без данных
+  bool soilBusy = sensorsReadBusy(SENSOR_READ_SOIL);
+  bool indoorBusy = sensorsReadBusy(SENSOR_READ_INDOOR);
+  bool heatingBusy = sensorsReadBusy(SENSOR_READ_HEATING);
+  data->status[0] = soilBusy ? SENSOR_STATUS_NO_DATA : sensorSoil.getStatus();
+  data->status[1] = indoorBusy ? SENSOR_STATUS_NO_DATA : sensorIndoor.getStatus();
+  data->status[2] = heatingBusy ? SENSOR_STATUS_NO_DATA : sensorHeating.getStatus();
+  data->values[0] = soilBusy ? NAN : sensorSoil.getValue1(false).filteredValue;
+  data->values[1] = soilBusy ? NAN : sensorSoil.getValue2(false).filteredValue;
+  data->values[2] = indoorBusy ? NAN : sensorIndoor.getValue2(false).filteredValue;
+  data->values[3] = indoorBusy ? NAN : sensorIndoor.getValue1(false).filteredValue;
+  data->values[4] = heatingBusy ? NAN : sensorHeating.getValue(false).filteredValue;
+  data->leaks = ((bits & WATER_LEAK_IN1) ? 0x01 : 0) | ((bits & WATER_LEAK_IN2) ? 0x02 : 0) | ((bits & WATER_LEAK_IN3) ? 0x04 : 0);
+  data->level = (bits & WATER_LEVEL_LOW) == 0;
+  data->pump = lcPump.getState();
+}
+
+static void snapshotAppend(const char* format, ...)
+{
+  if (_snapshotLen < sizeof(_snapshotBuf)) {
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(_snapshotBuf + _snapshotLen, sizeof(_snapshotBuf) - _snapshotLen, format, args);
+    va_end(args);
+    if (len > 0) _snapshotLen += len;
+  };
+}
+
+static void snapshotAppendValue(const char* key, float value, bool valid)
+{
+  if (valid && !isnan(value)) {
+    snapshotAppend("\"%s\":%.2f", key, value);
+  } else {
+    snapshotAppend("\"%s\":null", key);
+  };
+}
+
+// Показания сенсоров, флаги протечки и уровня, состояние насоса; закрывающая скобка не добавляется
+static void snapshotAppendData(const snapshot_data_t* data)
+{
+  bool soilOk = data->status[0] == SENSOR_STATUS_OK;
+  bool indoorOk = data->status[1] == SENSOR_STATUS_OK;
+  bool heatingOk = data->status[2] == SENSOR_STATUS_OK;
+
+  snapshotAppend("{\"time\":%d,\"" SENSOR_SOIL_TOPIC "\":{\"status\":\"%s\",", 
+    (int)data->time, sensorSoil.statusString((sensor_status_t)data->status[0]));
+  snapshotAppendValue(CONFIG_SENSOR_TEMP_NAME, data->values[0], soilOk);
+  snapshotAppend(",");
+  snapshotAppendValue(CONFIG_SENSOR_MOISTURE_NAME, data->values[1], soilOk);
+  snapshotAppend("},\"" SENSOR_INDOOR_TOPIC "\":{\"status\":\"%s\",", sensorIndoor.statusString((sensor_status_t)data->status[1]));
+  snapshotAppendValue(CONFIG_SENSOR_TEMP_NAME, data->values[2], indoorOk);
+  snapshotAppend(",");
+  snapshotAppendValue(CONFIG_SENSOR_HUMIDITY_NAME, data->values[3], indoorOk);
+  snapshotAppend("},\"" SENSOR_HEATING_TOPIC "\":{\"status\":\"%s\",", sensorHeating.statusString((sensor_status_t)data->status[2]));
+  snapshotAppendValue(CONFIG_SENSOR_TEMP_NAME, data->values[4], heatingOk);
+  snapshotAppend("},\"" CONFIG_WATER_LEAK_TOPIC "\":[%d,%d,%d],\"" CONFIG_WATER_LEVEL_TOPIC "\":%d,", 
+    (data->leaks & 0x01) > 0, (data->leaks & 0x02) > 0, (data->leaks & 0x04) > 0, data->level);
+  snapshotAppend("\"" CONFIG_WATERING_TOPIC "\":{\"state\":%d", data->pump);
+}
+
+#if CONFIG_MQTT_PAYLOAD_CBOR
+
+static uint8_t _cborBuf[CBOR_COBS_CAPACITY(CONFIG_SNAPSHOT_SIZE)];
+static cbor_payload_t _cbor;
+
+// [время, статус почвы, температура почвы, влажность почвы, статус помещения, температура, влажность, 
+//  статус отопления, температура отопления, флаги перелива, уровень воды, насос]; показания - в сотых долях
+static void snapshotCborData(const snapshot_data_t* data)
+{
+  bool soilOk = data->status[0] == SENSOR_STATUS_OK;
+  bool indoorOk = data->status[1] == SENSOR_STATUS_OK;
+  bool heatingOk = data->status[2] == SENSOR_STATUS_OK;
+
+  cborPutArray(&_cbor, 12);
+  cborPutUInt(&_cbor, data->time);
+  cborPutUInt(&_cbor, data->status[0]);
+  cborPutFixed(&_cbor, data->values[0], 2, soilOk);
+  cborPutFixed(&_cbor, data->values[1], 2, soilOk);
+  cborPutUInt(&_cbor, data->status[1]);
+  cborPutFixed(&_cbor, data->values[2], 2, indoorOk);
+  cborPutFixed(&_cbor, data->values[3], 2, indoorOk);
+  cborPutUInt(&_cbor, data->status[2]);
+  cborPutFixed(&_cbor, data->values[4], 2, heatingOk);
+  cborPutUInt(&_cbor, data->leaks);
+  cborPutBool(&_cbor, data->level);
+  cborPutBool(&_cbor, data->pump);
+}
+
+#endif // CONFIG_MQTT_PAYLOAD_CBOR
+
+#endif // CONFIG_MQTT_SNAPSHOT_ENABLE || CONFIG_MQTT_BACKLOG_ENABLE
 
-static void gpioInit()
+#if CONFIG_MQTT_SNAPSHOT_ENABLE
+
+static char* _snapshotTopic = nullptr;
+
+static void snapshotMqttTopicCreate()
 {
-  waterleakInit();
-  gpioWaterLevel.initGPIO();
-  ledWatering = ledTaskCreate(CONFIG_GPIO_WATERING_LED, true, true, "led_wtr", CONFIG_LED_TASK_STACK_SIZE, nullptr);
-  ledTaskSend(ledWatering, lmFlash, 5, 500, 500);
+  _snapshotTopic = mqttTopic(TOPIC_SNAPSHOT);
 }
 
-static void sensorsGpioEventHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+static void snapshotMqttTopicFree()
 {
-  if (event_id == RE_GPIO_CHANGE) {
-    if (event_data) {
-      gpio_data_t* data = (gpio_data_t*)event_data;
-      if (data->pin == CONFIG_GPIO_WATER_LEVEL) {
-        xEventGroupSetBits(_wateringFlags, WATER_LEVEL_CHANGED);
-        if (data->value == 1) {
-          xEventGroupSetBits(_wateringFlags, WATER_LEVEL_LOW);
-        } else {
-          xEventGroupClearBits(_wateringFlags, WATER_LEVEL_LOW);
-        };
-      };
-    };
+  _snapshotTopic = nullptr;
+}
+
+// Все данные устройства в одном сообщении, формируется за один проход в статическом буфере
+static void snapshotMqttPublish()
+{
+  if (_snapshotTopic == nullptr) return;
+
+  snapshot_data_t data;
+  snapshotCollect(&data);
+  re_load_counters_t counters = lcPump.getCounters();
+  re_load_durations_t durations = lcPump.getDurations();
+
+  #if CONFIG_MQTT_PAYLOAD_CBOR
+    // [версия схемы, снимок, [last_on, last_off, включений: сегодня, неделя, месяц, всего, 
+    //  длительность: последняя, сегодня, неделя, месяц, всего]]
+    cborInit(&_cbor, _cborBuf, sizeof(_cborBuf));
+    cborPutArray(&_cbor, 3);
+    cborPutUInt(&_cbor, CONFIG_PAYLOAD_SCHEMA_VERSION);
+    snapshotCborData(&data);
+    cborPutArray(&_cbor, 11);
+    cborPutUInt(&_cbor, (uint32_t)lcPump.getLastOn());
+    cborPutUInt(&_cbor, (uint32_t)lcPump.getLastOff());
+    cborPutUInt(&_cbor, counters.cntToday);
+    cborPutUInt(&_cbor, counters.cntWeekCurr);
+    cborPutUInt(&_cbor, counters.cntMonthCurr);
+    cborPutUInt(&_cbor, counters.cntTotal);
+    cborPutUInt(&_cbor, durations.durLast);
+    cborPutUInt(&_cbor, durations.durToday);
+    cborPutUInt(&_cbor, durations.durWeekCurr);
+    cborPutUInt(&_cbor, durations.durMonthCurr);
+    cborPutUInt(&_cbor, durations.durTotal);
+    _snapshotLen = cborCobsEncode(&_cbor, _snapshotBuf, sizeof(_snapshotBuf));
+    if (_snapshotLen == 0) _snapshotLen = sizeof(_snapshotBuf);
+  #else
+    _snapshotLen = 0;
+    snapshotAppendData(&data);
+    snapshotAppend(",\"last_on\":%d,\"last_off\":%d,"
+      "\"count\":{\"today\":%" PRIu32 ",\"week\":%" PRIu32 ",\"month\":%" PRIu32 ",\"total\":%" PRIu32 "},"
+      "\"duration\":{\"last\":%" PRIu32 ",\"today\":%" PRIu32 ",\"week\":%" PRIu32 ",\"month\":%" PRIu32 ",\"total\":%" PRIu32 "}}}",
+      (int)lcPump.getLastOn(), (int)lcPump.getLastOff(),
+      counters.cntToday, counters.cntWeekCurr, counters.cntMonthCurr, counters.cntTotal,
+      durations.durLast, durations.durToday, durations.durWeekCurr, durations.durMonthCurr, durations.durTotal);
+  #endif // CONFIG_MQTT_PAYLOAD_CBOR
+
+  if (_snapshotLen < sizeof(_snapshotBuf)) {
+    mqttPublish(_snapshotTopic, _snapshotBuf, CONFIG_MQTT_SENSORS_QOS, CONFIG_MQTT_SENSORS_RETAINED, false, false);
+  } else {
+    rlog_e(logTAG, "Snapshot does not fit into buffer (%zu bytes)", sizeof(_snapshotBuf));
   };
 }
 
+#endif // CONFIG_MQTT_SNAPSHOT_ENABLE
+
 // -----------------------------------------------------------------------------------------------------------------------
-// ------------------------------------------------- Управление нагрузкой ------------------------------------------------
+// -------------------------------------------------- Отложенная отправка ------------------------------------------------
 // -----------------------------------------------------------------------------------------------------------------------
 
-static bool relaysPublish(rLoadController *ctrl, char* topic, char* payload, bool free_topic, bool free_payload)
+#if CONFIG_MQTT_BACKLOG_ENABLE
+
+static char* _backlogTopic = nullptr;
+static snapshot_data_t _backlogItems[CONFIG_MQTT_BACKLOG_SIZE];
+static uint16_t _backlogHead = 0;
+static uint16_t _backlogCount = 0;
+static uint16_t _backlogStride = 1;    // При прореживании сохраняется только каждый _backlogStride-й снимок
+static uint16_t _backlogSkip = 0;
+static uint32_t _backlogDropped = 0;
+static esp_timer_t _backlogTimer;
+
+static void backlogMqttTopicCreate()
 {
-  return mqttPublish(topic, payload, CONFIG_MQTT_LOAD_QOS, CONFIG_MQTT_LOAD_RETAINED, free_topic, free_payload);
+  _backlogTopic = mqttTopic(TOPIC_BACKLOG);
+  timerSet(&_backlogTimer, CONFIG_MQTT_BACKLOG_INTERVAL);
 }
 
-char* sensorsWateringNotifyData()
+static void backlogMqttTopicFree()
 {
-  return malloc_stringf("Влажность:   %.1f %%\nТемпература: %.1f°C", sensorsGetSoilMoisture(), sensorsGetSoilTemp());
+  _backlogTopic = nullptr;
 }
 
-void wateringPumpStateChange(rLoadController *ctrl, bool state, time_t duration)
+static inline snapshot_data_t* backlogItem(uint16_t index)
 {
-  ledMode();
-  #if CONFIG_TELEGRAM_ENABLE
-    if (wateringNotify != NOTIFY_OFF) {
-      char* data = sensorsWateringNotifyData();
-      if (data) {
-        if (state) {
-          tgSend(CONFIG_WATERING_NOTIFY_KIND, CONFIG_WATERING_NOTIFY_PRIORITY, wateringNotify == NOTIFY_SOUND, CONFIG_TELEGRAM_DEVICE, 
-          "💦 Полив <b>запущен</b>\n\n<code>%s</code>", data);
-        } else {
-          uint16_t last_h = duration / 3600;
-          uint16_t last_m = duration % 3600 / 60;
-          uint16_t last_s = duration % 3600 % 60;
-          tgSend(CONFIG_WATERING_NOTIFY_KIND, CONFIG_WATERING_NOTIFY_PRIORITY, wateringNotify == NOTIFY_SOUND, CONFIG_TELEGRAM_DEVICE, 
-          "✅ Полив <b>завершен</b>\n\n<code>%s\nВремя работы: %.2dч %.2dм %.2dc</code>", data, last_h, last_m, last_s);
-        };
-        free(data);
-      };
-    };
-  #endif // CONFIG_TELEGRAM_ENABLE
+  return &_backlogItems[(_backlogHead + index) % CONFIG_MQTT_BACKLOG_SIZE];
 }
 
-void wateringPumpBefore(rLoadController *ctrl, bool state, time_t duration)
+// Сохранение снимка, пока брокер недоступен
+static void backlogPush()
 {
-  gpioWaterLevel.deactivate(false);
+  if (_backlogSkip > 0) {
+    _backlogSkip--;
+    return;
+  };
+  _backlogSkip = _backlogStride - 1;
+
+  if (_backlogCount >= CONFIG_MQTT_BACKLOG_SIZE) {
+    #if CONFIG_MQTT_BACKLOG_POLICY == 1
+      // Прореживание: оставляем каждый второй снимок (включая самый свежий) и вдвое реже сохраняем новые
+      uint16_t keep = _backlogCount / 2;
+      for (uint16_t i = 0; i < keep; i++) {
+        *backlogItem(i) = *backlogItem(2 * i + 1);
+      };
+      _backlogDropped += _backlogCount - keep;
+      _backlogCount = keep;
+      if (_backlogStride < 0x8000) _backlogStride *= 2;
+      _backlogSkip = _backlogStride - 1;
+      rlog_w(logTAG, "MQTT backlog is full, downsampled to every %d snapshot", _backlogStride);
+    #else
+      // Вытесняем самый старый снимок
+      _backlogHead = (_backlogHead + 1) % CONFIG_MQTT_BACKLOG_SIZE;
+      _backlogCount--;
+      _backlogDropped++;
+    #endif // CONFIG_MQTT_BACKLOG_POLICY
+  };
+
+  snapshotCollect(backlogItem(_backlogCount));
+  _backlogCount++;
 }
 
-void wateringPumpAfter(rLoadController *ctrl, bool state, time_t duration)
+// Отправка накопленных снимков порциями, не чаще CONFIG_MQTT_BACKLOG_INTERVAL и только при достаточном запасе кучи
+static void backlogFlush()
 {
-  gpioWaterLevel.activate(false);
-}
+  if ((_backlogCount == 0) || (_backlogTopic == nullptr)) return;
+  if (!timerTimeout(&_backlogTimer)) return;
+  timerSet(&_backlogTimer, CONFIG_MQTT_BACKLOG_INTERVAL);
+  if (esp_get_free_heap_size() < CONFIG_BACKLOG_MIN_FREE_HEAP) {
+    rlog_w(logTAG, "MQTT backlog flush postponed: low free heap (%" PRIu32 " bytes)", esp_get_free_heap_size());
+    return;
+  };
 
-static rLoadGpioController lcPump(CONFIG_GPIO_PUMP, 0x01, false, CONFIG_WATERING_KEY, 
-      &wateringMoistureCycleTime, &wateringMoistureCycleInterval, TI_SECONDS,
-      wateringPumpBefore, wateringPumpAfter, wateringPumpStateChange, relaysPublish);
+  uint16_t sent = 0;
+  #if CONFIG_MQTT_PAYLOAD_CBOR
+    // [версия схемы, осталось, потеряно, [снимок, ...]]
+    cborInit(&_cbor, _cborBuf, sizeof(_cborBuf));
+    cborPutArray(&_cbor, 4);
+    cborPutUInt(&_cbor, CONFIG_PAYLOAD_SCHEMA_VERSION);
+    cborPutUInt(&_cbor, _backlogCount);
+    cborPutUInt(&_cbor, _backlogDropped);
+    cborPutArrayBegin(&_cbor);
+    while ((sent < _backlogCount) && (sent < CONFIG_MQTT_BACKLOG_BATCH)) {
+      // 1 байт резерва под завершение массива
+      uint16_t prevLen = _cbor.len;
+      snapshotCborData(backlogItem(sent));
+      if (_cbor.overflow || (_cbor.len + 1 > _cbor.size)) {
+        _cbor.len = prevLen;
+        _cbor.overflow = false;
+        break;
+      };
+      sent++;
+    };
+    cborPutBreak(&_cbor);
+    _snapshotLen = cborCobsEncode(&_cbor, _snapshotBuf, sizeof(_snapshotBuf));
+    if ((sent == 0) || (_snapshotLen == 0)) {
+      rlog_e(logTAG, "Snapshot does not fit into buffer (%zu bytes)", sizeof(_snapshotBuf));
+      return;
+    };
+  #else
+    _snapshotLen = 0;
+    snapshotAppend("{\"left\":%d,\"dropped\":%" PRIu32 ",\"data\":[", _backlogCount, _backlogDropped);
+    while ((sent < _backlogCount) && (sent < CONFIG_MQTT_BACKLOG_BATCH)) {
+      // Если очередной снимок не помещается в буфер, откатываемся и отправляем то, что есть (3 байта резерва под "]}")
+      uint16_t prevLen = _snapshotLen;
+      if (sent > 0) snapshotAppend(",");
+      snapshotAppendData(backlogItem(sent));
+      snapshotAppend("}}");
+      if (_snapshotLen + 3 > sizeof(_snapshotBuf)) {
+        _snapshotLen = prevLen;
+        _snapshotBuf[_snapshotLen] = 0;
+        break;
+      };
+      sent++;
+    };
+    if (sent == 0) {
+      rlog_e(logTAG, "Snapshot does not fit into buffer (%zu bytes)", sizeof(_snapshotBuf));
+      return;
+    };
+    snapshotAppend("]}");
+  #endif // CONFIG_MQTT_PAYLOAD_CBOR
 
-static void ledMode()
-{
-  if (sensorsGetWaterLeaks()) {
-    ledTaskSend(ledWatering, lmBlinkOn, CONFIG_LED_WATER_LEAK);
-  } else if (xEventGroupGetBits(_wateringFlags) & WATER_LEVEL_LOW) {
-    ledTaskSend(ledWatering, lmBlinkOn, CONFIG_LED_WATER_LEVEL);
-  } else if (lcPump.getState()) {
-    ledTaskSend(ledWatering, lmBlinkOn, CONFIG_LED_WATER_ON);
-  } else {
-    ledTaskSend(ledWatering, lmBlinkOff, CONFIG_LED_WATER_OFF);
+  if (mqttPublish(_backlogTopic, _snapshotBuf, CONFIG_MQTT_SENSORS_QOS, false, false, false) == ESP_OK) {
+    _backlogHead = (_backlogHead + sent) % CONFIG_MQTT_BACKLOG_SIZE;
+    _backlogCount -= sent;
+    if (_backlogCount == 0) {
+      rlog_i(logTAG, "MQTT backlog flushed, %" PRIu32 " snapshots were dropped", _backlogDropped);
+      _backlogStride = 1;
+      _backlogSkip = 0;
+      _backlogDropped = 0;
+    };
   };
 }
 
-static void relaysInit()
-{
-  #if defined(CONFIG_ELTARIFFS_ENABLED) && CONFIG_ELTARIFFS_ENABLED
-  lcPump.setPeriodStartDay(elTariffsGetReportDayAddress());
-  #endif // CONFIG_ELTARIFFS_ENABLED
-  lcPump.loadInit(false);
-  lcPump.countersNvsRestore();
-}
+#endif // CONFIG_MQTT_BACKLOG_ENABLE
 
-static void relaysMqttTopicsCreate(bool primary)
-{
-  lcPump.mqttTopicCreate(primary, false, CONFIG_WATERING_TOPIC, nullptr, nullptr);
-}
+// -----------------------------------------------------------------------------------------------------------------------
+// --------------------------------------------------- История показаний -------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
 
-static void relaysMqttTopicsFree()
+#if CONFIG_WATERING_HISTORY_ENABLE
+
+static char* _historyTopic = nullptr;
+static char _historyBuf[CONFIG_HISTORY_CHUNK_SIZE];
+static uint32_t _historyLastTime = 0;
+// Время последней записи, доставленной на брокер (онлайн или при выгрузке)
+static uint32_t _historyDrainFrom = 0;
+// Время задано командой "history <unixtime>": запись с этим временем тоже выгружается
+static bool _historyDrainInclusive = false;
+static volatile bool _historyDrainPending = false;
+
+static void historyMqttTopicCreate()
 {
-  lcPump.mqttTopicFree();
+  _historyTopic = mqttTopic(TOPIC_HISTORY);
+  // После восстановления связи нужно отправить всё, что накопилось за время её отсутствия
+  _historyDrainPending = true;
 }
 
-static void relaysMqttPublishState()
+static void historyMqttTopicFree()
 {
-  lcPump.mqttPublish();
+  _historyTopic = nullptr;
 }
 
-static void relaysStoreData()
+static int16_t historySensorValue(rSensor* sensor, float value)
 {
-  rlog_i(logTAG, "Store relays data");
-
-  lcPump.countersNvsStore();
+  if (sensor->getStatus() == SENSOR_STATUS_OK) {
+    return historyEncodeValue(value);
+  };
+  return CONFIG_HISTORY_NO_VALUE;
 }
 
-static void relaysTimeEventHandler(int32_t event_id, void* event_data)
+static void historyStore()
 {
-  lcPump.countersTimeEventHandler(event_id, event_data);
+  if (!statesTimeIsOk()) return;
+  uint32_t now = (uint32_t)time(nullptr);
+  if ((now - _historyLastTime) < CONFIG_WATERING_HISTORY_INTERVAL) return;
+  _historyLastTime = now;
 
-  /**************************************************************************
-  // 2023-07-19: Отладка счетчиков
-  if (event_id == RE_TIME_START_OF_DAY) {
-    tgSend(MK_MAIN, MP_ORDINARY, true, "DEBUG", "⏰ Получено событие: RE_TIME_START_OF_DAY");
+  history_sample_t sample;
+  sample.time = now;
+  for (uint8_t i = 0; i < CONFIG_HISTORY_CHANNELS; i++) {
+    sample.values[i] = CONFIG_HISTORY_NO_VALUE;
+  };
+  if (!sensorsReadBusy(SENSOR_READ_SOIL)) {
+    sample.values[0] = historySensorValue(&sensorSoil, sensorSoil.getValue1(false).filteredValue);
+    sample.values[1] = historySensorValue(&sensorSoil, sensorSoil.getValue2(false).filteredValue);
+  };
+  if (!sensorsReadBusy(SENSOR_READ_INDOOR)) {
+    sample.values[2] = historySensorValue(&sensorIndoor, sensorIndoor.getValue2(false).filteredValue);
+    sample.values[3] = historySensorValue(&sensorIndoor, sensorIndoor.getValue1(false).filteredValue);
+  };
+  if (!sensorsReadBusy(SENSOR_READ_HEATING)) {
+    sample.values[4] = historySensorValue(&sensorHeating, sensorHeating.getValue(false).filteredValue);
+  };
+  sample.pump = lcPump.getState();
+  if (!historyAdd(&sample)) {
+    rlog_w(logTAG, "History sample rejected: time went backwards");
+    return;
+  };
 
-    if ((event_data)) {
-      int* mday = (int*)event_data;
-      if (*mday == 24) {
-        tgSend(MK_MAIN, MP_ORDINARY, true, "DEBUG", "⏰ Получено событие: RE_TIME_START_OF_PERIOD");
-      };
-    };
-  }
-  else if (event_id == RE_TIME_START_OF_WEEK) {
-    tgSend(MK_MAIN, MP_ORDINARY, true, "DEBUG", "⏰ Получено событие: RE_TIME_START_OF_WEEK");
-  }
-  else if (event_id == RE_TIME_START_OF_MONTH) {
-    tgSend(MK_MAIN, MP_ORDINARY, true, "DEBUG", "⏰ Получено событие: RE_TIME_START_OF_MONTH");
-  }
-  else if (event_id == RE_TIME_START_OF_YEAR) {
-    tgSend(MK_MAIN, MP_ORDINARY, true, "DEBUG", "⏰ Получено событие: RE_TIME_START_OF_YEAR");
+  // Пока связь есть, данные уходят на брокер в обычном режиме и повторно их выгружать не нужно
+  if (mqttIsConnected() && !_historyDrainPending) {
+    _historyDrainFrom = now;
   };
-  **************************************************************************/
 }
 
-static void relaysOtaHandler()
+static int historyFormatValue(char* buf, size_t size, int16_t value)
 {
-  lcPump.loadSetState(false, true, true);  
+  if (value == CONFIG_HISTORY_NO_VALUE) {
+    return snprintf(buf, size, "null");
+  };
+  int32_t absval = value < 0 ? -(int32_t)value : value;
+  return snprintf(buf, size, "%s%d.%d", value < 0 ? "-" : "", 
+    (int)(absval / CONFIG_HISTORY_SCALE), (int)(absval % CONFIG_HISTORY_SCALE));
 }
 
+static int historyFormatSample(char* buf, size_t size, const history_sample_t* sample)
+{
+  int len = snprintf(buf, size, "[%u", (unsigned int)sample->time);
+  for (uint8_t i = 0; i < CONFIG_HISTORY_CHANNELS; i++) {
+    if ((len > 0) && ((size_t)len < size)) len += snprintf(buf + len, size - len, ",");
+    if ((len > 0) && ((size_t)len < size)) len += historyFormatValue(buf + len, size - len, sample->values[i]);
+  };
+  if ((len > 0) && ((size_t)len < size)) len += snprintf(buf + len, size - len, ",%d]", sample->pump);
+  return len;
+}
 
-void wateringControl() 
+// Выгрузка накопленных записей порциями: {"samples":..,"bytes":..,"capacity":..,"data":[[time,soil_t,soil_m,indoor_t,indoor_h,heating_t,pump],..]}
+static void historyMqttDrain()
 {
-  bool oldPump = lcPump.getState();
-  
-  // Пролучаем данные с датчиков
-  bool waterLeak = sensorsCheckWaterLeaks();
-  bool waterLevel = sensorsCheckWaterLevel();
-  float soilMoisture = sensorsGetSoilMoisture();
-
-  // Проверяем перелив, уровень воды и расписание
-  bool newPump = !waterLeak && waterLevel
-    && (wateringMode != WATERING_OFF) 
-    && checkTimespanNowEx(wateringTimespan, true);
-
-  // Проверяем уровень влажности почвы
-  if (newPump && (wateringMode == WATERING_SENSORS)) {
-    if (!isnan(soilMoisture)) {
-      if (oldPump) {
-        newPump = soilMoisture < wateringMoistureMax;
-      } else {
-        newPump = soilMoisture <= wateringMoistureMin;
-      };
-    } else {
-      newPump = false;
+  if (!_historyDrainPending || (_historyTopic == nullptr)) return;
+
+  history_stats_t stats;
+  historyGetStats(&stats);
+
+  history_cursor_t cursor;
+  history_sample_t sample;
+  char row[96];
+  uint8_t chunks = 0;
+  int len = 0;
+  uint32_t chunkLast = 0;
+  historyCursorInit(&cursor);
+  while (historyCursorNext(&cursor, &sample)) {
+    if (_historyDrainInclusive ? sample.time < _historyDrainFrom : sample.time <= _historyDrainFrom) continue;
+    int rowLen = historyFormatSample(row, sizeof(row), &sample);
+    if ((rowLen <= 0) || ((size_t)rowLen >= sizeof(row))) continue;
+
+    // Текущее сообщение заполнено - отправляем его и начинаем следующее
+    if ((len > 0) && ((size_t)(len + rowLen + 3) > sizeof(_historyBuf))) {
+      snprintf(_historyBuf + len, sizeof(_historyBuf) - len, "]}");
+      // Не отправленная порция будет выгружена повторно в следующем цикле
+      if (mqttPublish(_historyTopic, _historyBuf, CONFIG_MQTT_SENSORS_QOS, false, false, false) != ESP_OK) return;
+      _historyDrainFrom = chunkLast;
+      _historyDrainInclusive = false;
+      len = 0;
+      if (++chunks >= CONFIG_HISTORY_DRAIN_CHUNKS) return;
     };
 
-    // Если полив еще не начат, дополнительно учитываем температуру почвы
-    float soilTemp = sensorsGetSoilTemp();
-    if (newPump && !oldPump && !isnan(soilTemp)) {
-      newPump = (soilTemp >= wateringSoilTempMin) && (soilTemp <= wateringSoilTempMax);
+    if (len == 0) {
+      len = snprintf(_historyBuf, sizeof(_historyBuf), "{\"samples\":%u,\"bytes\":%u,\"capacity\":%u,\"data\":[%s", 
+        (unsigned int)stats.samples, (unsigned int)stats.bytes, (unsigned int)stats.capacity, row);
+    } else {
+      len += snprintf(_historyBuf + len, sizeof(_historyBuf) - len, ",%s", row);
     };
+    chunkLast = sample.time;
   };
 
-  // Контроль общего времени и интервалов полива
-  if (newPump && (wateringMoistureMaxDuration > 0)) {
-    if (oldPump) {
-      if (checkTimeInterval(lcPump.getLastOn(), wateringMoistureMaxDuration, TI_MINUTES, true)) {
-        newPump = false;
-      };
+  if (len > 0) {
+    snprintf(_historyBuf + len, sizeof(_historyBuf) - len, "]}");
+    if (mqttPublish(_historyTopic, _historyBuf, CONFIG_MQTT_SENSORS_QOS, false, false, false) != ESP_OK) return;
+    _historyDrainFrom = chunkLast;
+  };
+  _historyDrainInclusive = false;
+  _historyDrainPending = false;
+
+  if (stats.encode_count > 0) {
+    rlog_i(logTAG, "History: %" PRIu32 " samples, %" PRIu32 " of %" PRIu32 " bytes, %" PRIu32 " evicted, encode %" PRIu32 " us/sample", 
+      stats.samples, stats.bytes, stats.capacity, stats.evicted, stats.encode_time / stats.encode_count);
+  };
+}
+
+// Запрос истории командой: "history" - всё, что ещё не отправлено; "history all" - весь буфер; "history <unixtime>" - начиная с указанного времени
+static void historyCommand(const char* from)
+{
+  if (from != nullptr) {
+    if (strcasecmp(from, "all") == 0) {
+      _historyDrainFrom = 0;
+      _historyDrainInclusive = false;
     } else {
-      if (checkTimeInterval(lcPump.getLastOff(), wateringMoistureMaxDuration, TI_MINUTES, false)) {
-        newPump = false;
-      };
+      _historyDrainFrom = (uint32_t)strtoul(from, nullptr, 10);
+      _historyDrainInclusive = true;
     };
   };
-
-  // Управление насосом
-  rlog_i(logTAG, "Watering state: %d", newPump);
-  lcPump.loadSetState(newPump, false, true);
+  _historyDrainPending = true;
+  rlog_i(logTAG, "History requested from %" PRIu32, _historyDrainFrom);
 }
 
+#endif // CONFIG_WATERING_HISTORY_ENABLE
+
 // -----------------------------------------------------------------------------------------------------------------------
 // --------------------------------------------------- Event  handlers ---------------------------------------------------
 // -----------------------------------------------------------------------------------------------------------------------
 
 static void sensorsMqttEventHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
 {
+  heap_mark_t heap = heapBegin();
   if (event_id == RE_MQTT_CONNECTED) {
     re_mqtt_event_data_t* data = (re_mqtt_event_data_t*)event_data;
+    mqttTopicsSelect(data->primary);
+    #if CONFIG_WATERING_MQTT_DEDUP
+      dedupReset();
+    #endif // CONFIG_WATERING_MQTT_DEDUP
     sensorsMqttTopicsCreate(data->primary);
     relaysMqttTopicsCreate(data->primary);
+    #if CONFIG_MQTT_SNAPSHOT_ENABLE
+      snapshotMqttTopicCreate();
+    #endif // CONFIG_MQTT_SNAPSHOT_ENABLE
+    #if CONFIG_MQTT_BACKLOG_ENABLE
+      backlogMqttTopicCreate();
+    #endif // CONFIG_MQTT_BACKLOG_ENABLE
+    #if CONFIG_WATERING_HISTORY_ENABLE
+      historyMqttTopicCreate();
+    #endif // CONFIG_WATERING_HISTORY_ENABLE
   } 
   else if ((event_id == RE_MQTT_CONN_LOST) || (event_id == RE_MQTT_CONN_FAILED)) {
     sensorsMqttTopicsFree();
     relaysMqttTopicsFree();
-  }
+    #if CONFIG_MQTT_SNAPSHOT_ENABLE
+      snapshotMqttTopicFree();
+    #endif // CONFIG_MQTT_SNAPSHOT_ENABLE
+    #if CONFIG_MQTT_BACKLOG_ENABLE
+      backlogMqttTopicFree();
+    #endif // CONFIG_MQTT_BACKLOG_ENABLE
+    #if CONFIG_WATERING_HISTORY_ENABLE
+      historyMqttTopicFree();
+    #endif // CONFIG_WATERING_HISTORY_ENABLE
+    mqttTopicsDeselect();
+  };
+  heapEnd(HEAP_MQTT, heap);
 }
 
 static void sensorsTimeEventHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
@@ -739,6 +3753,7 @@ static void sensorsTimeEventHandler(void* arg, esp_event_base_t event_base, int3
   if (event_id == RE_TIME_EVERY_MINUTE) {
     xEventGroupSetBits(_wateringFlags, TIME_MINUTE_EVENT);
   } else if (event_id == RE_TIME_START_OF_DAY) {
+    nvsWritesNewDay();
     _sensorsNeedStore = true;
   } else if (event_id == RE_TIME_SILENT_MODE_ON) {
     ledTaskSend(ledWatering, lmEnable, 0, 0, 0);
@@ -876,6 +3891,20 @@ static void sensorsCommandsEventHandler(void* arg, esp_event_base_t event_base,
           };
         };
       };
+
+      #if CONFIG_WATERING_HISTORY_ENABLE
+        // Запрос истории показаний
+        if ((cmd != nullptr) && (strcasecmp(cmd, CONFIG_HISTORY_COMMAND) == 0)) {
+          historyCommand(strtok(nullptr, seps));
+        };
+      #endif // CONFIG_WATERING_HISTORY_ENABLE
+
+      #if CONFIG_WATERING_JOURNAL
+        // Запрос журнала событий
+        if ((cmd != nullptr) && (strcasecmp(cmd, CONFIG_JOURNAL_COMMAND) == 0)) {
+          journalCommand(strtok(nullptr, seps));
+        };
+      #endif // CONFIG_WATERING_JOURNAL
     };
     if (buf != nullptr) free(buf);
   };
@@ -904,20 +3933,163 @@ bool sensorsEventHandlersRegister()
       && eventHandlerRegister(RE_SYSTEM_EVENTS, RE_SYS_OTA, &sensorsOtaEventHandler, nullptr);
 }
 
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------ Данные для внешних сервисов ------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#if CONFIG_OPENMON_ENABLE || CONFIG_THINGSPEAK_ENABLE
+
+// Буфер используется только из задачи полива, поэтому один на все сервисы
+static ds_payload_t dsValues;
+
+static bool dsSoilTemp(float* value)
+{
+  *value = sensorsGetSoilTemp();
+  return !isnan(*value);
+}
+
+static bool dsSoilMoisture(float* value)
+{
+  *value = sensorsGetSoilMoisture();
+  return !isnan(*value);
+}
+
+static bool dsIndoorTemp(float* value)
+{
+  if (!sensorsValueOk(&sensorIndoor, SENSOR_READ_INDOOR)) return false;
+  *value = sensorIndoor.getValue2(false).filteredValue;
+  return true;
+}
+
+static bool dsIndoorHumidity(float* value)
+{
+  if (!sensorsValueOk(&sensorIndoor, SENSOR_READ_INDOOR)) return false;
+  *value = sensorIndoor.getValue1(false).filteredValue;
+  return true;
+}
+
+static bool dsHeatingTemp(float* value)
+{
+  if (!sensorsValueOk(&sensorHeating, SENSOR_READ_HEATING)) return false;
+  *value = sensorHeating.getValue(false).filteredValue;
+  return true;
+}
+
+static bool dsPumpState(float* value)
+{
+  *value = lcPump.getState();
+  return true;
+}
+
+static bool dsWaterLeak(float* value)
+{
+  *value = sensorsGetWaterLeaks();
+  return true;
+}
+
+static bool dsWaterLevel(float* value)
+{
+  *value = (xEventGroupGetBits(_wateringFlags) & WATER_LEVEL_LOW) == 0;
+  return true;
+}
+
+#endif // CONFIG_OPENMON_ENABLE || CONFIG_THINGSPEAK_ENABLE
+
+#if CONFIG_OPENMON_ENABLE
+
+static bool dsWaterLeak1(float* value)
+{
+  *value = (xEventGroupGetBits(_wateringFlags) & WATER_LEAK_IN1) > 0;
+  return true;
+}
+
+static bool dsWaterLeak2(float* value)
+{
+  *value = (xEventGroupGetBits(_wateringFlags) & WATER_LEAK_IN2) > 0;
+  return true;
+}
+
+static bool dsWaterLeak3(float* value)
+{
+  *value = (xEventGroupGetBits(_wateringFlags) & WATER_LEAK_IN3) > 0;
+  return true;
+}
+
+static const ds_payload_field_t omFields[] = {
+  { "p1",  2, dsSoilMoisture },     // 01. Почва влажность:FLOAT:~:ON:OFF
+  { "p2",  2, dsSoilTemp },         // 02. Почва температура:FLOAT:~:OFF:OFF
+  { "p3",  0, dsPumpState },        // 03. Полив:INT:~:ON:OFF
+  { "p4",  0, dsWaterLeak1 },       // 04. Перелив 1:INT:~:ON:OFF
+  { "p5",  0, dsWaterLeak2 },       // 05. Перелив 2:INT:~:ON:OFF
+  { "p6",  0, dsWaterLeak3 },       // 06. Перелив 3:INT:~:ON:OFF
+  { "p7",  0, dsWaterLevel },       // 07. Вода:INT:~:ON:OFF
+  { "p8",  2, dsIndoorTemp },       // 08. Комната температура:FLOAT:~:OFF:OFF
+  { "p9",  2, dsIndoorHumidity },   // 09. Комната влажность:FLOAT:~:OFF:OFF
+  { "p10", 3, dsHeatingTemp }       // 10. Батареи отопления:FLOAT:~:OFF:OFF
+                                    // 11-13. Резерв:FLOAT:~:OFF:OFF
+                                    // 14-16. Резерв:INT:~:OFF:OFF
+};
+
+#endif // CONFIG_OPENMON_ENABLE
+
+#if CONFIG_THINGSPEAK_ENABLE
+
+static const ds_payload_field_t tsFields[] = {
+  { "field1", 1, dsSoilTemp },       // Field 1 Почва температура
+  { "field2", 1, dsSoilMoisture },   // Field 2 Почва влажность
+  { "field3", 0, dsPumpState },      // Field 3 Полив
+  { "field4", 0, dsWaterLeak },      // Field 4 Перелив
+  { "field5", 0, dsWaterLevel },     // Field 5 Уровень воды
+  { "field6", 1, dsIndoorTemp },     // Field 6 Комната температура
+  { "field7", 1, dsIndoorHumidity }, // Field 7 Комната влажность
+  { "field8", 1, dsHeatingTemp }     // Field 8 Батареи температура
+};
+
+#endif // CONFIG_THINGSPEAK_ENABLE
+
 // -----------------------------------------------------------------------------------------------------------------------
 // ------------------------------------------------------- Задача --------------------------------------------------------
 // -----------------------------------------------------------------------------------------------------------------------
 
-void wateringTaskExec(void *pvParameters)
+// Таймер сохранения изменившихся данных в NVS
+static esp_timer_t nvsStoreTimer;
+
+// Таймеры публикации данных с сенсоров
+static esp_timer_t mqttPubTimer;
+#if CONFIG_OPENMON_ENABLE
+  static esp_timer_t omSendTimer;
+#endif // CONFIG_OPENMON_ENABLE
+#if CONFIG_NARODMON_ENABLE
+  static esp_timer_t nmSendTimer;
+#endif // CONFIG_NARODMON_ENABLE
+#if CONFIG_THINGSPEAK_ENABLE
+  static esp_timer_t tsSendTimer;
+#endif // CONFIG_THINGSPEAK_ENABLE
+
+static void wateringTaskInit()
 {
   // -------------------------------------------------------------------------------------------------------
   // Инициализация устройств и сенсоров
   // -------------------------------------------------------------------------------------------------------
+  #if CONFIG_TELEGRAM_ENABLE && CONFIG_WATERING_NOTIFY_QUEUE
+    notifyTaskStart();
+  #endif // CONFIG_WATERING_NOTIFY_QUEUE
   gpioInit();
   relaysInit();
+  #if CONFIG_WATERING_VOLUME
+    volumeInit();
+  #endif // CONFIG_WATERING_VOLUME
+  interlockTaskStart();
   sensorsInitModbus();
   sensorsInitParameters();
   sensorsInitSensors();
+  wateringControlInit();
+  #if CONFIG_WATERING_SENSOR_HEALTH
+    healthInit();
+  #endif // CONFIG_WATERING_SENSOR_HEALTH
+  #if CONFIG_WATERING_PARALLEL_READ
+    sensorsReadersStart();
+  #endif // CONFIG_WATERING_PARALLEL_READ
 
   // -------------------------------------------------------------------------------------------------------
   // Инициализация контроллеров
@@ -946,232 +4118,214 @@ void wateringTaskExec(void *pvParameters)
   // -------------------------------------------------------------------------------------------------------
   // Таймеры публикции данных с сенсоров
   // -------------------------------------------------------------------------------------------------------
-  int8_t mqttIndex = 0;
-  esp_timer_t mqttPubTimer;
+  timerSet(&nvsStoreTimer, CONFIG_WATERING_NVS_INTERVAL*60*1000);
   timerSet(&mqttPubTimer, iMqttPubInterval*1000);
   #if CONFIG_OPENMON_ENABLE
-    esp_timer_t omSendTimer;
     timerSet(&omSendTimer, iOpenMonInterval*1000);
   #endif // CONFIG_OPENMON_ENABLE
   #if CONFIG_NARODMON_ENABLE
-    esp_timer_t nmSendTimer;
     timerSet(&nmSendTimer, iNarodMonInterval*1000);
   #endif // CONFIG_NARODMON_ENABLE
   #if CONFIG_THINGSPEAK_ENABLE
-    esp_timer_t tsSendTimer;
     timerSet(&tsSendTimer, iThingSpeakInterval*1000);
   #endif // CONFIG_THINGSPEAK_ENABLE
+}
 
-  TickType_t startTicks = 0;
-  TickType_t currTicks = 0;
-  TickType_t waitTicks = 0;
-  while (1) {
-    // Ждем тайамута или любого события
-    xEventGroupWaitBits(_wateringFlags, FORCED_CONTROL, pdFALSE, pdFALSE, waitTicks);
-    xEventGroupClearBits(_wateringFlags, TIME_MINUTE_EVENT);
-    // Фиксируем время начала данного рабочего цикла
-    startTicks = xTaskGetTickCount(); 
-
-    // -----------------------------------------------------------------------------------------------------
-    // Чтение данных с сенсоров
-    // -----------------------------------------------------------------------------------------------------
-    sensorSoil.readData();
-    if (sensorSoil.getStatus() == SENSOR_STATUS_OK) {
-      rlog_i("SOIL", "Values raw: %.1f %% / %.1f °С | out: %.1f %% / %.1f °С | min: %.1f %% / %.1f °С | max: %.1f %% / %.1f °С", 
-        sensorSoil.getValue2(false).rawValue, sensorSoil.getValue1(false).rawValue, 
-        sensorSoil.getValue2(false).filteredValue, sensorSoil.getValue1(false).filteredValue,
-        sensorSoil.getExtremumsDaily2(false).minValue.filteredValue, sensorSoil.getExtremumsDaily1(false).minValue.filteredValue,
-        sensorSoil.getExtremumsDaily2(false).maxValue.filteredValue, sensorSoil.getExtremumsDaily1(false).maxValue.filteredValue);
-    };
-
-    sensorIndoor.readData();
-    if (sensorIndoor.getStatus() == SENSOR_STATUS_OK) {
-      rlog_i("INDOOR", "Values raw: %.2f °С / %.2f %% | out: %.2f °С / %.2f %% | min: %.2f °С / %.2f %% | max: %.2f °С / %.2f %%", 
-        sensorIndoor.getValue2(false).rawValue, sensorIndoor.getValue1(false).rawValue, 
-        sensorIndoor.getValue2(false).filteredValue, sensorIndoor.getValue1(false).filteredValue, 
-        sensorIndoor.getExtremumsDaily2(false).minValue.filteredValue, sensorIndoor.getExtremumsDaily1(false).minValue.filteredValue, 
-        sensorIndoor.getExtremumsDaily2(false).maxValue.filteredValue, sensorIndoor.getExtremumsDaily1(false).maxValue.filteredValue);
-    };
-
-    sensorHeating.readData();
-    if (sensorHeating.getStatus() == SENSOR_STATUS_OK) {
-      rlog_i("HEATING", "Values raw: %.1f °С | out: %.1f °С | min: %.1f °С | max: %.1f °С", 
-        sensorHeating.getValue(false).rawValue,
-        sensorHeating.getValue(false).filteredValue,
-        sensorHeating.getExtremumsDaily(false).minValue.filteredValue,
-        sensorHeating.getExtremumsDaily(false).maxValue.filteredValue);
-    };
-
-    // -----------------------------------------------------------------------------------------------------
-    // Управление нагрузкой
-    // -----------------------------------------------------------------------------------------------------
-    
-    wateringControl();
-
-    // -----------------------------------------------------------------------------------------------------
-    // Сохранение экстремумов с сенсоров
-    // -----------------------------------------------------------------------------------------------------
-
-    if (_sensorsNeedStore) {
-      _sensorsNeedStore = false;
-      sensorsStoreData();
-    };
+// Один рабочий цикл задачи: чтение сенсоров, управление, публикация. Возвращает время ожидания до следующего цикла
+static TickType_t wateringTaskCycle()
+{
+  // Фиксируем время начала данного рабочего цикла
+  TickType_t startTicks = xTaskGetTickCount(); 
+  int64_t cycleStarted = esp_timer_get_time();
+  int64_t phaseStarted = cycleStarted;
 
-    // -----------------------------------------------------------------------------------------------------
-    // Публикация данных с сенсоров
-    // -----------------------------------------------------------------------------------------------------
+  // -----------------------------------------------------------------------------------------------------
+  // Чтение данных с сенсоров
+  // -----------------------------------------------------------------------------------------------------
+  heap_mark_t heap = heapBegin();
+  sensorsReadData();
+  heapEnd(HEAP_SENSORS, heap);
+  wateringProfile(PROFILE_READ, phaseStarted);
 
-    // MQTT брокер
-    if (mqttIsConnected()) {
-      // Если таймер вышел, сбрасываем индекс и публикуем локальные данные
-      if (timerTimeout(&mqttPubTimer)) {
-        timerSet(&mqttPubTimer, iMqttPubInterval*1000);
-        sensorSoil.publishData(false);
-        sensorIndoor.publishData(false);
-        sensorHeating.publishData(false);
+  // Последствия аварийного отключения насоса, если оно было
+  interlockDeferred();
+
+  // -----------------------------------------------------------------------------------------------------
+  // Управление нагрузкой
+  // -----------------------------------------------------------------------------------------------------
+  
+  phaseStarted = esp_timer_get_time();
+  heap = heapBegin();
+  wateringControl();
+  #if CONFIG_WATERING_VOLUME
+    volumeUpdate();
+  #endif // CONFIG_WATERING_VOLUME
+  heapEnd(HEAP_WATERING, heap);
+  wateringProfile(PROFILE_CONTROL, phaseStarted);
+
+  // -----------------------------------------------------------------------------------------------------
+  // Сохранение экстремумов с сенсоров и счётчиков насоса (записываются только изменившиеся группы)
+  // -----------------------------------------------------------------------------------------------------
+
+  if (_sensorsNeedStore || timerTimeout(&nvsStoreTimer)) {
+    _sensorsNeedStore = false;
+    timerSet(&nvsStoreTimer, CONFIG_WATERING_NVS_INTERVAL*60*1000);
+    phaseStarted = esp_timer_get_time();
+    heap = heapBegin();
+    sensorsStoreData();
+    heapEnd(HEAP_WATERING, heap);
+    wateringProfile(PROFILE_NVS, phaseStarted);
+  };
+
+  // Запись в историю показаний
+  #if CONFIG_WATERING_HISTORY_ENABLE
+    historyStore();
+  #endif // CONFIG_WATERING_HISTORY_ENABLE
+
+  // -----------------------------------------------------------------------------------------------------
+  // Публикация данных с сенсоров
+  // -----------------------------------------------------------------------------------------------------
+
+  // MQTT брокер
+  if (mqttIsConnected()) {
+    phaseStarted = esp_timer_get_time();
+    heap = heapBegin();
+    // Если таймер вышел, сбрасываем индекс и публикуем локальные данные
+    if (timerTimeout(&mqttPubTimer)) {
+      timerSet(&mqttPubTimer, iMqttPubInterval*1000);
+      #if CONFIG_MQTT_SNAPSHOT_ENABLE
+        snapshotMqttPublish();
+      #elif CONFIG_WATERING_MQTT_DEDUP
+        dedupMqttPublishChanged();
+      #else
+        if (!sensorsReadBusy(SENSOR_READ_SOIL)) {
+          for (uint8_t i = 0; i < CONFIG_WATERING_ZONES; i++) {
+            if (_zones[i].soil) _zones[i].soil->publishData(false);
+          };
+        };
+        if (!sensorsReadBusy(SENSOR_READ_INDOOR)) sensorIndoor.publishData(false);
+        if (!sensorsReadBusy(SENSOR_READ_HEATING)) sensorHeating.publishData(false);
         sensorsWaterLeakMqttPublish();
         sensorsWaterLevelMqttPublish();
         relaysMqttPublishState();
-      };
+      #endif // CONFIG_MQTT_SNAPSHOT_ENABLE
+      interlockMqttPublish();
+      nvsWritesMqttPublish();
+      #if CONFIG_WATERING_MODBUS_SCHEDULER
+        modbusMqttPublish();
+      #endif // CONFIG_WATERING_MODBUS_SCHEDULER
+      #if CONFIG_WATERING_MODEL_ENABLE
+        wateringModelMqttPublish();
+      #endif // CONFIG_WATERING_MODEL_ENABLE
+      #if CONFIG_WATERING_PROFILE
+        wateringProfileMqttPublish();
+      #endif // CONFIG_WATERING_PROFILE
+      #if CONFIG_WATERING_HEAP_ACCOUNTING
+        heapMqttPublish();
+      #endif // CONFIG_WATERING_HEAP_ACCOUNTING
+      #if CONFIG_WATERING_MQTT_DEDUP && !CONFIG_MQTT_SNAPSHOT_ENABLE
+        dedupMqttPublish();
+      #endif // CONFIG_WATERING_MQTT_DEDUP
+      #if CONFIG_WATERING_VOLUME
+        volumeMqttPublish();
+      #endif // CONFIG_WATERING_VOLUME
+      #if CONFIG_WATERING_SENSOR_HEALTH
+        healthMqttPublish();
+      #endif // CONFIG_WATERING_SENSOR_HEALTH
     };
+    // Отправка снимков, накопленных за время отсутствия связи
+    #if CONFIG_MQTT_BACKLOG_ENABLE
+      backlogFlush();
+    #endif // CONFIG_MQTT_BACKLOG_ENABLE
+    // Выгрузка истории, накопленной за время отсутствия связи
+    #if CONFIG_WATERING_HISTORY_ENABLE
+      historyMqttDrain();
+    #endif // CONFIG_WATERING_HISTORY_ENABLE
+    #if CONFIG_WATERING_JOURNAL
+      journalMqttDump();
+    #endif // CONFIG_WATERING_JOURNAL
+    heapEnd(HEAP_MQTT, heap);
+    wateringProfile(PROFILE_MQTT, phaseStarted);
+  };
 
-    // open-monitoring.online
-    #if CONFIG_OPENMON_ENABLE
-      if (timerTimeout(&omSendTimer)) {
-        char * omValues = nullptr;
-        // 01. Почва влажность:FLOAT:~:ON:OFF
-        // 02. Почва температура:FLOAT:~:OFF:OFF
-        if (sensorSoil.getStatus() == SENSOR_STATUS_OK) {
-          omValues = concat_strings_div(omValues, 
-            malloc_stringf("p1=%.2f&p2=%.2f", 
-              sensorSoil.getValue2(false).filteredValue,
-              sensorSoil.getValue1(false).filteredValue),
-            "&");
-        };
-        // 03. Полив:INT:~:ON:OFF
-        omValues = concat_strings_div(omValues, 
-          malloc_stringf("p3=%d", 
-            lcPump.getState()),
-          "&");
-        // 04. Перелив 1:INT:~:ON:OFF
-        // 05. Перелив 2:INT:~:ON:OFF
-        // 06. Перелив 3:INT:~:ON:OFF
-        // 07. Вода:INT:~:ON:OFF
-        omValues = concat_strings_div(omValues, 
-          malloc_stringf("p4=%d&p5=%d&p6=%d&p7=%d", 
-            ((xEventGroupGetBits(_wateringFlags) & WATER_LEAK_IN1) > 0),
-            ((xEventGroupGetBits(_wateringFlags) & WATER_LEAK_IN2) > 0),
-            ((xEventGroupGetBits(_wateringFlags) & WATER_LEAK_IN3) > 0),
-            ((xEventGroupGetBits(_wateringFlags) & WATER_LEVEL_LOW) == 0)),
-          "&");
-        // 08. Комната температура:FLOAT:~:OFF:OFF
-        // 09. Комната влажность:FLOAT:~:OFF:OFF
-        if (sensorIndoor.getStatus() == SENSOR_STATUS_OK) {
-          omValues = concat_strings_div(omValues, 
-            malloc_stringf("p8=%.2f&p9=%.2f", 
-              sensorIndoor.getValue2(false).filteredValue,
-              sensorIndoor.getValue1(false).filteredValue),
-            "&");
-        };
-        // 10. Батареи отопления:FLOAT:~:OFF:OFF
-        if (sensorHeating.getStatus() == SENSOR_STATUS_OK) {
-          omValues = concat_strings_div(omValues, 
-            malloc_stringf("p10=%.3f", 
-              sensorHeating.getValue(false).filteredValue),
-            "&");
-        };
-        // 11. Резерв:FLOAT:~:OFF:OFF
-        // 12. Резерв:FLOAT:~:OFF:OFF
-        // 13. Резерв:FLOAT:~:OFF:OFF
-        // 14. Резерв:INT:~:OFF:OFF
-        // 15. Резерв:INT:~:OFF:OFF
-        // 16. Резерв:INT:~:OFF:OFF
-
-        // Отправляем сформированный пакет на сервер
-        if (omValues) {
-          timerSet(&omSendTimer, iOpenMonInterval*1000);
-          dsSend(EDS_OPENMON, CONFIG_OPENMON_CTR01_ID, omValues, false);
-          free(omValues);
-        };
+  // Брокер недоступен - сохраняем снимок для отправки после восстановления связи
+  #if CONFIG_MQTT_BACKLOG_ENABLE
+    if (!mqttIsConnected() && statesTimeIsOk() && timerTimeout(&mqttPubTimer)) {
+      timerSet(&mqttPubTimer, iMqttPubInterval*1000);
+      backlogPush();
+    };
+  #endif // CONFIG_MQTT_BACKLOG_ENABLE
+
+  // open-monitoring.online
+  #if CONFIG_OPENMON_ENABLE
+    if (timerTimeout(&omSendTimer)) {
+      if (dsPayloadBuild(&dsValues, omFields, sizeof(omFields) / sizeof(ds_payload_field_t))) {
+        timerSet(&omSendTimer, iOpenMonInterval*1000);
+        phaseStarted = esp_timer_get_time();
+        dsSend(EDS_OPENMON, CONFIG_OPENMON_CTR01_ID, dsValues.data, false);
+        wateringProfile(PROFILE_OPENMON, phaseStarted);
       };
-    #endif // CONFIG_OPENMON_ENABLE
-
-    // narodmon.ru
-    #if CONFIG_NARODMON_ENABLE
-      if (statesInetIsAvailabled() && timerTimeout(&nmSendTimer)) {
-        char * nmValues = nullptr;
-        // Отправляем сформированный пакет на сервер
-        if (nmValues) {
-          timerSet(&nmSendTimer, iNarodMonInterval*1000);
-          dsSend(EDS_NARODMON, CONFIG_NARODMON_DEVICE01_ID, nmValues, false);
-          free(nmValues);
-        };
+    };
+  #endif // CONFIG_OPENMON_ENABLE
+
+  // narodmon.ru
+  #if CONFIG_NARODMON_ENABLE
+    if (statesInetIsAvailabled() && timerTimeout(&nmSendTimer)) {
+      char * nmValues = nullptr;
+      // Отправляем сформированный пакет на сервер
+      if (nmValues) {
+        timerSet(&nmSendTimer, iNarodMonInterval*1000);
+        phaseStarted = esp_timer_get_time();
+        dsSend(EDS_NARODMON, CONFIG_NARODMON_DEVICE01_ID, nmValues, false);
+        wateringProfile(PROFILE_NARODMON, phaseStarted);
+        free(nmValues);
       };
-    #endif // CONFIG_NARODMON_ENABLE
-
-    // thingspeak.com
-    #if CONFIG_THINGSPEAK_ENABLE
-      if (timerTimeout(&tsSendTimer)) {
-        char * tsValues = nullptr;
-        // Field 1 Почва температура
-        // Field 2 Почва влажность
-        if (sensorSoil.getStatus() == SENSOR_STATUS_OK) {
-          tsValues = concat_strings_div(tsValues, 
-            malloc_stringf("field1=%.1f&field2=%.1f", 
-              sensorSoil.getValue1(false).filteredValue,
-              sensorSoil.getValue2(false).filteredValue),
-            "&");
-        };
-        // Field 3 Полив
-        tsValues = concat_strings_div(tsValues, 
-          malloc_stringf("field3=%d", 
-            lcPump.getState()),
-          "&");
-        // Field 4 Перелив
-        tsValues = concat_strings_div(tsValues, 
-          malloc_stringf("field4=%d", 
-            sensorsGetWaterLeaks()),
-          "&");
-        // Field 5 Уровень воды
-        tsValues = concat_strings_div(tsValues, 
-          malloc_stringf("field5=%d", 
-            ((xEventGroupGetBits(_wateringFlags) & WATER_LEVEL_LOW) == 0)),
-          "&");
-        // Field 6 Комната температура
-        // Field 7 Комната влажность
-        if (sensorIndoor.getStatus() == SENSOR_STATUS_OK) {
-          tsValues = concat_strings_div(tsValues, 
-            malloc_stringf("field6=%.1f&field7=%.1f", 
-              sensorIndoor.getValue2(false).filteredValue,
-              sensorIndoor.getValue1(false).filteredValue),
-            "&");
-        };
-        // Field 8 Батареи температура
-        if (sensorHeating.getStatus() == SENSOR_STATUS_OK) {
-          tsValues = concat_strings_div(tsValues, 
-            malloc_stringf("field8=%.1f", 
-              sensorHeating.getValue(false).filteredValue),
-            "&");
-        };
+    };
+  #endif // CONFIG_NARODMON_ENABLE
 
-        // Отправляем сформированный пакет на сервер
-        if (tsValues) {
-          timerSet(&tsSendTimer, iThingSpeakInterval*1000);
-          dsSend(EDS_THINGSPEAK, CONFIG_THINGSPEAK_CHANNEL01_ID, tsValues, false);
-          free(tsValues);
-        };
+  // thingspeak.com
+  #if CONFIG_THINGSPEAK_ENABLE
+    if (timerTimeout(&tsSendTimer)) {
+      if (dsPayloadBuild(&dsValues, tsFields, sizeof(tsFields) / sizeof(ds_payload_field_t))) {
+        timerSet(&tsSendTimer, iThingSpeakInterval*1000);
+        phaseStarted = esp_timer_get_time();
+        dsSend(EDS_THINGSPEAK, CONFIG_THINGSPEAK_CHANNEL01_ID, dsValues.data, false);
+        wateringProfile(PROFILE_THINGSPEAK, phaseStarted);
       };
-    #endif // CONFIG_THINGSPEAK_ENABLE
+    };
+  #endif // CONFIG_THINGSPEAK_ENABLE
+
+  #if CONFIG_WATERING_HEAP_ACCOUNTING
+    heapCheck();
+  #endif // CONFIG_WATERING_HEAP_ACCOUNTING
+  wateringProfile(PROFILE_CYCLE, cycleStarted);
 
-    // -----------------------------------------------------------------------------------------------------
-    // Вычисление времени ожидания
-    // -----------------------------------------------------------------------------------------------------
-    currTicks = xTaskGetTickCount();
+  // -----------------------------------------------------------------------------------------------------
+  // Вычисление времени ожидания
+  // -----------------------------------------------------------------------------------------------------
+  #if CONFIG_WATERING_ADAPTIVE_READ
+    // Ждем ближайшего планового опроса
+    (void)startTicks;
+    return pdMS_TO_TICKS(sensorsReadWait());
+  #else
+    TickType_t currTicks = xTaskGetTickCount();
     if ((currTicks - startTicks) >= pdMS_TO_TICKS(_sensorsReadInterval*1000)) {
-      waitTicks = 0;
-    } else {
-      waitTicks = pdMS_TO_TICKS(_sensorsReadInterval*1000) - (currTicks - startTicks);
+      return 0;
     };
+    return pdMS_TO_TICKS(_sensorsReadInterval*1000) - (currTicks - startTicks);
+  #endif // CONFIG_WATERING_ADAPTIVE_READ
+}
+
+void wateringTaskExec(void *pvParameters)
+{
+  wateringTaskInit();
+
+  TickType_t waitTicks = 0;
+  while (1) {
+    // Ждем тайамута или любого события
+    xEventGroupWaitBits(_wateringFlags, FORCED_CONTROL, pdFALSE, pdFALSE, waitTicks);
+    xEventGroupClearBits(_wateringFlags, TIME_MINUTE_EVENT);
+    waitTicks = wateringTaskCycle();
   };
 
   vTaskDelete(nullptr);
@@ -12,6 +12,7 @@
 #include "reLed.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
+#include "zoneControl.h"
 
 // -----------------------------------------------------------------------------------------------------------------------
 // ------------------------------------------------------- Сенсоры -------------------------------------------------------
@@ -24,6 +25,8 @@
 #define SENSOR_MODBUS_PIN_TXD           CONFIG_GPIO_RS485_TX
 #define SENSOR_MODBUS_PIN_RTS           -1
 #define SENSOR_MODBUS_PIN_CTS           -1
+#define SENSOR_MODBUS_NVS_SPACE         "mbus"  // Сохраненная скорость шины
+#define SENSOR_MODBUS_NVS_BAUD          "baud"
 
 static void* _modbus = nullptr;
 
@@ -35,7 +38,12 @@ static void* _modbus = nullptr;
 #define SENSOR_SOIL_TOPIC               "soil"
 #define SENSOR_SOIL_FILTER_MODE         SENSOR_FILTER_RAW
 #define SENSOR_SOIL_FILTER_SIZE         0
+#define SENSOR_SOIL_SFILTER_MODE        SFILTER_MEDIAN    // Фильтр sensorFilter, применяется вместо встроенного
+#define SENSOR_SOIL_SFILTER_SIZE        5
 #define SENSOR_SOIL_ERRORS_LIMIT        16
+#define SENSOR_SOIL_DEADBAND_TEMP       0.05              // Минимальные изменения для повторной публикации
+#define SENSOR_SOIL_DEADBAND_MOISTURE   0.1
+#define SENSOR_SOIL_ZONE_ID             10                // Идентификаторы датчиков почвы дополнительных зон: SENSOR_SOIL_ZONE_ID + номер зоны
 
 static reCWTSoilS sensorSoil(1);
 
@@ -47,7 +55,11 @@ static reCWTSoilS sensorSoil(1);
 #define SENSOR_INDOOR_TOPIC             "indoor"
 #define SENSOR_INDOOR_FILTER_MODE       SENSOR_FILTER_RAW
 #define SENSOR_INDOOR_FILTER_SIZE       0
+#define SENSOR_INDOOR_SFILTER_MODE      SFILTER_EMA       // Фильтр sensorFilter, применяется вместо встроенного
+#define SENSOR_INDOOR_SFILTER_SIZE      5
 #define SENSOR_INDOOR_ERRORS_LIMIT      16
+#define SENSOR_INDOOR_DEADBAND_HUMIDITY 0.1               // Минимальные изменения для повторной публикации
+#define SENSOR_INDOOR_DEADBAND_TEMP     0.05
 
 static HTU2x sensorIndoor(2);
 
@@ -59,7 +71,10 @@ static HTU2x sensorIndoor(2);
 #define SENSOR_HEATING_TOPIC            "heating"
 #define SENSOR_HEATING_FILTER_MODE      SENSOR_FILTER_RAW
 #define SENSOR_HEATING_FILTER_SIZE      0
+#define SENSOR_HEATING_SFILTER_MODE     SFILTER_EMA       // Фильтр sensorFilter, применяется вместо встроенного
+#define SENSOR_HEATING_SFILTER_SIZE     5
 #define SENSOR_HEATING_ERRORS_LIMIT     16
+#define SENSOR_HEATING_DEADBAND_TEMP    0.05              // Минимальные изменения для повторной публикации
 
 static DS18x20 sensorHeating(3);
 
@@ -112,33 +127,15 @@ typedef enum {
 // -------------------------------------------------------- Полив --------------------------------------------------------
 // -----------------------------------------------------------------------------------------------------------------------
 
-// Интервал суток полива
-static uint32_t wateringTimespan = 18002100U;
+// Режим работы и настройки зоны (watering_mode_t, watering_zone_t) - в zoneControl.h
 
-// Режим работы
-typedef enum {
-  WATERING_OFF      = 0,     // Отключено
-  WATERING_FORCED   = 1,     // Включено принудительно
-  WATERING_SENSORS  = 2      // Управление по датчикам
-} watering_mode_t;
-static watering_mode_t wateringMode = WATERING_SENSORS;
+// Настройки всех зон; зона 0 - основной насос и датчик почвы, остальные копируют её настройки при первом запуске
+static watering_zone_t wateringZones[CONFIG_WATERING_ZONES] = { WATERING_ZONE_DEFAULTS };
 
 // Уведомления в telegram
 static notify_type_t wateringNotify = NOTIFY_OFF;
 static notify_type_t waterleakNotify = NOTIFY_SILENT;
 static notify_type_t waterlevelNotify = NOTIFY_SILENT;
-
-// Температура почвы
-static float wateringSoilTempMin = 10.0;
-static float wateringSoilTempMax = 30.0;
-// Влажность почвы 
-static float wateringMoistureMin = 30.0;
-static float wateringMoistureMax = 50.0;
-// Общая максимальная длительность полива в минутах
-static uint32_t wateringMoistureMaxDuration = 2*60;
-// Длительность включения насоса в секундах в пределах одного цикла
-static uint32_t wateringMoistureCycleTime = 15;
-static uint32_t wateringMoistureCycleInterval = 5*60;
 // Отключение сенсоров
 static uint8_t waterlevelSensorEnabled = 1; 
 static uint8_t waterleakSensorEnabled1 = 1; 
@@ -147,6 +144,37 @@ static uint8_t waterleakSensorEnabled3 = 1;
 // Количество измерений, при котором устранение перелива не учитывается (очень медленный debounce)
 static uint32_t waterleakDebounceCount = 100;
 
+#if CONFIG_WATERING_VOLUME
+// Полезный объем бака, л (0 - остаток в баке не оценивается)
+static float volumeTankCapacity = 0.0;
+#if CONFIG_WATERING_FLOW_METER
+// Количество импульсов счетчика воды на литр
+static float volumeMeterPulses = 450.0;
+#endif // CONFIG_WATERING_FLOW_METER
+#endif // CONFIG_WATERING_VOLUME
+
+#if CONFIG_WATERING_ADAPTIVE_READ
+// Периоды опроса сенсоров в секундах: почва - часто во время полива и вблизи порогов влажности, редко - вдали от них
+static uint32_t sensorsSoilFastInterval = 5;
+static uint32_t sensorsSoilSlowInterval = 5*60;
+// Ширина зоны вокруг порогов влажности, в которой почва опрашивается часто, %
+static float sensorsSoilNearBand = 3.0;
+// Помещение и батареи опрашиваются со своими постоянными периодами
+static uint32_t sensorsIndoorInterval = 60;
+static uint32_t sensorsHeatingInterval = 60;
+
+#define CONFIG_SENSOR_PARAM_INTERVAL_SOIL_FAST_KEY        "soil_fast"
+#define CONFIG_SENSOR_PARAM_INTERVAL_SOIL_FAST_FRIENDLY   "Период опроса почвы при поливе и вблизи порогов"
+#define CONFIG_SENSOR_PARAM_INTERVAL_SOIL_SLOW_KEY        "soil_slow"
+#define CONFIG_SENSOR_PARAM_INTERVAL_SOIL_SLOW_FRIENDLY   "Период опроса почвы вдали от порогов"
+#define CONFIG_SENSOR_PARAM_SOIL_NEAR_BAND_KEY            "soil_band"
+#define CONFIG_SENSOR_PARAM_SOIL_NEAR_BAND_FRIENDLY       "Зона частого опроса почвы около порогов влажности"
+#define CONFIG_SENSOR_PARAM_INTERVAL_INDOOR_KEY           "indoor"
+#define CONFIG_SENSOR_PARAM_INTERVAL_INDOOR_FRIENDLY      "Период опроса датчика в помещении"
+#define CONFIG_SENSOR_PARAM_INTERVAL_HEATING_KEY          "heating"
+#define CONFIG_SENSOR_PARAM_INTERVAL_HEATING_FRIENDLY     "Период опроса датчика батарей"
+#endif // CONFIG_WATERING_ADAPTIVE_READ
+
 #define CONFIG_WATERING_NOTIFY_KIND       MK_MAIN
 #define CONFIG_WATERING_NOTIFY_PRIORITY   MP_HIGH
 #define CONFIG_WATERING_NOTIFY_PERIOD     12*60*60
@@ -155,6 +183,21 @@ static uint32_t waterleakDebounceCount = 100;
 #define CONFIG_WATERING_TOPIC             "watering" 
 #define CONFIG_WATERING_FRIENDLY          "Полив"
 
+// Оборудование дополнительных зон: датчик почвы на общей шине Modbus и нагрузка (клапан или насос).
+// Зона с нулевым адресом датчика не используется. Элемент 0 описывает основную зону и приведен для справки
+typedef struct {
+  const char* key;                  // Ключ параметров и NVS
+  const char* topic;                // Топик MQTT
+  const char* name;                 // Отображаемое имя
+  uint8_t soil_address;             // Адрес датчика почвы Modbus
+  uint8_t load_gpio;                // GPIO нагрузки
+} watering_zone_hw_t;
+
+static const watering_zone_hw_t wateringZonesHw[CONFIG_WATERING_ZONES] = {
+  { CONFIG_WATERING_KEY, CONFIG_WATERING_TOPIC, CONFIG_WATERING_FRIENDLY, SENSOR_SOIL_ADDRESS, CONFIG_GPIO_PUMP },
+  // { "zone1", "zone1", "Зона 1", 0x02, 14 },
+};
+
 #define CONFIG_NOTIFY_WATERING_KEY        "notify/watering"
 #define CONFIG_NOTIFY_WATERING_FRIENDLY   "Уведомления о поливе" 
 #define CONFIG_NOTIFY_WATERLEAK_KEY       "notify/leaks"
@@ -176,6 +219,8 @@ static uint32_t waterleakDebounceCount = 100;
 #define CONFIG_WATERING_CYC_TIME_FRIENDLY "Длительность открытия клапана"
 #define CONFIG_WATERING_CYC_INTV_KEY      "cycle_interval"
 #define CONFIG_WATERING_CYC_INTV_FRIENDLY "Интервал открытия клапана"
+#define CONFIG_WATERING_FLOW_KEY          "flow_rate"
+#define CONFIG_WATERING_FLOW_FRIENDLY     "Расход воды, л/мин"
 
 #define CONFIG_WATERLVL_ENABLED_KEY       "wlevel_sensor"
 #define CONFIG_WATERLVL_ENABLED_FRIENDLY  "Датчик уровня"
@@ -187,6 +232,10 @@ static uint32_t waterleakDebounceCount = 100;
 #define CONFIG_WATERLEAK_ENABLED3_FRIENDLY "Датчик протечки #3"
 #define CONFIG_WATERLEAK_DEBOUNCE_KEY     "wleaks_debounce"
 #define CONFIG_WATERLEAK_DEBOUNCE_FRIENDLY "Количество циклов подтверждения устранения утечки"
+#define CONFIG_VOLUME_TANK_KEY            "tank_capacity"
+#define CONFIG_VOLUME_TANK_FRIENDLY       "Объем бака, л"
+#define CONFIG_VOLUME_PULSES_KEY          "meter_pulses"
+#define CONFIG_VOLUME_PULSES_FRIENDLY     "Импульсов счетчика воды на литр"
 
 #define CONFIG_WATER_LEVEL_GPIO           CONFIG_GPIO_WATER_LEVEL
 #define CONFIG_WATER_LEVEL_LEVEL          0
@@ -203,10 +252,54 @@ static uint32_t waterleakDebounceCount = 100;
 #define CONFIG_WATER_LEAK_ACT_OFF         1
 #define CONFIG_WATER_LEAK_LEVEL           0
 #define CONFIG_WATER_LEAK_PULL            true
-#define CONFIG_WATER_LEAK_DELAY_ON        1
-#define CONFIG_WATER_LEAK_DELAY_OFF       10
+#define CONFIG_WATER_LEAK_SCAN_INTERVAL   250     // Период опроса датчиков протечки, мс
+#define CONFIG_WATER_LEAK_SCAN_SETTLE     10000   // Задержка чтения после включения подтяжки, мкс
 #define CONFIG_WATER_LEAK_TOPIC           "water_leak"
 
+#define CONFIG_PAYLOAD_SCHEMA_VERSION     1       // Версия схемы двоичных сообщений (CONFIG_MQTT_PAYLOAD_CBOR), первое поле каждого сообщения
+
+#define CONFIG_SNAPSHOT_TOPIC             "snapshot"
+#define CONFIG_SNAPSHOT_SIZE              1536    // Размер буфера сводного сообщения и порции отложенных снимков
+
+#define CONFIG_BACKLOG_TOPIC              "backlog"
+#define CONFIG_BACKLOG_MIN_FREE_HEAP      32768   // Отложенные снимки не отправляются, если свободной кучи меньше
+
+#define CONFIG_HISTORY_TOPIC              "history"
+#define CONFIG_HISTORY_COMMAND            "history"
+#define CONFIG_HISTORY_CHUNK_SIZE         1024    // Размер одного сообщения при выгрузке истории
+#define CONFIG_HISTORY_DRAIN_CHUNKS       4       // Количество сообщений с историей за один рабочий цикл
+
+#define CONFIG_JOURNAL_TOPIC              "journal"
+#define CONFIG_JOURNAL_COMMAND            "journal"
+#define CONFIG_JOURNAL_CHUNK_SIZE         1024    // Размер одного сообщения при выгрузке журнала
+
+#define CONFIG_STORAGE_TOPIC              "storage"
+
+#define CONFIG_VOLUME_TOPIC               "volume"
+#define CONFIG_VOLUME_NVS_SPACE           "volume"
+#define CONFIG_VOLUME_STATS_SIZE          512     // Размер сообщения с расходом воды
+
+#define CONFIG_HEALTH_TOPIC               "health"
+#define CONFIG_HEALTH_STATS_SIZE          1024    // Размер сообщения с оценкой исправности сенсоров
+#define CONFIG_FALLBACK_NVS_SPACE         "fallback"
+
+#define CONFIG_INTERLOCK_TOPIC            "interlock"
+#define CONFIG_INTERLOCK_HIST_SIZE        20      // Гистограмма задержек: корзина i = [2^i, 2^(i+1)) мкс
+
+#define CONFIG_DEDUP_TOPIC                "dedup"
+
+#define CONFIG_HEAP_TOPIC                 "heap"
+#define CONFIG_HEAP_STATS_SIZE            768     // Размер сообщения со статистикой кучи
+
+#define CONFIG_PROFILE_TOPIC              "profile"
+#define CONFIG_PROFILE_STATS_SIZE         1536    // Размер сообщения со статистикой фаз рабочего цикла
+
+#define CONFIG_MODEL_TOPIC                "model"
+#define CONFIG_MODEL_STATS_SIZE           1024    // Размер сообщения с параметрами моделей почвы
+
+#define CONFIG_MODBUS_TOPIC               "modbus"
+#define CONFIG_MODBUS_STATS_SIZE          1024    // Размер сообщения со статистикой шины Modbus
+
 // -----------------------------------------------------------------------------------------------------------------------
 // ------------------------------------------------------- Задача --------------------------------------------------------
 // -----------------------------------------------------------------------------------------------------------------------
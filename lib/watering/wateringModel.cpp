@@ -0,0 +1,174 @@
+#include "wateringModel.h"
+#include <string.h>
+#include <math.h>
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------ Высыхание ------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+// Признаки нормированы вокруг типичных значений, отсутствующие данные дают нулевой вклад
+static void wmodelFeatures(const wmodel_inputs_t* inputs, float* x)
+{
+  x[0] = 1.0;
+  x[1] = isnan(inputs->indoor_temp) ? 0.0 : (inputs->indoor_temp - 20.0) / 10.0;
+  x[2] = isnan(inputs->indoor_humidity) ? 0.0 : (inputs->indoor_humidity - 50.0) / 10.0;
+  x[3] = isnan(inputs->heating_temp) ? 0.0 : (inputs->heating_temp - 40.0) / 10.0;
+}
+
+float wmodelDecayRate(const wmodel_t* model, const wmodel_inputs_t* inputs)
+{
+  float x[CONFIG_WMODEL_FEATURES];
+  wmodelFeatures(inputs, x);
+  float rate = 0.0;
+  for (uint8_t i = 0; i < CONFIG_WMODEL_FEATURES; i++) {
+    rate += model->theta[i] * x[i];
+  };
+  return rate > 0.0 ? rate : 0.0;
+}
+
+// Рекурсивный МНК с забыванием: theta += k * (y - theta * x), P = (P - k * x' * P) / lambda
+static void wmodelDecayUpdate(wmodel_t* model, const float* x, float y)
+{
+  float px[CONFIG_WMODEL_FEATURES];
+  float denom = CONFIG_WMODEL_FORGETTING;
+  for (uint8_t i = 0; i < CONFIG_WMODEL_FEATURES; i++) {
+    px[i] = 0.0;
+    for (uint8_t j = 0; j < CONFIG_WMODEL_FEATURES; j++) {
+      px[i] += model->p[i][j] * x[j];
+    };
+    denom += x[i] * px[i];
+  };
+  if (denom <= 0.0) return;
+
+  float err = y;
+  for (uint8_t i = 0; i < CONFIG_WMODEL_FEATURES; i++) {
+    err -= model->theta[i] * x[i];
+  };
+  for (uint8_t i = 0; i < CONFIG_WMODEL_FEATURES; i++) {
+    model->theta[i] += px[i] / denom * err;
+  };
+  // P симметрична, поэтому x' * P = (P * x)'
+  for (uint8_t i = 0; i < CONFIG_WMODEL_FEATURES; i++) {
+    for (uint8_t j = 0; j < CONFIG_WMODEL_FEATURES; j++) {
+      model->p[i][j] = (model->p[i][j] - px[i] * px[j] / denom) / CONFIG_WMODEL_FORGETTING;
+    };
+  };
+  model->decay_samples++;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// -------------------------------------------------------- Модель -------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+void wmodelInit(wmodel_t* model)
+{
+  memset(model, 0, sizeof(wmodel_t));
+  model->gain = CONFIG_WMODEL_GAIN_DEFAULT;
+  model->theta[0] = CONFIG_WMODEL_DECAY_DEFAULT;
+  for (uint8_t i = 0; i < CONFIG_WMODEL_FEATURES; i++) {
+    model->p[i][i] = 100.0;
+  };
+  model->last_moisture = NAN;
+}
+
+void wmodelObserve(wmodel_t* model, uint32_t now, float moisture, bool pumping, const wmodel_inputs_t* inputs)
+{
+  if (isnan(moisture)) return;
+
+  // Во время полива и сразу после него высыхание не наблюдается
+  if (pumping || model->episode) {
+    model->last_moisture = NAN;
+    return;
+  };
+
+  // Ждем, пока вода дойдет до датчика, и запоминаем максимум показаний
+  if (model->settling) {
+    if (moisture > model->peak_moisture) model->peak_moisture = moisture;
+    if (now - model->end_time < CONFIG_WMODEL_SETTLE_TIME) return;
+    model->settling = false;
+    if (model->pumped > 0) {
+      // Прирост с поправкой на то, что почва продолжала сохнуть с начала полива
+      float hours = (float)(now - model->start_time) / 3600.0;
+      float rise = model->peak_moisture - model->start_moisture + wmodelDecayRate(model, inputs) * hours;
+      if (rise > 0.0) {
+        float gain = rise / (float)model->pumped;
+        if (model->gain_samples == 0) {
+          model->gain = gain;
+        } else {
+          model->gain += CONFIG_WMODEL_GAIN_ALPHA * (gain - model->gain);
+        };
+        if (model->gain < CONFIG_WMODEL_GAIN_MIN) model->gain = CONFIG_WMODEL_GAIN_MIN;
+        model->gain_samples++;
+      };
+    };
+  };
+
+  // Высыхание между поливами
+  if (isnan(model->last_moisture)) {
+    model->last_moisture = moisture;
+    model->last_time = now;
+  } else if (now - model->last_time >= CONFIG_WMODEL_DECAY_PERIOD) {
+    float x[CONFIG_WMODEL_FEATURES];
+    wmodelFeatures(inputs, x);
+    float rate = (model->last_moisture - moisture) * 3600.0 / (float)(now - model->last_time);
+    wmodelDecayUpdate(model, x, rate);
+    model->last_moisture = moisture;
+    model->last_time = now;
+  };
+}
+
+uint32_t wmodelPlan(wmodel_t* model, uint32_t now, float moisture, float target, uint32_t max_pulse, uint32_t interval)
+{
+  float need = target - moisture;
+  if (need <= 0.0) need = 0.0;
+  uint32_t total = (uint32_t)ceilf(need / model->gain);
+  if (total == 0) total = 1;
+
+  if ((max_pulse == 0) || (interval == 0)) {
+    // Без циклов - один непрерывный импульс
+    model->plan_count = 1;
+    model->plan_pulse = total;
+    model->plan_interval = 0;
+  } else {
+    uint32_t count = (total + max_pulse - 1) / max_pulse;
+    if (count > UINT16_MAX) count = UINT16_MAX;
+    model->plan_count = (uint16_t)count;
+    model->plan_pulse = (total + count - 1) / count;
+    if (model->plan_pulse > max_pulse) model->plan_pulse = max_pulse;
+    model->plan_interval = interval;
+  };
+
+  model->episode = true;
+  model->settling = false;
+  model->start_moisture = moisture;
+  model->peak_moisture = moisture;
+  model->start_time = now;
+  model->pumped = 0;
+  return model->plan_pulse;
+}
+
+// Время работы насоса с начала полива: полные циклы "импульс + пауза" и часть текущего импульса
+static uint32_t wmodelPumpedTime(const wmodel_t* model, uint32_t elapsed)
+{
+  uint32_t period = model->plan_pulse + model->plan_interval;
+  if (period == 0) return 0;
+  uint32_t cycles = elapsed / period;
+  uint32_t rest = elapsed % period;
+  if (cycles >= model->plan_count) return model->plan_count * model->plan_pulse;
+  return cycles * model->plan_pulse + (rest < model->plan_pulse ? rest : model->plan_pulse);
+}
+
+bool wmodelPlanDone(const wmodel_t* model, uint32_t now)
+{
+  if (!model->episode) return true;
+  return wmodelPumpedTime(model, now - model->start_time) >= (uint32_t)model->plan_count * model->plan_pulse;
+}
+
+void wmodelStop(wmodel_t* model, uint32_t now)
+{
+  if (!model->episode) return;
+  model->episode = false;
+  model->settling = true;
+  model->end_time = now;
+  model->pumped = wmodelPumpedTime(model, now - model->start_time);
+}
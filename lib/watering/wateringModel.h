@@ -0,0 +1,78 @@
+#ifndef __WATERINGMODEL_H__
+#define __WATERINGMODEL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Модель влажности почвы одной зоны для упреждающего управления поливом. Модель обучается на ходу:
+//   - прирост влажности на секунду работы насоса - по результату каждого полива после того, как показания установились;
+//   - скорость высыхания (% в час) - рекурсивным МНК по температуре и влажности в помещении и температуре батарей.
+// Память постоянна и не зависит от времени работы
+
+#define CONFIG_WMODEL_FEATURES        4       // Свободный член + температура и влажность в помещении + температура батарей
+#define CONFIG_WMODEL_GAIN_DEFAULT    0.05    // Начальный прирост влажности, % за секунду работы насоса
+#define CONFIG_WMODEL_GAIN_MIN        0.001
+#define CONFIG_WMODEL_GAIN_ALPHA      0.3     // Вес нового наблюдения прироста
+#define CONFIG_WMODEL_DECAY_DEFAULT   0.2     // Начальная скорость высыхания, % в час
+#define CONFIG_WMODEL_DECAY_PERIOD    1800    // Минимальный интервал между наблюдениями высыхания, с
+#define CONFIG_WMODEL_SETTLE_TIME     900     // Время установления показаний после полива, с
+#define CONFIG_WMODEL_FORGETTING      0.98    // Коэффициент забывания рекурсивного МНК
+
+// Внешние условия; NAN - нет данных
+typedef struct {
+  float indoor_temp;
+  float indoor_humidity;
+  float heating_temp;
+} wmodel_inputs_t;
+
+typedef struct {
+  // Обученные параметры
+  float    gain;                                          // Прирост влажности, % за секунду работы насоса
+  uint32_t gain_samples;
+  float    theta[CONFIG_WMODEL_FEATURES];                 // Коэффициенты скорости высыхания
+  float    p[CONFIG_WMODEL_FEATURES][CONFIG_WMODEL_FEATURES];
+  uint32_t decay_samples;
+  // Наблюдение высыхания
+  float    last_moisture;
+  uint32_t last_time;
+  // Текущий полив: план и результат
+  bool     episode;
+  bool     settling;
+  float    start_moisture;
+  float    peak_moisture;
+  uint32_t start_time;
+  uint32_t end_time;
+  uint32_t pumped;                                        // Фактическое время работы насоса, с
+  uint32_t plan_pulse;                                    // Длительность одного импульса, с
+  uint32_t plan_interval;                                 // Пауза между импульсами, с
+  uint16_t plan_count;                                    // Количество импульсов
+} wmodel_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void wmodelInit(wmodel_t* model);
+
+// Ожидаемая скорость высыхания при заданных условиях, % в час
+float wmodelDecayRate(const wmodel_t* model, const wmodel_inputs_t* inputs);
+
+// Учет очередного показания влажности (время - монотонное, в секундах)
+void wmodelObserve(wmodel_t* model, uint32_t now, float moisture, bool pumping, const wmodel_inputs_t* inputs);
+
+// Расчет импульсов для подъема влажности до target: наименьшее число импульсов не длиннее max_pulse,
+// время работы поровну делится между импульсами. Возвращает длительность одного импульса
+uint32_t wmodelPlan(wmodel_t* model, uint32_t now, float moisture, float target, uint32_t max_pulse, uint32_t interval);
+
+// План выполнен: все импульсы отработаны
+bool wmodelPlanDone(const wmodel_t* model, uint32_t now);
+
+// Полив завершен (по плану или по любой другой причине)
+void wmodelStop(wmodel_t* model, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WATERINGMODEL_H__
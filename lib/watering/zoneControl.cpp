@@ -0,0 +1,211 @@
+#include "zoneControl.h"
+#include <string.h>
+#include <math.h>
+
+// -----------------------------------------------------------------------------------------------------------------------
+// -------------------------------------------------------- Время --------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+// Как checkTimespanNowEx(timespan, true) из библиотеки rTypes, но для заданного времени: timespan = ЧЧММЧЧММ,
+// начало включается, конец - нет; интервал может переходить через полночь. Время не синхронизировано - полива нет
+static bool zoneTimespan(time_t time, uint32_t timespan)
+{
+  if ((time <= 1000000000) || (timespan == 0)) return false;
+  struct tm ti;
+  localtime_r(&time, &ti);
+  int16_t  t0 = ti.tm_hour * 100 + ti.tm_min;
+  uint16_t t1 = timespan / 10000;
+  uint16_t t2 = timespan % 10000;
+  if (t1 < t2) {
+    return (t0 >= t1) && (t0 < t2);
+  };
+  return !((t0 >= t2) && (t1 > t0));
+}
+
+// Как checkTimeInterval(timestamp, minutes, TI_MINUTES, expired) из библиотеки rTypes, но для заданного времени
+static bool zoneInterval(time_t time, time_t timestamp, uint32_t minutes, bool expired)
+{
+  if ((timestamp <= 1000000000) || (time < timestamp)) return false;
+  if (expired) {
+    return (time - timestamp) > (time_t)minutes * 60;
+  };
+  return (time - timestamp) <= (time_t)minutes * 60;
+}
+
+static inline bool zoneBySensor(watering_mode_t mode)
+{
+  return (mode == WATERING_SENSORS) || (mode == WATERING_MODEL);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------- Условия полива ---------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+static bool zoneDecideEx(const watering_zone_t* zone, watering_mode_t mode, const zone_inputs_t* inputs,
+  float soilMoisture, float soilTemp)
+{
+  // Проверяем перелив, уровень воды и расписание
+  bool result = inputs->allowed
+    && (mode != WATERING_OFF)
+    && zoneTimespan(inputs->time, zone->timespan);
+
+  // Проверяем уровень влажности почвы
+  if (result && zoneBySensor(mode)) {
+    if (!isnan(soilMoisture)) {
+      if (inputs->state) {
+        result = soilMoisture < zone->moisture_max;
+      } else {
+        result = soilMoisture <= zone->moisture_min;
+      };
+    } else {
+      result = false;
+    };
+
+    // Если полив еще не начат, дополнительно учитываем температуру почвы
+    if (result && !inputs->state && !isnan(soilTemp)) {
+      result = (soilTemp >= zone->soil_temp_min) && (soilTemp <= zone->soil_temp_max);
+    };
+  };
+
+  // Контроль общего времени и интервалов полива
+  if (result && (zone->max_duration > 0)) {
+    if (inputs->state) {
+      if (zoneInterval(inputs->time, inputs->last_on, zone->max_duration, true)) {
+        result = false;
+      };
+    } else {
+      if (zoneInterval(inputs->time, inputs->last_off, zone->max_duration, false)) {
+        result = false;
+      };
+    };
+  };
+
+  return result;
+}
+
+bool zoneDecide(const watering_zone_t* zone, const zone_inputs_t* inputs)
+{
+  return zoneDecideEx(zone, zone->mode, inputs, inputs->moisture, inputs->soil_temp);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------ Полив по расписанию --------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+static float zoneFallbackEma(float average, float value, uint32_t count)
+{
+  if (count == 0) return value;
+  return average + 2.0 / (CONFIG_WATERING_FALLBACK_WEIGHT + 1) * (value - average);
+}
+
+bool zoneFallbackLearned(const watering_fallback_t* fallback)
+{
+  return (fallback->sessions >= CONFIG_WATERING_FALLBACK_SESSIONS) && (fallback->intervals > 0);
+}
+
+// Решение по изученному расписанию; permitted - полив разрешен с учетом перелива, уровня, расписания и общего времени
+static bool zoneFallbackDecide(const watering_fallback_t* fallback, uint32_t now, bool state, bool permitted)
+{
+  if (!permitted || !zoneFallbackLearned(fallback)) return false;
+  if (state) {
+    return (now - fallback->started) < fallback->duration;
+  };
+  // После запуска интервал отсчитывается от момента запуска
+  return (now - fallback->started) >= fallback->interval;
+}
+
+// Обучение на переключениях нагрузки: учитываются только поливы, начатые и законченные по исправному датчику
+static uint8_t zoneFallbackTrack(watering_fallback_t* data, watering_mode_t mode, uint32_t now, bool state, bool newState, bool fallback)
+{
+  uint8_t events = 0;
+  bool learn = !fallback && zoneBySensor(mode);
+  if (newState && !state) {
+    uint32_t interval = now - data->started;
+    if (learn && data->learning && (data->started > 0)
+     && (interval <= CONFIG_WATERING_FALLBACK_MAX_INTERVAL*60*60)) {
+      data->interval = zoneFallbackEma(data->interval, interval, data->intervals);
+      data->intervals++;
+      events |= ZONE_EVENT_LEARNED;
+    };
+    data->started = now;
+    data->learning = learn;
+  } else if (!newState && state) {
+    if (learn && data->learning && (data->started > 0)) {
+      data->duration = zoneFallbackEma(data->duration, now - data->started, data->sessions);
+      data->sessions++;
+      events |= ZONE_EVENT_LEARNED;
+    };
+  };
+  if (fallback != data->active) {
+    data->active = fallback;
+    events |= ZONE_EVENT_FALLBACK;
+  };
+  return events;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------- Модель почвы ----------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+// Упреждающее управление: при запуске полива рассчитывается число и длительность импульсов до верхнего порога,
+// полив прекращается по выполнении плана, не дожидаясь, пока вода дойдет до датчика. Повторный запуск
+// возможен только после того, как показания установились, иначе запаздывание датчика вызовет лишний полив
+static bool zoneModelControl(zone_control_t* control, const watering_zone_t* zone, const zone_inputs_t* inputs,
+  bool newState, uint8_t* events)
+{
+  wmodel_t* model = &control->model;
+  wmodelObserve(model, inputs->now, inputs->moisture, inputs->state, &inputs->inputs);
+  if (newState && !inputs->state) {
+    if (model->settling) {
+      newState = false;
+    } else {
+      control->pulse = wmodelPlan(model, inputs->now, inputs->moisture, zone->moisture_max,
+        zone->cycle_time, zone->cycle_interval);
+      *events |= ZONE_EVENT_PLAN;
+    };
+  } else if (newState && inputs->state && wmodelPlanDone(model, inputs->now)) {
+    newState = false;
+  };
+  if (!newState) {
+    wmodelStop(model, inputs->now);
+  };
+  return newState;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------ Управление -----------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+void zoneControlInit(zone_control_t* control, uint8_t features)
+{
+  memset(control, 0, sizeof(zone_control_t));
+  control->features = features;
+  wmodelInit(&control->model);
+}
+
+bool zoneControl(zone_control_t* control, const watering_zone_t* zone, const zone_inputs_t* inputs, uint8_t* events)
+{
+  *events = 0;
+  bool newState = zoneDecide(zone, inputs);
+
+  // Датчик почвы неисправен: остальные условия проверяются как при принудительном поливе, время - по изученному расписанию
+  bool fallback = false;
+  if (control->features & ZONE_FEATURE_FALLBACK) {
+    fallback = zoneBySensor(zone->mode) && !inputs->sensor_ok;
+    if (fallback) {
+      newState = zoneFallbackDecide(&control->fallback, inputs->now, inputs->state,
+        zoneDecideEx(zone, WATERING_FORCED, inputs, NAN, NAN));
+    };
+    *events |= zoneFallbackTrack(&control->fallback, zone->mode, inputs->now, inputs->state, newState, fallback);
+  };
+
+  if ((control->features & ZONE_FEATURE_MODEL) && (zone->mode == WATERING_MODEL) && !fallback) {
+    newState = zoneModelControl(control, zone, inputs, newState, events);
+  } else {
+    control->pulse = zone->cycle_time;
+    if (control->features & ZONE_FEATURE_MODEL) {
+      wmodelStop(&control->model, inputs->now);
+    };
+  };
+  return newState;
+}
@@ -0,0 +1,121 @@
+#ifndef __ZONECONTROL_H__
+#define __ZONECONTROL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <time.h>
+#include "wateringModel.h"
+
+// Решение о поливе одной зоны на очередном цикле основной задачи:
+//   - условия по настройкам зоны: режим, расписание, влажность и температура почвы, общее время полива;
+//   - полив по изученному расписанию, пока датчик почвы неисправен, и обучение этого расписания по исправному датчику;
+//   - упреждающее управление по модели почвы (режим WATERING_MODEL).
+// Модуль не обращается к сенсорам, нагрузкам, NVS и часам: показания и время передаются явно, а о том, что нужно
+// сохранить или записать в журнал, сообщают флаги событий. Параметры обучения расписания задаются в project_config.h;
+// значения по умолчанию - только для сборки модуля вне проекта (тесты на хосте)
+
+#ifdef ESP_PLATFORM
+#include "project_config.h"
+#endif // ESP_PLATFORM
+
+#ifndef CONFIG_WATERING_FALLBACK_SESSIONS
+#define CONFIG_WATERING_FALLBACK_SESSIONS 3
+#endif // CONFIG_WATERING_FALLBACK_SESSIONS
+
+#ifndef CONFIG_WATERING_FALLBACK_WEIGHT
+#define CONFIG_WATERING_FALLBACK_WEIGHT 5
+#endif // CONFIG_WATERING_FALLBACK_WEIGHT
+
+#ifndef CONFIG_WATERING_FALLBACK_MAX_INTERVAL
+#define CONFIG_WATERING_FALLBACK_MAX_INTERVAL 7*24
+#endif // CONFIG_WATERING_FALLBACK_MAX_INTERVAL
+
+// Режим работы
+typedef enum {
+  WATERING_OFF      = 0,     // Отключено
+  WATERING_FORCED   = 1,     // Включено принудительно
+  WATERING_SENSORS  = 2,     // Управление по датчикам
+  WATERING_MODEL    = 3      // Управление по датчикам с обучаемой моделью почвы (CONFIG_WATERING_MODEL_ENABLE)
+} watering_mode_t;
+
+// Настройки зоны полива
+typedef struct {
+  watering_mode_t mode;             // Режим работы
+  uint32_t timespan;                // Интервал суток полива
+  float soil_temp_min;              // Температура почвы
+  float soil_temp_max;
+  float moisture_min;               // Влажность почвы
+  float moisture_max;
+  uint32_t max_duration;            // Общая максимальная длительность полива в минутах
+  uint32_t cycle_time;              // Длительность включения насоса в секундах в пределах одного цикла
+  uint32_t cycle_interval;
+  float flow_rate;                  // Расход воды при включенной нагрузке, л/мин (CONFIG_WATERING_VOLUME)
+} watering_zone_t;
+
+#define WATERING_ZONE_DEFAULTS { WATERING_SENSORS, 18002100U, 10.0, 30.0, 30.0, 50.0, 2*60, 15, 5*60, 2.0 }
+
+// Функции управления, включенные в прошивке
+#define ZONE_FEATURE_FALLBACK         0x01    // Полив по расписанию при неисправном датчике (CONFIG_WATERING_SENSOR_HEALTH)
+#define ZONE_FEATURE_MODEL            0x02    // Модель почвы (CONFIG_WATERING_MODEL_ENABLE)
+
+// События цикла
+#define ZONE_EVENT_LEARNED            0x01    // Изменились средние интервал или длительность полива
+#define ZONE_EVENT_PLAN               0x02    // Рассчитан план импульсов по модели
+#define ZONE_EVENT_FALLBACK           0x04    // Зона перешла на полив по расписанию или вернулась к датчику
+
+// Расписание для полива без датчика почвы: средние интервал и длительность поливов по исправному датчику.
+// Длительность считается от включения до выключения нагрузки, импульсы внутри полива формирует сама нагрузка
+typedef struct {
+  float interval;                   // Средний интервал между началами поливов, с
+  float duration;                   // Средняя длительность полива, с
+  uint32_t sessions;                // Поливов, учтенных в средней длительности
+  uint32_t intervals;               // Интервалов, учтенных в среднем интервале
+  uint32_t started;                 // Начало текущего или последнего полива, с от запуска (0 - после запуска поливов не было)
+  bool learning;                    // Текущий или последний полив выполнен по исправному датчику
+  bool active;                      // Зона поливается по расписанию
+} watering_fallback_t;
+
+// Состояние управления одной зоной
+typedef struct {
+  uint8_t features;                 // ZONE_FEATURE_*
+  watering_fallback_t fallback;
+  wmodel_t model;
+  uint32_t pulse;                   // Длительность импульса нагрузки для следующего полива, с
+} zone_control_t;
+
+// Данные для решения на одном цикле
+typedef struct {
+  time_t   time;                    // Текущее время, для расписания и общего времени полива
+  uint32_t now;                     // Монотонное время, с от запуска
+  bool     allowed;                 // Нет перелива и блокировки, вода в баке есть
+  bool     state;                   // Текущее состояние нагрузки
+  time_t   last_on;                 // Время последнего включения и выключения нагрузки
+  time_t   last_off;
+  float    moisture;                // Показания датчика почвы; NAN - нет данных
+  float    soil_temp;
+  bool     sensor_ok;               // Датчик почвы исправен (оценка sensorHealth)
+  wmodel_inputs_t inputs;           // Внешние условия для модели
+} zone_inputs_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void zoneControlInit(zone_control_t* control, uint8_t features);
+
+// Условия полива по настройкам зоны и показаниям датчика, без расписания по неисправному датчику и модели
+bool zoneDecide(const watering_zone_t* zone, const zone_inputs_t* inputs);
+
+// Решение на очередном цикле: возвращает новое состояние нагрузки, в events - ZONE_EVENT_*.
+// Длительность импульса для нагрузки - в control->pulse
+bool zoneControl(zone_control_t* control, const watering_zone_t* zone, const zone_inputs_t* inputs, uint8_t* events);
+
+// Расписание изучено: учтено достаточно поливов и хотя бы один интервал
+bool zoneFallbackLearned(const watering_fallback_t* fallback);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ZONECONTROL_H__
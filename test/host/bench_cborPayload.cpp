@@ -0,0 +1,224 @@
+#include "cborPayload.h"
+#include "hostTest.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <chrono>
+
+// Размер сообщения и время его формирования: JSON (как сейчас) и CBOR + COBS (CONFIG_MQTT_PAYLOAD_CBOR).
+// Сообщения повторяют прошивку:
+//   - перелив: malloc_stringf("{\"channel1\":%d,...}") / [версия схемы, флаги перелива];
+//   - уровень воды: malloc_stringf("{\"status\":%d}") / [версия схемы, уровень в норме];
+//   - сводное сообщение: snapshotAppendData() и счетчики насоса через vsnprintf в статическом буфере / snapshotCborData().
+// Время - лучшее из нескольких серий, чтобы не учитывать вытеснение процесса на хосте; оно только печатается,
+// проверяется размер сообщений
+
+#define BENCH_ITERATIONS          20000
+#define BENCH_SERIES              5
+#define BENCH_SNAPSHOT_SIZE       1536      // CONFIG_SNAPSHOT_SIZE
+#define BENCH_SCHEMA_VERSION      1         // CONFIG_PAYLOAD_SCHEMA_VERSION
+
+typedef struct {
+  uint32_t time;
+  uint8_t  status[3];
+  float    values[5];
+  uint8_t  leaks;
+  bool     level;
+  bool     pump;
+  uint32_t last_on;
+  uint32_t last_off;
+  uint32_t counters[4];
+  uint32_t durations[5];
+} bench_data_t;
+
+typedef size_t (*cb_encode_t)(const bench_data_t* data);
+
+static const bench_data_t _data = {
+  1700000000, { 0, 0, 0 }, { 18.37, 42.85, 22.41, 47.2, 51.63 }, 0x02, true, false,
+  1699990000, 1699990060, { 3, 17, 64, 1523 }, { 60, 180, 1020, 3840, 91380 }
+};
+
+static char _buf[BENCH_SNAPSHOT_SIZE];
+static uint16_t _len = 0;
+static uint8_t _raw[CBOR_COBS_CAPACITY(BENCH_SNAPSHOT_SIZE)];
+
+// Так же, как malloc_stringf() из библиотеки rStrings
+static char* legacyStringf(const char* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(nullptr, 0, format, args);
+  va_end(args);
+  if (len < 0) return nullptr;
+  char* buf = (char*)malloc(len + 1);
+  if (buf) {
+    va_start(args, format);
+    vsnprintf(buf, len + 1, format, args);
+    va_end(args);
+  };
+  return buf;
+}
+
+// Сообщение ставится в очередь MQTT и освобождается (free_payload = true)
+static size_t jsonRelease(char* payload)
+{
+  TEST_CHECK(payload != nullptr);
+  size_t len = strlen(payload);
+  free(payload);
+  return len;
+}
+
+static size_t jsonLeak(const bench_data_t* data)
+{
+  return jsonRelease(legacyStringf("{\"channel1\":%d,\"channel2\":%d,\"channel3\":%d}",
+    (data->leaks & 0x01) > 0, (data->leaks & 0x02) > 0, (data->leaks & 0x04) > 0));
+}
+
+static size_t jsonLevel(const bench_data_t* data)
+{
+  return jsonRelease(legacyStringf("{\"status\":%d}", data->level));
+}
+
+static void snapshotAppend(const char* format, ...)
+{
+  if (_len < sizeof(_buf)) {
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(_buf + _len, sizeof(_buf) - _len, format, args);
+    va_end(args);
+    if (len > 0) _len += len;
+  };
+}
+
+static void snapshotAppendValue(const char* key, float value, bool valid)
+{
+  if (valid && !isnan(value)) {
+    snapshotAppend("\"%s\":%.2f", key, value);
+  } else {
+    snapshotAppend("\"%s\":null", key);
+  };
+}
+
+static size_t jsonSnapshot(const bench_data_t* data)
+{
+  _len = 0;
+  snapshotAppend("{\"time\":%d,\"soil\":{\"status\":\"%s\",", (int)data->time, "OK");
+  snapshotAppendValue("temperature", data->values[0], data->status[0] == 0);
+  snapshotAppend(",");
+  snapshotAppendValue("moisture", data->values[1], data->status[0] == 0);
+  snapshotAppend("},\"indoor\":{\"status\":\"%s\",", "OK");
+  snapshotAppendValue("temperature", data->values[2], data->status[1] == 0);
+  snapshotAppend(",");
+  snapshotAppendValue("humidity", data->values[3], data->status[1] == 0);
+  snapshotAppend("},\"heating\":{\"status\":\"%s\",", "OK");
+  snapshotAppendValue("temperature", data->values[4], data->status[2] == 0);
+  snapshotAppend("},\"water_leak\":[%d,%d,%d],\"water_level\":%d,",
+    (data->leaks & 0x01) > 0, (data->leaks & 0x02) > 0, (data->leaks & 0x04) > 0, data->level);
+  snapshotAppend("\"watering\":{\"state\":%d", data->pump);
+  snapshotAppend(",\"last_on\":%d,\"last_off\":%d,"
+    "\"count\":{\"today\":%" PRIu32 ",\"week\":%" PRIu32 ",\"month\":%" PRIu32 ",\"total\":%" PRIu32 "},"
+    "\"duration\":{\"last\":%" PRIu32 ",\"today\":%" PRIu32 ",\"week\":%" PRIu32 ",\"month\":%" PRIu32 ",\"total\":%" PRIu32 "}}}",
+    (int)data->last_on, (int)data->last_off,
+    data->counters[0], data->counters[1], data->counters[2], data->counters[3],
+    data->durations[0], data->durations[1], data->durations[2], data->durations[3], data->durations[4]);
+  TEST_CHECK(_len < sizeof(_buf));
+  return _len;
+}
+
+static size_t cborLeak(const bench_data_t* data)
+{
+  uint8_t raw[8];
+  char buf[sizeof(raw) + 2];
+  cbor_payload_t cbor;
+  cborInit(&cbor, raw, sizeof(raw));
+  cborPutArray(&cbor, 2);
+  cborPutUInt(&cbor, BENCH_SCHEMA_VERSION);
+  cborPutUInt(&cbor, data->leaks);
+  return cborCobsEncode(&cbor, buf, sizeof(buf));
+}
+
+static size_t cborLevel(const bench_data_t* data)
+{
+  uint8_t raw[4];
+  char buf[sizeof(raw) + 2];
+  cbor_payload_t cbor;
+  cborInit(&cbor, raw, sizeof(raw));
+  cborPutArray(&cbor, 2);
+  cborPutUInt(&cbor, BENCH_SCHEMA_VERSION);
+  cborPutBool(&cbor, data->level);
+  return cborCobsEncode(&cbor, buf, sizeof(buf));
+}
+
+static size_t cborSnapshot(const bench_data_t* data)
+{
+  cbor_payload_t cbor;
+  cborInit(&cbor, _raw, sizeof(_raw));
+  cborPutArray(&cbor, 3);
+  cborPutUInt(&cbor, BENCH_SCHEMA_VERSION);
+  cborPutArray(&cbor, 12);
+  cborPutUInt(&cbor, data->time);
+  cborPutUInt(&cbor, data->status[0]);
+  cborPutFixed(&cbor, data->values[0], 2, data->status[0] == 0);
+  cborPutFixed(&cbor, data->values[1], 2, data->status[0] == 0);
+  cborPutUInt(&cbor, data->status[1]);
+  cborPutFixed(&cbor, data->values[2], 2, data->status[1] == 0);
+  cborPutFixed(&cbor, data->values[3], 2, data->status[1] == 0);
+  cborPutUInt(&cbor, data->status[2]);
+  cborPutFixed(&cbor, data->values[4], 2, data->status[2] == 0);
+  cborPutUInt(&cbor, data->leaks);
+  cborPutBool(&cbor, data->level);
+  cborPutBool(&cbor, data->pump);
+  cborPutArray(&cbor, 11);
+  cborPutUInt(&cbor, data->last_on);
+  cborPutUInt(&cbor, data->last_off);
+  for (uint8_t i = 0; i < 4; i++) cborPutUInt(&cbor, data->counters[i]);
+  for (uint8_t i = 0; i < 5; i++) cborPutUInt(&cbor, data->durations[i]);
+  TEST_CHECK(!cbor.overflow);
+  return cborCobsEncode(&cbor, _buf, sizeof(_buf));
+}
+
+// Среднее время формирования одного сообщения, нс
+static double benchEncode(cb_encode_t encode, size_t* bytes)
+{
+  double best = INFINITY;
+  volatile size_t sink = 0;
+  for (uint8_t series = 0; series < BENCH_SERIES; series++) {
+    auto started = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+      sink = sink + encode(&_data);
+    };
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count() / BENCH_ITERATIONS;
+    if (ns < best) best = ns;
+  };
+  *bytes = encode(&_data);
+  return best;
+}
+
+int main()
+{
+  struct {
+    const char* name;
+    cb_encode_t json;
+    cb_encode_t cbor;
+  } messages[] = {
+    { "water_leak", jsonLeak, cborLeak },
+    { "water_level", jsonLevel, cborLevel },
+    { "snapshot", jsonSnapshot, cborSnapshot }
+  };
+
+  printf("Payload size and encode time, best of %d series of %d\n", BENCH_SERIES, BENCH_ITERATIONS);
+  printf("%-12s %10s %10s %12s %12s\n", "message", "json, B", "cbor, B", "json, ns", "cbor, ns");
+  for (auto& message : messages) {
+    size_t jsonBytes, cborBytes;
+    double jsonNs = benchEncode(message.json, &jsonBytes);
+    double cborNs = benchEncode(message.cbor, &cborBytes);
+    printf("%-12s %10zu %10zu %12.0f %12.0f\n", message.name, jsonBytes, cborBytes, jsonNs, cborNs);
+
+    TEST_CHECK(cborBytes > 0);
+    TEST_CHECK(cborBytes * 2 < jsonBytes);
+  };
+  return 0;
+}
@@ -0,0 +1,253 @@
+#include "cborPayload.h"
+#include "cycleProfile.h"
+#include "dsPayload.h"
+#include "leakScan.h"
+#include "modbusSchedule.h"
+#include "sensorFilter.h"
+#include "sensorHealth.h"
+#include "sensorHistory.h"
+#include "wateringModel.h"
+#include "hostAlloc.h"
+#include "hostTest.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <random>
+
+// Количество обращений к куче за рабочий цикл основной задачи по фазам, как они идут в wateringTaskCycle().
+// Фазы вызывают те же чистые модули, что и прошивка; обращения подсчитываются подменой malloc / free (hostAlloc.cpp).
+// Память выделяется только при инициализации (окна фильтров), в самом цикле выделений быть не должно.
+// Для сравнения - публикация по прежней схеме: каждое сообщение форматируется в новую строку через malloc_stringf()
+
+#define BENCH_CYCLES              10000
+#define BENCH_CYCLE_S             30        // CONFIG_WATERING_TASK_CYCLE
+#define BENCH_SLAVES              3         // Датчики почвы на шине Modbus
+#define BENCH_FILTERS             6         // Влажность и температура почвы трех зон
+#define BENCH_FILTER_SIZE         15
+
+typedef enum {
+  PHASE_READ = 0,
+  PHASE_MODBUS,
+  PHASE_CONTROL,
+  PHASE_HISTORY,
+  PHASE_SNAPSHOT,
+  PHASE_EXTERNAL,
+  PHASE_PROFILE,
+  PHASE_LEGACY,
+  PHASE_COUNT
+} bench_phase_t;
+
+static const char* _phaseNames[PHASE_COUNT] = {
+  "sensors: filters and health",
+  "modbus: schedule and results",
+  "watering: model and leak scan",
+  "history",
+  "mqtt: snapshot (cbor + cobs)",
+  "open-monitoring / thingspeak",
+  "cycle profile",
+  "legacy publish (malloc_stringf)"
+};
+
+typedef struct {
+  sfilter_t         filters[BENCH_FILTERS];
+  shealth_t         health[BENCH_SLAVES];
+  modbus_bus_t      bus;
+  modbus_slave_t    slaves[BENCH_SLAVES];
+  wmodel_t          model;
+  leak_scan_t       leaks;
+  profile_phase_t   profile;
+  ds_payload_t      ds;
+  float             values[BENCH_FILTERS];
+  uint8_t           leakMask;
+} bench_state_t;
+
+static const shealth_limits_t _soilLimits = { 0.0, 100.0, 20.0, 6 * 3600, 600 };
+
+static bench_state_t* _state = nullptr;
+
+static bool dsSoilMoisture(float* value) { *value = _state->values[0]; return true; };
+static bool dsSoilTemp(float* value) { *value = _state->values[1]; return true; };
+static bool dsLeaks(float* value) { *value = _state->leakMask; return true; };
+
+static const ds_payload_field_t _dsFields[] = {
+  { "p1", 2, dsSoilMoisture },
+  { "p2", 2, dsSoilTemp },
+  { "p3", 0, dsLeaks }
+};
+
+// Так же, как malloc_stringf() из библиотеки rStrings
+static char* legacyStringf(const char* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(nullptr, 0, format, args);
+  va_end(args);
+  if (len < 0) return nullptr;
+  char* buf = (char*)malloc(len + 1);
+  if (buf) {
+    va_start(args, format);
+    vsnprintf(buf, len + 1, format, args);
+    va_end(args);
+  };
+  return buf;
+}
+
+static void phaseRead(bench_state_t* state, uint32_t now, std::mt19937& rng)
+{
+  std::normal_distribution<float> noise(0.0, 0.3);
+  for (uint8_t i = 0; i < BENCH_FILTERS; i++) {
+    float raw = (i % 2 == 0 ? 45.0 : 21.0) + 5.0 * sinf(now / 43200.0) + noise(rng);
+    state->values[i] = sfilterAdd(&state->filters[i], raw);
+  };
+  for (uint8_t i = 0; i < BENCH_SLAVES; i++) {
+    shealthObserve(&state->health[i], now, true, state->values[2 * i]);
+    shealthUpdate(&state->health[i], now);
+  };
+}
+
+static void phaseModbus(bench_state_t* state, int64_t now_us)
+{
+  uint8_t order[BENCH_SLAVES];
+  uint8_t count = modbusScheduleOrder(&state->bus, state->slaves, BENCH_SLAVES, 0x07, 0x01, now_us, order);
+  int64_t started = now_us;
+  for (uint8_t i = 0; i < count; i++) {
+    modbusSlaveDone(&state->bus, &state->slaves[order[i]], true, started, started + 40000);
+    started += 40000;
+  };
+}
+
+static void phaseControl(bench_state_t* state, uint32_t now, uint32_t cycle)
+{
+  const wmodel_inputs_t inputs = { 22.0, 40.0, 50.0 };
+  bool pumping = (cycle % 2880) < 4;
+  wmodelObserve(&state->model, now, state->values[0], pumping, &inputs);
+  if ((cycle % 2880) == 0) wmodelPlan(&state->model, now, state->values[0], 60.0, 30, 300);
+  if ((cycle % 2880) == 4) wmodelStop(&state->model, now);
+  uint8_t cleared;
+  state->leakMask = leakScanProcess(&state->leaks, 0x07, (cycle % 1000) == 500 ? 0x02 : 0x00, 0x00,
+    (int64_t)now * 1000000, 60000000, &cleared);
+}
+
+static void phaseHistory(bench_state_t* state, uint32_t now)
+{
+  history_sample_t sample;
+  sample.time = now;
+  for (uint8_t i = 0; i < CONFIG_HISTORY_CHANNELS; i++) {
+    sample.values[i] = historyEncodeValue(state->values[i]);
+  };
+  sample.pump = false;
+  historyAdd(&sample);
+}
+
+static void phaseSnapshot(bench_state_t* state, uint32_t now)
+{
+  static uint8_t raw[CBOR_COBS_CAPACITY(128)];
+  static char buf[128];
+  cbor_payload_t cbor;
+  cborInit(&cbor, raw, sizeof(raw));
+  cborPutArray(&cbor, 12);
+  cborPutUInt(&cbor, now);
+  cborPutUInt(&cbor, 0);
+  cborPutFixed(&cbor, state->values[0], 2, true);
+  cborPutFixed(&cbor, state->values[1], 2, true);
+  cborPutUInt(&cbor, 0);
+  cborPutFixed(&cbor, state->values[2], 2, true);
+  cborPutFixed(&cbor, state->values[3], 2, true);
+  cborPutUInt(&cbor, 0);
+  cborPutFixed(&cbor, state->values[4], 2, true);
+  cborPutUInt(&cbor, state->leakMask);
+  cborPutBool(&cbor, true);
+  cborPutBool(&cbor, false);
+  TEST_CHECK(cborCobsEncode(&cbor, buf, sizeof(buf)) > 0);
+}
+
+static void phaseExternal(bench_state_t* state)
+{
+  TEST_CHECK(dsPayloadBuild(&state->ds, _dsFields, sizeof(_dsFields) / sizeof(ds_payload_field_t)));
+}
+
+static void phaseLegacy(bench_state_t* state)
+{
+  char* payload = legacyStringf("{\"value\":%.2f,\"filtered\":%.2f}", state->values[0], state->values[0]);
+  TEST_CHECK(payload != nullptr);
+  free(payload);
+  payload = legacyStringf("{\"channel1\":%d,\"channel2\":%d,\"channel3\":%d}",
+    (state->leakMask & 0x01) != 0, (state->leakMask & 0x02) != 0, (state->leakMask & 0x04) != 0);
+  TEST_CHECK(payload != nullptr);
+  free(payload);
+}
+
+int main()
+{
+  static bench_state_t state;
+  _state = &state;
+  memset(&state, 0, sizeof(state));
+
+  // Инициализация: единственное место, где модули обращаются к куче
+  host_alloc_t mark, init;
+  hostAllocGet(&mark);
+  for (uint8_t i = 0; i < BENCH_FILTERS; i++) {
+    TEST_CHECK(sfilterInit(&state.filters[i], i % 2 == 0 ? SFILTER_MEDIAN : SFILTER_MEAN, BENCH_FILTER_SIZE));
+  };
+  for (uint8_t i = 0; i < BENCH_SLAVES; i++) {
+    shealthInit(&state.health[i], &_soilLimits, 0);
+  };
+  modbusBusInit(&state.bus, 10, 600);
+  wmodelInit(&state.model);
+  leakScanInit(&state.leaks);
+  profileReset(&state.profile);
+  historyClear();
+  hostAllocSince(&mark, &init);
+
+  host_alloc_t totals[PHASE_COUNT];
+  memset(totals, 0, sizeof(totals));
+  std::mt19937 rng(1);
+  for (uint32_t cycle = 0; cycle < BENCH_CYCLES; cycle++) {
+    uint32_t now = 60 + cycle * BENCH_CYCLE_S;
+    for (uint8_t phase = 0; phase < PHASE_COUNT; phase++) {
+      hostAllocGet(&mark);
+      switch (phase) {
+        case PHASE_READ:     phaseRead(&state, now, rng); break;
+        case PHASE_MODBUS:   phaseModbus(&state, (int64_t)now * 1000000); break;
+        case PHASE_CONTROL:  phaseControl(&state, now, cycle); break;
+        case PHASE_HISTORY:  phaseHistory(&state, now); break;
+        case PHASE_SNAPSHOT: phaseSnapshot(&state, now); break;
+        case PHASE_EXTERNAL: phaseExternal(&state); break;
+        case PHASE_PROFILE:  profileAdd(&state.profile, 1000 + cycle % 5000); break;
+        case PHASE_LEGACY:   phaseLegacy(&state); break;
+      };
+      host_alloc_t delta;
+      hostAllocSince(&mark, &delta);
+      totals[phase].allocs += delta.allocs;
+      totals[phase].frees += delta.frees;
+      totals[phase].bytes += delta.bytes;
+    };
+  };
+
+  printf("Heap usage per task cycle, %d cycles\n", BENCH_CYCLES);
+  printf("%-34s %12llu allocs %8llu bytes (once)\n", "init", (unsigned long long)init.allocs, (unsigned long long)init.bytes);
+  uint64_t cycleAllocs = 0;
+  for (uint8_t phase = 0; phase < PHASE_COUNT; phase++) {
+    printf("%-34s %12.2f allocs %8.1f bytes per cycle\n", _phaseNames[phase],
+      (double)totals[phase].allocs / BENCH_CYCLES, (double)totals[phase].bytes / BENCH_CYCLES);
+    if (phase != PHASE_LEGACY) cycleAllocs += totals[phase].allocs + totals[phase].frees;
+  };
+
+  // Окна фильтров: по одному блоку под значения, позиции и кучи медианы, по одному блоку у среднего
+  TEST_CHECK(init.allocs == (BENCH_FILTERS / 2) * 3 + (BENCH_FILTERS / 2));
+  // Рабочий цикл не обращается к куче
+  TEST_CHECK(cycleAllocs == 0);
+  // Подсчет действительно работает: прежняя схема выделяет и освобождает по строке на сообщение
+  TEST_CHECK(totals[PHASE_LEGACY].allocs == 2ULL * BENCH_CYCLES);
+  TEST_CHECK(totals[PHASE_LEGACY].frees == totals[PHASE_LEGACY].allocs);
+
+  hostAllocGet(&mark);
+  for (uint8_t i = 0; i < BENCH_FILTERS; i++) {
+    sfilterFree(&state.filters[i]);
+  };
+  host_alloc_t done;
+  hostAllocSince(&mark, &done);
+  TEST_CHECK(done.frees == init.allocs);
+  return 0;
+}
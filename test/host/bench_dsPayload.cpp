@@ -0,0 +1,212 @@
+#include "dsPayload.h"
+#include "hostAlloc.h"
+#include "hostTest.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+// Обращения к куче и время формирования данных для open-monitoring.online и thingspeak.com:
+//   - прежняя схема: каждая группа полей - malloc_stringf(), группы склеиваются concat_strings_div()
+//     (как в wateringTaskCycle() до перехода на dsPayload);
+//   - dsPayloadBuild(): статический буфер и таблица полей omFields / tsFields из watering.cpp.
+// Показания сенсоров - константы; все сенсоры исправны, поэтому оба способа дают одинаковые строки.
+// Время - лучшее из нескольких серий, только для сведения: на хосте оно зависит от нагрузки, проверки по нему нет
+
+#define BENCH_ITERATIONS          20000
+#define BENCH_SERIES              5
+
+static const float _soilTemp = 18.37;
+static const float _soilMoisture = 42.85;
+static const float _indoorTemp = 22.41;
+static const float _indoorHumidity = 47.23;
+static const float _heatingTemp = 51.634;
+static const bool  _pump = false;
+static const uint8_t _leaks = 0x02;
+static const bool  _level = true;
+
+// Так же, как malloc_stringf() из библиотеки rStrings
+static char* legacyStringf(const char* format, ...)
+{
+  char* ret = nullptr;
+  va_list args1, args2;
+  va_start(args1, format);
+  va_copy(args2, args1);
+  int len = vsnprintf(nullptr, 0, format, args1);
+  va_end(args1);
+  if (len > 0) {
+    ret = (char*)malloc(len + 1);
+    if (ret) {
+      memset(ret, 0, len + 1);
+      vsnprintf(ret, len + 1, format, args2);
+    };
+  };
+  va_end(args2);
+  return ret;
+}
+
+// Так же, как concat_strings_div() из библиотеки rStrings
+static char* legacyConcat(char* part1, char* part2, const char* divider)
+{
+  char* ret = nullptr;
+  if (part1) {
+    if (part2) {
+      ret = legacyStringf("%s%s%s", part1, divider, part2);
+      free(part1);
+      free(part2);
+    } else {
+      ret = part1;
+    };
+  } else {
+    ret = part2;
+  };
+  return ret;
+}
+
+static char* legacyOpenMon()
+{
+  char* values = nullptr;
+  values = legacyConcat(values, legacyStringf("p1=%.2f&p2=%.2f", _soilMoisture, _soilTemp), "&");
+  values = legacyConcat(values, legacyStringf("p3=%d", _pump), "&");
+  values = legacyConcat(values, legacyStringf("p4=%d&p5=%d&p6=%d&p7=%d",
+    (_leaks & 0x01) > 0, (_leaks & 0x02) > 0, (_leaks & 0x04) > 0, _level), "&");
+  values = legacyConcat(values, legacyStringf("p8=%.2f&p9=%.2f", _indoorTemp, _indoorHumidity), "&");
+  values = legacyConcat(values, legacyStringf("p10=%.3f", _heatingTemp), "&");
+  return values;
+}
+
+static char* legacyThingSpeak()
+{
+  char* values = nullptr;
+  values = legacyConcat(values, legacyStringf("field1=%.1f&field2=%.1f", _soilTemp, _soilMoisture), "&");
+  values = legacyConcat(values, legacyStringf("field3=%d", _pump), "&");
+  values = legacyConcat(values, legacyStringf("field4=%d", _leaks), "&");
+  values = legacyConcat(values, legacyStringf("field5=%d", _level), "&");
+  values = legacyConcat(values, legacyStringf("field6=%.1f&field7=%.1f", _indoorTemp, _indoorHumidity), "&");
+  values = legacyConcat(values, legacyStringf("field8=%.1f", _heatingTemp), "&");
+  return values;
+}
+
+static bool dsSoilTemp(float* value) { *value = _soilTemp; return true; }
+static bool dsSoilMoisture(float* value) { *value = _soilMoisture; return true; }
+static bool dsIndoorTemp(float* value) { *value = _indoorTemp; return true; }
+static bool dsIndoorHumidity(float* value) { *value = _indoorHumidity; return true; }
+static bool dsHeatingTemp(float* value) { *value = _heatingTemp; return true; }
+static bool dsPumpState(float* value) { *value = _pump; return true; }
+static bool dsWaterLeak(float* value) { *value = _leaks; return true; }
+static bool dsWaterLeak1(float* value) { *value = (_leaks & 0x01) > 0; return true; }
+static bool dsWaterLeak2(float* value) { *value = (_leaks & 0x02) > 0; return true; }
+static bool dsWaterLeak3(float* value) { *value = (_leaks & 0x04) > 0; return true; }
+static bool dsWaterLevel(float* value) { *value = _level; return true; }
+
+static const ds_payload_field_t omFields[] = {
+  { "p1",  2, dsSoilMoisture },
+  { "p2",  2, dsSoilTemp },
+  { "p3",  0, dsPumpState },
+  { "p4",  0, dsWaterLeak1 },
+  { "p5",  0, dsWaterLeak2 },
+  { "p6",  0, dsWaterLeak3 },
+  { "p7",  0, dsWaterLevel },
+  { "p8",  2, dsIndoorTemp },
+  { "p9",  2, dsIndoorHumidity },
+  { "p10", 3, dsHeatingTemp }
+};
+
+static const ds_payload_field_t tsFields[] = {
+  { "field1", 1, dsSoilTemp },
+  { "field2", 1, dsSoilMoisture },
+  { "field3", 0, dsPumpState },
+  { "field4", 0, dsWaterLeak },
+  { "field5", 0, dsWaterLevel },
+  { "field6", 1, dsIndoorTemp },
+  { "field7", 1, dsIndoorHumidity },
+  { "field8", 1, dsHeatingTemp }
+};
+
+typedef char* (*cb_legacy_t) ();
+
+static ds_payload_t _payload;
+
+// Сообщение передается в dsSend() и освобождается; возвращает время на одно сообщение, нс
+static double benchLegacy(cb_legacy_t build, host_alloc_t* perPayload)
+{
+  double best = INFINITY;
+  volatile size_t sink = 0;
+  host_alloc_t mark;
+  hostAllocGet(&mark);
+  for (uint8_t series = 0; series < BENCH_SERIES; series++) {
+    auto started = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+      char* values = build();
+      sink = sink + strlen(values);
+      free(values);
+    };
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count() / BENCH_ITERATIONS;
+    if (ns < best) best = ns;
+  };
+  hostAllocSince(&mark, perPayload);
+  return best;
+}
+
+static double benchPayload(const ds_payload_field_t* fields, size_t count, host_alloc_t* perPayload)
+{
+  double best = INFINITY;
+  volatile size_t sink = 0;
+  host_alloc_t mark;
+  hostAllocGet(&mark);
+  for (uint8_t series = 0; series < BENCH_SERIES; series++) {
+    auto started = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+      TEST_CHECK(dsPayloadBuild(&_payload, fields, count));
+      sink = sink + _payload.len;
+    };
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count() / BENCH_ITERATIONS;
+    if (ns < best) best = ns;
+  };
+  hostAllocSince(&mark, perPayload);
+  return best;
+}
+
+int main()
+{
+  struct {
+    const char* name;
+    cb_legacy_t legacy;
+    const ds_payload_field_t* fields;
+    size_t count;
+  } services[] = {
+    { "openmon", legacyOpenMon, omFields, sizeof(omFields) / sizeof(ds_payload_field_t) },
+    { "thingspeak", legacyThingSpeak, tsFields, sizeof(tsFields) / sizeof(ds_payload_field_t) }
+  };
+  const uint32_t payloads = BENCH_SERIES * BENCH_ITERATIONS;
+
+  printf("Data send payload, %d series of %d, time is best of series\n", BENCH_SERIES, BENCH_ITERATIONS);
+  printf("%-12s %-10s %8s %10s %10s\n", "service", "method", "allocs", "bytes", "ns");
+  for (auto& service : services) {
+    // Обе схемы формируют одну и ту же строку
+    char* expected = service.legacy();
+    TEST_CHECK(expected != nullptr);
+    TEST_CHECK(dsPayloadBuild(&_payload, service.fields, service.count));
+    TEST_CHECK(strcmp(_payload.data, expected) == 0);
+    free(expected);
+
+    host_alloc_t legacy, payload;
+    double legacyNs = benchLegacy(service.legacy, &legacy);
+    double payloadNs = benchPayload(service.fields, service.count, &payload);
+    printf("%-12s %-10s %8.2f %10.1f %10.0f\n", service.name, "legacy",
+      (double)legacy.allocs / payloads, (double)legacy.bytes / payloads, legacyNs);
+    printf("%-12s %-10s %8.2f %10.1f %10.0f\n", service.name, "dsPayload",
+      (double)payload.allocs / payloads, (double)payload.bytes / payloads, payloadNs);
+
+    // Прежняя схема: malloc_stringf() на каждую группу и на каждую склейку, все освобождается после отправки
+    TEST_CHECK(legacy.allocs >= (uint64_t)payloads * service.count / 2);
+    TEST_CHECK(legacy.frees == legacy.allocs);
+    TEST_CHECK(legacy.bytes > (uint64_t)payloads * strlen(_payload.data));
+    // dsPayloadBuild() к куче не обращается
+    TEST_CHECK(payload.allocs == 0);
+    TEST_CHECK(payload.frees == 0);
+    TEST_CHECK(payload.bytes == 0);
+  };
+  return 0;
+}
@@ -0,0 +1,139 @@
+#include "leakScan.h"
+#include "cycleProfile.h"
+#include "hostTest.h"
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+
+// Задержка от появления воды на датчике до отключения выхода насоса.
+// Складывается из двух частей:
+//   - обнаружение: ожидание ближайшего опроса входа; моделируется по расписанию опроса для случайного момента протечки;
+//   - передача: от установки PUMP_INTERLOCK до записи в GPIO в задаче аварийного отключения; измеряется на хосте
+//     (поток опроса будит поток отключения через условную переменную, как xEventGroupSetBits / xEventGroupWaitBits).
+// Прежняя схема: входы опрашивались по очереди (подтяжка, vTaskDelay(DELAY_ON), чтение, vTaskDelay(DELAY_OFF))
+// один раз за цикл основной задачи, насос отключался в том же цикле
+
+#define BENCH_TRIALS              20000
+#define BENCH_HANDOFFS            2000
+#define BENCH_TICK_US             10000     // CONFIG_FREERTOS_HZ = 100
+#define BENCH_TASK_CYCLE_US       30000000  // CONFIG_WATERING_TASK_CYCLE
+#define BENCH_LEAK_DELAY_ON       1         // Прежние CONFIG_WATER_LEAK_DELAY_ON / CONFIG_WATER_LEAK_DELAY_OFF, тиков
+#define BENCH_LEAK_DELAY_OFF      10
+#define BENCH_SCAN_SETTLE_US      10000     // CONFIG_WATER_LEAK_SCAN_SETTLE
+
+static void printPhase(const char* name, const profile_phase_t* phase)
+{
+  printf("%-32s p50 %9u us  p99 %9u us  max %9u us\n", name, 
+    profilePercentile(phase, 50), profilePercentile(phase, 99), phase->max_us);
+}
+
+// Прежняя схема: момент чтения канала внутри цикла основной задачи
+static int64_t legacyProbeOffset(uint8_t channel)
+{
+  return (int64_t)channel * (BENCH_LEAK_DELAY_ON + BENCH_LEAK_DELAY_OFF) * BENCH_TICK_US + BENCH_LEAK_DELAY_ON * BENCH_TICK_US;
+}
+
+static void benchLegacy(profile_phase_t* detect)
+{
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int64_t> onsetDist(0, 100LL * BENCH_TASK_CYCLE_US);
+  profileReset(detect);
+  for (uint32_t n = 0; n < BENCH_TRIALS; n++) {
+    int64_t onset = onsetDist(rng);
+    uint8_t channel = n % CONFIG_LEAK_SCAN_CHANNELS;
+    int64_t cycle = onset / BENCH_TASK_CYCLE_US * BENCH_TASK_CYCLE_US;
+    int64_t probe = cycle + legacyProbeOffset(channel);
+    if (probe < onset) probe += BENCH_TASK_CYCLE_US;
+    profileAdd(detect, (uint32_t)(probe - onset));
+  };
+}
+
+// Новая схема: каждые interval_us включается подтяжка, через BENCH_SCAN_SETTLE_US все входы читаются разом
+// и обрабатываются leakScanProcess()
+static void benchScan(profile_phase_t* detect, int64_t interval_us)
+{
+  std::mt19937 rng(2);
+  std::uniform_int_distribution<int64_t> onsetDist(interval_us, 1000 * interval_us);
+  profileReset(detect);
+  for (uint32_t n = 0; n < BENCH_TRIALS; n++) {
+    int64_t onset = onsetDist(rng);
+    uint8_t wetMask = 1 << (n % CONFIG_LEAK_SCAN_CHANNELS);
+    leak_scan_t scan;
+    leakScanInit(&scan);
+    uint8_t cleared;
+    int64_t sample = (onset / interval_us - 1) * interval_us + BENCH_SCAN_SETTLE_US;
+    while (true) {
+      uint8_t wet = sample >= onset ? wetMask : 0;
+      if (leakScanProcess(&scan, 0x07, wet, 0x00, sample, 60000000, &cleared)) break;
+      sample += interval_us;
+    };
+    profileAdd(detect, (uint32_t)(sample - onset));
+  };
+}
+
+static void benchHandoff(profile_phase_t* handoff)
+{
+  std::mutex lock;
+  std::condition_variable cond;
+  bool interlock = false;
+  bool stop = false;
+  std::atomic<bool> pump(true);
+  std::chrono::steady_clock::time_point raised;
+
+  profileReset(handoff);
+  std::thread worker([&]() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+      cond.wait(guard, [&]() { return interlock || stop; });
+      if (stop) break;
+      interlock = false;
+      pump.store(false);
+      profileAdd(handoff, (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - raised).count());
+    };
+  });
+
+  for (uint32_t n = 0; n < BENCH_HANDOFFS; n++) {
+    pump.store(true);
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      raised = std::chrono::steady_clock::now();
+      interlock = true;
+    };
+    cond.notify_one();
+    while (pump.load()) std::this_thread::yield();
+  };
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stop = true;
+  };
+  cond.notify_one();
+  worker.join();
+}
+
+int main()
+{
+  profile_phase_t legacy, handoff, detect;
+  benchLegacy(&legacy);
+  benchHandoff(&handoff);
+
+  printf("Leak to pump off latency, %d trials\n", BENCH_TRIALS);
+  printPhase("legacy: task cycle 30 s", &legacy);
+  printPhase("handoff to interlock (host)", &handoff);
+
+  const int64_t intervals[] = { 50000, 100000, 250000, 500000 };
+  for (int64_t interval : intervals) {
+    benchScan(&detect, interval);
+    char name[64];
+    snprintf(name, sizeof(name), "scan every %lld ms", (long long)(interval / 1000));
+    printPhase(name, &detect);
+    // Вода обнаруживается не позднее чем через один период опроса
+    TEST_CHECK(detect.max_us <= interval);
+    TEST_CHECK(profilePercentile(&detect, 99) * 10 < profilePercentile(&legacy, 50));
+  };
+  return 0;
+}
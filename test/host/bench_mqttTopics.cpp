@@ -0,0 +1,108 @@
+#include "mqttTopics.h"
+#include "hostAlloc.h"
+#include "hostTest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+// Обращения к куче за цикл публикации топиков устройства:
+//   - прежняя схема: топик собирается mqttGetTopicDevice1() при каждой публикации и освобождается после отправки
+//     (как в sensorsWaterLeakMqttPublish() / sensorsWaterLevelMqttPublish());
+//   - таблица: топики собираются в арену при выборе брокера (mqttTopicsBuild), публикация берет готовый указатель.
+// Вместо mqttGetTopicDevice1() и mqttPublish() - заглушки с тем же порядком работы с памятью
+
+#define BENCH_CYCLES              20000
+#define BENCH_RECONNECTS          10
+
+static const char* _names[] = {
+  "storage", "water_leak", "water_level", "interlock", "modbus", "model", "profile", "heap",
+  "dedup", "volume", "health", "snapshot", "backlog", "history", "journal"
+};
+#define BENCH_TOPICS (sizeof(_names) / sizeof(const char*))
+
+static size_t _published = 0;
+
+// Как mqttGetTopicDevice1(): строка в куче, префикс брокера и имя устройства
+static char* topicCreate(bool primary, bool local, const char* topic)
+{
+  const char* format = "%s/%s/autowatering/%s";
+  int len = snprintf(nullptr, 0, format, primary ? "home" : "backup", local ? "local" : "public", topic);
+  char* buf = (char*)malloc(len + 1);
+  if (buf) snprintf(buf, len + 1, format, primary ? "home" : "backup", local ? "local" : "public", topic);
+  return buf;
+}
+
+// Как mqttPublish(): сообщение ставится в очередь, топик освобождается, если free_topic
+static void benchPublish(char* topic, const char* payload, bool free_topic)
+{
+  TEST_CHECK(topic != nullptr);
+  _published += strlen(topic) + strlen(payload);
+  if (free_topic) free(topic);
+}
+
+static double benchLegacy(host_alloc_t* perCycle)
+{
+  host_alloc_t mark;
+  hostAllocGet(&mark);
+  auto started = std::chrono::steady_clock::now();
+  for (uint32_t cycle = 0; cycle < BENCH_CYCLES; cycle++) {
+    for (uint8_t i = 0; i < BENCH_TOPICS; i++) {
+      benchPublish(topicCreate(true, false, _names[i]), "{}", true);
+    };
+  };
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+  hostAllocSince(&mark, perCycle);
+  return ns / BENCH_CYCLES;
+}
+
+static double benchTable(host_alloc_t* build, host_alloc_t* perCycle)
+{
+  static mqtt_topics_t tables[2];
+  host_alloc_t mark;
+  hostAllocGet(&mark);
+  // Подключения чередуются между основным и резервным брокером, каждая таблица собирается один раз
+  for (uint8_t n = 0; n < BENCH_RECONNECTS; n++) {
+    bool primary = (n % 2) == 0;
+    TEST_CHECK(mqttTopicsBuild(&tables[primary ? 0 : 1], primary, _names, BENCH_TOPICS, topicCreate));
+  };
+  hostAllocSince(&mark, build);
+
+  mqtt_topics_t* active = &tables[0];
+  hostAllocGet(&mark);
+  auto started = std::chrono::steady_clock::now();
+  for (uint32_t cycle = 0; cycle < BENCH_CYCLES; cycle++) {
+    for (uint8_t i = 0; i < BENCH_TOPICS; i++) {
+      benchPublish(active->topics[i], "{}", false);
+    };
+  };
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+  hostAllocSince(&mark, perCycle);
+  return ns / BENCH_CYCLES;
+}
+
+int main()
+{
+  host_alloc_t legacy, build, table;
+  double legacyNs = benchLegacy(&legacy);
+  double tableNs = benchTable(&build, &table);
+
+  printf("MQTT topics, %u topics per publish cycle, %d cycles, %d reconnects\n", (unsigned)BENCH_TOPICS, BENCH_CYCLES, BENCH_RECONNECTS);
+  printf("%-28s %8.2f allocs %8.1f bytes %10.0f ns per cycle\n", "legacy: topic per publish",
+    (double)legacy.allocs / BENCH_CYCLES, (double)legacy.bytes / BENCH_CYCLES, legacyNs);
+  printf("%-28s %8.2f allocs %8.1f bytes %10.0f ns per cycle\n", "topic table",
+    (double)table.allocs / BENCH_CYCLES, (double)table.bytes / BENCH_CYCLES, tableNs);
+  printf("%-28s %8llu allocs %8llu bytes (all reconnects)\n", "topic table: build",
+    (unsigned long long)build.allocs, (unsigned long long)build.bytes);
+
+  TEST_CHECK(legacy.allocs == (uint64_t)BENCH_TOPICS * BENCH_CYCLES);
+  TEST_CHECK(legacy.frees == legacy.allocs);
+  // С таблицей публикация не обращается к куче
+  TEST_CHECK(table.allocs == 0);
+  TEST_CHECK(table.frees == 0);
+  // Временные строки создаются только при первой сборке таблицы каждого брокера и сразу освобождаются
+  TEST_CHECK(build.allocs == 2 * BENCH_TOPICS);
+  TEST_CHECK(build.frees == build.allocs);
+  TEST_CHECK(_published > 0);
+  return 0;
+}
@@ -0,0 +1,142 @@
+#include "sensorFilter.h"
+#include "hostTest.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+// Стоимость обработки одного значения фильтрами sensorFilter при окнах 5..256 в сравнении со встроенными 
+// фильтрами rSensorItem (reSensor.cpp): среднее суммирует всё окно, медиана - проход пузырьком по всему буферу 
+// на каждое значение. Для сравнения точности - медиана окна, посчитанная сортировкой копии окна.
+// Время только печатается (медиана O(log n) видна по росту стоимости с окном), проверяется совпадение результатов
+
+#define BENCH_VALUES    200000
+
+// rSensorItem::getAverageValue()
+typedef struct {
+  float buf[CONFIG_SFILTER_MAX_SIZE + 1];
+  uint16_t size;
+  uint16_t index;
+  bool init;
+} legacy_filter_t;
+
+static float legacyAverage(legacy_filter_t* f, float value)
+{
+  if (!f->init) {
+    f->init = true;
+    for (uint16_t i = 0; i < f->size; i++) f->buf[i] = value;
+  };
+  f->buf[f->index] = value;
+  if (++f->index >= f->size) f->index = 0;
+  float sum = 0;
+  for (uint16_t i = 0; i < f->size; i++) sum += f->buf[i];
+  return sum / f->size;
+}
+
+// rSensorItem::getMedianValue()
+static float legacyMedian(legacy_filter_t* f, float value)
+{
+  if (!f->init) {
+    f->init = true;
+    for (uint16_t i = 0; i < f->size; i++) f->buf[i] = value;
+  };
+  f->buf[f->index] = value;
+  if ((f->index < f->size - 1) && (f->buf[f->index] > f->buf[f->index + 1])) {
+    for (int i = f->index; i < f->size - 1; i++) {
+      if (f->buf[i] > f->buf[i + 1]) std::swap(f->buf[i], f->buf[i + 1]);
+    };
+  } else {
+    if ((f->index > 0) && (f->buf[f->index - 1] > f->buf[f->index])) {
+      for (int i = f->index; i > 0; i--) {
+        if (f->buf[i] < f->buf[i - 1]) std::swap(f->buf[i], f->buf[i - 1]);
+      };
+    };
+  };
+  if (++f->index >= f->size) f->index = 0;
+  return f->buf[f->size / 2];
+}
+
+// Медиана сортировкой копии окна
+typedef struct {
+  float buf[CONFIG_SFILTER_MAX_SIZE + 1];
+  float tmp[CONFIG_SFILTER_MAX_SIZE + 1];
+  uint16_t size;
+  uint16_t count;
+  uint16_t index;
+} sort_filter_t;
+
+static float sortMedian(sort_filter_t* f, float value)
+{
+  f->buf[f->index] = value;
+  if (++f->index >= f->size) f->index = 0;
+  if (f->count < f->size) f->count++;
+  memcpy(f->tmp, f->buf, f->count * sizeof(float));
+  std::sort(f->tmp, f->tmp + f->count);
+  if (f->count & 1) return f->tmp[f->count / 2];
+  return (f->tmp[f->count / 2 - 1] + f->tmp[f->count / 2]) / 2;
+}
+
+static float _values[BENCH_VALUES];
+static volatile float _sink;
+
+template <typename F>
+static double benchNs(F filter, uint32_t count = BENCH_VALUES)
+{
+  auto start = std::chrono::steady_clock::now();
+  float acc = 0;
+  for (uint32_t i = 0; i < count; i++) acc += filter(_values[i]);
+  _sink = acc;
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+}
+
+int main()
+{
+  // Влажность почвы с шумом и редкими выбросами, как у CWT-TH
+  std::mt19937 rng(15);
+  std::normal_distribution<float> noise(0.0f, 0.3f);
+  for (uint32_t i = 0; i < BENCH_VALUES; i++) {
+    _values[i] = 40.0f + 5.0f * sinf((float)i / 5000.0f) + noise(rng);
+    if (rng() % 50 == 0) _values[i] = (rng() & 1) ? 0.0f : 100.0f;
+  };
+
+  printf("Filter cost per value, ns (%d values)\n", BENCH_VALUES);
+  printf("%6s %10s %10s %10s %10s %10s %10s\n", "window", "median", "mean", "ema", "rs median", "rs mean", "sorted");
+  const uint16_t sizes[] = { 5, 9, 15, 31, 63, 127, 255, 256 };
+  for (uint16_t size : sizes) {
+    sfilter_t median, mean, ema;
+    memset(&median, 0, sizeof(median));
+    memset(&mean, 0, sizeof(mean));
+    memset(&ema, 0, sizeof(ema));
+    TEST_CHECK(sfilterInit(&median, SFILTER_MEDIAN, size));
+    TEST_CHECK(sfilterInit(&mean, SFILTER_MEAN, size));
+    TEST_CHECK(sfilterInit(&ema, SFILTER_EMA, size));
+    static legacy_filter_t legacyMed, legacyAvg;
+    memset(&legacyMed, 0, sizeof(legacyMed));
+    memset(&legacyAvg, 0, sizeof(legacyAvg));
+    legacyMed.size = legacyAvg.size = size;
+    static sort_filter_t sorted;
+    memset(&sorted, 0, sizeof(sorted));
+    sorted.size = median.size;
+
+    double tMedian = benchNs([&](float v) { return sfilterAdd(&median, v); });
+    double tMean = benchNs([&](float v) { return sfilterAdd(&mean, v); });
+    double tEma = benchNs([&](float v) { return sfilterAdd(&ema, v); });
+    double tLegacyMed = benchNs([&](float v) { return legacyMedian(&legacyMed, v); });
+    double tLegacyAvg = benchNs([&](float v) { return legacyAverage(&legacyAvg, v); });
+    double tSorted = benchNs([&](float v) { return sortMedian(&sorted, v); }, BENCH_VALUES / 20);
+    printf("%6u %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", size, tMedian, tMean, tEma, tLegacyMed, tLegacyAvg, tSorted);
+
+    // Результат совпадает с медианой, посчитанной сортировкой
+    sfilterReset(&median);
+    memset(&sorted, 0, sizeof(sorted));
+    sorted.size = median.size;
+    for (uint32_t i = 0; i < 10000; i++) {
+      TEST_NEAR(sfilterAdd(&median, _values[i]), sortMedian(&sorted, _values[i]), 1e-6);
+    };
+    sfilterFree(&median);
+    sfilterFree(&mean);
+    sfilterFree(&ema);
+  };
+  return 0;
+}
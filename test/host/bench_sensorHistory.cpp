@@ -0,0 +1,93 @@
+#include "sensorHistory.h"
+#include "hostTest.h"
+#include <stdio.h>
+#include <chrono>
+#include <random>
+
+// Объем памяти и скорость упаковки истории показаний: трое суток показаний с периодом 30 с (как в основном цикле).
+// Сигналы правдоподобные: влажность почвы медленно высыхает и скачком растет при поливе, температуры меняются
+// по суточному циклу, канал батарей иногда без данных. Два профиля: показания после фильтра (меняются только
+// при переходе через шаг 0.1) и "шумные" показания, у которых последний разряд меняется почти каждое чтение
+
+#define BENCH_PERIOD      30
+#define BENCH_DAYS        3
+#define BENCH_SAMPLES     (BENCH_DAYS * 24 * 3600 / BENCH_PERIOD)
+
+static void makeSamples(history_sample_t* samples, uint32_t count, float jitter)
+{
+  std::mt19937 rng(7);
+  std::normal_distribution<float> noise(0.0f, jitter > 0.0f ? jitter : 1.0f);
+  float moisture = 45.0f;
+  uint32_t pumpLeft = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t time = 1700000000 + i * BENCH_PERIOD;
+    float day = (float)(time % 86400) / 86400.0f;
+    if (pumpLeft > 0) {
+      pumpLeft--;
+      moisture += 0.8f;
+    } else if (moisture < 35.0f) {
+      pumpLeft = 6;
+    } else {
+      moisture -= 0.2f / 120.0f;
+    };
+    float daily = sinf(day * 2.0f * (float)M_PI);
+    history_sample_t* sample = &samples[i];
+    sample->time = time;
+    sample->values[0] = historyEncodeValue(moisture + (jitter > 0.0f ? noise(rng) : 0.0f));
+    sample->values[1] = historyEncodeValue(18.0f + 2.0f * daily + (jitter > 0.0f ? noise(rng) : 0.0f));
+    sample->values[2] = historyEncodeValue(22.0f + 1.5f * daily + (jitter > 0.0f ? noise(rng) : 0.0f));
+    sample->values[3] = historyEncodeValue(45.0f - 5.0f * daily + (jitter > 0.0f ? noise(rng) : 0.0f));
+    sample->values[4] = (i % 500 == 0) ? CONFIG_HISTORY_NO_VALUE : historyEncodeValue(50.0f + 8.0f * daily + (jitter > 0.0f ? noise(rng) : 0.0f));
+    sample->pump = pumpLeft > 0;
+  };
+}
+
+static void benchProfile(const char* name, float jitter, double minHours)
+{
+  static history_sample_t samples[BENCH_SAMPLES];
+  makeSamples(samples, BENCH_SAMPLES, jitter);
+
+  historyClear();
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+    TEST_CHECK(historyAdd(&samples[i]));
+  };
+  double encodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  history_stats_t stats;
+  historyGetStats(&stats);
+  history_cursor_t cursor;
+  historyCursorInit(&cursor);
+  history_sample_t sample;
+  uint32_t read = 0;
+  start = std::chrono::steady_clock::now();
+  while (historyCursorNext(&cursor, &sample)) read++;
+  double decodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  TEST_CHECK(read == stats.samples);
+
+  double bytesPerSample = (double)stats.bytes / stats.samples;
+  double rawPerSample = 4 + 2 * CONFIG_HISTORY_CHANNELS + 1;
+  double hours = (double)stats.capacity / bytesPerSample * BENCH_PERIOD / 3600.0;
+  printf("%s\n", name);
+  printf("  retained            %8u samples, %u evicted\n", stats.samples, stats.evicted);
+  printf("  encoded             %8.2f bytes/sample (raw %.0f, x%.1f)\n", bytesPerSample, rawPerSample, rawPerSample / bytesPerSample);
+  printf("  buffer holds        %8.1f hours of samples\n", hours);
+  printf("  encode              %8.1f ns/sample (%.2f Msamples/s)\n", encodeNs / BENCH_SAMPLES, BENCH_SAMPLES / encodeNs * 1000.0);
+  printf("  decode              %8.1f ns/sample\n", decodeNs / read);
+
+  // Дельта-кодирование должно быть как минимум вдвое компактнее записи целиком
+  TEST_CHECK(bytesPerSample * 2 < rawPerSample);
+  TEST_CHECK(hours >= minHours);
+}
+
+int main()
+{
+  history_stats_t stats;
+  historyClear();
+  historyGetStats(&stats);
+  printf("History footprint, %u samples every %d s, %u channels\n", BENCH_SAMPLES, BENCH_PERIOD, CONFIG_HISTORY_CHANNELS);
+  printf("buffer                %8u bytes (%u blocks x %u), static\n", stats.capacity, CONFIG_HISTORY_BLOCKS, CONFIG_HISTORY_BLOCK_SIZE);
+  benchProfile("filtered readings", 0.0f, 24.0);
+  benchProfile("noisy readings (last digit jitter)", 0.05f, 12.0);
+  return 0;
+}
@@ -0,0 +1,171 @@
+#include "wateringModel.h"
+#include "hostTest.h"
+#include <stdio.h>
+#include <string.h>
+#include <random>
+
+// Воспроизведение 60 суток полива одной зоны на модели почвы для двух способов управления:
+//   - гистерезис (WATERING_SENSORS): полив включается при влажности <= moisture_min и продолжается импульсами 
+//     cycle_time через cycle_interval, пока датчик не покажет moisture_max;
+//   - модель (WATERING_MODEL): то же условие запуска, число и длительность импульсов рассчитывает wateringModel,
+//     повторный запуск - только после установления показаний (как wateringModelControl() в watering.cpp).
+// Почва: вода от насоса доходит до датчика с запаздыванием первого порядка (постоянная времени SOIL_TAU), 
+// высыхание зависит от температуры и влажности в помещении и температуры батарей, которые меняются по суткам.
+// Настройки зоны - WATERING_ZONE_DEFAULTS: 30..50 %, импульс 15 с через 5 мин, не дольше 2 ч, полив с 18:00 до 21:00
+
+#define SIM_DAYS            60
+#define SIM_CYCLE           30          // Период основного цикла, с
+#define ZONE_MOISTURE_MIN   30.0f
+#define ZONE_MOISTURE_MAX   50.0f
+#define ZONE_CYCLE_TIME     15
+#define ZONE_CYCLE_INTERVAL (5 * 60)
+#define ZONE_MAX_DURATION   (2 * 3600)
+#define ZONE_FLOW_RATE      2.0         // л/мин
+#define ZONE_HOUR_FROM      18
+#define ZONE_HOUR_TO        21
+#define SOIL_GAIN           0.08        // Фактический прирост влажности, % за секунду работы насоса
+#define SOIL_TAU            1200.0      // Запаздывание датчика, с
+
+typedef enum { CTRL_HYSTERESIS, CTRL_MODEL } ctrl_mode_t;
+
+typedef struct {
+  uint32_t pumped;          // Секунд работы насоса
+  uint32_t starts;          // Включений насоса (импульсов)
+  uint32_t episodes;        // Поливов
+  double   overshoot_sum;   // Превышение moisture_max после установления показаний, сумма по поливам
+  double   overshoot_max;
+  double   undershoot_sum;  // Недолив до moisture_max, сумма по поливам
+  uint32_t dry_time;        // Время с влажностью ниже moisture_min - 5, с
+} ctrl_result_t;
+
+// Внешние условия: суточные колебания, отопление включено с 10-х суток
+static void simInputs(uint32_t t, wmodel_inputs_t* inputs)
+{
+  float day = (float)(t % 86400) / 86400.0f;
+  float daily = sinf((day - 0.25f) * 2.0f * (float)M_PI);
+  inputs->indoor_temp = 22.0f + 2.0f * daily;
+  inputs->indoor_humidity = 45.0f - 8.0f * daily;
+  inputs->heating_temp = t > 10 * 86400 ? 50.0f + 5.0f * daily : 25.0f;
+}
+
+// Фактическая скорость высыхания, % в час
+static double soilDecay(const wmodel_inputs_t* inputs)
+{
+  double rate = 0.25 + 0.15 * (inputs->indoor_temp - 20.0) / 10.0 - 0.05 * (inputs->indoor_humidity - 50.0) / 10.0
+    + 0.10 * (inputs->heating_temp - 40.0) / 10.0;
+  return rate > 0.02 ? rate : 0.02;
+}
+
+static void simRun(ctrl_mode_t mode, uint32_t from_day, ctrl_result_t* result)
+{
+  memset(result, 0, sizeof(ctrl_result_t));
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<float> noise(-0.1f, 0.1f);
+  wmodel_t model;
+  wmodelInit(&model);
+
+  double moisture = 40.0;       // Показания датчика без шума
+  double pending = 0.0;         // Вода, еще не дошедшая до датчика, %
+  bool state = false;           // Логическое состояние нагрузки (включая паузы между импульсами)
+  uint32_t stateOn = 0;
+  uint32_t pulse = ZONE_CYCLE_TIME;
+  bool pumpPrev = false;
+  bool watch = false;           // Ждем установления показаний после полива
+  uint32_t watchUntil = 0;
+  double peak = 0.0;
+  float reading = 40.0f;
+
+  for (uint32_t t = 0; t < SIM_DAYS * 86400; t++) {
+    bool counted = t >= from_day * 86400;
+    wmodel_inputs_t inputs;
+    simInputs(t, &inputs);
+
+    // Основной цикл: показания датчика и решение
+    if (t % SIM_CYCLE == 0) {
+      reading = roundf(((float)moisture + noise(rng)) * 10.0f) / 10.0f;
+      uint32_t hour = (t % 86400) / 3600;
+      bool allowed = (hour >= ZONE_HOUR_FROM) && (hour < ZONE_HOUR_TO);
+      bool newState = allowed && (state ? reading < ZONE_MOISTURE_MAX : reading <= ZONE_MOISTURE_MIN);
+      if (state && (t - stateOn >= ZONE_MAX_DURATION)) newState = false;
+      if (mode == CTRL_MODEL) {
+        wmodelObserve(&model, t, reading, state, &inputs);
+        if (newState && !state) {
+          if (model.settling) {
+            newState = false;
+          } else {
+            pulse = wmodelPlan(&model, t, reading, ZONE_MOISTURE_MAX, ZONE_CYCLE_TIME, ZONE_CYCLE_INTERVAL);
+          };
+        } else if (newState && state && wmodelPlanDone(&model, t)) {
+          newState = false;
+        };
+        if (!newState) wmodelStop(&model, t);
+      };
+      if (newState && !state) {
+        stateOn = t;
+        if (counted) result->episodes++;
+      };
+      if (!newState && state) {
+        watch = true;
+        watchUntil = t + 3 * 3600;
+        peak = moisture;
+      };
+      state = newState;
+    };
+
+    // Импульсный режим нагрузки: pulse секунд работы, ZONE_CYCLE_INTERVAL паузы
+    bool pump = state && ((t - stateOn) % (pulse + ZONE_CYCLE_INTERVAL) < pulse);
+    if (counted && pump) result->pumped++;
+    if (counted && pump && !pumpPrev) result->starts++;
+    pumpPrev = pump;
+
+    // Почва
+    if (pump) pending += SOIL_GAIN;
+    double arrived = pending / SOIL_TAU;
+    pending -= arrived;
+    moisture += arrived - soilDecay(&inputs) / 3600.0;
+    if (counted && (moisture < ZONE_MOISTURE_MIN - 5.0)) result->dry_time++;
+
+    if (watch) {
+      if (moisture > peak) peak = moisture;
+      if (t >= watchUntil) {
+        watch = false;
+        if (counted) {
+          double over = peak > ZONE_MOISTURE_MAX ? peak - ZONE_MOISTURE_MAX : 0.0;
+          result->overshoot_sum += over;
+          if (over > result->overshoot_max) result->overshoot_max = over;
+          result->undershoot_sum += peak < ZONE_MOISTURE_MAX ? ZONE_MOISTURE_MAX - peak : 0.0;
+        };
+      };
+    };
+  };
+}
+
+static void printResult(const char* name, const ctrl_result_t* r, uint32_t days)
+{
+  printf("%-12s %9.1f %9.1f %8u %9.2f %9.2f %9.2f %9.1f\n", name,
+    r->pumped / 60.0 * ZONE_FLOW_RATE / days, (double)r->starts / days, r->episodes,
+    r->overshoot_sum / r->episodes, r->overshoot_max, r->undershoot_sum / r->episodes, r->dry_time / 3600.0);
+}
+
+int main()
+{
+  // Первые 10 суток модель обучается, сравнение - по остальным
+  const uint32_t from_day = 10;
+  ctrl_result_t hyst, model;
+  simRun(CTRL_HYSTERESIS, from_day, &hyst);
+  simRun(CTRL_MODEL, from_day, &model);
+
+  printf("Watering replay, %d days (first %u excluded), sensor lag %.0f min\n", SIM_DAYS, from_day, SOIL_TAU / 60.0);
+  printf("%-12s %9s %9s %8s %9s %9s %9s %9s\n", "controller", "l/day", "pulses/d", "waters", "over avg", "over max", "under avg", "dry, h");
+  printResult("hysteresis", &hyst, SIM_DAYS - from_day);
+  printResult("model", &model, SIM_DAYS - from_day);
+
+  // Модель должна точнее попадать в верхний порог (перелив и недолив вместе) и лить меньше воды.
+  // Время пересыхания ниже порога зависит в основном от окна полива и печатается для справки
+  TEST_CHECK((model.episodes > 0) && (hyst.episodes > 0));
+  TEST_CHECK(model.pumped < hyst.pumped);
+  TEST_CHECK(model.overshoot_sum / model.episodes < hyst.overshoot_sum / hyst.episodes);
+  TEST_CHECK((model.overshoot_sum + model.undershoot_sum) / model.episodes 
+    < (hyst.overshoot_sum + hyst.undershoot_sum) / hyst.episodes);
+  return 0;
+}
@@ -0,0 +1,53 @@
+#include "hostAlloc.h"
+#include <string.h>
+
+extern "C" {
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t count, size_t size);
+  void* __libc_realloc(void* ptr, size_t size);
+  void  __libc_free(void* ptr);
+}
+
+static host_alloc_t _hostAlloc = { 0, 0, 0 };
+
+extern "C" void* malloc(size_t size) noexcept
+{
+  _hostAlloc.allocs++;
+  _hostAlloc.bytes += size;
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) noexcept
+{
+  _hostAlloc.allocs++;
+  _hostAlloc.bytes += count * size;
+  return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) noexcept
+{
+  if (ptr) _hostAlloc.frees++;
+  if (size > 0) {
+    _hostAlloc.allocs++;
+    _hostAlloc.bytes += size;
+  };
+  return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void* ptr) noexcept
+{
+  if (ptr) _hostAlloc.frees++;
+  __libc_free(ptr);
+}
+
+void hostAllocGet(host_alloc_t* counters)
+{
+  memcpy(counters, &_hostAlloc, sizeof(host_alloc_t));
+}
+
+void hostAllocSince(const host_alloc_t* from, host_alloc_t* delta)
+{
+  delta->allocs = _hostAlloc.allocs - from->allocs;
+  delta->frees = _hostAlloc.frees - from->frees;
+  delta->bytes = _hostAlloc.bytes - from->bytes;
+}
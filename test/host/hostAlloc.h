@@ -0,0 +1,29 @@
+#ifndef __HOSTALLOC_H__
+#define __HOSTALLOC_H__
+
+// Подсчет обращений к куче на хосте: hostAlloc.cpp подменяет malloc / calloc / realloc / free (glibc)
+// и передает вызовы в __libc_*. operator new в libstdc++ вызывает malloc и тоже учитывается.
+// Счетчики общие для процесса, поэтому замеры выполняются в одном потоке
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+  uint64_t allocs;          // malloc, calloc; realloc учитывается как free + malloc
+  uint64_t frees;
+  uint64_t bytes;           // Запрошено байт
+} host_alloc_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void hostAllocGet(host_alloc_t* counters);
+// Разница счетчиков с момента from
+void hostAllocSince(const host_alloc_t* from, host_alloc_t* delta);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __HOSTALLOC_H__
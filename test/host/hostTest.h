@@ -0,0 +1,31 @@
+#ifndef __HOSTTEST_H__
+#define __HOSTTEST_H__
+
+// Минимальные проверки для тестов на хосте: при первой ошибке выводится место проверки,
+// и процесс завершается с ненулевым кодом (ctest считает тест проваленным)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define TEST_CHECK(cond) do { \
+  if (!(cond)) { \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    exit(1); \
+  }; \
+} while (0)
+
+#define TEST_NEAR(a, b, eps) do { \
+  double _a = (a), _b = (b); \
+  if (!(fabs(_a - _b) <= (eps))) { \
+    fprintf(stderr, "%s:%d: check failed: %s = %g, expected %g\n", __FILE__, __LINE__, #a, _a, _b); \
+    exit(1); \
+  }; \
+} while (0)
+
+#define TEST_RUN(test) do { \
+  test(); \
+  printf("%-40s ok\n", #test); \
+} while (0)
+
+#endif // __HOSTTEST_H__
@@ -0,0 +1,16 @@
+#ifndef __ESP_TIMER_H__
+#define __ESP_TIMER_H__
+
+// Заглушка esp_timer для сборки на хосте: монотонное время в микросекундах
+
+#include <stdint.h>
+#include <time.h>
+
+static inline int64_t esp_timer_get_time(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+#endif // __ESP_TIMER_H__
@@ -0,0 +1,128 @@
+#include "cborPayload.h"
+#include "hostTest.h"
+#include <string.h>
+
+static bool cborEquals(const cbor_payload_t* cbor, const uint8_t* expected, uint16_t len)
+{
+  return (cbor->len == len) && (memcmp(cbor->data, expected, len) == 0);
+}
+
+// Примеры из приложения A RFC 8949
+static void test_integers()
+{
+  uint8_t buffer[64];
+  cbor_payload_t cbor;
+  cborInit(&cbor, buffer, sizeof(buffer));
+  cborPutUInt(&cbor, 0);
+  cborPutUInt(&cbor, 23);
+  cborPutUInt(&cbor, 24);
+  cborPutUInt(&cbor, 1000);
+  cborPutUInt(&cbor, 1000000);
+  cborPutInt(&cbor, -1);
+  cborPutInt(&cbor, -100);
+  cborPutInt(&cbor, -1000);
+  static const uint8_t expected[] = {
+    0x00, 0x17, 0x18, 0x18, 0x19, 0x03, 0xE8, 0x1A, 0x00, 0x0F, 0x42, 0x40,
+    0x20, 0x38, 0x63, 0x39, 0x03, 0xE7
+  };
+  TEST_CHECK(cborEquals(&cbor, expected, sizeof(expected)));
+  TEST_CHECK(!cbor.overflow);
+}
+
+static void test_simple_and_arrays()
+{
+  uint8_t buffer[64];
+  cbor_payload_t cbor;
+  cborInit(&cbor, buffer, sizeof(buffer));
+  cborPutArray(&cbor, 3);
+  cborPutBool(&cbor, false);
+  cborPutBool(&cbor, true);
+  cborPutNull(&cbor);
+  cborPutArrayBegin(&cbor);
+  cborPutFixed(&cbor, 23.4f, 1, true);
+  cborPutFixed(&cbor, NAN, 1, true);
+  cborPutFixed(&cbor, 10.0f, 1, false);
+  cborPutFixed(&cbor, -1.25f, 2, true);
+  cborPutBreak(&cbor);
+  static const uint8_t expected[] = {
+    0x83, 0xF4, 0xF5, 0xF6,
+    0x9F, 0x18, 0xEA, 0xF6, 0xF6, 0x38, 0x7C, 0xFF
+  };
+  TEST_CHECK(cborEquals(&cbor, expected, sizeof(expected)));
+}
+
+static void test_overflow()
+{
+  uint8_t buffer[2];
+  cbor_payload_t cbor;
+  cborInit(&cbor, buffer, sizeof(buffer));
+  TEST_CHECK(cborPutUInt(&cbor, 1));
+  TEST_CHECK(!cborPutUInt(&cbor, 1000));
+  TEST_CHECK(cbor.overflow);
+  char dest[16];
+  TEST_CHECK(cborCobsEncode(&cbor, dest, sizeof(dest)) == 0);
+}
+
+// Обратное преобразование COBS для проверки
+static size_t cobsDecode(const char* src, size_t len, uint8_t* dest)
+{
+  size_t out = 0;
+  size_t i = 0;
+  while (i < len) {
+    uint8_t code = (uint8_t)src[i++];
+    for (uint8_t j = 1; j < code; j++) dest[out++] = (uint8_t)src[i++];
+    if ((code < 0xFF) && (i < len)) dest[out++] = 0;
+  };
+  return out;
+}
+
+static void test_cobs_roundtrip()
+{
+  const uint16_t sizes[] = { 0, 1, 253, 254, 255, 600 };
+  for (uint16_t size : sizes) {
+    uint8_t buffer[600];
+    for (uint16_t i = 0; i < size; i++) {
+      buffer[i] = (i % 7 == 3) ? 0 : (uint8_t)(i * 31 + 1);
+    };
+    if (size >= 254) {
+      // Длинный участок без нулей - блоки по 254 байта
+      memset(buffer, 0x55, 254);
+    };
+    cbor_payload_t cbor;
+    cborInit(&cbor, buffer, sizeof(buffer));
+    cbor.len = size;
+
+    char dest[700];
+    size_t len = cborCobsEncode(&cbor, dest, sizeof(dest));
+    TEST_CHECK(len > 0);
+    TEST_CHECK(strlen(dest) == len);
+    uint8_t decoded[700];
+    TEST_CHECK(cobsDecode(dest, len, decoded) == size);
+    TEST_CHECK(memcmp(decoded, buffer, size) == 0);
+  };
+}
+
+// Буфер CBOR размера CBOR_COBS_CAPACITY() всегда помещается в буфер COBS
+static void test_cobs_capacity()
+{
+  const uint16_t sizes[] = { 16, 255, 256, 512, 1024 };
+  for (uint16_t size : sizes) {
+    uint8_t buffer[1024];
+    memset(buffer, 0x11, sizeof(buffer));
+    cbor_payload_t cbor;
+    cborInit(&cbor, buffer, CBOR_COBS_CAPACITY(size));
+    cbor.len = cbor.size;
+    char dest[1024];
+    TEST_CHECK(cborCobsEncode(&cbor, dest, size) > 0);
+  };
+}
+
+int main()
+{
+  TEST_RUN(test_integers);
+  TEST_RUN(test_simple_and_arrays);
+  TEST_RUN(test_overflow);
+  TEST_RUN(test_cobs_roundtrip);
+  TEST_RUN(test_cobs_capacity);
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include "cycleProfile.h"
+#include "hostTest.h"
+
+static void test_empty()
+{
+  profile_phase_t phase;
+  profileReset(&phase);
+  TEST_CHECK(phase.count == 0);
+  TEST_CHECK(profilePercentile(&phase, 50) == 0);
+}
+
+static void test_min_max_sum()
+{
+  profile_phase_t phase;
+  profileReset(&phase);
+  profileAdd(&phase, 100);
+  profileAdd(&phase, 3);
+  profileAdd(&phase, 5000);
+  TEST_CHECK(phase.count == 3);
+  TEST_CHECK(phase.min_us == 3);
+  TEST_CHECK(phase.max_us == 5000);
+  TEST_CHECK(phase.sum_us == 5103);
+  TEST_CHECK(profilePercentile(&phase, 100) == 5000);
+}
+
+// Процентиль - верхняя граница корзины: не меньше точного значения и не больше него на 1 / CONFIG_PROFILE_SUB_BUCKETS
+static void test_percentile_error()
+{
+  profile_phase_t phase;
+  profileReset(&phase);
+  for (uint32_t us = 1; us <= 10000; us++) {
+    profileAdd(&phase, us);
+  };
+  const uint8_t percents[] = { 50, 90, 99 };
+  for (uint8_t percent : percents) {
+    uint32_t exact = 10000 * percent / 100;
+    uint32_t value = profilePercentile(&phase, percent);
+    TEST_CHECK(value >= exact);
+    TEST_CHECK(value <= exact + exact / CONFIG_PROFILE_SUB_BUCKETS);
+  };
+}
+
+static void test_long_phase_clamped()
+{
+  profile_phase_t phase;
+  profileReset(&phase);
+  profileAdd(&phase, UINT32_MAX);
+  TEST_CHECK(phase.hist[CONFIG_PROFILE_BUCKETS - 1] == 1);
+  TEST_CHECK(phase.max_us == UINT32_MAX);
+  // Процентиль ограничен верхней границей последней корзины
+  uint32_t value = profilePercentile(&phase, 50);
+  TEST_CHECK(value >= (1U << CONFIG_PROFILE_OCTAVES));
+  TEST_CHECK(value < UINT32_MAX);
+}
+
+int main()
+{
+  TEST_RUN(test_empty);
+  TEST_RUN(test_min_max_sum);
+  TEST_RUN(test_percentile_error);
+  TEST_RUN(test_long_phase_clamped);
+  return 0;
+}
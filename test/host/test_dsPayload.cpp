@@ -0,0 +1,55 @@
+#include "dsPayload.h"
+#include "hostTest.h"
+#include <string.h>
+
+static bool valueTemp(float* value) { *value = 23.456f; return true; }
+static bool valueMissing(float* value) { (void)value; return false; }
+static bool valueHumidity(float* value) { *value = -0.04f; return true; }
+
+static void test_int_and_float()
+{
+  static ds_payload_t payload;
+  dsPayloadClear(&payload);
+  TEST_CHECK(dsPayloadAddInt(&payload, "p1", -15));
+  TEST_CHECK(dsPayloadAddFloat(&payload, "p2", 3.14159f, 2));
+  TEST_CHECK(dsPayloadAddFloat(&payload, "p3", 2.5f, 0));
+  TEST_CHECK(dsPayloadAddFloat(&payload, "p4", 0.05f, 3));
+  TEST_CHECK(!dsPayloadAddFloat(&payload, "p5", NAN, 1));
+  TEST_CHECK(strcmp(payload.data, "p1=-15&p2=3.14&p3=3&p4=0.050") == 0);
+  TEST_CHECK(payload.len == strlen(payload.data));
+}
+
+static void test_build()
+{
+  static const ds_payload_field_t fields[] = {
+    { "field1", 1, valueTemp },
+    { "field2", 1, valueMissing },
+    { "field3", 1, valueHumidity },
+  };
+  static ds_payload_t payload;
+  TEST_CHECK(dsPayloadBuild(&payload, fields, 3));
+  TEST_CHECK(strcmp(payload.data, "field1=23.5&field3=0.0") == 0);
+  TEST_CHECK(!dsPayloadBuild(&payload, fields + 1, 1));
+}
+
+// Поле, которое не помещается в буфер, откатывается целиком
+static void test_overflow_rollback()
+{
+  static ds_payload_t payload;
+  dsPayloadClear(&payload);
+  uint16_t fields = 0;
+  while (dsPayloadAddInt(&payload, "key", 1234567)) fields++;
+  TEST_CHECK(fields > 0);
+  TEST_CHECK(payload.overflow);
+  TEST_CHECK(payload.len < CONFIG_DSPAYLOAD_SIZE);
+  TEST_CHECK(payload.len == strlen(payload.data));
+  TEST_CHECK(payload.data[payload.len - 1] == '7');
+}
+
+int main()
+{
+  TEST_RUN(test_int_and_float);
+  TEST_RUN(test_build);
+  TEST_RUN(test_overflow_rollback);
+  return 0;
+}
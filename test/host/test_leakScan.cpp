@@ -0,0 +1,56 @@
+#include "leakScan.h"
+#include "hostTest.h"
+
+static const int64_t debounce = 60000000;
+
+static void test_set_immediately()
+{
+  leak_scan_t scan;
+  leakScanInit(&scan);
+  uint8_t cleared;
+  TEST_CHECK(leakScanProcess(&scan, 0x07, 0x00, 0x00, 1000, debounce, &cleared) == 0);
+  TEST_CHECK(cleared == 0);
+  TEST_CHECK(leakScanProcess(&scan, 0x07, 0x05, 0x00, 2000, debounce, &cleared) == 0x05);
+  TEST_CHECK(cleared == 0);
+  // Признак уже установлен - повторно не устанавливается
+  TEST_CHECK(leakScanProcess(&scan, 0x07, 0x05, 0x05, 3000, debounce, &cleared) == 0);
+}
+
+static void test_disabled_ignored()
+{
+  leak_scan_t scan;
+  leakScanInit(&scan);
+  uint8_t cleared;
+  TEST_CHECK(leakScanProcess(&scan, 0x02, 0x07, 0x00, 1000, debounce, &cleared) == 0x02);
+  TEST_CHECK(leakScanProcess(&scan, 0x02, 0x00, 0x05, 1000 + 2 * debounce, debounce, &cleared) == 0);
+  TEST_CHECK(cleared == 0);
+}
+
+// Признак снимается только после непрерывного "сухого" интервала; новое "мокрое" чтение начинает отсчет заново
+static void test_clear_debounced()
+{
+  leak_scan_t scan;
+  leakScanInit(&scan);
+  uint8_t cleared;
+  int64_t t = 1000;
+  leakScanProcess(&scan, 0x01, 0x00, 0x01, t, debounce, &cleared);
+  TEST_CHECK(cleared == 0);
+  leakScanProcess(&scan, 0x01, 0x00, 0x01, t + debounce / 2, debounce, &cleared);
+  TEST_CHECK(cleared == 0);
+  leakScanProcess(&scan, 0x01, 0x01, 0x01, t + debounce - 1, debounce, &cleared);
+  TEST_CHECK(cleared == 0);
+  leakScanProcess(&scan, 0x01, 0x00, 0x01, t + debounce, debounce, &cleared);
+  TEST_CHECK(cleared == 0);
+  leakScanProcess(&scan, 0x01, 0x00, 0x01, t + 2 * debounce - 1, debounce, &cleared);
+  TEST_CHECK(cleared == 0);
+  leakScanProcess(&scan, 0x01, 0x00, 0x01, t + 2 * debounce, debounce, &cleared);
+  TEST_CHECK(cleared == 0x01);
+}
+
+int main()
+{
+  TEST_RUN(test_set_immediately);
+  TEST_RUN(test_disabled_ignored);
+  TEST_RUN(test_clear_debounced);
+  return 0;
+}
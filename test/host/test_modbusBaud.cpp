@@ -0,0 +1,207 @@
+#include "modbusBaud.h"
+#include "hostTest.h"
+
+static void test_codes()
+{
+  TEST_CHECK(modbusBaudCode(2400) == 0);
+  TEST_CHECK(modbusBaudCode(9600) == 2);
+  TEST_CHECK(modbusBaudCode(115200) == MODBUS_BAUDS_COUNT - 1);
+  TEST_CHECK(modbusBaudCode(14400) == -1);
+  for (uint8_t i = 0; i < MODBUS_BAUDS_COUNT; i++) {
+    TEST_CHECK(modbusBaudCode(modbusBauds[i]) == i);
+  };
+}
+
+static void test_candidates_order()
+{
+  uint32_t candidates[MODBUS_BAUD_CANDIDATES_MAX];
+  uint8_t count = modbusBaudCandidates(38400, 19200, 9600, candidates);
+  TEST_CHECK(count == MODBUS_BAUDS_COUNT);
+  TEST_CHECK(candidates[0] == 38400);
+  TEST_CHECK(candidates[1] == 19200);
+  TEST_CHECK(candidates[2] == 9600);
+  TEST_CHECK(candidates[3] == 2400);
+  TEST_CHECK(candidates[4] == 4800);
+  TEST_CHECK(candidates[5] == 57600);
+  TEST_CHECK(candidates[6] == 115200);
+}
+
+// Повторы и неподдерживаемые скорости (например, испорченное значение в NVS) пропускаются
+static void test_candidates_dedup()
+{
+  uint32_t candidates[MODBUS_BAUD_CANDIDATES_MAX];
+  uint8_t count = modbusBaudCandidates(12345, 9600, 9600, candidates);
+  TEST_CHECK(count == MODBUS_BAUDS_COUNT);
+  TEST_CHECK(candidates[0] == 9600);
+  for (uint8_t i = 0; i < count; i++) {
+    for (uint8_t j = i + 1; j < count; j++) {
+      TEST_CHECK(candidates[i] != candidates[j]);
+    };
+  };
+}
+
+// Модель шины: датчик отвечает, если UART работает на его скорости; код скорости принимают только датчики,
+// которые слышат мастера. Часть датчиков применяет новую скорость только после перезапуска питания (pending)
+#define SIM_SENSORS 3
+
+typedef struct {
+  uint32_t baud;
+  uint32_t pending;                 // Скорость после перезапуска питания (0 - без изменений)
+  bool     delayed;                 // Новая скорость применяется только после перезапуска питания
+  bool     dead;                    // Датчик не отвечает после смены скорости
+} sim_sensor_t;
+
+static sim_sensor_t _sensors[SIM_SENSORS];
+static uint32_t _uart = 0;
+static uint32_t _probes = 0;
+static uint32_t _writes = 0;
+
+static void simInit(uint32_t baud)
+{
+  for (uint8_t i = 0; i < SIM_SENSORS; i++) {
+    _sensors[i] = { baud, 0, false, false };
+  };
+  _uart = 0;
+  _probes = 0;
+  _writes = 0;
+}
+
+static bool simProbe(uint32_t baud)
+{
+  _uart = baud;
+  _probes++;
+  for (uint8_t i = 0; i < SIM_SENSORS; i++) {
+    if (_sensors[i].baud != baud) return false;
+  };
+  return true;
+}
+
+static bool simWrite(uint32_t baud)
+{
+  bool ret = true;
+  _writes++;
+  for (uint8_t i = 0; i < SIM_SENSORS; i++) {
+    sim_sensor_t* sensor = &_sensors[i];
+    if (sensor->baud != _uart) {
+      ret = false;
+    } else if (sensor->delayed) {
+      sensor->pending = baud;
+    } else {
+      sensor->baud = sensor->dead ? 1 : baud;
+    };
+  };
+  return ret;
+}
+
+static void simUart(uint32_t baud)
+{
+  _uart = baud;
+}
+
+static void simPowerCycle()
+{
+  for (uint8_t i = 0; i < SIM_SENSORS; i++) {
+    if (_sensors[i].pending) _sensors[i].baud = _sensors[i].pending;
+    _sensors[i].pending = 0;
+  };
+}
+
+static const modbus_baud_bus_t _bus = { simProbe, simWrite, simUart };
+
+// Датчики уже на целевой скорости: одна проверка, без записи
+static void test_setup_kept()
+{
+  uint32_t detected, current;
+  simInit(19200);
+  TEST_CHECK(modbusBaudSetupBus(&_bus, 19200, 19200, 9600, &detected, &current) == MODBUS_BAUD_KEPT);
+  TEST_CHECK(detected == 19200);
+  TEST_CHECK(current == 19200);
+  TEST_CHECK(_probes == 1);
+  TEST_CHECK(_writes == 0);
+}
+
+// Новые датчики на заводской скорости переводятся на целевую
+static void test_setup_switched()
+{
+  uint32_t detected, current;
+  simInit(9600);
+  TEST_CHECK(modbusBaudSetupBus(&_bus, 9600, 19200, 9600, &detected, &current) == MODBUS_BAUD_SWITCHED);
+  TEST_CHECK(detected == 9600);
+  TEST_CHECK(current == 19200);
+  TEST_CHECK(_uart == 19200);
+  for (uint8_t i = 0; i < SIM_SENSORS; i++) {
+    TEST_CHECK(_sensors[i].baud == 19200);
+  };
+}
+
+// Испорченная скорость в NVS: датчики находятся полным перебором в порядке modbusBaudCandidates()
+static void test_setup_scan()
+{
+  uint32_t detected, current;
+  simInit(38400);
+  TEST_CHECK(modbusBaudSetupBus(&_bus, 12345, 38400, 9600, &detected, &current) == MODBUS_BAUD_KEPT);
+  TEST_CHECK(detected == 38400);
+  TEST_CHECK(_probes == 1);
+
+  simInit(57600);
+  TEST_CHECK(modbusBaudSetupBus(&_bus, 12345, 19200, 9600, &detected, &current) == MODBUS_BAUD_SWITCHED);
+  TEST_CHECK(detected == 57600);
+  // 19200, 9600, 2400, 4800, 38400, 57600 и проверка после переключения
+  TEST_CHECK(_probes == 7);
+}
+
+// Один датчик применяет скорость только после перезапуска питания: остальные возвращаются на прежнюю скорость
+// записью на целевой скорости, а отложенная скорость отстающего датчика перезаписывается прежней
+static void test_setup_rollback()
+{
+  uint32_t detected, current;
+  simInit(9600);
+  _sensors[1].delayed = true;
+  TEST_CHECK(modbusBaudSetupBus(&_bus, 9600, 19200, 9600, &detected, &current) == MODBUS_BAUD_ROLLED_BACK);
+  TEST_CHECK(detected == 9600);
+  TEST_CHECK(current == 9600);
+  TEST_CHECK(_uart == 9600);
+  for (uint8_t i = 0; i < SIM_SENSORS; i++) {
+    TEST_CHECK(_sensors[i].baud == 9600);
+  };
+  // После перезапуска питания вся шина по-прежнему на 9600
+  simPowerCycle();
+  TEST_CHECK(simProbe(9600));
+}
+
+// Датчик перестал отвечать после смены скорости: возврат не помогает
+static void test_setup_lost()
+{
+  uint32_t detected, current;
+  simInit(9600);
+  _sensors[2].dead = true;
+  TEST_CHECK(modbusBaudSetupBus(&_bus, 9600, 19200, 9600, &detected, &current) == MODBUS_BAUD_LOST);
+  TEST_CHECK(current == 9600);
+}
+
+// Датчики не отвечают ни на одной скорости: UART остается на заводской скорости, запись не выполняется
+static void test_setup_not_found()
+{
+  uint32_t detected, current;
+  simInit(1);
+  TEST_CHECK(modbusBaudSetupBus(&_bus, 9600, 19200, 9600, &detected, &current) == MODBUS_BAUD_NOT_FOUND);
+  TEST_CHECK(detected == 0);
+  TEST_CHECK(current == 9600);
+  TEST_CHECK(_uart == 9600);
+  TEST_CHECK(_probes == MODBUS_BAUDS_COUNT);
+  TEST_CHECK(_writes == 0);
+}
+
+int main()
+{
+  TEST_RUN(test_codes);
+  TEST_RUN(test_candidates_order);
+  TEST_RUN(test_candidates_dedup);
+  TEST_RUN(test_setup_kept);
+  TEST_RUN(test_setup_switched);
+  TEST_RUN(test_setup_scan);
+  TEST_RUN(test_setup_rollback);
+  TEST_RUN(test_setup_lost);
+  TEST_RUN(test_setup_not_found);
+  return 0;
+}
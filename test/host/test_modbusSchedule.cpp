@@ -0,0 +1,161 @@
+#include "modbusSchedule.h"
+#include "hostTest.h"
+#include <string.h>
+
+// Моделируемая линия: 24 датчика, опрос каждые 30 с в течение двух часов. Ответ исправного датчика занимает 
+// SIM_REPLY_US, неответ - таймаут мастера. Датчики 3 и 7 не отвечают никогда (7 - в зоне, где идёт полив), 
+// 11 не отвечает на каждый третий запрос, 15 не отвечает первые 10 минут
+
+#define SIM_SLAVES          24
+#define SIM_CYCLE_US        30000000LL
+#define SIM_CYCLES          240
+#define SIM_REPLY_US        25000
+#define SIM_TIMEOUT_US      150000
+#define SIM_RETRY_MIN       10
+#define SIM_RETRY_MAX       600
+
+static bool simReply(uint8_t slave, uint32_t request, int64_t now)
+{
+  switch (slave) {
+    case 3:
+    case 7:  return false;
+    case 11: return (request % 3) != 2;
+    case 15: return now >= 600000000LL;
+    default: return true;
+  };
+}
+
+typedef struct {
+  modbus_bus_t bus;
+  modbus_slave_t slaves[SIM_SLAVES];
+  int64_t polled[SIM_SLAVES][SIM_CYCLES];
+  uint32_t polls[SIM_SLAVES];
+  uint64_t busy;
+} sim_t;
+
+static void simRun(sim_t* sim, uint32_t active)
+{
+  memset(sim, 0, sizeof(sim_t));
+  modbusBusInit(&sim->bus, SIM_RETRY_MIN, SIM_RETRY_MAX);
+  uint32_t present = (1UL << SIM_SLAVES) - 1;
+  for (uint32_t cycle = 0; cycle < SIM_CYCLES; cycle++) {
+    int64_t now = 1 + cycle * SIM_CYCLE_US;
+    uint8_t order[SIM_SLAVES];
+    uint8_t count = modbusScheduleOrder(&sim->bus, sim->slaves, SIM_SLAVES, present, active, now, order);
+    // Сначала все активные зоны
+    bool passive = false;
+    for (uint8_t n = 0; n < count; n++) {
+      bool isActive = (active >> order[n]) & 1;
+      TEST_CHECK(!(passive && isActive));
+      passive = !isActive;
+    };
+    for (uint8_t n = 0; n < count; n++) {
+      uint8_t i = order[n];
+      bool ok = simReply(i, sim->slaves[i].requests, now);
+      int64_t finished = now + (ok ? SIM_REPLY_US : SIM_TIMEOUT_US);
+      modbusSlaveDone(&sim->bus, &sim->slaves[i], ok, now, finished);
+      sim->busy += finished - now;
+      sim->polled[i][sim->polls[i]++] = now;
+      now = finished;
+    };
+  };
+}
+
+static void test_active_always_polled()
+{
+  static sim_t sim;
+  simRun(&sim, (1UL << 0) | (1UL << 5) | (1UL << 7));
+  TEST_CHECK(sim.polls[0] == SIM_CYCLES);
+  TEST_CHECK(sim.polls[5] == SIM_CYCLES);
+  // Пауза после ошибок на активные зоны не действует
+  TEST_CHECK(sim.polls[7] == SIM_CYCLES);
+  TEST_CHECK(sim.slaves[7].errors == SIM_CYCLES);
+  TEST_CHECK(sim.slaves[7].skipped == 0);
+}
+
+// Пауза удваивается: 10, 20, 40, ... 600 с и отсчитывается от конца опроса; опрос возможен только в цикле, 
+// поэтому интервал округляется вверх до цикла (плюс сдвиг внутри цикла из-за опроса других датчиков)
+static void test_backoff()
+{
+  static sim_t sim;
+  simRun(&sim, 0);
+  const modbus_slave_t* dead = &sim.slaves[3];
+  TEST_CHECK(dead->requests == sim.polls[3]);
+  TEST_CHECK(dead->requests + dead->skipped == SIM_CYCLES);
+  TEST_CHECK(dead->failures == dead->requests);
+  for (uint32_t n = 1; n < sim.polls[3]; n++) {
+    int64_t gap = sim.polled[3][n] - sim.polled[3][n - 1];
+    uint32_t pause = SIM_RETRY_MIN << (n - 1);
+    if ((n > 16) || (pause > SIM_RETRY_MAX)) pause = SIM_RETRY_MAX;
+    TEST_CHECK(gap >= (int64_t)pause * 1000000LL);
+    TEST_CHECK(gap < (int64_t)pause * 1000000LL + SIM_CYCLE_US + SIM_SLAVES * SIM_TIMEOUT_US);
+  };
+  TEST_CHECK(dead->requests < SIM_CYCLES / 10);
+}
+
+// После восстановления датчик снова опрашивается каждый цикл
+static void test_recovery()
+{
+  static sim_t sim;
+  simRun(&sim, 0);
+  const modbus_slave_t* slave = &sim.slaves[15];
+  TEST_CHECK(slave->failures == 0);
+  TEST_CHECK(slave->retry_at == 0);
+  uint32_t last = sim.polls[15] - 1;
+  for (uint32_t n = last; n > last - 100; n--) {
+    TEST_CHECK(sim.polled[15][n] - sim.polled[15][n - 1] < SIM_CYCLE_US + SIM_SLAVES * SIM_TIMEOUT_US);
+  };
+  // Одиночные ошибки дают короткую паузу, большую часть циклов датчик опрашивается
+  TEST_CHECK(sim.slaves[11].failures <= 1);
+  TEST_CHECK(sim.polls[11] > SIM_CYCLES / 2);
+}
+
+static void test_statistics()
+{
+  static sim_t sim;
+  simRun(&sim, 1UL << 7);
+  uint64_t busy = 0;
+  for (uint8_t i = 0; i < SIM_SLAVES; i++) {
+    const modbus_slave_t* slave = &sim.slaves[i];
+    busy += slave->latency_sum;
+    if (slave->requests > 0) {
+      TEST_CHECK(slave->latency_max == (slave->errors > 0 ? SIM_TIMEOUT_US : SIM_REPLY_US));
+    };
+  };
+  TEST_CHECK(busy == sim.busy);
+  TEST_CHECK(sim.bus.busy_time == sim.busy);
+  int64_t end = 1 + SIM_CYCLES * SIM_CYCLE_US;
+  TEST_NEAR(modbusBusUtilization(&sim.bus, end), 100.0 * (double)sim.busy / (double)(end - 1), 1e-3);
+
+  // Без пауз после ошибок неотвечающие датчики занимали бы шину на время таймаута каждый цикл
+  uint64_t naive = (uint64_t)SIM_CYCLES * ((SIM_SLAVES - 2) * SIM_REPLY_US + 2 * SIM_TIMEOUT_US);
+  printf("bus utilization %.3f%% (busy %.1f s, polling every slave each cycle %.1f s)\n", 
+    modbusBusUtilization(&sim.bus, end), (double)sim.busy / 1e6, (double)naive / 1e6);
+  TEST_CHECK(sim.busy < naive);
+
+  modbusBusWindowReset(&sim.bus, end);
+  TEST_CHECK(sim.bus.busy_time == 0);
+  TEST_CHECK(modbusBusUtilization(&sim.bus, end) == 0.0);
+}
+
+static void test_absent_skipped()
+{
+  modbus_bus_t bus;
+  modbusBusInit(&bus, SIM_RETRY_MIN, SIM_RETRY_MAX);
+  modbus_slave_t slaves[4];
+  memset(slaves, 0, sizeof(slaves));
+  uint8_t order[4];
+  TEST_CHECK(modbusScheduleOrder(&bus, slaves, 4, 0x0A, 0x08, 1000, order) == 2);
+  TEST_CHECK((order[0] == 3) && (order[1] == 1));
+  TEST_CHECK(bus.window_start == 1000);
+}
+
+int main()
+{
+  TEST_RUN(test_active_always_polled);
+  TEST_RUN(test_backoff);
+  TEST_RUN(test_recovery);
+  TEST_RUN(test_statistics);
+  TEST_RUN(test_absent_skipped);
+  return 0;
+}
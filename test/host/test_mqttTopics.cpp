@@ -0,0 +1,114 @@
+#include "mqttTopics.h"
+#include "hostTest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t _created = 0;
+
+// Как mqttGetTopicDevice1(): префикс брокера / устройство / топик
+static char* topicCreate(bool primary, bool local, const char* topic)
+{
+  _created++;
+  if (strcmp(topic, "missing") == 0) return nullptr;
+  size_t size = strlen(topic) + 32;
+  char* buf = (char*)malloc(size);
+  snprintf(buf, size, "%s/%s/device/%s", primary ? "home" : "backup", local ? "local" : "public", topic);
+  return buf;
+}
+
+static void test_build_once()
+{
+  static mqtt_topics_t table;
+  const char* names[] = { "water_leak", "water_level", "snapshot" };
+  _created = 0;
+  TEST_CHECK(mqttTopicsBuild(&table, true, names, 3, topicCreate));
+  TEST_CHECK(_created == 3);
+  TEST_CHECK(strcmp(table.topics[0], "home/public/device/water_leak") == 0);
+  TEST_CHECK(strcmp(table.topics[2], "home/public/device/snapshot") == 0);
+  TEST_CHECK(table.topics[3] == nullptr);
+  TEST_CHECK(table.used == strlen(table.topics[0]) + strlen(table.topics[1]) + strlen(table.topics[2]) + 3);
+  // Повторный выбор брокера топики не пересобирает, указатели не меняются
+  char* leak = table.topics[0];
+  TEST_CHECK(mqttTopicsBuild(&table, true, names, 3, topicCreate));
+  TEST_CHECK(_created == 3);
+  TEST_CHECK(table.topics[0] == leak);
+}
+
+static void test_secondary()
+{
+  static mqtt_topics_t table;
+  const char* names[] = { "water_leak" };
+  TEST_CHECK(mqttTopicsBuild(&table, false, names, 1, topicCreate));
+  TEST_CHECK(strcmp(table.topics[0], "backup/public/device/water_leak") == 0);
+}
+
+// Не созданный или не поместившийся топик недоступен, остальные работают
+static void test_failures()
+{
+  static mqtt_topics_t table;
+  const char* names[] = { "missing", "water_leak" };
+  TEST_CHECK(!mqttTopicsBuild(&table, true, names, 2, topicCreate));
+  TEST_CHECK(table.topics[0] == nullptr);
+  TEST_CHECK(strcmp(table.topics[1], "home/public/device/water_leak") == 0);
+  TEST_CHECK(!table.ready);
+
+  static mqtt_topics_t small;
+  static char longName[CONFIG_MQTT_TOPICS_ARENA_SIZE / 2];
+  memset(longName, 'x', sizeof(longName) - 1);
+  const char* many[] = { longName, longName, "water_leak" };
+  TEST_CHECK(!mqttTopicsBuild(&small, true, many, 3, topicCreate));
+  TEST_CHECK(small.topics[0] != nullptr);
+  TEST_CHECK(small.topics[1] == nullptr);
+  TEST_CHECK(strcmp(small.topics[2], "home/public/device/water_leak") == 0);
+  TEST_CHECK(small.used <= CONFIG_MQTT_TOPICS_ARENA_SIZE);
+}
+
+// Временная ошибка выделения памяти при подключении: таблица не готова, при следующем выборе брокера
+// досоздается только недостающий топик, уже собранные остаются на месте
+static uint32_t _failures = 0;
+
+static char* topicCreateFlaky(bool primary, bool local, const char* topic)
+{
+  if ((_failures > 0) && (strcmp(topic, "water_level") == 0)) {
+    _failures--;
+    _created++;
+    return nullptr;
+  };
+  return topicCreate(primary, local, topic);
+}
+
+static void test_retry_after_failure()
+{
+  static mqtt_topics_t table;
+  const char* names[] = { "water_leak", "water_level", "snapshot" };
+  _created = 0;
+  _failures = 1;
+  TEST_CHECK(!mqttTopicsBuild(&table, true, names, 3, topicCreateFlaky));
+  TEST_CHECK(!table.ready);
+  TEST_CHECK(table.topics[1] == nullptr);
+  char* leak = table.topics[0];
+  char* snapshot = table.topics[2];
+  uint16_t used = table.used;
+
+  TEST_CHECK(mqttTopicsBuild(&table, true, names, 3, topicCreateFlaky));
+  TEST_CHECK(table.ready);
+  TEST_CHECK(_created == 4);
+  TEST_CHECK(table.topics[0] == leak);
+  TEST_CHECK(table.topics[2] == snapshot);
+  TEST_CHECK(strcmp(table.topics[1], "home/public/device/water_level") == 0);
+  TEST_CHECK(table.used == used + strlen(table.topics[1]) + 1);
+
+  // Готовая таблица больше не пересобирается
+  TEST_CHECK(mqttTopicsBuild(&table, true, names, 3, topicCreateFlaky));
+  TEST_CHECK(_created == 4);
+}
+
+int main()
+{
+  TEST_RUN(test_build_once);
+  TEST_RUN(test_secondary);
+  TEST_RUN(test_failures);
+  TEST_RUN(test_retry_after_failure);
+  return 0;
+}
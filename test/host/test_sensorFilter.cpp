@@ -0,0 +1,111 @@
+#include "sensorFilter.h"
+#include "hostTest.h"
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+// Медиана и среднее последних size значений, посчитанные напрямую
+static float referenceMedian(const std::vector<float>& values, size_t size)
+{
+  size_t n = std::min(values.size(), size);
+  std::vector<float> window(values.end() - n, values.end());
+  std::sort(window.begin(), window.end());
+  if (n & 1) return window[n / 2];
+  return (window[n / 2 - 1] + window[n / 2]) / 2;
+}
+
+static double referenceMean(const std::vector<float>& values, size_t size)
+{
+  size_t n = std::min(values.size(), size);
+  double sum = 0;
+  for (size_t i = values.size() - n; i < values.size(); i++) sum += values[i];
+  return sum / n;
+}
+
+static void test_median_matches_reference()
+{
+  const uint16_t sizes[] = { 3, 5, 8, 33, 255, CONFIG_SFILTER_MAX_SIZE };
+  for (uint16_t size : sizes) {
+    sfilter_t filter;
+    memset(&filter, 0, sizeof(filter));
+    TEST_CHECK(sfilterInit(&filter, SFILTER_MEDIAN, size));
+    // Четное окно увеличивается до нечетного
+    TEST_CHECK(filter.size == (size | 1));
+
+    std::vector<float> values;
+    srand(size);
+    for (uint16_t i = 0; i < 4 * filter.size + 17; i++) {
+      // Повторяющиеся значения, выбросы и плавный тренд
+      float value = (float)(rand() % 50) / 2.0f + (float)i / 100.0f;
+      if (rand() % 20 == 0) value = (rand() & 1) ? 1000.0f : -1000.0f;
+      values.push_back(value);
+      TEST_NEAR(sfilterAdd(&filter, value), referenceMedian(values, filter.size), 1e-4);
+    };
+    sfilterFree(&filter);
+    TEST_CHECK(filter.data == nullptr);
+  };
+}
+
+static void test_mean_matches_reference()
+{
+  sfilter_t filter;
+  memset(&filter, 0, sizeof(filter));
+  TEST_CHECK(sfilterInit(&filter, SFILTER_MEAN, 10));
+  std::vector<float> values;
+  srand(1);
+  for (uint16_t i = 0; i < 95; i++) {
+    float value = (float)(rand() % 1000) / 10.0f;
+    values.push_back(value);
+    TEST_NEAR(sfilterAdd(&filter, value), referenceMean(values, 10), 1e-3);
+  };
+  sfilterFree(&filter);
+}
+
+static void test_ema()
+{
+  sfilter_t filter;
+  memset(&filter, 0, sizeof(filter));
+  TEST_CHECK(sfilterInit(&filter, SFILTER_EMA, 3));
+  TEST_NEAR(sfilterAdd(&filter, 10.0f), 10.0, 1e-6);
+  // Коэффициент 2 / (3 + 1) = 0.5
+  TEST_NEAR(sfilterAdd(&filter, 20.0f), 15.0, 1e-6);
+  TEST_NEAR(sfilterAdd(&filter, 15.0f), 15.0, 1e-6);
+  sfilterFree(&filter);
+}
+
+static void test_nan_skipped()
+{
+  sfilter_t filter;
+  memset(&filter, 0, sizeof(filter));
+  TEST_CHECK(sfilterInit(&filter, SFILTER_MEDIAN, 3));
+  sfilterAdd(&filter, 1.0f);
+  sfilterAdd(&filter, 2.0f);
+  TEST_CHECK(isnan(sfilterAdd(&filter, NAN)));
+  TEST_CHECK(filter.count == 2);
+  TEST_NEAR(sfilterAdd(&filter, 3.0f), 2.0, 1e-6);
+  sfilterFree(&filter);
+}
+
+static void test_reset_and_none()
+{
+  sfilter_t filter;
+  memset(&filter, 0, sizeof(filter));
+  TEST_CHECK(sfilterInit(&filter, SFILTER_NONE, 10));
+  TEST_NEAR(sfilterAdd(&filter, 42.0f), 42.0, 0);
+
+  TEST_CHECK(sfilterInit(&filter, SFILTER_MEDIAN, 5));
+  for (uint8_t i = 0; i < 5; i++) sfilterAdd(&filter, 100.0f);
+  sfilterReset(&filter);
+  TEST_NEAR(sfilterAdd(&filter, 7.0f), 7.0, 0);
+  sfilterFree(&filter);
+}
+
+int main()
+{
+  TEST_RUN(test_median_matches_reference);
+  TEST_RUN(test_mean_matches_reference);
+  TEST_RUN(test_ema);
+  TEST_RUN(test_nan_skipped);
+  TEST_RUN(test_reset_and_none);
+  return 0;
+}
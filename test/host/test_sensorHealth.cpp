@@ -0,0 +1,92 @@
+#include "sensorHealth.h"
+#include "hostTest.h"
+
+static const shealth_limits_t limits = { 0.0, 100.0, 20.0, 3600, 600 };
+
+static void test_healthy_readings()
+{
+  shealth_t health;
+  shealthInit(&health, &limits, 0);
+  for (uint32_t t = 10; t <= 600; t += 10) {
+    shealthObserve(&health, t, true, 40.0f + (float)(t % 30) / 10.0f);
+    TEST_CHECK(!shealthUpdate(&health, t));
+  };
+  TEST_CHECK(health.healthy);
+  TEST_CHECK(health.score == 100);
+  TEST_CHECK(health.flags == 0);
+}
+
+// Одиночный сбой не переключает состояние, серия ошибок - переключает, восстановление - с гистерезисом
+static void test_errors_hysteresis()
+{
+  shealth_t health;
+  shealthInit(&health, &limits, 0);
+  shealthObserve(&health, 10, false, NAN);
+  TEST_CHECK(!shealthUpdate(&health, 10));
+  TEST_CHECK(health.healthy);
+
+  uint32_t t = 20;
+  while (health.healthy) {
+    shealthObserve(&health, t, true, 150.0f);
+    shealthUpdate(&health, t);
+    t += 10;
+    TEST_CHECK(t < 1000);
+  };
+  TEST_CHECK(health.score < CONFIG_SHEALTH_SCORE_BAD);
+  TEST_CHECK(health.flags & SHEALTH_ERRORS);
+
+  uint32_t recovered = 0;
+  while (!health.healthy) {
+    shealthObserve(&health, t, true, 40.0f);
+    shealthUpdate(&health, t);
+    if (health.score >= CONFIG_SHEALTH_SCORE_BAD) recovered++;
+    t += 10;
+    TEST_CHECK(t < 5000);
+  };
+  // Между порогами сенсор остается неисправным
+  TEST_CHECK(recovered > 1);
+  TEST_CHECK(health.score >= CONFIG_SHEALTH_SCORE_GOOD);
+}
+
+static void test_stuck_and_stale()
+{
+  shealth_t health;
+  shealthInit(&health, &limits, 0);
+  for (uint32_t t = 60; t <= 3600 + 120; t += 60) {
+    shealthObserve(&health, t, true, 50.0f);
+    shealthUpdate(&health, t);
+  };
+  TEST_CHECK(health.flags & SHEALTH_STUCK);
+  TEST_CHECK(!health.healthy);
+
+  shealthInit(&health, &limits, 0);
+  shealthObserve(&health, 10, true, 50.0f);
+  TEST_CHECK(!shealthUpdate(&health, 600));
+  TEST_CHECK(shealthUpdate(&health, 611));
+  TEST_CHECK(health.flags & SHEALTH_STALE);
+  TEST_CHECK(health.score == 0);
+}
+
+static void test_jumps()
+{
+  shealth_t health;
+  shealthInit(&health, &limits, 0);
+  uint32_t t = 0;
+  for (uint8_t i = 0; i < 40; i++) {
+    shealthObserve(&health, t, true, (i & 1) ? 10.0f : 90.0f);
+    shealthUpdate(&health, t);
+    t += 10;
+  };
+  TEST_CHECK(health.jumps == 39);
+  TEST_CHECK(health.flags & SHEALTH_JUMPS);
+  TEST_CHECK(!health.healthy);
+}
+
+int main()
+{
+  TEST_RUN(test_healthy_readings);
+  TEST_RUN(test_errors_hysteresis);
+  TEST_RUN(test_stuck_and_stale);
+  TEST_RUN(test_jumps);
+  return 0;
+}
@@ -0,0 +1,110 @@
+#include "sensorHistory.h"
+#include "hostTest.h"
+#include <string.h>
+
+static history_sample_t makeSample(uint32_t time, uint32_t i)
+{
+  history_sample_t sample;
+  sample.time = time;
+  sample.values[0] = historyEncodeValue(40.0f + (float)(i % 20) / 10.0f);
+  sample.values[1] = historyEncodeValue(22.5f);
+  sample.values[2] = historyEncodeValue(-5.0f + (float)(i % 3));
+  sample.values[3] = (i % 10 == 0) ? CONFIG_HISTORY_NO_VALUE : historyEncodeValue(55.0f);
+  sample.values[4] = historyEncodeValue(60.0f - (float)i / 100.0f);
+  sample.pump = (i % 50) < 5;
+  return sample;
+}
+
+static bool sampleEquals(const history_sample_t* a, const history_sample_t* b)
+{
+  if ((a->time != b->time) || (a->pump != b->pump)) return false;
+  return memcmp(a->values, b->values, sizeof(a->values)) == 0;
+}
+
+static void test_encode_value()
+{
+  TEST_CHECK(historyEncodeValue(NAN) == CONFIG_HISTORY_NO_VALUE);
+  TEST_CHECK(isnan(historyDecodeValue(CONFIG_HISTORY_NO_VALUE)));
+  TEST_CHECK(historyEncodeValue(12.34f) == 123);
+  TEST_CHECK(historyEncodeValue(-1e9f) == CONFIG_HISTORY_NO_VALUE + 1);
+  TEST_CHECK(historyEncodeValue(1e9f) == INT16_MAX);
+  TEST_NEAR(historyDecodeValue(historyEncodeValue(-7.5f)), -7.5, 1e-6);
+}
+
+static void test_roundtrip()
+{
+  historyClear();
+  const uint32_t count = 500;
+  for (uint32_t i = 0; i < count; i++) {
+    history_sample_t sample = makeSample(1000 + i * 60, i);
+    TEST_CHECK(historyAdd(&sample));
+  };
+  history_stats_t stats;
+  historyGetStats(&stats);
+  TEST_CHECK(stats.samples == count);
+  TEST_CHECK(stats.evicted == 0);
+  // Приращения намного короче ключевой записи
+  TEST_CHECK(stats.bytes < count * (1 + 4 + 2 * CONFIG_HISTORY_CHANNELS) / 2);
+
+  history_cursor_t cursor;
+  historyCursorInit(&cursor);
+  history_sample_t sample;
+  uint32_t i = 0;
+  while (historyCursorNext(&cursor, &sample)) {
+    history_sample_t expected = makeSample(1000 + i * 60, i);
+    TEST_CHECK(sampleEquals(&sample, &expected));
+    i++;
+  };
+  TEST_CHECK(i == count);
+}
+
+static void test_time_backwards_rejected()
+{
+  historyClear();
+  history_sample_t sample = makeSample(1000, 0);
+  TEST_CHECK(historyAdd(&sample));
+  sample.time = 999;
+  TEST_CHECK(!historyAdd(&sample));
+}
+
+// При заполнении вытесняются самые старые блоки, оставшиеся записи читаются подряд без пропусков
+static void test_eviction()
+{
+  historyClear();
+  uint32_t i = 0;
+  history_stats_t stats;
+  do {
+    history_sample_t sample = makeSample(i * 60, i);
+    TEST_CHECK(historyAdd(&sample));
+    historyGetStats(&stats);
+    i++;
+  } while (stats.evicted == 0);
+  for (uint32_t j = 0; j < 1000; j++, i++) {
+    history_sample_t sample = makeSample(i * 60, i);
+    TEST_CHECK(historyAdd(&sample));
+  };
+  historyGetStats(&stats);
+  TEST_CHECK(stats.samples + stats.evicted == i);
+  TEST_CHECK(stats.bytes <= stats.capacity);
+
+  history_cursor_t cursor;
+  historyCursorInit(&cursor);
+  history_sample_t sample;
+  uint32_t read = 0;
+  uint32_t first = stats.evicted;
+  while (historyCursorNext(&cursor, &sample)) {
+    history_sample_t expected = makeSample((first + read) * 60, first + read);
+    TEST_CHECK(sampleEquals(&sample, &expected));
+    read++;
+  };
+  TEST_CHECK(read == stats.samples);
+}
+
+int main()
+{
+  TEST_RUN(test_encode_value);
+  TEST_RUN(test_roundtrip);
+  TEST_RUN(test_time_backwards_rejected);
+  TEST_RUN(test_eviction);
+  return 0;
+}
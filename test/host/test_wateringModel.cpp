@@ -0,0 +1,93 @@
+#include "wateringModel.h"
+#include "hostTest.h"
+
+static const wmodel_inputs_t inputs = { 24.0, 40.0, 55.0 };
+
+static void test_defaults()
+{
+  wmodel_t model;
+  wmodelInit(&model);
+  TEST_NEAR(model.gain, CONFIG_WMODEL_GAIN_DEFAULT, 1e-6);
+  wmodel_inputs_t none = { NAN, NAN, NAN };
+  TEST_NEAR(wmodelDecayRate(&model, &none), CONFIG_WMODEL_DECAY_DEFAULT, 1e-6);
+  TEST_CHECK(wmodelPlanDone(&model, 0));
+}
+
+// Наименьшее число импульсов не длиннее max_pulse, время работы делится поровну
+static void test_plan()
+{
+  wmodel_t model;
+  wmodelInit(&model);
+  // 10% / 0.05 = 200 с работы насоса
+  TEST_CHECK(wmodelPlan(&model, 1000, 30.0f, 40.0f, 60, 300) == 50);
+  TEST_CHECK(model.plan_count == 4);
+  TEST_CHECK(model.plan_interval == 300);
+  TEST_CHECK(!wmodelPlanDone(&model, 1000 + 3 * 350 + 49));
+  TEST_CHECK(wmodelPlanDone(&model, 1000 + 3 * 350 + 50));
+
+  TEST_CHECK(wmodelPlan(&model, 0, 30.0f, 40.0f, 0, 0) == 200);
+  TEST_CHECK(model.plan_count == 1);
+
+  // Влажность уже выше цели - минимальный импульс
+  TEST_CHECK(wmodelPlan(&model, 0, 50.0f, 40.0f, 60, 300) == 1);
+}
+
+// Прирост на секунду работы насоса определяется по максимуму показаний после установления
+static void test_gain_learning()
+{
+  wmodel_t model;
+  wmodelInit(&model);
+  const float true_gain = 0.1f;
+  uint32_t now = 0;
+  float moisture = 30.0f;
+  for (uint8_t episode = 0; episode < 5; episode++) {
+    wmodelObserve(&model, now, moisture, true, &inputs);
+    uint32_t pulse = wmodelPlan(&model, now, moisture, 40.0f, 0, 0);
+    now += pulse;
+    wmodelStop(&model, now);
+    moisture += true_gain * (float)pulse;
+    for (uint32_t t = 0; t <= CONFIG_WMODEL_SETTLE_TIME; t += 60) {
+      wmodelObserve(&model, now + t, moisture, false, &inputs);
+    };
+    now += CONFIG_WMODEL_SETTLE_TIME + 60;
+    moisture = 30.0f;
+  };
+  TEST_CHECK(model.gain_samples == 5);
+  // Поправка на высыхание за время полива завышает прирост не больше чем на несколько процентов
+  TEST_NEAR(model.gain, true_gain, true_gain * 0.05);
+}
+
+// Скорость высыхания сходится к фактической при постоянных условиях
+static void test_decay_learning()
+{
+  wmodel_t model;
+  wmodelInit(&model);
+  const float rate = 0.5f;
+  float moisture = 60.0f;
+  for (uint32_t now = 0; now < 7 * 24 * 3600; now += 600) {
+    wmodelObserve(&model, now, moisture, false, &inputs);
+    moisture -= rate * 600.0f / 3600.0f;
+  };
+  TEST_CHECK(model.decay_samples > 100);
+  TEST_NEAR(wmodelDecayRate(&model, &inputs), rate, 0.01);
+}
+
+static void test_pumping_blocks_decay()
+{
+  wmodel_t model;
+  wmodelInit(&model);
+  wmodelObserve(&model, 0, 50.0f, false, &inputs);
+  wmodelObserve(&model, 3600, 60.0f, true, &inputs);
+  wmodelObserve(&model, 7200, 59.0f, false, &inputs);
+  TEST_CHECK(model.decay_samples == 0);
+}
+
+int main()
+{
+  TEST_RUN(test_defaults);
+  TEST_RUN(test_plan);
+  TEST_RUN(test_gain_learning);
+  TEST_RUN(test_decay_learning);
+  TEST_RUN(test_pumping_blocks_decay);
+  return 0;
+}
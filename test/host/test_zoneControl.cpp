@@ -0,0 +1,358 @@
+#include "zoneControl.h"
+#include "hostTest.h"
+#include <stdlib.h>
+#include <time.h>
+
+// Решения по отдельным условиям и сезон работы зоны на модельном времени: цикл основной задачи (30 с) вызывает
+// zoneControl() так же, как wateringControl(); нагрузка включает насос импульсами pulse / cycle_interval,
+// почва высыхает с постоянной скоростью и набирает влажность, пока насос работает
+
+#define SIM_START                 1699920000      // 2023-11-14 00:00:00 UTC
+#define SIM_CYCLE                 30              // CONFIG_WATERING_TASK_CYCLE, с
+#define SIM_DAY                   (24*60*60)
+
+static zone_inputs_t inputsAt(time_t time, float moisture, bool state)
+{
+  zone_inputs_t inputs;
+  inputs.time = time;
+  inputs.now = (uint32_t)(time - SIM_START) + 100;
+  inputs.allowed = true;
+  inputs.state = state;
+  inputs.last_on = 0;
+  inputs.last_off = 0;
+  inputs.moisture = moisture;
+  inputs.soil_temp = 20.0;
+  inputs.sensor_ok = true;
+  inputs.inputs = { NAN, NAN, NAN };
+  return inputs;
+}
+
+static watering_zone_t zoneAllDay()
+{
+  watering_zone_t zone = WATERING_ZONE_DEFAULTS;
+  zone.timespan = 6002200U;
+  return zone;
+}
+
+// Включение на нижнем пороге, выключение на верхнем; температура почвы учитывается только при включении
+static void test_hysteresis()
+{
+  watering_zone_t zone = zoneAllDay();
+  time_t noon = SIM_START + 12*60*60;
+  zone_inputs_t inputs = inputsAt(noon, 30.5, false);
+  TEST_CHECK(!zoneDecide(&zone, &inputs));
+  inputs.moisture = 30.0;
+  TEST_CHECK(zoneDecide(&zone, &inputs));
+  inputs.soil_temp = 5.0;
+  TEST_CHECK(!zoneDecide(&zone, &inputs));
+  inputs.soil_temp = NAN;
+  TEST_CHECK(zoneDecide(&zone, &inputs));
+
+  inputs.state = true;
+  inputs.soil_temp = 5.0;
+  inputs.moisture = 49.9;
+  TEST_CHECK(zoneDecide(&zone, &inputs));
+  inputs.moisture = 50.0;
+  TEST_CHECK(!zoneDecide(&zone, &inputs));
+  // Нет показаний - полива по датчику нет
+  inputs.moisture = NAN;
+  TEST_CHECK(!zoneDecide(&zone, &inputs));
+}
+
+static void test_modes()
+{
+  watering_zone_t zone = zoneAllDay();
+  zone_inputs_t inputs = inputsAt(SIM_START + 12*60*60, NAN, false);
+  zone.mode = WATERING_FORCED;
+  TEST_CHECK(zoneDecide(&zone, &inputs));
+  zone.mode = WATERING_OFF;
+  inputs.moisture = 10.0;
+  TEST_CHECK(!zoneDecide(&zone, &inputs));
+  // Перелив, нет воды или блокировка запрещают полив в любом режиме
+  zone.mode = WATERING_FORCED;
+  inputs.allowed = false;
+  TEST_CHECK(!zoneDecide(&zone, &inputs));
+  zone.mode = WATERING_SENSORS;
+  TEST_CHECK(!zoneDecide(&zone, &inputs));
+}
+
+// Начало интервала включается, конец - нет; интервал через полночь; без синхронизации времени полива нет
+static void test_timespan()
+{
+  watering_zone_t zone = WATERING_ZONE_DEFAULTS;
+  zone_inputs_t inputs = inputsAt(SIM_START + 17*60*60 + 59*60, 20.0, false);
+  TEST_CHECK(!zoneDecide(&zone, &inputs));
+  inputs.time = SIM_START + 18*60*60;
+  TEST_CHECK(zoneDecide(&zone, &inputs));
+  inputs.time = SIM_START + 20*60*60 + 59*60;
+  TEST_CHECK(zoneDecide(&zone, &inputs));
+  inputs.time = SIM_START + 21*60*60;
+  TEST_CHECK(!zoneDecide(&zone, &inputs));
+
+  zone.timespan = 23000600U;
+  inputs.time = SIM_START + 23*60*60;
+  TEST_CHECK(zoneDecide(&zone, &inputs));
+  inputs.time = SIM_START + SIM_DAY + 5*60*60 + 59*60;
+  TEST_CHECK(zoneDecide(&zone, &inputs));
+  inputs.time = SIM_START + SIM_DAY + 6*60*60;
+  TEST_CHECK(!zoneDecide(&zone, &inputs));
+
+  inputs.time = 60;
+  TEST_CHECK(!zoneDecide(&zone, &inputs));
+  zone.timespan = 0;
+  inputs.time = SIM_START + 23*60*60;
+  TEST_CHECK(!zoneDecide(&zone, &inputs));
+}
+
+// Полив длится не дольше max_duration и повторяется не раньше, чем через max_duration после выключения
+static void test_max_duration()
+{
+  watering_zone_t zone = zoneAllDay();
+  time_t noon = SIM_START + 12*60*60;
+  zone_inputs_t inputs = inputsAt(noon, 20.0, true);
+  inputs.last_on = noon - 120*60;
+  TEST_CHECK(zoneDecide(&zone, &inputs));
+  inputs.last_on = noon - 120*60 - 1;
+  TEST_CHECK(!zoneDecide(&zone, &inputs));
+
+  inputs.state = false;
+  inputs.last_off = noon - 120*60;
+  TEST_CHECK(!zoneDecide(&zone, &inputs));
+  inputs.last_off = noon - 120*60 - 1;
+  TEST_CHECK(zoneDecide(&zone, &inputs));
+  // Время последнего выключения неизвестно - ограничения нет
+  inputs.last_off = 0;
+  TEST_CHECK(zoneDecide(&zone, &inputs));
+}
+
+// Модель зоны: почва, нагрузка и датчик
+typedef struct {
+  watering_zone_t zone;
+  zone_control_t  control;
+  time_t   time;
+  float    moisture;                // Фактическая влажность почвы, %
+  float    decay;                   // Высыхание, % в час
+  float    gain;                    // Прирост при работе насоса, % в секунду
+  bool     state;                   // Состояние нагрузки
+  time_t   last_on;
+  time_t   last_off;
+  time_t   pulse_started;           // Начало текущего импульса насоса
+  bool     sensor_ok;               // Датчик почвы исправен
+  bool     leak;
+  // Результаты
+  uint32_t sessions;
+  uint32_t outside;                 // Включений вне расписания
+  uint32_t pumped;                  // Время работы насоса, с
+  uint32_t learned;                 // Событий ZONE_EVENT_LEARNED
+  uint32_t switched;                // Событий ZONE_EVENT_FALLBACK
+  uint32_t plans;                   // Событий ZONE_EVENT_PLAN
+  float    min_moisture;
+  float    max_moisture;
+} sim_zone_t;
+
+static void simInit(sim_zone_t* sim, watering_mode_t mode, uint8_t features)
+{
+  sim->zone = zoneAllDay();
+  sim->zone.mode = mode;
+  zoneControlInit(&sim->control, features);
+  sim->time = SIM_START;
+  sim->moisture = 40.0;
+  sim->decay = 0.8;
+  sim->gain = 0.2;
+  sim->state = false;
+  sim->last_on = 0;
+  sim->last_off = 0;
+  sim->pulse_started = 0;
+  sim->sensor_ok = true;
+  sim->leak = false;
+  sim->sessions = 0;
+  sim->outside = 0;
+  sim->pumped = 0;
+  sim->learned = 0;
+  sim->switched = 0;
+  sim->plans = 0;
+  sim->min_moisture = 100.0;
+  sim->max_moisture = 0.0;
+}
+
+static void simCycle(sim_zone_t* sim)
+{
+  zone_inputs_t inputs = inputsAt(sim->time, sim->sensor_ok ? sim->moisture : NAN, sim->state);
+  inputs.allowed = !sim->leak;
+  inputs.last_on = sim->last_on;
+  inputs.last_off = sim->last_off;
+  inputs.sensor_ok = sim->sensor_ok;
+  uint8_t events;
+  bool newState = zoneControl(&sim->control, &sim->zone, &inputs, &events);
+  if (events & ZONE_EVENT_LEARNED) sim->learned++;
+  if (events & ZONE_EVENT_FALLBACK) sim->switched++;
+  if (events & ZONE_EVENT_PLAN) sim->plans++;
+  if (newState && !sim->state) {
+    struct tm ti;
+    localtime_r(&sim->time, &ti);
+    if ((ti.tm_hour < 6) || (ti.tm_hour >= 22)) sim->outside++;
+    sim->sessions++;
+    sim->last_on = sim->time;
+    sim->pulse_started = sim->time;
+  } else if (!newState && sim->state) {
+    sim->last_off = sim->time;
+  };
+  sim->state = newState;
+}
+
+// Посекундная модель почвы между циклами основной задачи
+static void simRun(sim_zone_t* sim, uint32_t seconds)
+{
+  for (uint32_t s = 0; s < seconds; s++) {
+    if ((s % SIM_CYCLE) == 0) simCycle(sim);
+    sim->moisture -= sim->decay / 3600;
+    if (sim->state) {
+      uint32_t phase = (uint32_t)(sim->time - sim->pulse_started) % (sim->control.pulse + sim->zone.cycle_interval);
+      if (phase < sim->control.pulse) {
+        sim->moisture += sim->gain;
+        sim->pumped++;
+      };
+    };
+    if (sim->moisture < sim->min_moisture) sim->min_moisture = sim->moisture;
+    if (sim->moisture > sim->max_moisture) sim->max_moisture = sim->moisture;
+    sim->time++;
+  };
+}
+
+// Два месяца по датчику: влажность держится между порогами (ночью - с запасом на высыхание вне расписания),
+// полив не выходит за расписание, расписание для работы без датчика изучается
+static void test_season_sensors()
+{
+  static sim_zone_t sim;
+  simInit(&sim, WATERING_SENSORS, ZONE_FEATURE_FALLBACK);
+  simRun(&sim, 60 * SIM_DAY);
+  printf("sensors: %u sessions, %u s pumped, moisture %.1f..%.1f, interval %.0f s, duration %.0f s\n",
+    (unsigned)sim.sessions, (unsigned)sim.pumped, sim.min_moisture, sim.max_moisture,
+    sim.control.fallback.interval, sim.control.fallback.duration);
+  TEST_CHECK(sim.sessions >= 40);
+  TEST_CHECK(sim.outside == 0);
+  TEST_CHECK(sim.min_moisture > sim.zone.moisture_min - 8 * sim.decay - 1.0);
+  TEST_CHECK(sim.max_moisture < sim.zone.moisture_max + sim.control.pulse * sim.gain + 1.0);
+  TEST_CHECK(sim.switched == 0);
+  TEST_CHECK(!sim.control.fallback.active);
+  // Каждый полив, кроме первого, дает интервал, и каждый законченный - длительность
+  TEST_CHECK(sim.control.fallback.intervals == sim.sessions - 1);
+  TEST_CHECK(sim.control.fallback.sessions >= sim.sessions - 1);
+  TEST_CHECK(sim.learned >= 2 * sim.sessions - 2);
+  TEST_CHECK(zoneFallbackLearned(&sim.control.fallback));
+  TEST_CHECK(sim.control.fallback.interval > 4*60*60);
+  TEST_CHECK(sim.control.fallback.duration > 0);
+  TEST_CHECK(sim.control.fallback.duration < sim.zone.max_duration * 60);
+}
+
+// Датчик отказал на 10 дней: полив идет по изученному расписанию и не обучает его, после восстановления
+// зона снова поливается по датчику
+static void test_season_fallback()
+{
+  static sim_zone_t sim;
+  simInit(&sim, WATERING_SENSORS, ZONE_FEATURE_FALLBACK);
+  simRun(&sim, 20 * SIM_DAY);
+  TEST_CHECK(zoneFallbackLearned(&sim.control.fallback));
+  watering_fallback_t learned = sim.control.fallback;
+  uint32_t sessions = sim.sessions;
+
+  sim.sensor_ok = false;
+  simRun(&sim, 10 * SIM_DAY);
+  TEST_CHECK(sim.switched == 1);
+  TEST_CHECK(sim.control.fallback.active);
+  TEST_CHECK(sim.control.fallback.intervals == learned.intervals);
+  TEST_CHECK(sim.control.fallback.sessions == learned.sessions);
+  uint32_t fallbackSessions = sim.sessions - sessions;
+  uint32_t expected = 10 * SIM_DAY / learned.interval;
+  printf("fallback: %u sessions in 10 days, expected about %u, moisture %.1f..%.1f\n",
+    (unsigned)fallbackSessions, (unsigned)expected, sim.min_moisture, sim.max_moisture);
+  // Полив вне расписания суток переносится, поэтому сеансов может быть меньше, но не больше изученного
+  TEST_CHECK(fallbackSessions >= expected / 2);
+  TEST_CHECK(fallbackSessions <= expected + 1);
+  TEST_CHECK(sim.outside == 0);
+  TEST_CHECK(sim.moisture > 10.0);
+
+  sim.sensor_ok = true;
+  uint32_t intervals = sim.control.fallback.intervals;
+  simRun(&sim, 10 * SIM_DAY);
+  TEST_CHECK(sim.switched == 2);
+  TEST_CHECK(!sim.control.fallback.active);
+  // Первый полив после восстановления интервала не дает: предыдущий был по расписанию
+  TEST_CHECK(sim.control.fallback.intervals > intervals);
+  TEST_CHECK(sim.control.fallback.intervals < intervals + (sim.sessions - sessions - fallbackSessions));
+}
+
+// Датчик неисправен с самого начала: расписание не изучено, полива нет
+static void test_fallback_not_learned()
+{
+  static sim_zone_t sim;
+  simInit(&sim, WATERING_SENSORS, ZONE_FEATURE_FALLBACK);
+  sim.sensor_ok = false;
+  simRun(&sim, 3 * SIM_DAY);
+  TEST_CHECK(sim.switched == 1);
+  TEST_CHECK(sim.sessions == 0);
+  TEST_CHECK(sim.learned == 0);
+  // Без ZONE_FEATURE_FALLBACK неисправный датчик просто не дает поливать, событий нет
+  simInit(&sim, WATERING_SENSORS, 0);
+  sim.sensor_ok = false;
+  simRun(&sim, 3 * SIM_DAY);
+  TEST_CHECK(sim.switched == 0);
+  TEST_CHECK(sim.sessions == 0);
+}
+
+// Перелив во время полива выключает насос на ближайшем цикле
+static void test_leak_stops()
+{
+  static sim_zone_t sim;
+  simInit(&sim, WATERING_FORCED, ZONE_FEATURE_FALLBACK);
+  sim.zone.max_duration = 0;
+  simRun(&sim, 7*60*60);
+  TEST_CHECK(sim.state);
+  sim.leak = true;
+  simRun(&sim, SIM_CYCLE);
+  TEST_CHECK(!sim.state);
+  simRun(&sim, SIM_DAY);
+  TEST_CHECK(sim.sessions == 1);
+  // Принудительный полив расписание без датчика не обучает
+  TEST_CHECK(sim.learned == 0);
+}
+
+// Модель почвы: план импульсов при каждом запуске, полив заканчивается по плану, перелива выше порога почти нет
+static void test_season_model()
+{
+  static sim_zone_t sim;
+  simInit(&sim, WATERING_MODEL, ZONE_FEATURE_FALLBACK | ZONE_FEATURE_MODEL);
+  sim.gain = 0.1;
+  simRun(&sim, 30 * SIM_DAY);
+  printf("model: %u sessions, %u plans, gain %.4f (%u samples), moisture %.1f..%.1f\n",
+    (unsigned)sim.sessions, (unsigned)sim.plans, sim.control.model.gain, (unsigned)sim.control.model.gain_samples,
+    sim.min_moisture, sim.max_moisture);
+  TEST_CHECK(sim.sessions >= 20);
+  TEST_CHECK(sim.plans == sim.sessions);
+  TEST_CHECK(sim.outside == 0);
+  TEST_CHECK(sim.control.model.gain_samples > 0);
+  TEST_NEAR(sim.control.model.gain, sim.gain, sim.gain * 0.2);
+  TEST_CHECK(sim.max_moisture < sim.zone.moisture_max + 2.0);
+  TEST_CHECK(zoneFallbackLearned(&sim.control.fallback));
+
+  // Вне режима модели импульс - из настроек зоны
+  sim.zone.mode = WATERING_SENSORS;
+  simRun(&sim, SIM_CYCLE);
+  TEST_CHECK(sim.control.pulse == sim.zone.cycle_time);
+}
+
+int main()
+{
+  setenv("TZ", "UTC", 1);
+  tzset();
+  TEST_RUN(test_hysteresis);
+  TEST_RUN(test_modes);
+  TEST_RUN(test_timespan);
+  TEST_RUN(test_max_duration);
+  TEST_RUN(test_season_sensors);
+  TEST_RUN(test_season_fallback);
+  TEST_RUN(test_fallback_not_learned);
+  TEST_RUN(test_leak_stops);
+  TEST_RUN(test_season_model);
+  return 0;
+}